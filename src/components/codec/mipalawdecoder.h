@@ -31,17 +31,17 @@
 #define MIPALAWDECODER_H
 
 #include "mipconfig.h"
-#include "mipcomponent.h"
+#include "mipoutputmessagequeuewithstate.h"
+#include "mippacketlossconcealer.h"
 #include "miptime.h"
-#include <list>
-
-class MIPRaw16bitAudioMessage;
 
 /** An a-law decoder.
  *  This component accepts a-law encoded audio messages and produces message
- *  raw audio messages using 16 bit signed native endian encoding.
+ *  raw audio messages using 16 bit signed native endian encoding. Messages which
+ *  request concealment of lost audio (see MIPEncodedAudioMessage::setConcealment) are
+ *  handled by a MIPPacketLossConcealer instance which is kept for each source.
  */
-class EMIPLIB_IMPORTEXPORT MIPALawDecoder : public MIPComponent
+class EMIPLIB_IMPORTEXPORT MIPALawDecoder : public MIPOutputMessageQueueWithState
 {
 public:
 	MIPALawDecoder();
@@ -54,17 +54,19 @@ public:
 	bool destroy();
 
 	bool push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg);
-	bool pull(const MIPComponentChain &chain, int64_t iteration, MIPMessage **pMsg);
 private:
-	void clearMessages();
-	
-	bool m_init;
-	int64_t m_prevIteration;
+	class ALawStateInfo : public MIPStateInfo
+	{
+	public:
+		ALawStateInfo()								{ }
+		~ALawStateInfo()							{ }
 
-	std::list<MIPRaw16bitAudioMessage *> m_messages;
-	std::list<MIPRaw16bitAudioMessage *>::const_iterator m_msgIt;
+		MIPPacketLossConcealer &getConcealer(int sampRate, int channels)	{ if (m_concealer.getSamplingRate() != sampRate || m_concealer.getNumberOfChannels() != channels) m_concealer.init(sampRate, channels); return m_concealer; }
+	private:
+		MIPPacketLossConcealer m_concealer;
+	};
 
-	static int16_t m_decompressionTable[256];
+	bool m_init;
 };	
 
 #endif // MIPALAWDECODER_H
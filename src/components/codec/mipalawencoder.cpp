@@ -26,6 +26,9 @@
 #include "mipalawencoder.h"
 #include "mipencodedaudiomessage.h"
 #include "miprawaudiomessage.h"
+#include "mipg711.h"
+#include "mipcomponentchain.h"
+#include "mipmessagearena.h"
 
 #include "mipdebug.h"
 
@@ -98,42 +101,11 @@ bool MIPALawEncoder::push(const MIPComponentChain &chain, int64_t iteration, MIP
 	int numBytes = numFrames*numChannels;
 	int sampRate = pAudioMsg->getSamplingRate();
 	const int16_t *pSamples = (const int16_t *)pAudioMsg->getFrames();
-	uint8_t *pBuffer = new uint8_t[numBytes];
+	uint8_t *pBuffer = chain.getMessageArena().allocateArray<uint8_t>(numBytes);
 
-	for (int i = 0 ; i < numBytes ; i++)
-	{
-		int samp, seg, seglimit, sign, mant;
-		unsigned char pcmA;
-
-		samp = pSamples[i];
-
-		sign = (samp >= 0);
-
-		if(!sign)
-			samp = -samp;
-
-#define plusbits 3
-#define MAX_MAGNITUDE ((unsigned)(1 << (12 + plusbits)) - 1)
-
-		if(samp > MAX_MAGNITUDE)
-			samp = MAX_MAGNITUDE;
+	MIPG711::encodeALaw(pSamples, pBuffer, numBytes);
 
-		seglimit = 1 << (5 + plusbits);
-		seg = 0;
-
-		while(seglimit <= samp)
-		{
-			seglimit <<= 1;
-			seg++;
-		}
-
-		mant = (samp >> ((seg == 0) ? 1 + plusbits : seg + plusbits)) & 0xF;
-		pcmA = (sign << 7)|(seg << 4) | mant;
-
-		pBuffer[i] = pcmA ^ 0x55;
-	}
-	
-	MIPEncodedAudioMessage *pNewMsg = new MIPEncodedAudioMessage(MIPENCODEDAUDIOMESSAGE_TYPE_ALAW, sampRate, numChannels, numFrames, pBuffer, numBytes, true);
+	MIPEncodedAudioMessage *pNewMsg = chain.getMessageArena().createMessage<MIPEncodedAudioMessage>(MIPENCODEDAUDIOMESSAGE_TYPE_ALAW, sampRate, numChannels, numFrames, pBuffer, numBytes, false);
 	pNewMsg->copyMediaInfoFrom(*pAudioMsg); // copy time and sourceID
 	m_messages.push_back(pNewMsg);
 		
@@ -172,10 +144,7 @@ bool MIPALawEncoder::pull(const MIPComponentChain &chain, int64_t iteration, MIP
 
 void MIPALawEncoder::clearMessages()
 {
-	std::list<MIPEncodedAudioMessage *>::iterator it;
-
-	for (it = m_messages.begin() ; it != m_messages.end() ; it++)
-		delete (*it);
+	// The messages themselves are stored in the chain's message arena
 	m_messages.clear();
 	m_msgIt = m_messages.begin();
 }
@@ -33,7 +33,7 @@
 #include "mipconfig.h"
 #include "mipcomponent.h"
 #include "miptime.h"
-#include <list>
+#include <vector>
 
 class MIPEncodedAudioMessage;
 
@@ -63,8 +63,8 @@ private:
 	bool m_init;
 	int64_t m_prevIteration;
 
-	std::list<MIPEncodedAudioMessage *> m_messages;
-	std::list<MIPEncodedAudioMessage *>::const_iterator m_msgIt;
+	std::vector<MIPEncodedAudioMessage *> m_messages;
+	std::vector<MIPEncodedAudioMessage *>::const_iterator m_msgIt;
 };	
 
 #endif // MIPALAWENCODER_H
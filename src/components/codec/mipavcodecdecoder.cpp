@@ -53,7 +53,7 @@ MIPAVCodecDecoder::~MIPAVCodecDecoder()
 	destroy();
 }
 	
-bool MIPAVCodecDecoder::init(bool waitForKeyframe)
+bool MIPAVCodecDecoder::init(bool waitForKeyframe, int numThreads)
 {
 	if (m_init)
 	{
@@ -61,17 +61,22 @@ bool MIPAVCodecDecoder::init(bool waitForKeyframe)
 		return false;
 	}
 
-	m_pCodec = avcodec_find_decoder(AV_CODEC_ID_H263);
-	if (m_pCodec == 0)
+	m_pH263Codec = avcodec_find_decoder(AV_CODEC_ID_H263);
+	if (m_pH263Codec == 0)
 	{
 		setErrorString(MIPAVCODECDECODER_ERRSTR_CANTFINDCODEC);
 		return false;
 	}
 
+	// These are optional, depending on how libavcodec was built
+	m_pH264Codec = avcodec_find_decoder(AV_CODEC_ID_H264);
+	m_pVP8Codec = avcodec_find_decoder(AV_CODEC_ID_VP8);
+
 	m_pFrame = av_frame_alloc();
 	
 	m_init = true;
 	m_waitForKeyframe = waitForKeyframe;
+	m_numThreads = numThreads;
 
 	MIPOutputMessageQueueWithState::init(60.0); // TODO make this delay configurable
 
@@ -103,12 +108,24 @@ bool MIPAVCodecDecoder::push(const MIPComponentChain &chain, int64_t iteration,
 		return false;
 	}
 
-	if (!(pMsg->getMessageType() == MIPMESSAGE_TYPE_VIDEO_ENCODED && pMsg->getMessageSubtype() == MIPENCODEDVIDEOMESSAGE_TYPE_H263P))
+	if (pMsg->getMessageType() != MIPMESSAGE_TYPE_VIDEO_ENCODED)
 	{
 		setErrorString(MIPAVCODECDECODER_ERRSTR_BADMESSAGE);
 		return false;
 	}
 
+	uint32_t subtype = pMsg->getMessageSubtype();
+	AVCodec *pCodec = getCodec(subtype);
+
+	if (pCodec == 0)
+	{
+		if (subtype == MIPENCODEDVIDEOMESSAGE_TYPE_H264 || subtype == MIPENCODEDVIDEOMESSAGE_TYPE_VP8)
+			setErrorString(MIPAVCODECDECODER_ERRSTR_CANTFINDCODEC);
+		else
+			setErrorString(MIPAVCODECDECODER_ERRSTR_BADMESSAGE);
+		return false;
+	}
+
 	MIPOutputMessageQueueWithState::checkIteration(iteration);
 
 	MIPEncodedVideoMessage *pEncMsg = (MIPEncodedVideoMessage *)pMsg;
@@ -121,7 +138,7 @@ bool MIPAVCodecDecoder::push(const MIPComponentChain &chain, int64_t iteration,
 	{
 		AVCodecContext *pContext;
 
-		pContext = avcodec_alloc_context3(m_pCodec);
+		pContext = avcodec_alloc_context3(pCodec);
 		if (!pContext)
 		{
 			setErrorString(MIPAVCODECDECODER_ERRSTR_CANTCREATECONTEXT);
@@ -130,8 +147,11 @@ bool MIPAVCodecDecoder::push(const MIPComponentChain &chain, int64_t iteration,
 		
 		pContext->width = 0; // let the codec work out the dimensions
 		pContext->height = 0;
+		pContext->thread_count = m_numThreads;
+		pContext->thread_type = FF_THREAD_SLICE;
+		pContext->flags |= AV_CODEC_FLAG_LOW_DELAY;
 
-		if (avcodec_open2(pContext, m_pCodec, nullptr) < 0)
+		if (avcodec_open2(pContext, pCodec, nullptr) < 0)
 		{
 			av_free(pContext);
 			setErrorString(MIPAVCODECDECODER_ERRSTR_CANTCREATENEWDECODER);
@@ -142,7 +162,7 @@ bool MIPAVCodecDecoder::push(const MIPComponentChain &chain, int64_t iteration,
 		//SwsContext *pSwsContext = sws_getContext(width, height, pContext->pix_fmt, width, height, PIX_FMT_YUV420P, SWS_FAST_BILINEAR, 0, 0, 0);
 		//pInf = new DecoderInfo(width, height, pContext, pSwsContext);
 
-		pInf = new DecoderInfo(width, height, pContext, 0);
+		pInf = new DecoderInfo(width, height, subtype, pContext, 0);
 
 		if (!MIPOutputMessageQueueWithState::addState(sourceID, pInf))
 		{
@@ -152,7 +172,7 @@ bool MIPAVCodecDecoder::push(const MIPComponentChain &chain, int64_t iteration,
 	}
 	else
 	{
-		if (!(pInf->getWidth() == width && pInf->getHeight() == height))
+		if (!(pInf->getWidth() == width && pInf->getHeight() == height && pInf->getSubtype() == subtype))
 		{
 			return true; // ignore message
 		}
@@ -203,24 +223,32 @@ bool MIPAVCodecDecoder::push(const MIPComponentChain &chain, int64_t iteration,
 
 	if (!skip)
 	{
-		// adjust width and height settings
+		// Use the dimensions of the decoded frame itself: the RTP depacketizers don't
+		// know the resolution, so a change (new SPS, VP8 keyframe) only shows up here
 
-		width = pInf->getContext()->width;
-		height = pInf->getContext()->height;
+		width = m_pFrame->width;
+		height = m_pFrame->height;
 
-		size_t dataSize = (width*height*3)/2;
-		uint8_t *pData = new uint8_t [dataSize];
+		AVPixelFormat pixFmt = (AVPixelFormat)m_pFrame->format;
+
+		if (width <= 0 || height <= 0)
+			return true; // nothing usable, ignore
 
 		SwsContext *pSwsContext = pInf->getSwsContext();
 
-		// TODO: check if width and height changed somehow?
-		if (pSwsContext == 0)
+		if (!pInf->isSwsContextFor(width, height, pixFmt))
 		{
-			pSwsContext = sws_getContext(width, height, pInf->getContext()->pix_fmt, width, height, AV_PIX_FMT_YUV420P, SWS_FAST_BILINEAR, 0, 0, 0);
+			pSwsContext = sws_getCachedContext(pSwsContext, width, height, pixFmt, width, height, AV_PIX_FMT_YUV420P, SWS_FAST_BILINEAR, 0, 0, 0);
+			pInf->setSwsContext(pSwsContext, width, height, pixFmt);
 
-			pInf->setSwsContext(pSwsContext);
+			if (pSwsContext == 0)
+				return true; // can't convert this format, ignore
 		}
 
+		size_t dataSize = (width*height*3)/2;
+		MIPSharedBuffer *pBuffer = MIPSharedBuffer::allocate(dataSize);
+		uint8_t *pData = pBuffer->getData();
+
 		uint8_t *pDstPointers[3];
 		int dstStrides[3];
 	
@@ -233,7 +261,7 @@ bool MIPAVCodecDecoder::push(const MIPComponentChain &chain, int64_t iteration,
 
 		sws_scale(pSwsContext, m_pFrame->data, m_pFrame->linesize, 0, height, pDstPointers, dstStrides);
 	
-		MIPRawYUV420PVideoMessage *pNewMsg = new MIPRawYUV420PVideoMessage(width, height, pData, true);
+		MIPRawYUV420PVideoMessage *pNewMsg = new MIPRawYUV420PVideoMessage(width, height, pBuffer);
 
 		pNewMsg->setSourceID(sourceID);
 		pNewMsg->setTime(pEncMsg->getTime());
@@ -244,6 +272,20 @@ bool MIPAVCodecDecoder::push(const MIPComponentChain &chain, int64_t iteration,
 	return true;
 }
 
+AVCodec *MIPAVCodecDecoder::getCodec(uint32_t subtype)
+{
+	switch (subtype)
+	{
+	case MIPENCODEDVIDEOMESSAGE_TYPE_H263P:
+		return m_pH263Codec;
+	case MIPENCODEDVIDEOMESSAGE_TYPE_H264:
+		return m_pH264Codec;
+	case MIPENCODEDVIDEOMESSAGE_TYPE_VP8:
+		return m_pVP8Codec;
+	}
+	return 0;
+}
+
 void MIPAVCodecDecoder::initAVCodec()
 {
 	avcodec_register_all();
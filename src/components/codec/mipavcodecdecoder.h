@@ -49,9 +49,11 @@ extern "C"
 
 class MIPRawYUV420PVideoMessage;
 
-/** This component is a libavcodec based H.263+ decoder.
- *  This component is a libavcodec based H.263+ decoder. It accepts encoded video messages with
- *  subtype MIPENCODEDVIDEOMESSAGE_TYPE_H263P and creates raw video messages in YUV420P format.
+/** This component is a libavcodec based H.263+, H.264 and VP8 decoder.
+ *  This component is a libavcodec based H.263+, H.264 and VP8 decoder. It accepts encoded video 
+ *  messages with subtype MIPENCODEDVIDEOMESSAGE_TYPE_H263P, MIPENCODEDVIDEOMESSAGE_TYPE_H264 or
+ *  MIPENCODEDVIDEOMESSAGE_TYPE_VP8 and creates raw video messages in YUV420P format. A separate
+ *  decoder is created for each source, based on the subtype of the first message of that source.
  */
 class EMIPLIB_IMPORTEXPORT MIPAVCodecDecoder : public MIPOutputMessageQueueWithState
 {
@@ -64,8 +66,11 @@ public:
 	 *  \param waitForKeyframe If set to true, frames will only be output after a key frame
 	 *                         has been received. Looks cleaner, but you may have to wait a
 	 *                         bit longer to actually see something.
+	 *  \param numThreads The number of threads each decoder may use. If zero, libavcodec
+	 *                    will choose the number of threads itself. Only slice based threading
+	 *                    is used, to avoid the extra delay of frame based threading.
 	 */
-	bool init(bool waitForKeyframe);
+	bool init(bool waitForKeyframe, int numThreads = 0);
 
 	/** De-initialize the component. */
 	bool destroy();
@@ -82,12 +87,16 @@ private:
 	class DecoderInfo : public MIPStateInfo
 	{
 	public:
-		DecoderInfo(int w, int h, AVCodecContext *pContext, SwsContext *pSwsContext)
+		DecoderInfo(int w, int h, uint32_t subtype, AVCodecContext *pContext, SwsContext *pSwsContext)
 		{
+			m_subtype = subtype;
 			m_width = w;
 			m_height = h;
 			m_pContext = pContext;
 			m_pSwsContext = pSwsContext;
+			m_swsWidth = 0;
+			m_swsHeight = 0;
+			m_swsFormat = AV_PIX_FMT_NONE;
 			m_gotKeyframe = false;
 		}
 
@@ -101,24 +110,35 @@ private:
 
 		int getWidth() const								{ return m_width; }
 		int getHeight() const								{ return m_height; }
+		uint32_t getSubtype() const							{ return m_subtype; }
 		AVCodecContext *getContext()						{ return m_pContext; }
 		SwsContext *getSwsContext()							{ return m_pSwsContext; }
 		void setSwsContext(SwsContext *pCtx)				{ m_pSwsContext = pCtx; }
+		bool isSwsContextFor(int w, int h, AVPixelFormat fmt) const			{ return m_pSwsContext != 0 && m_swsWidth == w && m_swsHeight == h && m_swsFormat == fmt; }
+		void setSwsContext(SwsContext *pCtx, int w, int h, AVPixelFormat fmt)		{ m_pSwsContext = pCtx; m_swsWidth = w; m_swsHeight = h; m_swsFormat = fmt; }
 		bool receivedKeyframe() const						{ return m_gotKeyframe; }
 		void setReceivedKeyframe(bool f)					{ m_gotKeyframe = f; }
 	private:
 		int m_width, m_height;
+		uint32_t m_subtype;
 		AVCodecContext *m_pContext;
 		SwsContext *m_pSwsContext;
+		int m_swsWidth, m_swsHeight;
+		AVPixelFormat m_swsFormat;
 		bool m_gotKeyframe;
 	};
 	
+	AVCodec *getCodec(uint32_t subtype);
+
 	bool m_init;
 	
-	AVCodec *m_pCodec;
+	AVCodec *m_pH263Codec;
+	AVCodec *m_pH264Codec;
+	AVCodec *m_pVP8Codec;
 	AVFrame *m_pFrame;
 
 	bool m_waitForKeyframe;
+	int m_numThreads;
 };
 
 #endif // MIPCONFIG_SUPPORT_AVCODEC
@@ -32,6 +32,7 @@
 
 extern "C" {
 #include <libavutil/imgutils.h>
+#include <libavutil/opt.h>
 }
 
 #include "mipdebug.h"
@@ -46,6 +47,7 @@ extern "C" {
 #define MIPAVCODECENCODER_ERRSTR_BADDIMENSIONS					"Invalid image width or height"
 #define MIPAVCODECENCODER_ERRSTR_CANTENCODE						"Error encoding frame"
 #define MIPAVCODECENCODER_ERRSTR_CANTFILLPICTURE				"Can't fill picture"
+#define MIPAVCODECENCODER_ERRSTR_BADCODECTYPE					"Invalid codec type"
 
 MIPAVCodecEncoder::MIPAVCodecEncoder() : MIPOutputMessageQueue("MIPAVCodecEncoder")
 {
@@ -57,7 +59,7 @@ MIPAVCodecEncoder::~MIPAVCodecEncoder()
 	destroy();
 }
 
-bool MIPAVCodecEncoder::init(int width, int height, real_t framerate, int bitrate)
+bool MIPAVCodecEncoder::init(int width, int height, real_t framerate, int bitrate, CodecType codecType, int numThreads)
 {
 	if (m_pCodec != 0)
 	{
@@ -73,7 +75,29 @@ bool MIPAVCodecEncoder::init(int width, int height, real_t framerate, int bitrat
 		return false;
 	}
 		
-	m_pCodec = avcodec_find_encoder(AV_CODEC_ID_H263P);
+	AVCodecID codecID;
+	uint32_t msgSubtype;
+
+	switch (codecType)
+	{
+	case H263P:
+		codecID = AV_CODEC_ID_H263P;
+		msgSubtype = MIPENCODEDVIDEOMESSAGE_TYPE_H263P;
+		break;
+	case H264:
+		codecID = AV_CODEC_ID_H264;
+		msgSubtype = MIPENCODEDVIDEOMESSAGE_TYPE_H264;
+		break;
+	case VP8:
+		codecID = AV_CODEC_ID_VP8;
+		msgSubtype = MIPENCODEDVIDEOMESSAGE_TYPE_VP8;
+		break;
+	default:
+		setErrorString(MIPAVCODECENCODER_ERRSTR_BADCODECTYPE);
+		return false;
+	}
+
+	m_pCodec = avcodec_find_encoder(codecID);
 	if (m_pCodec == 0)
 	{
 		setErrorString(MIPAVCODECENCODER_ERRSTR_CANTFINDCODEC);
@@ -92,9 +116,32 @@ bool MIPAVCodecEncoder::init(int width, int height, real_t framerate, int bitrat
 		m_pContext->bit_rate = bitrate;
 		m_pContext->bit_rate_tolerance = bitrate/20; // 5%
 	}
+
+	// Each frame should be output as soon as it's encoded: no B-frames, and
+	// only slice threading (frame threading adds a delay of one frame per thread)
+	m_pContext->max_b_frames = 0;
+	m_pContext->thread_count = numThreads;
+	m_pContext->thread_type = FF_THREAD_SLICE;
+
+	if (codecType == H264)
+	{
+		// Don't set AV_CODEC_FLAG_GLOBAL_HEADER, we need the SPS and PPS in-band
+		m_pContext->gop_size = (int)(framerate*2.0+0.5);
+		av_opt_set(m_pContext->priv_data, "preset", "veryfast", 0);
+		av_opt_set(m_pContext->priv_data, "tune", "zerolatency", 0);
+		av_opt_set(m_pContext->priv_data, "profile", "baseline", 0);
+	}
+	else if (codecType == VP8)
+	{
+		m_pContext->gop_size = (int)(framerate*2.0+0.5);
+		av_opt_set(m_pContext->priv_data, "deadline", "realtime", 0);
+		av_opt_set_int(m_pContext->priv_data, "cpu-used", 8, 0);
+		av_opt_set_int(m_pContext->priv_data, "lag-in-frames", 0, 0);
+	}
 	
 	if (avcodec_open2(m_pContext, m_pCodec, nullptr) < 0)
 	{
+		av_free(m_pContext);
 		m_pCodec = 0;
 		setErrorString(MIPAVCODECENCODER_ERRSTR_CANTINITCONTEXT);
 		return false;
@@ -107,6 +154,7 @@ bool MIPAVCodecEncoder::init(int width, int height, real_t framerate, int bitrat
 	
 	m_width = width;
 	m_height = height;
+	m_msgSubtype = msgSubtype;
 	
 	MIPOutputMessageQueue::init();
 
@@ -193,7 +241,7 @@ bool MIPAVCodecEncoder::push(const MIPComponentChain &chain, int64_t iteration,
 	}
 	
 	uint8_t *pData = new uint8_t [pkt.size];
-	MIPEncodedVideoMessage *pNewMsg = new MIPEncodedVideoMessage(MIPENCODEDVIDEOMESSAGE_TYPE_H263P, m_width, m_height, pData, pkt.size, true);
+	MIPEncodedVideoMessage *pNewMsg = new MIPEncodedVideoMessage(m_msgSubtype, m_width, m_height, pData, pkt.size, true);
 	memcpy(pData, pkt.data, pkt.size);
 	av_packet_unref(&pkt);
 
@@ -42,14 +42,26 @@ extern "C" {
 
 class MIPEncodedVideoMessage;
 
-/** A libavcodec based H.263+ encoder.
- *  This component is a H.263+ encoder, based on the libavcodec library. It accepts
+/** A libavcodec based H.263+, H.264 or VP8 encoder.
+ *  This component is a video encoder, based on the libavcodec library. It accepts
  *  raw video messages in YUV420P format and creates encoded video messages with
- *  subtype MIPENCODEDVIDEOMESSAGE_TYPE_H263P.
+ *  subtype MIPENCODEDVIDEOMESSAGE_TYPE_H263P, MIPENCODEDVIDEOMESSAGE_TYPE_H264 or
+ *  MIPENCODEDVIDEOMESSAGE_TYPE_VP8. The H.264 and VP8 encoders are configured for
+ *  low latency: no B-frames or look-ahead are used, so that each input frame 
+ *  immediately produces an encoded frame, and only slice based threading is used
+ *  since frame based threading would delay the output by a number of frames.
  */
 class EMIPLIB_IMPORTEXPORT MIPAVCodecEncoder : public MIPOutputMessageQueue
 {
 public:
+	/** Used to select the compression algorithm. */
+	enum CodecType
+	{
+		H263P,		/**< H.263+ compression. */
+		H264,		/**< H.264 compression, producing an Annex B byte stream with in-band parameter sets. */
+		VP8		/**< VP8 compression. */
+	};
+
 	MIPAVCodecEncoder();
 	~MIPAVCodecEncoder();
 
@@ -60,8 +72,11 @@ public:
 	 *  \param framerate The framerate.
 	 *  \param bitrate The bitrate generated by the encoder. If the value is zero or
 	 *                 negative, a default value is used.
+	 *  \param codecType The compression algorithm to use.
+	 *  \param numThreads The number of threads the codec may use to encode a frame. If
+	 *                    zero, libavcodec will choose the number of threads itself.
 	 */
-	bool init(int width, int height, real_t framerate, int bitrate = 0);
+	bool init(int width, int height, real_t framerate, int bitrate = 0, CodecType codecType = H263P, int numThreads = 0);
 
 	/** De-initializes the encoder. */
 	bool destroy();
@@ -81,6 +96,7 @@ private:
 	AVCodecContext *m_pContext;
 	AVFrame *m_pFrame;
 	int m_width, m_height;
+	uint32_t m_msgSubtype;
 };
 
 #endif // MIPCONFIG_SUPPORT_AVCODEC
@@ -0,0 +1,149 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+#include "mipconfig.h"
+#include "mipcomfortnoisedecoder.h"
+#include "mipencodedaudiomessage.h"
+#include "miprawaudiomessage.h"
+#include <vector>
+
+#include "mipdebug.h"
+
+#define MIPCOMFORTNOISEDECODER_ERRSTR_NOTINIT			"Not initialized"
+#define MIPCOMFORTNOISEDECODER_ERRSTR_ALREADYINIT		"Already initialized"
+#define MIPCOMFORTNOISEDECODER_ERRSTR_BADMESSAGE		"Only comfort noise messages are accepted"
+
+MIPComfortNoiseDecoder::MIPComfortNoiseDecoder() : MIPOutputMessageQueueWithState("MIPComfortNoiseDecoder")
+{
+	m_init = false;
+	m_floatSamples = false;
+}
+
+MIPComfortNoiseDecoder::~MIPComfortNoiseDecoder()
+{
+	destroy();
+}
+
+bool MIPComfortNoiseDecoder::init(bool floatSamples)
+{
+	if (m_init)
+	{
+		setErrorString(MIPCOMFORTNOISEDECODER_ERRSTR_ALREADYINIT);
+		return false;
+	}
+	
+	MIPOutputMessageQueueWithState::init(60.0);
+	m_floatSamples = floatSamples;
+	m_init = true;
+	
+	return true;
+}
+
+bool MIPComfortNoiseDecoder::destroy()
+{
+	if (!m_init)
+	{
+		setErrorString(MIPCOMFORTNOISEDECODER_ERRSTR_NOTINIT);
+		return false;
+	}
+	
+	MIPOutputMessageQueueWithState::clear();
+	m_init = false;
+
+	return true;
+}
+
+bool MIPComfortNoiseDecoder::push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg)
+{
+	if (!m_init)
+	{
+		setErrorString(MIPCOMFORTNOISEDECODER_ERRSTR_NOTINIT);
+		return false;
+	}
+
+	if (!(pMsg->getMessageType() == MIPMESSAGE_TYPE_AUDIO_ENCODED && pMsg->getMessageSubtype() == MIPENCODEDAUDIOMESSAGE_TYPE_CN) ) 
+	{
+		setErrorString(MIPCOMFORTNOISEDECODER_ERRSTR_BADMESSAGE);
+		return false;
+	}
+
+	checkIteration(iteration);
+
+	MIPEncodedAudioMessage *pAudioMsg = (MIPEncodedAudioMessage *)pMsg;
+	int numFrames = pAudioMsg->getNumberOfFrames();
+	int sampRate = pAudioMsg->getSamplingRate();
+	uint64_t sourceID = pAudioMsg->getSourceID();
+
+	if (numFrames <= 0 || pAudioMsg->getNumberOfChannels() != 1)
+		return true; // nothing to generate
+
+	CNStateInfo *pStateInfo = (CNStateInfo *)findState(sourceID);
+
+	if (pStateInfo == 0)
+	{
+		pStateInfo = new CNStateInfo();
+
+		if (!MIPOutputMessageQueueWithState::addState(sourceID, pStateInfo))
+			return false; // shouldn't happen, error message already set
+	}
+
+	pStateInfo->setUpdateTime();
+
+	MIPComfortNoise &comfortNoise = pStateInfo->getComfortNoise();
+
+	if (!comfortNoise.setParameters(pAudioMsg->getData(), pAudioMsg->getDataLength()))
+		return true; // empty payload, ignore it
+
+	MIPSharedBuffer *pBuffer = 0;
+	MIPAudioMessage *pNewMsg = 0;
+
+	if (m_floatSamples)
+	{
+		pBuffer = MIPSharedBuffer::allocate(numFrames*sizeof(float));
+		comfortNoise.generate((float *)pBuffer->getData(), numFrames);
+		pNewMsg = new MIPRawFloatAudioMessage(sampRate, 1, numFrames, pBuffer);
+	}
+	else
+	{
+		std::vector<float> noise(numFrames);
+
+		comfortNoise.generate(&noise[0], numFrames);
+
+		pBuffer = MIPSharedBuffer::allocate(numFrames*sizeof(int16_t));
+
+		int16_t *pSamples = (int16_t *)pBuffer->getData();
+
+		// generate() keeps the samples within [-1, 1]
+		for (int i = 0 ; i < numFrames ; i++)
+			pSamples[i] = (int16_t)(noise[i]*32767.0f);
+
+		pNewMsg = new MIPRaw16bitAudioMessage(sampRate, 1, numFrames, true, MIPRaw16bitAudioMessage::Native, pBuffer);
+	}
+	
+	pNewMsg->copyMediaInfoFrom(*pAudioMsg); // copy time and sourceID
+	MIPOutputMessageQueueWithState::addToOutputQueue(pNewMsg, true);
+	
+	return true;
+}
+
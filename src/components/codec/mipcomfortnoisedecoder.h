@@ -0,0 +1,77 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+/**
+ * \file mipcomfortnoisedecoder.h
+ */
+
+#ifndef MIPCOMFORTNOISEDECODER_H
+
+#define MIPCOMFORTNOISEDECODER_H
+
+#include "mipconfig.h"
+#include "mipoutputmessagequeuewithstate.h"
+#include "mipcomfortnoise.h"
+
+/** Generates comfort noise.
+ *  This component accepts encoded audio messages with subtype MIPENCODEDAUDIOMESSAGE_TYPE_CN,
+ *  which contain RFC 3389 comfort noise parameters, and produces mono raw audio messages 
+ *  containing matching background noise. For each source a MIPComfortNoise instance is kept,
+ *  so that the generated noise continues smoothly when new parameters arrive.
+ */
+class EMIPLIB_IMPORTEXPORT MIPComfortNoiseDecoder : public MIPOutputMessageQueueWithState
+{
+public:
+	MIPComfortNoiseDecoder();
+	~MIPComfortNoiseDecoder();
+
+	/** Initialize the component.
+	 *  Initialize the component.
+	 *  \param floatSamples If \c true, floating point audio messages will be generated. Otherwise,
+	 *                      the output uses 16 bit signed native endian encoding.
+	 */
+	bool init(bool floatSamples = false);
+
+	/** Clean up the component. */
+	bool destroy();
+
+	bool push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg);
+private:
+	class CNStateInfo : public MIPStateInfo
+	{
+	public:
+		CNStateInfo()								{ }
+		~CNStateInfo()								{ }
+
+		MIPComfortNoise &getComfortNoise()					{ return m_comfortNoise; }
+	private:
+		MIPComfortNoise m_comfortNoise;
+	};
+
+	bool m_init;
+	bool m_floatSamples;
+};	
+
+#endif // MIPCOMFORTNOISEDECODER_H
+
@@ -0,0 +1,175 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+#include "mipconfig.h"
+#include "mipg711transcoder.h"
+#include "mipencodedaudiomessage.h"
+#include "mipg711.h"
+
+#include "mipdebug.h"
+
+#define MIPG711TRANSCODER_ERRSTR_NOTINIT			"Not initialized"
+#define MIPG711TRANSCODER_ERRSTR_ALREADYINIT			"Already initialized"
+#define MIPG711TRANSCODER_ERRSTR_BADSUBTYPE			"The output subtype must be either u-law or A-law"
+#define MIPG711TRANSCODER_ERRSTR_BADMESSAGE			"Only u-law or A-law encoded audio messages are accepted"
+
+MIPG711Transcoder::MIPG711Transcoder() : MIPComponent("MIPG711Transcoder")
+{
+	m_init = false;
+}
+
+MIPG711Transcoder::~MIPG711Transcoder()
+{
+	destroy();
+}
+
+bool MIPG711Transcoder::init(uint32_t outputSubtype)
+{
+	if (m_init)
+	{
+		setErrorString(MIPG711TRANSCODER_ERRSTR_ALREADYINIT);
+		return false;
+	}
+
+	if (!(outputSubtype == MIPENCODEDAUDIOMESSAGE_TYPE_ULAW || outputSubtype == MIPENCODEDAUDIOMESSAGE_TYPE_ALAW))
+	{
+		setErrorString(MIPG711TRANSCODER_ERRSTR_BADSUBTYPE);
+		return false;
+	}
+	
+	m_outputSubtype = outputSubtype;
+	m_prevIteration = -1;
+	m_msgIt = m_messages.begin();
+	m_init = true;
+	
+	return true;
+}
+
+bool MIPG711Transcoder::destroy()
+{
+	if (!m_init)
+	{
+		setErrorString(MIPG711TRANSCODER_ERRSTR_NOTINIT);
+		return false;
+	}
+	
+	clearMessages();
+	m_init = false;
+
+	return true;
+}
+
+bool MIPG711Transcoder::push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg)
+{
+	if (!m_init)
+	{
+		setErrorString(MIPG711TRANSCODER_ERRSTR_NOTINIT);
+		return false;
+	}
+
+	if (iteration != m_prevIteration)
+	{
+		m_prevIteration = iteration;
+		clearMessages();
+	}
+
+	if (!(pMsg->getMessageType() == MIPMESSAGE_TYPE_AUDIO_ENCODED && 
+	      (pMsg->getMessageSubtype() == MIPENCODEDAUDIOMESSAGE_TYPE_ULAW || pMsg->getMessageSubtype() == MIPENCODEDAUDIOMESSAGE_TYPE_ALAW)))
+	{
+		setErrorString(MIPG711TRANSCODER_ERRSTR_BADMESSAGE);
+		return false;
+	}
+
+	MIPEncodedAudioMessage *pAudioMsg = (MIPEncodedAudioMessage *)pMsg;
+	MIPEncodedAudioMessage *pNewMsg = 0;
+
+	if (pAudioMsg->getMessageSubtype() == m_outputSubtype)
+		pNewMsg = (MIPEncodedAudioMessage *)pAudioMsg->createCopy();
+	else if (pAudioMsg->isConcealment())
+	{
+		// Nothing to convert, the decoder will synthesize the audio
+		pNewMsg = new MIPEncodedAudioMessage(m_outputSubtype, pAudioMsg->getSamplingRate(), pAudioMsg->getNumberOfChannels(), 
+		                                     pAudioMsg->getNumberOfFrames(), 0, 0, true);
+		pNewMsg->setConcealment(false);
+		pNewMsg->copyMediaInfoFrom(*pAudioMsg); // copy time and sourceID
+	}
+	else
+	{
+		size_t numBytes = pAudioMsg->getDataLength();
+		MIPSharedBuffer *pBuffer = MIPSharedBuffer::allocate(numBytes);
+
+		if (m_outputSubtype == MIPENCODEDAUDIOMESSAGE_TYPE_ALAW)
+			MIPG711::uLawToALaw(pAudioMsg->getData(), pBuffer->getData(), numBytes);
+		else
+			MIPG711::aLawToULaw(pAudioMsg->getData(), pBuffer->getData(), numBytes);
+
+		pNewMsg = new MIPEncodedAudioMessage(m_outputSubtype, pAudioMsg->getSamplingRate(), pAudioMsg->getNumberOfChannels(), 
+		                                     pAudioMsg->getNumberOfFrames(), pBuffer, numBytes);
+		pNewMsg->copyMediaInfoFrom(*pAudioMsg); // copy time and sourceID
+	}
+
+	m_messages.push_back(pNewMsg);
+	m_msgIt = m_messages.begin();
+
+	return true;
+}
+
+bool MIPG711Transcoder::pull(const MIPComponentChain &chain, int64_t iteration, MIPMessage **pMsg)
+{
+	if (!m_init)
+	{
+		setErrorString(MIPG711TRANSCODER_ERRSTR_NOTINIT);
+		return false;
+	}
+
+	if (iteration != m_prevIteration)
+	{
+		m_prevIteration = iteration;
+		clearMessages();
+	}
+
+	if (m_msgIt == m_messages.end())
+	{
+		*pMsg = 0;
+		m_msgIt = m_messages.begin();
+	}
+	else
+	{
+		*pMsg = *m_msgIt;
+		m_msgIt++;
+	}
+	
+	return true;
+}
+
+void MIPG711Transcoder::clearMessages()
+{
+	std::list<MIPEncodedAudioMessage *>::iterator it;
+
+	for (it = m_messages.begin() ; it != m_messages.end() ; it++)
+		delete (*it);
+	m_messages.clear();
+	m_msgIt = m_messages.begin();
+}
+
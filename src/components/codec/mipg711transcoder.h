@@ -0,0 +1,77 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+/**
+ * \file mipg711transcoder.h
+ */
+
+#ifndef MIPG711TRANSCODER_H
+
+#define MIPG711TRANSCODER_H
+
+#include "mipconfig.h"
+#include "mipcomponent.h"
+#include "miptime.h"
+#include <list>
+
+class MIPEncodedAudioMessage;
+
+/** Converts u-law encoded audio to A-law or vice versa.
+ *  This component accepts encoded audio messages with subtype MIPENCODEDAUDIOMESSAGE_TYPE_ULAW
+ *  or MIPENCODEDAUDIOMESSAGE_TYPE_ALAW and produces messages with the subtype that was specified
+ *  in the MIPG711Transcoder::init function. The conversion is done directly, using a lookup table,
+ *  so the audio is not decoded to linear samples first. Messages which already have the requested
+ *  subtype are passed on as a copy, which shares the data with the original when possible.
+ */
+class EMIPLIB_IMPORTEXPORT MIPG711Transcoder : public MIPComponent
+{
+public:
+	MIPG711Transcoder();
+	~MIPG711Transcoder();
+
+	/** Initialize the component.
+	 *  Initialize the component.
+	 *  \param outputSubtype The subtype of the messages that are produced, which must be either
+	 *                       MIPENCODEDAUDIOMESSAGE_TYPE_ULAW or MIPENCODEDAUDIOMESSAGE_TYPE_ALAW.
+	 */
+	bool init(uint32_t outputSubtype);
+
+	/** Clean up the component. */
+	bool destroy();
+
+	bool push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg);
+	bool pull(const MIPComponentChain &chain, int64_t iteration, MIPMessage **pMsg);
+private:
+	void clearMessages();
+	
+	bool m_init;
+	int64_t m_prevIteration;
+	uint32_t m_outputSubtype;
+
+	std::list<MIPEncodedAudioMessage *> m_messages;
+	std::list<MIPEncodedAudioMessage *>::const_iterator m_msgIt;
+};	
+
+#endif // MIPG711TRANSCODER_H
+
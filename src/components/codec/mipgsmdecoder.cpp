@@ -45,6 +45,7 @@
 MIPGSMDecoder::GSMStateInfo::GSMStateInfo()
 { 
 	m_lastTime = MIPTime::getCurrentTime(); 
+	m_concealer.init(MIPGSMDECODER_SAMPRATE, 1);
 	m_pState = gsm_create(); // TODO: check if this goes wrong?
 }
 		
@@ -163,12 +164,6 @@ bool MIPGSMDecoder::push(const MIPComponentChain &chain, int64_t iteration, MIPM
 		return false;
 	}
 
-	if (pEncMsg->getDataLength() != MIPGSMDECODER_FRAMESIZE)
-	{
-		setErrorString(MIPGSMDECODER_ERRSTR_BADENCODEDFRAMESIZE);
-		return false;
-	}
-
 	uint64_t sourceID = pEncMsg->getSourceID();
 
 	auto it = m_gsmStates.find(sourceID);
@@ -184,11 +179,21 @@ bool MIPGSMDecoder::push(const MIPComponentChain &chain, int64_t iteration, MIPM
 
 	pGSMInf->setUpdateTime();
 
+	if (pEncMsg->isConcealment())
+		return concealFrames(pGSMInf->getConcealer(), pEncMsg);
+
+	if (pEncMsg->getDataLength() != MIPGSMDECODER_FRAMESIZE)
+	{
+		setErrorString(MIPGSMDECODER_ERRSTR_BADENCODEDFRAMESIZE);
+		return false;
+	}
+
 	// use 16 bit signed native encoding
 	
 	uint16_t *pFrames = new uint16_t [MIPGSMDECODER_NUMFRAMES];
 	
 	gsm_decode(pGSMInf->getState(), (gsm_byte *)pEncMsg->getData(), (gsm_signal *)pFrames);
+	pGSMInf->getConcealer().addFrames((int16_t *)pFrames, MIPGSMDECODER_NUMFRAMES);
 	
 	MIPRaw16bitAudioMessage *pNewMsg = new MIPRaw16bitAudioMessage(MIPGSMDECODER_SAMPRATE, 1, MIPGSMDECODER_NUMFRAMES, true, MIPRaw16bitAudioMessage::Native, pFrames, true);
 	pNewMsg->copyMediaInfoFrom(*pEncMsg); // copy source ID and message time
@@ -198,6 +203,29 @@ bool MIPGSMDecoder::push(const MIPComponentChain &chain, int64_t iteration, MIPM
 	return true;
 }
 
+bool MIPGSMDecoder::concealFrames(MIPPacketLossConcealer &concealer, MIPEncodedAudioMessage *pEncMsg)
+{
+	int numFrames = pEncMsg->getNumberOfFrames();
+
+	if (numFrames <= 0)
+		return true; // nothing to conceal
+
+	uint16_t *pFrames = new uint16_t [numFrames];
+
+	if (!concealer.conceal((int16_t *)pFrames, numFrames))
+	{
+		delete [] pFrames;
+		return true;
+	}
+
+	MIPRaw16bitAudioMessage *pNewMsg = new MIPRaw16bitAudioMessage(MIPGSMDECODER_SAMPRATE, 1, numFrames, true, MIPRaw16bitAudioMessage::Native, pFrames, true);
+	pNewMsg->copyMediaInfoFrom(*pEncMsg); // copy source ID and message time
+	m_messages.push_back(pNewMsg);
+	m_msgIt = m_messages.begin();
+	
+	return true;
+}
+
 bool MIPGSMDecoder::pull(const MIPComponentChain &chain, int64_t iteration, MIPMessage **pMsg)
 {
 	if (!m_init)
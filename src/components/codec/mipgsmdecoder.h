@@ -35,17 +35,21 @@
 #ifdef MIPCONFIG_SUPPORT_GSM
 
 #include "mipcomponent.h"
+#include "mippacketlossconcealer.h"
 #include "miptime.h"
 #include <unordered_map>
 #include <list>
 
 class MIPAudioMessage;
+class MIPEncodedAudioMessage;
 struct gsm_state;
 
 /** Decodes messages which contain GSM 06.10 encoded data.
  *  This component can be used to decompress data using the GSM codec. Input messages
  *  should be MIPEncodedAudioMessage instances with subtype MIPENCODEDAUDIOMESSAGE_TYPE_GSM.
- *  The component generates signed 16 bit native endian encoded raw audio messages.
+ *  The component generates signed 16 bit native endian encoded raw audio messages. Messages
+ *  which request concealment of lost audio (see MIPEncodedAudioMessage::setConcealment) are
+ *  handled by a MIPPacketLossConcealer instance which is kept for each source.
  */
 class EMIPLIB_IMPORTEXPORT MIPGSMDecoder : public MIPComponent
 {
@@ -64,6 +68,7 @@ public:
 private:
 	void clearMessages();
 	void expire();
+	bool concealFrames(MIPPacketLossConcealer &concealer, MIPEncodedAudioMessage *pEncMsg);
 
 	class GSMStateInfo
 	{
@@ -74,8 +79,10 @@ private:
 		gsm_state *getState()							{ return m_pState; }
 		MIPTime getLastUpdateTime() const					{ return m_lastTime; }
 		void setUpdateTime()							{ m_lastTime = MIPTime::getCurrentTime(); }
+		MIPPacketLossConcealer &getConcealer()					{ return m_concealer; }
 	private:
 		MIPTime m_lastTime;
+		MIPPacketLossConcealer m_concealer;
 		gsm_state *m_pState;
 	};
 
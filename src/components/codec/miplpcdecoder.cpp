@@ -45,6 +45,7 @@
 MIPLPCDecoder::LPCStateInfo::LPCStateInfo()
 { 
 	m_lastTime = MIPTime::getCurrentTime(); 
+	m_concealer.init(MIPLPCDECODER_SAMPRATE, 1);
 	m_pDecoder = new LPCDecoder();
 }
 		
@@ -166,12 +167,6 @@ bool MIPLPCDecoder::push(const MIPComponentChain &chain, int64_t iteration, MIPM
 		return false;
 	}
 
-	if (pEncMsg->getDataLength() != MIPLPCDECODER_FRAMESIZE)
-	{
-		setErrorString(MIPLPCDECODER_ERRSTR_BADENCODEDFRAMESIZE);
-		return false;
-	}
-
 	uint64_t sourceID = pEncMsg->getSourceID();
 
 	auto it = m_lpcStates.find(sourceID);
@@ -187,6 +182,15 @@ bool MIPLPCDecoder::push(const MIPComponentChain &chain, int64_t iteration, MIPM
 
 	pLPCInf->setUpdateTime();
 
+	if (pEncMsg->isConcealment())
+		return concealFrames(pLPCInf->getConcealer(), pEncMsg);
+
+	if (pEncMsg->getDataLength() != MIPLPCDECODER_FRAMESIZE)
+	{
+		setErrorString(MIPLPCDECODER_ERRSTR_BADENCODEDFRAMESIZE);
+		return false;
+	}
+
 	// use 16 bit signed native encoding
 	
 	uint16_t *pFrames = new uint16_t [MIPLPCDECODER_NUMFRAMES];
@@ -196,6 +200,8 @@ bool MIPLPCDecoder::push(const MIPComponentChain &chain, int64_t iteration, MIPM
 	
 	for (int i = 0 ; i < MIPLPCDECODER_NUMFRAMES ; i++)
 		pFrames2[i] = (int16_t)m_pFrameBuffer[i];
+
+	pLPCInf->getConcealer().addFrames(pFrames2, MIPLPCDECODER_NUMFRAMES);
 	
 	MIPRaw16bitAudioMessage *pNewMsg = new MIPRaw16bitAudioMessage(MIPLPCDECODER_SAMPRATE, 1, MIPLPCDECODER_NUMFRAMES, true, MIPRaw16bitAudioMessage::Native, pFrames, true);
 	pNewMsg->copyMediaInfoFrom(*pEncMsg); // copy source ID and message time
@@ -205,6 +211,29 @@ bool MIPLPCDecoder::push(const MIPComponentChain &chain, int64_t iteration, MIPM
 	return true;
 }
 
+bool MIPLPCDecoder::concealFrames(MIPPacketLossConcealer &concealer, MIPEncodedAudioMessage *pEncMsg)
+{
+	int numFrames = pEncMsg->getNumberOfFrames();
+
+	if (numFrames <= 0)
+		return true; // nothing to conceal
+
+	uint16_t *pFrames = new uint16_t [numFrames];
+
+	if (!concealer.conceal((int16_t *)pFrames, numFrames))
+	{
+		delete [] pFrames;
+		return true;
+	}
+
+	MIPRaw16bitAudioMessage *pNewMsg = new MIPRaw16bitAudioMessage(MIPLPCDECODER_SAMPRATE, 1, numFrames, true, MIPRaw16bitAudioMessage::Native, pFrames, true);
+	pNewMsg->copyMediaInfoFrom(*pEncMsg); // copy source ID and message time
+	m_messages.push_back(pNewMsg);
+	m_msgIt = m_messages.begin();
+	
+	return true;
+}
+
 bool MIPLPCDecoder::pull(const MIPComponentChain &chain, int64_t iteration, MIPMessage **pMsg)
 {
 	if (!m_init)
@@ -152,38 +152,62 @@ bool MIPOpusDecoder::push(const MIPComponentChain &chain, int64_t iteration, MIP
 	int dataLength = pEncMsg->getDataLength();
 
 	int maxFrameSize = (m_outputSamplingRate/100)*12; // 120ms 
+	int decodeFEC = 0;
 	MIPMediaMessage *pNewMsg = 0;
+
+	if (pEncMsg->isConcealment())
+	{
+		// For concealment, the decoder must be told exactly how much audio is missing
+
+		if (pEncMsg->getSamplingRate() <= 0 || pEncMsg->getNumberOfFrames() <= 0)
+			return true; // don't know how long the gap is, ignore it
+
+		int64_t missingFrames = ((int64_t)pEncMsg->getNumberOfFrames()*(int64_t)m_outputSamplingRate)/(int64_t)pEncMsg->getSamplingRate();
+
+		if (missingFrames > maxFrameSize)
+			missingFrames = maxFrameSize;
+		maxFrameSize = (int)missingFrames;
+
+		if (pEncMsg->useFEC() && dataLength > 0)
+			decodeFEC = 1;
+		else // packet loss concealment by the decoder itself
+		{
+			pData = 0;
+			dataLength = 0;
+		}
+	}
 	
 	if (!m_useFloat)
 	{
-		uint16_t *pFrames = new uint16_t[maxFrameSize*m_outputChannels];
-		int16_t *pPtr = (int16_t *)pFrames;
+		MIPSharedBuffer *pBuffer = MIPSharedBuffer::allocate(maxFrameSize*m_outputChannels*sizeof(uint16_t));
+		int16_t *pPtr = (int16_t *)pBuffer->getData();
 
-		int numFrames = opus_decode(pDecoder, pData, dataLength, pPtr, maxFrameSize, 0);
+		int numFrames = opus_decode(pDecoder, pData, dataLength, pPtr, maxFrameSize, decodeFEC);
 		if (numFrames < 0)
 		{
 			// silently ignore decoding errors
-			delete [] pFrames;
+			pBuffer->release();
 			return true; 
 		}
 
 		// use 16 bit signed native encoding
 		
-		pNewMsg = new MIPRaw16bitAudioMessage(m_outputSamplingRate, m_outputChannels, numFrames, true, MIPRaw16bitAudioMessage::Native, pFrames, true);
+		pNewMsg = new MIPRaw16bitAudioMessage(m_outputSamplingRate, m_outputChannels, numFrames, true, MIPRaw16bitAudioMessage::Native, pBuffer);
 	}
 	else
 	{
-		float *pFrames = new float[maxFrameSize*m_outputChannels];
+		MIPSharedBuffer *pBuffer = MIPSharedBuffer::allocate(maxFrameSize*m_outputChannels*sizeof(float));
+		float *pFrames = (float *)pBuffer->getData();
 		
-		int numFrames = opus_decode_float(pDecoder, pData, dataLength, pFrames, maxFrameSize, 0);
+		int numFrames = opus_decode_float(pDecoder, pData, dataLength, pFrames, maxFrameSize, decodeFEC);
 		if (numFrames < 0)
 		{
 			// silently ignore decoding errors
-			delete [] pFrames;
+			pBuffer->release();
 			return true; 
 		}
 		
-		pNewMsg = new MIPRawFloatAudioMessage(m_outputSamplingRate, m_outputChannels, numFrames, pFrames, true);
+		pNewMsg = new MIPRawFloatAudioMessage(m_outputSamplingRate, m_outputChannels, numFrames, pBuffer);
 	}
 
 	pNewMsg->copyMediaInfoFrom(*pEncMsg); // copy source ID and message time
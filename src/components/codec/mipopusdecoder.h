@@ -43,7 +43,9 @@ class MIPAudioMessage;
  *  This component can be used to decompress data using the Opus codec. Input messages
  *  should be MIPEncodedAudioMessage instances with subtype MIPENCODEDAUDIOMESSAGE_TYPE_OPUS.
  *  The component generates floating point mono raw audio messages or signed 16 bit native endian
- *  encoded raw audio messages.
+ *  encoded raw audio messages. Messages which request concealment of lost audio (see 
+ *  MIPEncodedAudioMessage::setConcealment) are handled using the in-band forward error correction
+ *  data of the next packet if requested, or using the packet loss concealment of the decoder.
  */
 class EMIPLIB_IMPORTEXPORT MIPOpusDecoder : public MIPOutputMessageQueueWithState
 {
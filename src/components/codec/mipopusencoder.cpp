@@ -29,6 +29,7 @@
 #include "mipopusencoder.h"
 #include "mipencodedaudiomessage.h"
 #include "miprawaudiomessage.h"
+#include "mipsharedbuffer.h"
 #include <opus/opus.h>
 
 #include <iostream>
@@ -50,10 +51,19 @@
 #define MIPOPUSENCODER_ERRSTR_INVALIDBITRATE			"The bitrate must lie between 6000 and 510000"
 #define MIPOPUSENCODER_ERRSTR_INVALIDCHANNELS			"The number of channels must be either 1 or 2"
 #define MIPOPUSENCODER_ERRSTR_INVALIDSAMPLINGRATE		"The sampling rate must be 8000, 12000, 16000, 24000 or 48000"
+#define MIPOPUSENCODER_ERRSTR_NOTIERS				"At least one bitrate tier must be specified"
+#define MIPOPUSENCODER_ERRSTR_CANTSTORESTATE			"Unable to store the encoder state for a new source"
 
-MIPOpusEncoder::MIPOpusEncoder() : MIPOutputMessageQueue("MIPOpusEncoder")
+MIPOpusEncoder::OpusStateInfo::~OpusStateInfo()
+{
+	for (size_t i = 0 ; i < m_states.size() ; i++)
+		opus_encoder_destroy((OpusEncoder *)m_states[i]);
+}
+
+MIPOpusEncoder::MIPOpusEncoder() : MIPOutputMessageQueueWithState("MIPOpusEncoder")
 {
 	m_init = false;
+	m_settingsVersion = 0;
 }
 
 MIPOpusEncoder::~MIPOpusEncoder()
@@ -149,40 +159,21 @@ bool MIPOpusEncoder::init(int inputSamplingRate, int channels, EncoderType appli
 		return false;
 	};
 
-	if (targetBitrate != 0) // 0 specifies default bitrate
-	{
-		if (targetBitrate < 6000 || targetBitrate > 510000)
-		{
-			setErrorString(MIPOPUSENCODER_ERRSTR_INVALIDBITRATE);
-			return false;
-		}
-	}
-
-	int error = 0;
-	OpusEncoder *pEncoder = opus_encoder_create(inputSamplingRate, channels, app, &error);
-
-	if (error != OPUS_OK)
-	{
-		setErrorString(MIPOPUSENCODER_ERRSTR_CANTCREATEENCODER);
+	if (!checkBitrate(targetBitrate))
 		return false;
-	}
 
-	if (targetBitrate != 0)
-	{
-		if (opus_encoder_ctl(pEncoder, OPUS_SET_BITRATE(targetBitrate)) != 0)
-		{
-			opus_encoder_destroy(pEncoder);
-			setErrorString(MIPOPUSENCODER_ERRSTR_CANTSETBITRATE);
-			return false;
-		}
-	}
-
-	MIPOutputMessageQueue::init();
+	// The encoder states themselves are created when the first message of a source arrives
 	
+	MIPOutputMessageQueueWithState::init(60.0);
+
+	m_tierBitrates.assign(1, targetBitrate);
+	m_sourceBitrates.clear();
+	m_settingsVersion++;
+
 	m_init = true;
 	m_inputSamplingRate = inputSamplingRate;
 	m_inputChannels = channels;
-	m_pState = pEncoder;
+	m_application = app;
 	m_bufLength = 48000/100*12*2; // should be more than enough
 
 	m_pBuffer = new uint8_t[m_bufLength];
@@ -198,11 +189,9 @@ bool MIPOpusEncoder::destroy()
 		return false;
 	}
 
-	clearMessages();
+	MIPOutputMessageQueueWithState::clear();
 
 	delete [] m_pBuffer;
-	OpusEncoder *pEncoder = (OpusEncoder *)m_pState;
-	opus_encoder_destroy(pEncoder);
 
 	m_init = false;
 
@@ -225,80 +214,176 @@ bool MIPOpusEncoder::push(const MIPComponentChain &chain, int64_t iteration, MIP
 		return false;
 	}
 
-	OpusEncoder *pEncoder = (OpusEncoder *)m_pState;
-	MIPEncodedAudioMessage *pNewMsg = 0;
 	MIPMediaMessage *pInputMessage = (MIPMediaMessage *)pMsg;
-	int numBytes = 0;
+	MIPAudioMessage *pAudioMsg = (MIPAudioMessage *)pMsg;
 
-	if (pMsg->getMessageSubtype() == MIPRAWAUDIOMESSAGE_TYPE_FLOAT)
+	if (pAudioMsg->getSamplingRate() != m_inputSamplingRate)
 	{
-		MIPRawFloatAudioMessage *pAudioMsg = (MIPRawFloatAudioMessage *)pMsg;
+		setErrorString(MIPOPUSENCODER_ERRSTR_INCOMPATIBLESAMPRATE);
+		return false;
+	}
 	
-		if (pAudioMsg->getSamplingRate() != m_inputSamplingRate)
+	if (pAudioMsg->getNumberOfChannels() != m_inputChannels)
+	{
+		setErrorString(MIPOPUSENCODER_ERRSTR_INCOMPATIBLECHANNELS);
+		return false;
+	}
+	
+	if (pAudioMsg->getNumberOfFrames() != m_inputFrames)
+	{
+		setErrorString(MIPOPUSENCODER_ERRSTR_INCOMPATIBLEFRAMES);
+		return false;
+	}
+
+	uint64_t sourceID = pInputMessage->getSourceID();
+	OpusStateInfo *pStateInfo = (OpusStateInfo *)findState(sourceID);
+
+	if (pStateInfo == 0)
+	{
+		pStateInfo = new OpusStateInfo();
+		if (!MIPOutputMessageQueueWithState::addState(sourceID, pStateInfo))
 		{
-			setErrorString(MIPOPUSENCODER_ERRSTR_INCOMPATIBLESAMPRATE);
+			delete pStateInfo;
+			setErrorString(MIPOPUSENCODER_ERRSTR_CANTSTORESTATE);
 			return false;
 		}
-		
-		if (pAudioMsg->getNumberOfChannels() != m_inputChannels)
-		{
-			setErrorString(MIPOPUSENCODER_ERRSTR_INCOMPATIBLECHANNELS);
+	}
+	pStateInfo->setUpdateTime();
+
+	if (pStateInfo->getSettingsVersion() != m_settingsVersion)
+	{
+		if (!updateEncoders(sourceID, pStateInfo))
 			return false;
+	}
+
+	std::vector<void *> &states = pStateInfo->getStates();
+
+	for (size_t tier = 0 ; tier < states.size() ; tier++)
+	{
+		OpusEncoder *pEncoder = (OpusEncoder *)states[tier];
+		int numBytes = 0;
+
+		if (pMsg->getMessageSubtype() == MIPRAWAUDIOMESSAGE_TYPE_FLOAT)
+		{
+			const float *pFloatBuf = ((MIPRawFloatAudioMessage *)pMsg)->getFrames();
+			numBytes = opus_encode_float(pEncoder, pFloatBuf, m_inputFrames, m_pBuffer, m_bufLength);
 		}
-		
-		if (pAudioMsg->getNumberOfFrames() != m_inputFrames)
+		else // Signed 16 bit, native endian encoded samples
 		{
-			setErrorString(MIPOPUSENCODER_ERRSTR_INCOMPATIBLEFRAMES);
+			const int16_t *pIntBuf = (const int16_t *)((MIPRaw16bitAudioMessage *)pMsg)->getFrames();
+			numBytes = opus_encode(pEncoder, pIntBuf, m_inputFrames, m_pBuffer, m_bufLength);
+		}
+
+		if (numBytes < 0)
+		{
+			setErrorString(MIPOPUSENCODER_ERRSTR_ENCODERERROR);
 			return false;
 		}
-	
-		const float *pFloatBuf = pAudioMsg->getFrames();
-		numBytes = opus_encode_float(pEncoder, pFloatBuf, m_inputFrames, m_pBuffer, m_bufLength);
+
+		MIPEncodedAudioMessage *pNewMsg = new MIPEncodedAudioMessage(MIPENCODEDAUDIOMESSAGE_TYPE_OPUS, m_inputSamplingRate, m_inputChannels, m_inputFrames, 
+		                                                             MIPSharedBuffer::createCopy(m_pBuffer, numBytes), numBytes);
+
+		pNewMsg->copyMediaInfoFrom(*pInputMessage); // copy time and sourceID
+		pNewMsg->setEncodingTier((int)tier);
+		MIPOutputMessageQueueWithState::addToOutputQueue(pNewMsg, true);
 	}
-	else // Signed 16 bit, native endian encoded samples
+
+	return true;
+}
+
+bool MIPOpusEncoder::updateEncoders(uint64_t sourceID, OpusStateInfo *pStateInfo)
+{
+	std::vector<int> targetBitrates;
+	int64_t version;
+
 	{
-		MIPRaw16bitAudioMessage *pAudioMsg = (MIPRaw16bitAudioMessage *)pMsg;
-	
-		if (pAudioMsg->getSamplingRate() != m_inputSamplingRate)
+		std::lock_guard<std::mutex> guard(m_settingsMutex);
+
+		targetBitrates = m_tierBitrates;
+		version = m_settingsVersion;
+
+		auto it = m_sourceBitrates.find(sourceID);
+		if (it != m_sourceBitrates.end())
+			targetBitrates[0] = it->second;
+	}
+
+	std::vector<void *> &states = pStateInfo->getStates();
+	std::vector<int> &bitrates = pStateInfo->getBitrates();
+
+	while (states.size() > targetBitrates.size())
+	{
+		opus_encoder_destroy((OpusEncoder *)states.back());
+		states.pop_back();
+		bitrates.pop_back();
+	}
+
+	while (states.size() < targetBitrates.size())
+	{
+		int error = 0;
+		OpusEncoder *pEncoder = opus_encoder_create(m_inputSamplingRate, m_inputChannels, m_application, &error);
+
+		if (error != OPUS_OK)
 		{
-			setErrorString(MIPOPUSENCODER_ERRSTR_INCOMPATIBLESAMPRATE);
+			setErrorString(MIPOPUSENCODER_ERRSTR_CANTCREATEENCODER);
 			return false;
 		}
-		
-		if (pAudioMsg->getNumberOfChannels() != m_inputChannels)
+
+		states.push_back(pEncoder);
+		bitrates.push_back(0); // a new encoder uses the default bitrate
+	}
+
+	for (size_t i = 0 ; i < states.size() ; i++)
+	{
+		if (bitrates[i] == targetBitrates[i])
+			continue;
+
+		int bitrate = (targetBitrates[i] == 0)?OPUS_AUTO:targetBitrates[i];
+
+		if (opus_encoder_ctl((OpusEncoder *)states[i], OPUS_SET_BITRATE(bitrate)) != OPUS_OK)
 		{
-			setErrorString(MIPOPUSENCODER_ERRSTR_INCOMPATIBLECHANNELS);
+			setErrorString(MIPOPUSENCODER_ERRSTR_CANTSETBITRATE);
 			return false;
 		}
-		
-		if (pAudioMsg->getNumberOfFrames() != m_inputFrames)
+		bitrates[i] = targetBitrates[i];
+	}
+
+	pStateInfo->setSettingsVersion(version);
+	return true;
+}
+
+bool MIPOpusEncoder::checkBitrate(int targetBitrate)
+{
+	if (targetBitrate != 0) // 0 specifies default bitrate
+	{
+		if (targetBitrate < 6000 || targetBitrate > 510000)
 		{
-			setErrorString(MIPOPUSENCODER_ERRSTR_INCOMPATIBLEFRAMES);
+			setErrorString(MIPOPUSENCODER_ERRSTR_INVALIDBITRATE);
 			return false;
 		}
-	
-		int16_t *pIntBuf = (int16_t *)pAudioMsg->getFrames();
-		numBytes = opus_encode(pEncoder, pIntBuf, m_inputFrames, m_pBuffer, m_bufLength);
 	}
+	return true;
+}
 
-	if (numBytes < 0)
+bool MIPOpusEncoder::setBitrate(int targetBitrate)
+{
+	if (!m_init)
 	{
-		setErrorString(MIPOPUSENCODER_ERRSTR_ENCODERERROR);
+		setErrorString(MIPOPUSENCODER_ERRSTR_NOTINIT);
 		return false;
 	}
 
-	uint8_t *pNewBuffer = new uint8_t[numBytes];
-	memcpy(pNewBuffer, m_pBuffer, numBytes);
-	
-	pNewMsg = new MIPEncodedAudioMessage(MIPENCODEDAUDIOMESSAGE_TYPE_OPUS, m_inputSamplingRate, m_inputChannels, m_inputFrames, pNewBuffer, numBytes, true);
+	if (!checkBitrate(targetBitrate))
+		return false;
+
+	std::lock_guard<std::mutex> guard(m_settingsMutex);
 
-	pNewMsg->copyMediaInfoFrom(*pInputMessage); // copy time and sourceID
-	MIPOutputMessageQueue::addToOutputQueue(pNewMsg, true);
+	m_tierBitrates.assign(1, targetBitrate);
+	m_settingsVersion++;
 
 	return true;
 }
 
-bool MIPOpusEncoder::setBitrate(int targetBitrate)
+bool MIPOpusEncoder::setBitrateTiers(const std::vector<int> &targetBitrates)
 {
 	if (!m_init)
 	{
@@ -306,26 +391,45 @@ bool MIPOpusEncoder::setBitrate(int targetBitrate)
 		return false;
 	}
 
-	if (targetBitrate != 0) // 0 specifies default bitrate
+	if (targetBitrates.empty())
 	{
-		if (targetBitrate < 6000 || targetBitrate > 510000)
-		{
-			setErrorString(MIPOPUSENCODER_ERRSTR_INVALIDBITRATE);
+		setErrorString(MIPOPUSENCODER_ERRSTR_NOTIERS);
+		return false;
+	}
+
+	for (size_t i = 0 ; i < targetBitrates.size() ; i++)
+	{
+		if (!checkBitrate(targetBitrates[i]))
 			return false;
-		}
 	}
 
-	OpusEncoder *pEncoder = (OpusEncoder *)m_pState;
+	std::lock_guard<std::mutex> guard(m_settingsMutex);
+
+	m_tierBitrates = targetBitrates;
+	m_settingsVersion++;
 
-	if (targetBitrate != 0)
+	return true;
+}
+
+bool MIPOpusEncoder::setSourceBitrate(uint64_t sourceID, int targetBitrate)
+{
+	if (!m_init)
 	{
-		if (opus_encoder_ctl(pEncoder, OPUS_SET_BITRATE(targetBitrate)) != 0)
-		{
-			setErrorString(MIPOPUSENCODER_ERRSTR_CANTSETBITRATE);
-			return false;
-		}
+		setErrorString(MIPOPUSENCODER_ERRSTR_NOTINIT);
+		return false;
 	}
 
+	if (targetBitrate != -1 && !checkBitrate(targetBitrate))
+		return false;
+
+	std::lock_guard<std::mutex> guard(m_settingsMutex);
+
+	if (targetBitrate == -1)
+		m_sourceBitrates.erase(sourceID);
+	else
+		m_sourceBitrates[sourceID] = targetBitrate;
+	m_settingsVersion++;
+
 	return true;
 }
 
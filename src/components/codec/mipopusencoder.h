@@ -34,9 +34,12 @@
 
 #ifdef MIPCONFIG_SUPPORT_OPUS
 
-#include "mipoutputmessagequeue.h"
+#include "mipoutputmessagequeuewithstate.h"
 #include "miptime.h"
-#include <list>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <atomic>
 
 class MIPEncodedAudioMessage;
 
@@ -44,8 +47,16 @@ class MIPEncodedAudioMessage;
  *  Using this component, floating point mono raw audio messages and raw 16 bit raw audio
  *  messages can be compressed using the Opus codec. Messages generated by this component 
  *  are encoded audio messages with subtype MIPENCODEDAUDIOMESSAGE_TYPE_OPUS.
+ *
+ *  A separate encoder state is kept for each source ID, so a single instance can encode
+ *  several streams, for example the personal mixes which MIPAudioMixer produces for each 
+ *  participant of a conference. States of sources which haven't been seen for a minute
+ *  are removed. Each stream can be encoded at several bitrates at once 
+ *  (see MIPOpusEncoder::setBitrateTiers), and the bitrate of a single stream can be 
+ *  changed while the chain is running (see MIPOpusEncoder::setSourceBitrate), for example 
+ *  based on the receiver reports of its destination.
  */
-class EMIPLIB_IMPORTEXPORT MIPOpusEncoder : public MIPOutputMessageQueue
+class EMIPLIB_IMPORTEXPORT MIPOpusEncoder : public MIPOutputMessageQueueWithState
 {
 public:
 	/** Used to specify the mode in which the encoder should operate. */
@@ -80,18 +91,65 @@ public:
 	/** Sets the codec bitrate.
 	 *  The codec should produce data corresponding to this bitrate (note that this does not
 	 *  include header overhead from IP/UDP/RTP when transmitting the data over the network).
-	 *  Specify 0 for the codec default, or select a value between 6000 and 510000. */
+	 *  Specify 0 for the codec default, or select a value between 6000 and 510000. This
+	 *  sets the bitrate of the first tier, and removes any other tiers. It can be called
+	 *  while the component is being used in a running chain. */
 	bool setBitrate(int targetBitrate = 0);
 
+	/** Encodes each incoming message at several bitrates.
+	 *  Encodes each incoming message at several bitrates. For every incoming message, one
+	 *  output message is created for each tier, in the order of this list; the tier of an 
+	 *  output message can be retrieved using MIPEncodedAudioMessage::getEncodingTier. Every
+	 *  tier of every source uses its own encoder state. Each bitrate must be 0 (the codec default)
+	 *  or lie between 6000 and 510000. This function can be called while the component is
+	 *  being used in a running chain.
+	 */
+	bool setBitrateTiers(const std::vector<int> &targetBitrates);
+
+	/** Overrides the bitrate of the first tier for a specific source.
+	 *  Overrides the bitrate of the first tier for a specific source, which allows the bitrate
+	 *  of each destination to be adjusted separately, for example based on the packet loss
+	 *  reported by its receiver. Specify -1 to remove the override. This function can be called
+	 *  while the component is being used in a running chain.
+	 */
+	bool setSourceBitrate(uint64_t sourceID, int targetBitrate);
+
 	bool push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg);
 private:
+	class OpusStateInfo : public MIPStateInfo
+	{
+	public:
+		OpusStateInfo()									{ m_settingsVersion = -1; }
+		~OpusStateInfo();
+
+		std::vector<void *> &getStates()						{ return m_states; }
+		std::vector<int> &getBitrates()							{ return m_bitrates; }
+		int64_t getSettingsVersion() const						{ return m_settingsVersion; }
+		void setSettingsVersion(int64_t v)						{ m_settingsVersion = v; }
+	private:
+		std::vector<void *> m_states;
+		std::vector<int> m_bitrates;
+		int64_t m_settingsVersion;
+	};
+
+	bool checkBitrate(int targetBitrate);
+	bool updateEncoders(uint64_t sourceID, OpusStateInfo *pStateInfo);
+
 	bool m_init;
 
 	int m_inputSamplingRate, m_inputChannels;
 	int m_inputFrames;
-	void *m_pState;
+	int m_application;
 	uint8_t *m_pBuffer;
 	int m_bufLength;
+
+	// Settings which can be changed from another thread, protected by the mutex;
+	// the version number is increased on every change so that the encoders can
+	// be updated the next time they are used
+	std::mutex m_settingsMutex;
+	std::vector<int> m_tierBitrates;
+	std::unordered_map<uint64_t, int> m_sourceBitrates;
+	std::atomic<int64_t> m_settingsVersion;
 };	
 
 #endif // MIPCONFIG_SUPPORT_OPUS
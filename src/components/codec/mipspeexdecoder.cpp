@@ -202,25 +202,26 @@ bool MIPSpeexDecoder::push(const MIPComponentChain &chain, int64_t iteration, MI
 
 	if (m_floatSamples)
 	{
-		float *pFrames = new float [numFrames];
+		MIPSharedBuffer *pBuffer = MIPSharedBuffer::allocate(numFrames*sizeof(float));
+		float *pFrames = (float *)pBuffer->getData();
 		
 		speex_decode(pSpeexInf->getState(), pSpeexInf->getBits(), pFrames);
 	
 		for (int i = 0 ; i < numFrames ; i++)
 			pFrames[i] /= (float)32767.0;
 		
-		MIPRawFloatAudioMessage *pNewMsg = new MIPRawFloatAudioMessage(sampRate, 1, numFrames, pFrames, true);
+		MIPRawFloatAudioMessage *pNewMsg = new MIPRawFloatAudioMessage(sampRate, 1, numFrames, pBuffer);
 		pNewMsg->copyMediaInfoFrom(*pEncMsg); // copy source ID and message time
 		m_messages.push_back(pNewMsg);
 		m_msgIt = m_messages.begin();
 	}
 	else // use 16 bit signed native encoding
 	{
-		uint16_t *pFrames = new uint16_t [numFrames];
+		MIPSharedBuffer *pBuffer = MIPSharedBuffer::allocate(numFrames*sizeof(uint16_t));
 		
-		speex_decode_int(pSpeexInf->getState(), pSpeexInf->getBits(), (int16_t *)pFrames);
+		speex_decode_int(pSpeexInf->getState(), pSpeexInf->getBits(), (int16_t *)pBuffer->getData());
 		
-		MIPRaw16bitAudioMessage *pNewMsg = new MIPRaw16bitAudioMessage(sampRate, 1, numFrames, true, MIPRaw16bitAudioMessage::Native, pFrames, true);
+		MIPRaw16bitAudioMessage *pNewMsg = new MIPRaw16bitAudioMessage(sampRate, 1, numFrames, true, MIPRaw16bitAudioMessage::Native, pBuffer);
 		pNewMsg->copyMediaInfoFrom(*pEncMsg); // copy source ID and message time
 		m_messages.push_back(pNewMsg);
 		m_msgIt = m_messages.begin();
@@ -31,17 +31,17 @@
 #define MIPULAWDECODER_H
 
 #include "mipconfig.h"
-#include "mipcomponent.h"
+#include "mipoutputmessagequeuewithstate.h"
+#include "mippacketlossconcealer.h"
 #include "miptime.h"
-#include <list>
-
-class MIPRaw16bitAudioMessage;
 
 /** An u-law decoder.
  *  This component accepts u-law encoded audio messages and produces message
- *  raw audio messages using 16 bit signed native endian encoding.
+ *  raw audio messages using 16 bit signed native endian encoding. Messages which
+ *  request concealment of lost audio (see MIPEncodedAudioMessage::setConcealment) are
+ *  handled by a MIPPacketLossConcealer instance which is kept for each source.
  */
-class EMIPLIB_IMPORTEXPORT MIPULawDecoder : public MIPComponent
+class EMIPLIB_IMPORTEXPORT MIPULawDecoder : public MIPOutputMessageQueueWithState
 {
 public:
 	MIPULawDecoder();
@@ -54,17 +54,19 @@ public:
 	bool destroy();
 
 	bool push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg);
-	bool pull(const MIPComponentChain &chain, int64_t iteration, MIPMessage **pMsg);
 private:
-	void clearMessages();
-	
-	bool m_init;
-	int64_t m_prevIteration;
+	class ULawStateInfo : public MIPStateInfo
+	{
+	public:
+		ULawStateInfo()								{ }
+		~ULawStateInfo()							{ }
 
-	std::list<MIPRaw16bitAudioMessage *> m_messages;
-	std::list<MIPRaw16bitAudioMessage *>::const_iterator m_msgIt;
+		MIPPacketLossConcealer &getConcealer(int sampRate, int channels)	{ if (m_concealer.getSamplingRate() != sampRate || m_concealer.getNumberOfChannels() != channels) m_concealer.init(sampRate, channels); return m_concealer; }
+	private:
+		MIPPacketLossConcealer m_concealer;
+	};
 
-	static int16_t m_decompressionTable[256];
+	bool m_init;
 };	
 
 #endif // MIPULAWDECODER_H
@@ -26,6 +26,9 @@
 #include "mipulawencoder.h"
 #include "mipencodedaudiomessage.h"
 #include "miprawaudiomessage.h"
+#include "mipg711.h"
+#include "mipcomponentchain.h"
+#include "mipmessagearena.h"
 
 #include "mipdebug.h"
 
@@ -33,22 +36,6 @@
 #define MIPULAWENCODER_ERRSTR_ALREADYINIT			"Already initialized"
 #define MIPULAWENCODER_ERRSTR_BADMESSAGE			"Only signed 16 bit native endian raw audio messages are accepted"
 
-const uint8_t MIPULawEncoder::expEnc[256] = 
-{
-	0,0,1,1,2,2,2,2,3,3,3,3,3,3,3,3,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
-	5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,
-	6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
-	6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
-	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
-	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
-	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
-	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7
-};
-
-#define MIPULAWENCODER_CLIP						32635
-#define MIPULAWENCODER_BIAS						132
-
-
 MIPULawEncoder::MIPULawEncoder() : MIPComponent("MIPULawEncoder")
 {
 	m_init = false;
@@ -114,36 +101,11 @@ bool MIPULawEncoder::push(const MIPComponentChain &chain, int64_t iteration, MIP
 	int numBytes = numFrames*numChannels;
 	int sampRate = pAudioMsg->getSamplingRate();
 	const int16_t *pSamples = (const int16_t *)pAudioMsg->getFrames();
-	uint8_t *pBuffer = new uint8_t[numBytes];
+	uint8_t *pBuffer = chain.getMessageArena().allocateArray<uint8_t>(numBytes);
 
-	for (int i = 0 ; i < numBytes ; i++)
-	{
-		int val = pSamples[i];
-		int mant,signval,mantpos,expon;
-		
-		if (val < 0)
-		{
-			signval = (1<<7);
-			if (val < -MIPULAWENCODER_CLIP)
-				val = MIPULAWENCODER_CLIP;
-			else
-				val = -val;
-		}
-		else
-		{
-			signval = 0;
-			if (val > MIPULAWENCODER_CLIP)
-				val = MIPULAWENCODER_CLIP;
-		}
-
-		val += MIPULAWENCODER_BIAS;
-		expon = expEnc[val>>7];
-		mantpos = (int)expon + 7 - 4;
-		mant = ((val >> mantpos) & 15);
-		pBuffer[i] = ~((uint8_t)(signval|(expon<<4)|mant));
-	}
-	
-	MIPEncodedAudioMessage *pNewMsg = new MIPEncodedAudioMessage(MIPENCODEDAUDIOMESSAGE_TYPE_ULAW, sampRate, numChannels, numFrames, pBuffer, numBytes, true);
+	MIPG711::encodeULaw(pSamples, pBuffer, numBytes);
+
+	MIPEncodedAudioMessage *pNewMsg = chain.getMessageArena().createMessage<MIPEncodedAudioMessage>(MIPENCODEDAUDIOMESSAGE_TYPE_ULAW, sampRate, numChannels, numFrames, pBuffer, numBytes, false);
 	pNewMsg->copyMediaInfoFrom(*pAudioMsg); // copy time and sourceID
 	m_messages.push_back(pNewMsg);
 		
@@ -182,10 +144,7 @@ bool MIPULawEncoder::pull(const MIPComponentChain &chain, int64_t iteration, MIP
 
 void MIPULawEncoder::clearMessages()
 {
-	std::list<MIPEncodedAudioMessage *>::iterator it;
-
-	for (it = m_messages.begin() ; it != m_messages.end() ; it++)
-		delete (*it);
+	// The messages themselves are stored in the chain's message arena
 	m_messages.clear();
 	m_msgIt = m_messages.begin();
 }
@@ -33,7 +33,7 @@
 #include "mipconfig.h"
 #include "mipcomponent.h"
 #include "miptime.h"
-#include <list>
+#include <vector>
 
 class MIPEncodedAudioMessage;
 
@@ -63,10 +63,8 @@ private:
 	bool m_init;
 	int64_t m_prevIteration;
 
-	std::list<MIPEncodedAudioMessage *> m_messages;
-	std::list<MIPEncodedAudioMessage *>::const_iterator m_msgIt;
-
-	static const uint8_t expEnc[256];
+	std::vector<MIPEncodedAudioMessage *> m_messages;
+	std::vector<MIPEncodedAudioMessage *>::const_iterator m_msgIt;
 };	
 
 #endif // MIPULAWENCODER_H
@@ -29,7 +29,7 @@
 #include "mipopenslesandroidinput.h"
 #include "miprawaudiomessage.h"
 #include "mipsystemmessage.h"
-#include "mipstreambuffer.h"
+#include "mipringbuffer.h"
 #include "mipsignalwaiter.h"
 #include <vector>
 #include <sstream>
@@ -43,6 +43,8 @@ const int numRecordBuffers = 10;
 #define MIPOPENSLESANDROIDINPUT_ERRSTR_NOTINIT "The OpenSL ES audio output component is not initialized"
 #define MIPOPENSLESANDROIDINPUT_ERRSTR_NOPULL "Pull is not supported"
 
+#define MIPOPENSLESANDROIDINPUT_BUFFEREDBLOCKS 16
+
 MIPOpenSLESAndroidInput::MIPOpenSLESAndroidInput() : MIPComponent("MIPOpenSLESAndroidInput")
 {
 	m_init = false;
@@ -97,7 +99,8 @@ bool MIPOpenSLESAndroidInput::open(int sampRate, int channels, MIPTime interval)
 		delete m_pSigWait;
 		return false;
 	}
-	m_pBuffer = new MIPStreamBuffer(m_blockSize, 10);
+	m_pBuffer = new MIPRingBuffer();
+	m_pBuffer->init(m_blockSize*MIPOPENSLESANDROIDINPUT_BUFFEREDBLOCKS);
 	m_pThread = new AudioThread(m_pBuffer, m_blockSize, sampRate, channels, interval, m_pSigWait);
 	if (m_pThread->Start() < 0)
 	{
@@ -200,7 +203,7 @@ bool MIPOpenSLESAndroidInput::pull(const MIPComponentChain &chain, int64_t itera
 	return true;
 }
 
-MIPOpenSLESAndroidInput::AudioThread::AudioThread(MIPStreamBuffer *pBuffer, int blockSize, int sampRate, int channels, 
+MIPOpenSLESAndroidInput::AudioThread::AudioThread(MIPRingBuffer *pBuffer, int blockSize, int sampRate, int channels, 
                                                   MIPTime interval, MIPSignalWaiter *pSigWait)
 {
 	m_stopFlag = false;
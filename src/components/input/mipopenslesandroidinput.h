@@ -42,7 +42,7 @@
 #include <vector>
 #include <atomic>
 
-class MIPStreamBuffer;
+class MIPRingBuffer;
 class MIPSignalWaiter;
 class MIPRaw16bitAudioMessage;
 
@@ -70,7 +70,7 @@ private:
 	int m_sampRate;
 	int m_channels;
 	int m_blockSize;
-	MIPStreamBuffer *m_pBuffer;
+	MIPRingBuffer *m_pBuffer;
 	MIPSignalWaiter *m_pSigWait;
 
 	MIPRaw16bitAudioMessage *m_pMsg;
@@ -80,7 +80,7 @@ private:
 	class AudioThread : public jthread::JThread
 	{
 	public:
-		AudioThread(MIPStreamBuffer *pBuffer, int blockSize, int sampRate, int channels, MIPTime interval, MIPSignalWaiter *pSigWait);
+		AudioThread(MIPRingBuffer *pBuffer, int blockSize, int sampRate, int channels, MIPTime interval, MIPSignalWaiter *pSigWait);
 		~AudioThread();
 
 		void *Thread();
@@ -92,7 +92,7 @@ private:
 
 		std::string m_errorString;
 		std::atomic_bool m_stopFlag, m_successFullyStarted;
-		MIPStreamBuffer *m_pBuffer;
+		MIPRingBuffer *m_pBuffer;
 		int m_blockSize;
 		int m_sampRate, m_channels;
 		MIPTime m_interval;
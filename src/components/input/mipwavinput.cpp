@@ -45,7 +45,7 @@ MIPWAVInput::~MIPWAVInput()
 	close();
 }
 
-bool MIPWAVInput::open(const std::string &fname, int frames, bool loop, bool intSamples)
+bool MIPWAVInput::open(const std::string &fname, int frames, bool loop, bool intSamples, bool useCache)
 {
 	if (m_pSndFile != 0)
 	{
@@ -54,7 +54,7 @@ bool MIPWAVInput::open(const std::string &fname, int frames, bool loop, bool int
 	}
 
 	m_pSndFile = new MIPWAVReader();
-	if (!m_pSndFile->open(fname))
+	if (!m_pSndFile->open(fname, useCache))
 	{
 		setErrorString(std::string(MIPWAVINPUT_ERRSTR_CANTOPENFILE) + m_pSndFile->getErrorString());
 		delete m_pSndFile;
@@ -85,7 +85,7 @@ bool MIPWAVInput::open(const std::string &fname, int frames, bool loop, bool int
 	return true;
 }
 
-bool MIPWAVInput::open(const std::string &fname, MIPTime interval, bool loop, bool intSamples)
+bool MIPWAVInput::open(const std::string &fname, MIPTime interval, bool loop, bool intSamples, bool useCache)
 {
 	if (m_pSndFile != 0)
 	{
@@ -94,7 +94,7 @@ bool MIPWAVInput::open(const std::string &fname, MIPTime interval, bool loop, bo
 	}
 
 	m_pSndFile = new MIPWAVReader();
-	if (!m_pSndFile->open(fname))
+	if (!m_pSndFile->open(fname, useCache))
 	{
 		setErrorString(std::string(MIPWAVINPUT_ERRSTR_CANTOPENFILE) + m_pSndFile->getErrorString());
 		delete m_pSndFile;
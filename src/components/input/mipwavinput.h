@@ -60,8 +60,10 @@ public:
 	 *  \param frames	The number of frames which should be read during each iteration.
 	 *  \param loop		Flag indicating if the sound file should be played over and over again or just once.
 	 *  \param intSamples	If \c true, 16 bit integer samples will be used. If \c false, floating point samples will be used.
+	 *  \param useCache	If \c true, the file is kept in memory and shared with other inputs that play the same
+	 *                      file (see MIPWAVReader::open).
 	 */
-	bool open(const std::string &fname, int frames, bool loop = true, bool intSamples = false);
+	bool open(const std::string &fname, int frames, bool loop = true, bool intSamples = false, bool useCache = false);
 	
 	/** Opens a sound file.
 	 *  With this function, a sound file can be opened for reading.
@@ -70,8 +72,10 @@ public:
 	 *                      by this parameter are read.
 	 *  \param loop		Flag indicating if the sound file should be played over and over again or just once.
 	 *  \param intSamples	If \c true, 16 bit integer samples will be used. If \c false, floating point samples will be used.
+	 *  \param useCache	If \c true, the file is kept in memory and shared with other inputs that play the same
+	 *                      file (see MIPWAVReader::open).
 	 */
-	bool open(const std::string &fname, MIPTime interval, bool loop = true, bool intSamples = false);
+	bool open(const std::string &fname, MIPTime interval, bool loop = true, bool intSamples = false, bool useCache = false);
 
 	/** Closes the sound file.
 	 *  Use this function to stop using a previously opened sound file.
@@ -29,7 +29,7 @@
 #include "mippainputoutput.h"
 #include "miprawaudiomessage.h"
 #include "mipsystemmessage.h"
-#include "mipstreambuffer.h"
+#include "mipringbuffer.h"
 
 //#include <string.h>
 #include <iostream>
@@ -49,6 +49,8 @@
 #define MIPPAINPUTOUTPUT_ERRSTR_INCOMPATIBLEFRAMES		"Incompatible sampling number of frames"
 #define MIPPAINPUTOUTPUT_ERRSTR_CANTINITSIGWAIT			"Can't initialize the signal waiter"
 
+#define MIPPAINPUTOUTPUT_MAXBUFFEREDBLOCKS			10
+
 MIPPAInputOutput::MIPPAInputOutput() : MIPComponent("MIPPAInputOutput")
 {
 	m_pStream = 0;
@@ -129,10 +131,19 @@ bool MIPPAInputOutput::open(int sampRate, int channels, MIPTime interval, MIPPAI
 		m_pMsg = 0;
 	}
 	
+	// The buffers must be able to hold the amount of data at which they're reset
+	int bufferBlocks = (int)num + MIPPAINPUTOUTPUT_MAXBUFFEREDBLOCKS + 1;
+
 	if (accessMode == ReadOnly || accessMode == ReadWrite)
-		m_pInputBuffer = new MIPStreamBuffer(m_blockBytes, num);
+	{
+		m_pInputBuffer = new MIPRingBuffer();
+		m_pInputBuffer->init(bufferBlocks*m_blockBytes);
+	}
 	if (accessMode == WriteOnly || accessMode == ReadWrite)
-		m_pOutputBuffer = new MIPStreamBuffer(m_blockBytes, num);
+	{
+		m_pOutputBuffer = new MIPRingBuffer();
+		m_pOutputBuffer->init(bufferBlocks*m_blockBytes);
+	}
 	
 	// Initialize stream
 	
@@ -259,7 +270,8 @@ bool MIPPAInputOutput::push(const MIPComponentChain &chain, int64_t iteration, M
 #ifdef MIPDEBUG
 			std::cerr << "MIPPAInputOutput: Too many blocks buffered, resetting" << std::endl;
 #endif // MIPDEBUG
-			m_pOutputBuffer->clear();
+			// The PortAudio callback reads from this buffer, so it has to do the clearing
+			m_pOutputBuffer->requestClear();
 		}
 
 #if 0
@@ -352,11 +364,11 @@ int MIPPAInputOutput::portAudioCallback(const void *pInput, void *pOutput, unsig
 	if (m_pInputBuffer)
 	{
 		// Try to avoid too much memory being consumed
-		if (m_pInputBuffer->getAmountBuffered() > m_blockBytes*10) // TODO: make this configurable?
+		if (m_pInputBuffer->getAmountBuffered() > m_blockBytes*MIPPAINPUTOUTPUT_MAXBUFFEREDBLOCKS) // TODO: make this configurable?
 		{
 			//std::cerr << "MIPPAInputOutput::portAudioCallback: buffering too much data, clearing buffers" << std::endl;
 			m_sigWait.clearSignalBuffers();
-			m_pInputBuffer->clear();
+			m_pInputBuffer->requestClear(); // the chain thread is the one reading from this buffer
 		}
 		m_pInputBuffer->write(pInput, m_blockBytes);
 	}
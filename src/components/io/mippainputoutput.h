@@ -42,7 +42,7 @@
 #include <string>
 
 class MIPRaw16bitAudioMessage;
-class MIPStreamBuffer;
+class MIPRingBuffer;
 
 /** A PortAudio input and output component.
  *  This component is a PortAudio soundcard input and output 
@@ -99,7 +99,7 @@ private:
 	int m_channels;
 	AccessMode m_accessMode;
 	size_t m_blockFrames, m_blockBytes;
-	MIPStreamBuffer *m_pOutputBuffer, *m_pInputBuffer;
+	MIPRingBuffer *m_pOutputBuffer, *m_pInputBuffer;
 
 	bool m_gotMsg;
 	MIPSignalWaiter m_sigWait;
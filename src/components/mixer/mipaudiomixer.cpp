@@ -27,6 +27,23 @@
 #include "miprawaudiomessage.h"
 #include "mipsystemmessage.h"
 #include "mipfeedback.h"
+#include <string.h>
+#include <algorithm>
+
+#if defined(__AVX__)
+	#include <immintrin.h>
+	#define MIPAUDIOMIXER_AVX
+#endif // __AVX__
+#if defined(__AVX2__)
+	#define MIPAUDIOMIXER_AVX2
+#endif // __AVX2__
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define MIPAUDIOMIXER_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#include <arm_neon.h>
+	#define MIPAUDIOMIXER_NEON
+#endif
 
 //#include <iostream> 
 
@@ -42,6 +59,184 @@
 #define MIPAUDIOMIXER_ERRSTR_TIMINGINFOISNOTUSED		"Timing information is not being used, so the extra delay will not have any effect"
 #define MIPAUDIOMIXER_ERRSTR_NEGATIVEDELAY			"Only positive delays are allowed"
 
+#define MIPAUDIOMIXER_INITIALRINGSIZE				64
+#define MIPAUDIOMIXER_DESTINATIONTIMEOUT			60.0
+#define MIPAUDIOMIXER_LEVELSMOOTHING				0.8
+
+// Adds 'num' samples from 'pSrc' to the accumulator 'pDst'
+static inline void mixAddFloat(float *pDst, const float *pSrc, size_t num)
+{
+	size_t i = 0;
+
+#ifdef MIPAUDIOMIXER_AVX
+	for ( ; i + 8 <= num ; i += 8)
+		_mm256_storeu_ps(pDst + i, _mm256_add_ps(_mm256_loadu_ps(pDst + i), _mm256_loadu_ps(pSrc + i)));
+#endif // MIPAUDIOMIXER_AVX
+#if defined(MIPAUDIOMIXER_SSE2)
+	for ( ; i + 4 <= num ; i += 4)
+		_mm_storeu_ps(pDst + i, _mm_add_ps(_mm_loadu_ps(pDst + i), _mm_loadu_ps(pSrc + i)));
+#elif defined(MIPAUDIOMIXER_NEON)
+	for ( ; i + 4 <= num ; i += 4)
+		vst1q_f32(pDst + i, vaddq_f32(vld1q_f32(pDst + i), vld1q_f32(pSrc + i)));
+#endif
+	for ( ; i < num ; i++)
+		pDst[i] += pSrc[i];
+}
+
+// Adds 'num' 16 bit samples from 'pSrc' to the 32 bit accumulator 'pDst'
+static inline void mixAddInt(int32_t *pDst, const int16_t *pSrc, size_t num)
+{
+	size_t i = 0;
+
+#ifdef MIPAUDIOMIXER_AVX2
+	for ( ; i + 8 <= num ; i += 8)
+	{
+		__m256i s = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(pSrc + i)));
+		__m256i d = _mm256_loadu_si256((const __m256i *)(pDst + i));
+
+		_mm256_storeu_si256((__m256i *)(pDst + i), _mm256_add_epi32(d, s));
+	}
+#endif // MIPAUDIOMIXER_AVX2
+#if defined(MIPAUDIOMIXER_SSE2)
+	for ( ; i + 8 <= num ; i += 8)
+	{
+		__m128i s = _mm_loadu_si128((const __m128i *)(pSrc + i));
+		// sign extend by placing each sample in the upper half and shifting back
+		__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16);
+		__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16);
+		__m128i d0 = _mm_loadu_si128((const __m128i *)(pDst + i));
+		__m128i d1 = _mm_loadu_si128((const __m128i *)(pDst + i + 4));
+
+		_mm_storeu_si128((__m128i *)(pDst + i), _mm_add_epi32(d0, lo));
+		_mm_storeu_si128((__m128i *)(pDst + i + 4), _mm_add_epi32(d1, hi));
+	}
+#elif defined(MIPAUDIOMIXER_NEON)
+	for ( ; i + 8 <= num ; i += 8)
+	{
+		int16x8_t s = vld1q_s16(pSrc + i);
+
+		vst1q_s32(pDst + i, vaddw_s16(vld1q_s32(pDst + i), vget_low_s16(s)));
+		vst1q_s32(pDst + i + 4, vaddw_s16(vld1q_s32(pDst + i + 4), vget_high_s16(s)));
+	}
+#endif
+	for ( ; i < num ; i++)
+		pDst[i] += (int32_t)pSrc[i];
+}
+
+// Converts the 32 bit accumulator to 16 bit samples, clipping values which are out of range
+static inline void mixSaturateInt(int16_t *pDst, const int32_t *pSrc, size_t num)
+{
+	size_t i = 0;
+
+#if defined(MIPAUDIOMIXER_SSE2)
+	for ( ; i + 8 <= num ; i += 8)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i *)(pSrc + i));
+		__m128i b = _mm_loadu_si128((const __m128i *)(pSrc + i + 4));
+
+		_mm_storeu_si128((__m128i *)(pDst + i), _mm_packs_epi32(a, b));
+	}
+#elif defined(MIPAUDIOMIXER_NEON)
+	for ( ; i + 8 <= num ; i += 8)
+		vst1q_s16(pDst + i, vcombine_s16(vqmovn_s32(vld1q_s32(pSrc + i)), vqmovn_s32(vld1q_s32(pSrc + i + 4))));
+#endif
+	for ( ; i < num ; i++)
+	{
+		int32_t v = pSrc[i];
+
+		if (v > 32767)
+			v = 32767;
+		else if (v < -32768)
+			v = -32768;
+		pDst[i] = (int16_t)v;
+	}
+}
+
+// Adds 'num' samples from the 32 bit accumulator 'pSrc' to the accumulator 'pDst'
+static inline void mixAddAccum(int32_t *pDst, const int32_t *pSrc, size_t num)
+{
+	size_t i = 0;
+
+#if defined(MIPAUDIOMIXER_SSE2)
+	for ( ; i + 4 <= num ; i += 4)
+		_mm_storeu_si128((__m128i *)(pDst + i), _mm_add_epi32(_mm_loadu_si128((const __m128i *)(pDst + i)), _mm_loadu_si128((const __m128i *)(pSrc + i))));
+#elif defined(MIPAUDIOMIXER_NEON)
+	for ( ; i + 4 <= num ; i += 4)
+		vst1q_s32(pDst + i, vaddq_s32(vld1q_s32(pDst + i), vld1q_s32(pSrc + i)));
+#endif
+	for ( ; i < num ; i++)
+		pDst[i] += pSrc[i];
+}
+
+// Stores 'pTotal' minus 'pOwn' in 'pDst'
+static inline void mixSubtractFloat(float *pDst, const float *pTotal, const float *pOwn, size_t num)
+{
+	size_t i = 0;
+
+#if defined(MIPAUDIOMIXER_SSE2)
+	for ( ; i + 4 <= num ; i += 4)
+		_mm_storeu_ps(pDst + i, _mm_sub_ps(_mm_loadu_ps(pTotal + i), _mm_loadu_ps(pOwn + i)));
+#elif defined(MIPAUDIOMIXER_NEON)
+	for ( ; i + 4 <= num ; i += 4)
+		vst1q_f32(pDst + i, vsubq_f32(vld1q_f32(pTotal + i), vld1q_f32(pOwn + i)));
+#endif
+	for ( ; i < num ; i++)
+		pDst[i] = pTotal[i] - pOwn[i];
+}
+
+// Stores 'pTotal' minus 'pOwn' as 16 bit samples in 'pDst', clipping values which are out of range
+static inline void mixSubtractSaturateInt(int16_t *pDst, const int32_t *pTotal, const int32_t *pOwn, size_t num)
+{
+	size_t i = 0;
+
+#if defined(MIPAUDIOMIXER_SSE2)
+	for ( ; i + 8 <= num ; i += 8)
+	{
+		__m128i a = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)(pTotal + i)), _mm_loadu_si128((const __m128i *)(pOwn + i)));
+		__m128i b = _mm_sub_epi32(_mm_loadu_si128((const __m128i *)(pTotal + i + 4)), _mm_loadu_si128((const __m128i *)(pOwn + i + 4)));
+
+		_mm_storeu_si128((__m128i *)(pDst + i), _mm_packs_epi32(a, b));
+	}
+#elif defined(MIPAUDIOMIXER_NEON)
+	for ( ; i + 8 <= num ; i += 8)
+	{
+		int32x4_t a = vsubq_s32(vld1q_s32(pTotal + i), vld1q_s32(pOwn + i));
+		int32x4_t b = vsubq_s32(vld1q_s32(pTotal + i + 4), vld1q_s32(pOwn + i + 4));
+
+		vst1q_s16(pDst + i, vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+	}
+#endif
+	for ( ; i < num ; i++)
+	{
+		int32_t v = pTotal[i] - pOwn[i];
+
+		if (v > 32767)
+			v = 32767;
+		else if (v < -32768)
+			v = -32768;
+		pDst[i] = (int16_t)v;
+	}
+}
+
+// Returns the mean square value of the samples
+static inline double mixEnergyFloat(const float *pSrc, size_t num)
+{
+	double sum = 0;
+
+	for (size_t i = 0 ; i < num ; i++)
+		sum += (double)pSrc[i]*(double)pSrc[i];
+	return (num == 0)?0:(sum/(double)num);
+}
+
+static inline double mixEnergyInt(const int32_t *pSrc, size_t num)
+{
+	int64_t sum = 0;
+
+	for (size_t i = 0 ; i < num ; i++)
+		sum += (int64_t)pSrc[i]*(int64_t)pSrc[i];
+	return (num == 0)?0:((double)sum/(double)num);
+}
+
 MIPAudioMixer::MIPAudioMixer() : MIPComponent("MIPAudioMixer"), m_blockTime(0), m_playTime(0)
 {
 	m_init = false;
@@ -92,9 +287,19 @@ bool MIPAudioMixer::init(int sampRate, int channels, MIPTime blockTime, bool use
 	}
 	
 	m_pBlockFramesFloat = 0;
-	m_pBlockFramesInt = 0;
+	m_pBlockFramesAccum = 0;
+	m_pBlockFramesInt = (floatSamples)?0:(new uint16_t [m_blockSize]);
+
+	m_blockRing.resize(MIPAUDIOMIXER_INITIALRINGSIZE);
+	m_ringMask = MIPAUDIOMIXER_INITIALRINGSIZE-1;
 	
 	m_extraDelay = MIPTime(0);	
+
+	m_mixMinus = false;
+	m_maxSpeakers = 0;
+	m_destinations.clear();
+	m_numMixMinusMsgs = 0;
+	m_mixMinusMsgPos = 0;
 	
 	m_prevIteration = -1;
 	m_init = true;
@@ -111,10 +316,10 @@ bool MIPAudioMixer::destroy()
 	}
 
 	clearAudioBlocks();
+	deleteMixMinusMessages();
+	m_destinations.clear();
 	if (m_pMsgFloat)
 		delete m_pMsgFloat;
-	if (m_pBlockFramesFloat)
-		delete [] m_pBlockFramesFloat;
 	if (m_pSilenceFramesFloat)
 		delete [] m_pSilenceFramesFloat;
 	if (m_pMsgInt)
@@ -211,18 +416,14 @@ bool MIPAudioMixer::push(const MIPComponentChain &chain, int64_t iteration, MIPM
 		MIPRawFloatAudioMessage *pFloatAudioMsg = (MIPRawFloatAudioMessage *)pMsg;
 		const float *pSamples = pFloatAudioMsg->getFrames();
 	
-		initBlockSearch();
 		while (numSamplesLeft != 0)
 		{
-			MIPAudioMixerBlock block = searchBlock(intervalNumber);
-			float *blockSamples = block.getFramesFloat();
-			
+			MIPAudioMixerBlock &mixBlock = getBlock(intervalNumber);
+			float *blockSamples = (m_mixMinus)?getContribution(mixBlock, sourceID).m_pFloatFrames:mixBlock.m_pFloatFrames;
 			size_t num = (numSamplesLeft > (m_blockSize-sampleOffset))?(m_blockSize-sampleOffset):numSamplesLeft;
-			size_t i,j,k;
 			
 			// add samples to the block
-			for (i = 0, j = sampleOffset, k = samplePos ; i < num ; i++, j++, k++)
-				blockSamples[j] += pSamples[k];
+			mixAddFloat(blockSamples + sampleOffset, pSamples + samplePos, num);
 			
 			sampleOffset = 0;
 			samplePos += num;
@@ -235,18 +436,14 @@ bool MIPAudioMixer::push(const MIPComponentChain &chain, int64_t iteration, MIPM
 		MIPRaw16bitAudioMessage *pIntAudioMsg = (MIPRaw16bitAudioMessage *)pMsg;
 		const int16_t *pSamples = (const int16_t *)pIntAudioMsg->getFrames();
 	
-		initBlockSearch();
 		while (numSamplesLeft != 0)
 		{
-			MIPAudioMixerBlock block = searchBlock(intervalNumber);
-			int16_t *blockSamples = (int16_t *)block.getFramesInt();
-			
+			MIPAudioMixerBlock &mixBlock = getBlock(intervalNumber);
+			int32_t *blockSamples = (m_mixMinus)?getContribution(mixBlock, sourceID).m_pIntFrames:mixBlock.m_pIntFrames;
 			size_t num = (numSamplesLeft > (m_blockSize-sampleOffset))?(m_blockSize-sampleOffset):numSamplesLeft;
-			size_t i,j,k;
 			
-			// add samples to the block
-			for (i = 0, j = sampleOffset, k = samplePos ; i < num ; i++, j++, k++)
-				blockSamples[j] += pSamples[k];
+			// add samples to the 32 bit accumulator of the block
+			mixAddInt(blockSamples + sampleOffset, pSamples + samplePos, num);
 			
 			sampleOffset = 0;
 			samplePos += num;
@@ -268,32 +465,30 @@ bool MIPAudioMixer::pull(const MIPComponentChain &chain, int64_t iteration, MIPM
 		return false;
 	}
 
+	if (m_mixMinus)
+		return pullMixMinus(iteration, pMsg);
+
 	if (m_floatSamples)
 	{
 		if (m_prevIteration != 	iteration)
 		{
 			m_prevIteration = iteration;
 			
-			// delete old frames
+			// recycle old frames
 			if (m_pBlockFramesFloat)
-				delete [] m_pBlockFramesFloat;
+				m_freeFloatFrames.push_back(m_pBlockFramesFloat);
 			m_pBlockFramesFloat = 0;
 			
-			if (m_audioBlocks.empty())
-				m_pMsgFloat->setFrames(m_pSilenceFramesFloat,false);
-			else
+			MIPAudioMixerBlock &block = m_blockRing[(size_t)m_curInterval & m_ringMask];
+
+			if (block.m_interval == m_curInterval)
 			{
-				MIPAudioMixerBlock block = *(m_audioBlocks.begin());
-	
-				if (block.getInterval() == m_curInterval)
-				{
-					m_audioBlocks.pop_front();
-					m_pBlockFramesFloat = block.getFramesFloat();
-					m_pMsgFloat->setFrames(m_pBlockFramesFloat,false);
-				}
-				else
-					m_pMsgFloat->setFrames(m_pSilenceFramesFloat,false);
+				m_pBlockFramesFloat = block.m_pFloatFrames;
+				block = MIPAudioMixerBlock();
+				m_pMsgFloat->setFrames(m_pBlockFramesFloat,false);
 			}
+			else
+				m_pMsgFloat->setFrames(m_pSilenceFramesFloat,false);
 			
 			m_gotMessage = false;
 			m_curInterval++;
@@ -317,26 +512,22 @@ bool MIPAudioMixer::pull(const MIPComponentChain &chain, int64_t iteration, MIPM
 		{
 			m_prevIteration = iteration;
 			
-			// delete old frames
-			if (m_pBlockFramesInt)
-				delete [] m_pBlockFramesInt;
-			m_pBlockFramesInt = 0;
+			// recycle old frames
+			if (m_pBlockFramesAccum)
+				m_freeIntFrames.push_back(m_pBlockFramesAccum);
+			m_pBlockFramesAccum = 0;
 			
-			if (m_audioBlocks.empty())
-				m_pMsgInt->setFrames(true, MIPRaw16bitAudioMessage::Native, m_pSilenceFramesInt,false);
-			else
+			MIPAudioMixerBlock &block = m_blockRing[(size_t)m_curInterval & m_ringMask];
+
+			if (block.m_interval == m_curInterval)
 			{
-				MIPAudioMixerBlock block = *(m_audioBlocks.begin());
-	
-				if (block.getInterval() == m_curInterval)
-				{
-					m_audioBlocks.pop_front();
-					m_pBlockFramesInt = block.getFramesInt();
-					m_pMsgInt->setFrames(true, MIPRaw16bitAudioMessage::Native, m_pBlockFramesInt,false);
-				}
-				else
-					m_pMsgInt->setFrames(true, MIPRaw16bitAudioMessage::Native, m_pSilenceFramesInt,false);
+				m_pBlockFramesAccum = block.m_pIntFrames;
+				block = MIPAudioMixerBlock();
+				mixSaturateInt((int16_t *)m_pBlockFramesInt, m_pBlockFramesAccum, m_blockSize);
+				m_pMsgInt->setFrames(true, MIPRaw16bitAudioMessage::Native, m_pBlockFramesInt,false);
 			}
+			else
+				m_pMsgInt->setFrames(true, MIPRaw16bitAudioMessage::Native, m_pSilenceFramesInt,false);
 			
 			m_gotMessage = false;
 			m_curInterval++;
@@ -359,150 +550,396 @@ bool MIPAudioMixer::pull(const MIPComponentChain &chain, int64_t iteration, MIPM
 	return true;
 }
 
-void MIPAudioMixer::clearAudioBlocks()
+bool MIPAudioMixer::pullMixMinus(int64_t iteration, MIPMessage **pMsg)
 {
-	std::list<MIPAudioMixerBlock>::iterator it;
-
-	for (it = m_audioBlocks.begin() ; it != m_audioBlocks.end() ; it++)
+	if (m_prevIteration != iteration)
 	{
-		if ((*it).getFramesFloat())
-			delete [] (*it).getFramesFloat();
-		if ((*it).getFramesInt())
-			delete [] (*it).getFramesInt();
-	}
-	m_audioBlocks.clear();
-}
+		m_prevIteration = iteration;
 
-void MIPAudioMixer::initBlockSearch()
-{
-	m_it = m_audioBlocks.begin();
-}
+		recycleMixMinusFrames();
 
-MIPAudioMixer::MIPAudioMixerBlock MIPAudioMixer::searchBlock(int64_t intervalNumber)
-{
-	if (m_it == m_audioBlocks.end())
-	{
-		if (m_floatSamples)
+		MIPAudioMixerBlock &block = m_blockRing[(size_t)m_curInterval & m_ringMask];
+
+		if (block.m_interval == m_curInterval)
 		{
-			float *pNewFrames = new float [m_blockSize];
-			
-			memcpy(pNewFrames, m_pSilenceFramesFloat, sizeof(float)*m_blockSize);
-			MIPAudioMixerBlock block(intervalNumber, pNewFrames);
-			m_audioBlocks.push_back(block);
-			m_it = m_audioBlocks.end();
-			return block;
+			m_pBlockFramesFloat = block.m_pFloatFrames;
+			m_pBlockFramesAccum = block.m_pIntFrames;
+			m_contributions.swap(block.m_contributions);
+
+			// the block keeps the (now empty) contribution list, to reuse its memory
+			block.m_interval = -1;
+			block.m_pFloatFrames = 0;
+			block.m_pIntFrames = 0;
 		}
 
-		// 16 bit signed
-		
-		uint16_t *pNewFrames = new uint16_t [m_blockSize];
-			
-		memcpy(pNewFrames, m_pSilenceFramesInt, sizeof(uint16_t)*m_blockSize);
-		MIPAudioMixerBlock block(intervalNumber, pNewFrames);
-		m_audioBlocks.push_back(block);
-		m_it = m_audioBlocks.end();
-		return block;
+		createMixMinusMessages();
+
+		m_mixMinusMsgPos = 0;
+		m_curInterval++;
+		m_playTime += m_blockTime;
 	}
 
-	if (intervalNumber < (*m_it).getInterval())
+	if (m_mixMinusMsgPos < m_numMixMinusMsgs)
 	{
 		if (m_floatSamples)
-		{
-			float *pNewFrames = new float [m_blockSize];
-			
-			memcpy(pNewFrames, m_pSilenceFramesFloat, sizeof(float)*m_blockSize);
-			MIPAudioMixerBlock block(intervalNumber, pNewFrames);
-			m_it = m_audioBlocks.insert(m_it, block);
-			m_it++;
-			return block;
-		}
+			*pMsg = m_mixMinusMsgsFloat[m_mixMinusMsgPos];
+		else
+			*pMsg = m_mixMinusMsgsInt[m_mixMinusMsgPos];
+		m_mixMinusMsgPos++;
+	}
+	else
+	{
+		*pMsg = 0;
+		m_mixMinusMsgPos = 0;
+	}
+	return true;
+}
 
-		// 16 bit signed		
-		
-		uint16_t *pNewFrames = new uint16_t [m_blockSize];
-			
-		memcpy(pNewFrames, m_pSilenceFramesInt, sizeof(uint16_t)*m_blockSize);
-		MIPAudioMixerBlock block(intervalNumber, pNewFrames);
-		m_it = m_audioBlocks.insert(m_it, block);
-		m_it++;
-		return block;
+void MIPAudioMixer::createMixMinusMessages()
+{
+	int64_t timeoutIntervals = (int64_t)(MIPAUDIOMIXER_DESTINATIONTIMEOUT/m_blockTime.getValue());
+	std::map<uint64_t, MIPAudioMixerDestination>::iterator it;
+
+	for (it = m_destinations.begin() ; it != m_destinations.end() ; it++)
+		it->second.m_contribution = -1;
+
+	for (size_t i = 0 ; i < m_contributions.size() ; i++)
+	{
+		MIPAudioMixerDestination &dest = m_destinations[m_contributions[i].m_sourceID];
+
+		dest.m_lastInterval = m_curInterval;
+		dest.m_contribution = (int)i;
 	}
 
-	if (intervalNumber == (*m_it).getInterval())
+	it = m_destinations.begin();
+	while (it != m_destinations.end())
 	{
-		MIPAudioMixerBlock block = (*m_it);
-		m_it++;
-		return block;
+		if (!it->second.m_permanent && it->second.m_lastInterval + timeoutIntervals < m_curInterval)
+			it = m_destinations.erase(it);
+		else
+			it++;
 	}
 
-	// intervalNumber > (*m_it).getInterval()
-	
-	bool done = false;
-	
-	while (!done)
+	if (m_maxSpeakers > 0)
+		selectSpeakers();
+
+	// Mix the selected contributions only once; the messages for destinations which
+	// are not being heard will all refer to this mix
+
+	float *pTotalFloat = m_pSilenceFramesFloat;
+	uint16_t *pTotalInt = m_pSilenceFramesInt;
+
+	if (!m_contributions.empty())
 	{
-		m_it++;
-		if (m_it == m_audioBlocks.end())
+		if (m_floatSamples)
 		{
-			done = true;
+			for (size_t i = 0 ; i < m_contributions.size() ; i++)
+			{
+				if (m_contributions[i].m_selected)
+					mixAddFloat(m_pBlockFramesFloat, m_contributions[i].m_pFloatFrames, m_blockSize);
+			}
+			pTotalFloat = m_pBlockFramesFloat;
 		}
 		else
 		{
-			if ((*m_it).getInterval() == intervalNumber)
+			for (size_t i = 0 ; i < m_contributions.size() ; i++)
 			{
-				MIPAudioMixerBlock block = (*m_it);
-				m_it++;
-				return block;
+				if (m_contributions[i].m_selected)
+					mixAddAccum(m_pBlockFramesAccum, m_contributions[i].m_pIntFrames, m_blockSize);
 			}
+			mixSaturateInt((int16_t *)m_pBlockFramesInt, m_pBlockFramesAccum, m_blockSize);
+			pTotalInt = m_pBlockFramesInt;
+		}
+	}
 
-			if (intervalNumber < (*m_it).getInterval())
+	m_numMixMinusMsgs = 0;
+	for (it = m_destinations.begin() ; it != m_destinations.end() ; it++, m_numMixMinusMsgs++)
+	{
+		const MIPAudioMixerDestination &dest = it->second;
+		const MIPAudioMixerContribution *pOwn = 0;
+
+		if (dest.m_contribution >= 0 && m_contributions[dest.m_contribution].m_selected)
+			pOwn = &m_contributions[dest.m_contribution];
+
+		if (m_floatSamples)
+		{
+			float *pFrames = pTotalFloat;
+
+			if (pOwn)
+			{
+				pFrames = getFreeFloatFrames();
+				mixSubtractFloat(pFrames, pTotalFloat, pOwn->m_pFloatFrames, m_blockSize);
+				m_mixMinusFramesFloat.push_back(pFrames);
+			}
+
+			if (m_numMixMinusMsgs == m_mixMinusMsgsFloat.size())
+				m_mixMinusMsgsFloat.push_back(new MIPRawFloatAudioMessage(m_sampRate, m_channels, (int)m_blockFrames, pFrames, false));
+			else
+				m_mixMinusMsgsFloat[m_numMixMinusMsgs]->setFrames(pFrames, false);
+			m_mixMinusMsgsFloat[m_numMixMinusMsgs]->setSourceID(it->first);
+		}
+		else
+		{
+			uint16_t *pFrames = pTotalInt;
+
+			if (pOwn)
 			{
-				if (m_floatSamples)
+				if (m_freeOutputFramesInt.empty())
+					pFrames = new uint16_t [m_blockSize];
+				else
 				{
-					float *pNewFrames = new float [m_blockSize];
-			
-					memcpy(pNewFrames, m_pSilenceFramesFloat, sizeof(float)*m_blockSize);
-					MIPAudioMixerBlock block(intervalNumber, pNewFrames);
-					m_it = m_audioBlocks.insert(m_it, block);
-					m_it++;
-					return block;
+					pFrames = m_freeOutputFramesInt.back();
+					m_freeOutputFramesInt.pop_back();
 				}
-
-				// 16 bit signed
-				
-				uint16_t *pNewFrames = new uint16_t [m_blockSize];
-			
-				memcpy(pNewFrames, m_pSilenceFramesInt, sizeof(uint16_t)*m_blockSize);
-				MIPAudioMixerBlock block(intervalNumber, pNewFrames);
-				m_it = m_audioBlocks.insert(m_it, block);
-				m_it++;
-				return block;
+				mixSubtractSaturateInt((int16_t *)pFrames, m_pBlockFramesAccum, pOwn->m_pIntFrames, m_blockSize);
+				m_mixMinusFramesInt.push_back(pFrames);
 			}
+
+			if (m_numMixMinusMsgs == m_mixMinusMsgsInt.size())
+				m_mixMinusMsgsInt.push_back(new MIPRaw16bitAudioMessage(m_sampRate, m_channels, (int)m_blockFrames, true, MIPRaw16bitAudioMessage::Native, pFrames, false));
+			else
+				m_mixMinusMsgsInt[m_numMixMinusMsgs]->setFrames(true, MIPRaw16bitAudioMessage::Native, pFrames, false);
+			m_mixMinusMsgsInt[m_numMixMinusMsgs]->setSourceID(it->first);
 		}
-	} 
-	
+	}
+}
+
+void MIPAudioMixer::selectSpeakers()
+{
+	// Update the smoothed levels of all destinations, also the ones which are silent
+	// in this interval, so that a new speaker has to be loud for a few intervals
+	// before it replaces another one
+
+	std::map<uint64_t, MIPAudioMixerDestination>::iterator it;
+
+	for (it = m_destinations.begin() ; it != m_destinations.end() ; it++)
+	{
+		MIPAudioMixerDestination &dest = it->second;
+		double energy = 0;
+
+		if (dest.m_contribution >= 0)
+		{
+			MIPAudioMixerContribution &c = m_contributions[dest.m_contribution];
+
+			if (m_floatSamples)
+				energy = mixEnergyFloat(c.m_pFloatFrames, m_blockSize);
+			else
+				energy = mixEnergyInt(c.m_pIntFrames, m_blockSize);
+		}
+
+		dest.m_level = MIPAUDIOMIXER_LEVELSMOOTHING*dest.m_level + (1.0-MIPAUDIOMIXER_LEVELSMOOTHING)*energy;
+		if (dest.m_contribution >= 0)
+			m_contributions[dest.m_contribution].m_level = dest.m_level;
+	}
+
+	size_t maxSpeakers = (size_t)m_maxSpeakers;
+
+	if (m_contributions.size() <= maxSpeakers)
+		return;
+
+	m_speakerOrder.resize(m_contributions.size());
+	for (size_t i = 0 ; i < m_speakerOrder.size() ; i++)
+		m_speakerOrder[i] = i;
+
+	std::nth_element(m_speakerOrder.begin(), m_speakerOrder.begin() + maxSpeakers, m_speakerOrder.end(), 
+	                 [this](size_t a, size_t b) { return m_contributions[a].m_level > m_contributions[b].m_level; });
+
+	for (size_t i = 0 ; i < m_speakerOrder.size() ; i++)
+		m_contributions[m_speakerOrder[i]].m_selected = (i < maxSpeakers);
+}
+
+MIPAudioMixer::MIPAudioMixerContribution &MIPAudioMixer::getContribution(MIPAudioMixerBlock &block, uint64_t sourceID)
+{
+	std::vector<MIPAudioMixerContribution> &contributions = block.m_contributions;
+
+	for (size_t i = 0 ; i < contributions.size() ; i++)
+	{
+		if (contributions[i].m_sourceID == sourceID)
+			return contributions[i];
+	}
+
 	if (m_floatSamples)
+		contributions.push_back(MIPAudioMixerContribution(sourceID, getFreeFloatFrames(), 0));
+	else
+		contributions.push_back(MIPAudioMixerContribution(sourceID, 0, getFreeIntFrames()));
+	return contributions.back();
+}
+
+void MIPAudioMixer::recycleMixMinusFrames()
+{
+	for (size_t i = 0 ; i < m_contributions.size() ; i++)
 	{
-		float *pNewFrames = new float [m_blockSize];
-			
-		memcpy(pNewFrames, m_pSilenceFramesFloat, sizeof(float)*m_blockSize);
-		MIPAudioMixerBlock block(intervalNumber, pNewFrames);
-		m_audioBlocks.push_back(block);
-		m_it = m_audioBlocks.end();
-		return block;
+		if (m_contributions[i].m_pFloatFrames)
+			m_freeFloatFrames.push_back(m_contributions[i].m_pFloatFrames);
+		if (m_contributions[i].m_pIntFrames)
+			m_freeIntFrames.push_back(m_contributions[i].m_pIntFrames);
 	}
+	m_contributions.clear();
 
-	// 16 bit signed
-	
-	uint16_t *pNewFrames = new uint16_t [m_blockSize];
-			
-	memcpy(pNewFrames, m_pSilenceFramesInt, sizeof(uint16_t)*m_blockSize);
-	MIPAudioMixerBlock block(intervalNumber, pNewFrames);
-	m_audioBlocks.push_back(block);
-	m_it = m_audioBlocks.end();
+	if (m_pBlockFramesFloat)
+		m_freeFloatFrames.push_back(m_pBlockFramesFloat);
+	m_pBlockFramesFloat = 0;
+	if (m_pBlockFramesAccum)
+		m_freeIntFrames.push_back(m_pBlockFramesAccum);
+	m_pBlockFramesAccum = 0;
+
+	m_freeFloatFrames.insert(m_freeFloatFrames.end(), m_mixMinusFramesFloat.begin(), m_mixMinusFramesFloat.end());
+	m_mixMinusFramesFloat.clear();
+	m_freeOutputFramesInt.insert(m_freeOutputFramesInt.end(), m_mixMinusFramesInt.begin(), m_mixMinusFramesInt.end());
+	m_mixMinusFramesInt.clear();
+}
+
+void MIPAudioMixer::deleteMixMinusMessages()
+{
+	for (size_t i = 0 ; i < m_mixMinusMsgsFloat.size() ; i++)
+		delete m_mixMinusMsgsFloat[i];
+	m_mixMinusMsgsFloat.clear();
+	for (size_t i = 0 ; i < m_mixMinusMsgsInt.size() ; i++)
+		delete m_mixMinusMsgsInt[i];
+	m_mixMinusMsgsInt.clear();
+	m_numMixMinusMsgs = 0;
+	m_mixMinusMsgPos = 0;
+}
+
+void MIPAudioMixer::resetBlocks()
+{
+	clearAudioBlocks();
+
+	m_blockRing.resize(MIPAUDIOMIXER_INITIALRINGSIZE);
+	m_ringMask = MIPAUDIOMIXER_INITIALRINGSIZE-1;
+	m_numMixMinusMsgs = 0;
+	m_mixMinusMsgPos = 0;
+	m_prevIteration = -1;
+}
+
+void MIPAudioMixer::clearAudioBlocks()
+{
+	for (size_t i = 0 ; i < m_blockRing.size() ; i++)
+	{
+		if (m_blockRing[i].m_pFloatFrames)
+			delete [] m_blockRing[i].m_pFloatFrames;
+		if (m_blockRing[i].m_pIntFrames)
+			delete [] m_blockRing[i].m_pIntFrames;
+
+		std::vector<MIPAudioMixerContribution> &contributions = m_blockRing[i].m_contributions;
+
+		for (size_t j = 0 ; j < contributions.size() ; j++)
+		{
+			if (contributions[j].m_pFloatFrames)
+				delete [] contributions[j].m_pFloatFrames;
+			if (contributions[j].m_pIntFrames)
+				delete [] contributions[j].m_pIntFrames;
+		}
+	}
+	m_blockRing.clear();
+
+	for (size_t i = 0 ; i < m_contributions.size() ; i++)
+	{
+		if (m_contributions[i].m_pFloatFrames)
+			delete [] m_contributions[i].m_pFloatFrames;
+		if (m_contributions[i].m_pIntFrames)
+			delete [] m_contributions[i].m_pIntFrames;
+	}
+	m_contributions.clear();
+
+	for (size_t i = 0 ; i < m_mixMinusFramesFloat.size() ; i++)
+		delete [] m_mixMinusFramesFloat[i];
+	m_mixMinusFramesFloat.clear();
+	for (size_t i = 0 ; i < m_mixMinusFramesInt.size() ; i++)
+		delete [] m_mixMinusFramesInt[i];
+	m_mixMinusFramesInt.clear();
+	for (size_t i = 0 ; i < m_freeOutputFramesInt.size() ; i++)
+		delete [] m_freeOutputFramesInt[i];
+	m_freeOutputFramesInt.clear();
+
+	if (m_pBlockFramesFloat)
+		delete [] m_pBlockFramesFloat;
+	m_pBlockFramesFloat = 0;
+	if (m_pBlockFramesAccum)
+		delete [] m_pBlockFramesAccum;
+	m_pBlockFramesAccum = 0;
+
+	for (size_t i = 0 ; i < m_freeFloatFrames.size() ; i++)
+		delete [] m_freeFloatFrames[i];
+	m_freeFloatFrames.clear();
+	for (size_t i = 0 ; i < m_freeIntFrames.size() ; i++)
+		delete [] m_freeIntFrames[i];
+	m_freeIntFrames.clear();
+}
+
+MIPAudioMixer::MIPAudioMixerBlock &MIPAudioMixer::getBlock(int64_t intervalNumber)
+{
+	// All stored blocks belong to intervals in [m_curInterval, m_curInterval + ring size),
+	// so each of them has its own slot as long as the new interval also fits in this range
+
+	if ((uint64_t)(intervalNumber - m_curInterval) > (uint64_t)m_ringMask)
+		growBlockRing(intervalNumber);
+
+	MIPAudioMixerBlock &block = m_blockRing[(size_t)intervalNumber & m_ringMask];
+
+	if (block.m_interval != intervalNumber)
+	{
+		block.m_interval = intervalNumber;
+		if (m_floatSamples)
+			block.m_pFloatFrames = getFreeFloatFrames();
+		else
+			block.m_pIntFrames = getFreeIntFrames();
+	}
 	return block;
 }
 
+void MIPAudioMixer::growBlockRing(int64_t intervalNumber)
+{
+	size_t newSize = m_blockRing.size();
+
+	while ((uint64_t)(intervalNumber - m_curInterval) >= (uint64_t)newSize)
+		newSize <<= 1;
+
+	std::vector<MIPAudioMixerBlock> newRing(newSize);
+	size_t newMask = newSize-1;
+
+	for (size_t i = 0 ; i < m_blockRing.size() ; i++)
+	{
+		if (m_blockRing[i].m_interval >= 0)
+			newRing[(size_t)m_blockRing[i].m_interval & newMask] = m_blockRing[i];
+	}
+
+	m_blockRing.swap(newRing);
+	m_ringMask = newMask;
+}
+
+float *MIPAudioMixer::getFreeFloatFrames()
+{
+	float *pFrames = 0;
+
+	if (m_freeFloatFrames.empty())
+		pFrames = new float [m_blockSize];
+	else
+	{
+		pFrames = m_freeFloatFrames.back();
+		m_freeFloatFrames.pop_back();
+	}
+
+	memset(pFrames, 0, sizeof(float)*m_blockSize);
+	return pFrames;
+}
+
+int32_t *MIPAudioMixer::getFreeIntFrames()
+{
+	int32_t *pFrames = 0;
+
+	if (m_freeIntFrames.empty())
+		pFrames = new int32_t [m_blockSize];
+	else
+	{
+		pFrames = m_freeIntFrames.back();
+		m_freeIntFrames.pop_back();
+	}
+
+	memset(pFrames, 0, sizeof(int32_t)*m_blockSize);
+	return pFrames;
+}
+
 bool MIPAudioMixer::processFeedback(const MIPComponentChain &chain, int64_t feedbackChainID, 
                                     MIPFeedback *feedback)
 {
@@ -538,3 +975,19 @@ bool MIPAudioMixer::setExtraDelay(MIPTime t)
 	return true;
 }
 
+bool MIPAudioMixer::setMixMinus(bool enable, int maxSpeakers)
+{
+	if (!m_init)
+	{
+		setErrorString(MIPAUDIOMIXER_ERRSTR_NOTINIT);
+		return false;
+	}
+
+	if (enable != m_mixMinus)
+		resetBlocks();
+
+	m_mixMinus = enable;
+	m_maxSpeakers = (maxSpeakers > 0)?maxSpeakers:0;
+	return true;
+}
+
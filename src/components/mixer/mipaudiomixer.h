@@ -33,8 +33,9 @@
 #include "mipconfig.h"
 #include "mipcomponent.h"
 #include "miptime.h"
-#include <list>
+#include <vector>
 #include <set>
+#include <map>
 
 class MIPRaw16bitAudioMessage;
 class MIPRawFloatAudioMessage;
@@ -42,8 +43,10 @@ class MIPRawFloatAudioMessage;
 /** This component can mix several audio streams.
  *  Using this component, several audio streams can be mixed. In the default mode, it accepts 
  *  floating point raw audio messages and produces floating point raw audio messages. You
- *  can also work with signed 16 bit native raw audio messages. This component
- *  generates feedback about the current offset in the output stream.
+ *  can also work with signed 16 bit native raw audio messages. In that case the streams
+ *  are summed in 32 bit accumulators and the result is clipped to the 16 bit range, so
+ *  loud mixes saturate instead of wrapping around. This component generates feedback
+ *  about the current offset in the output stream.
  */
 class EMIPLIB_IMPORTEXPORT MIPAudioMixer : public MIPComponent
 {
@@ -94,28 +97,91 @@ public:
 
 	/** Clears the list of sources to ignore. */
 	void clearIgnoreList()									{ m_sourcesToIgnore.clear(); }
+
+	/** Enables or disables mix-minus mode.
+	 *  In mix-minus mode, the sum of all streams is still calculated only once per interval,
+	 *  but instead of a single message the mixer produces one message for every destination.
+	 *  The message for a destination contains the mix without that destination's own 
+	 *  contribution, and its source ID is set to the ID of the destination, so that it can be
+	 *  sent back to the corresponding participant (a MIPOpusEncoder for example keeps a 
+	 *  separate encoder state per source ID). Each source which is heard automatically becomes 
+	 *  a destination, until it hasn't been heard for a minute. Audio which is still waiting to
+	 *  be mixed is discarded when the mode is changed.
+	 *  \param enable Flag indicating if mix-minus mode should be used.
+	 *  \param maxSpeakers If larger than zero, only the streams of this many loudest sources
+	 *                     are mixed, which bounds the mixing cost in large conferences. The
+	 *                     loudness of a source is averaged over a few intervals, so that the
+	 *                     selection does not change too abruptly.
+	 */
+	bool setMixMinus(bool enable, int maxSpeakers = 0);
+
+	/** Returns \c true if mix-minus mode is being used. */
+	bool isMixMinusEnabled() const								{ return m_mixMinus; }
+
+	/** Adds a permanent mix-minus destination.
+	 *  Adds a permanent mix-minus destination, which keeps receiving the mix even if nothing
+	 *  has been heard from it for a long time, for example a participant who is only listening.
+	 */
+	void addMixMinusDestination(uint64_t id)						{ m_destinations[id].m_permanent = true; }
+
+	/** Removes a mix-minus destination. */
+	void removeMixMinusDestination(uint64_t id)						{ m_destinations.erase(id); }
 	
 	bool push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg);
 	bool pull(const MIPComponentChain &chain, int64_t iteration, MIPMessage **pMsg);
 	bool processFeedback(const MIPComponentChain &chain, int64_t feedbackChainID, MIPFeedback *feedback);
 private:
-	class MIPAudioMixerBlock
+	// In mix-minus mode, the samples of each source are kept separately until
+	// the block is played
+	class MIPAudioMixerContribution
 	{
 	public:
-		MIPAudioMixerBlock(int64_t playInterval, float *pFrames)			{ m_interval = playInterval; m_pFloatFrames = pFrames; m_pIntFrames = 0; }
-		MIPAudioMixerBlock(int64_t playInterval, uint16_t *pFrames)			{ m_interval = playInterval; m_pFloatFrames = 0; m_pIntFrames = pFrames; }
-		float *getFramesFloat()								{ return m_pFloatFrames; }
-		uint16_t *getFramesInt()							{ return m_pIntFrames; }
-		int64_t getInterval() const							{ return m_interval; }
-	private:
+		MIPAudioMixerContribution(uint64_t sourceID, float *pFloatFrames, int32_t *pIntFrames)
+		                                                                                { m_sourceID = sourceID; m_pFloatFrames = pFloatFrames; m_pIntFrames = pIntFrames; m_level = 0; m_selected = true; }
+
+		uint64_t m_sourceID;
 		float *m_pFloatFrames;
-		uint16_t *m_pIntFrames;
+		int32_t *m_pIntFrames;
+		double m_level;
+		bool m_selected;
+	};
+
+	// A slot in the circular block store. The slot for interval 'n' is found at
+	// position 'n & m_ringMask', so looking up a block takes constant time.
+	class MIPAudioMixerBlock
+	{
+	public:
+		MIPAudioMixerBlock()								{ m_interval = -1; m_pFloatFrames = 0; m_pIntFrames = 0; }
+		
 		int64_t m_interval;
+		float *m_pFloatFrames;
+		int32_t *m_pIntFrames;
+		std::vector<MIPAudioMixerContribution> m_contributions;
+	};
+
+	class MIPAudioMixerDestination
+	{
+	public:
+		MIPAudioMixerDestination()							{ m_lastInterval = 0; m_level = 0; m_contribution = -1; m_permanent = false; }
+
+		int64_t m_lastInterval;
+		double m_level;
+		int m_contribution;
+		bool m_permanent;
 	};
 	
 	void clearAudioBlocks();
-	void initBlockSearch();
-	MIPAudioMixerBlock searchBlock(int64_t intervalNumber);
+	MIPAudioMixerBlock &getBlock(int64_t intervalNumber);
+	void growBlockRing(int64_t intervalNumber);
+	float *getFreeFloatFrames();
+	int32_t *getFreeIntFrames();
+	MIPAudioMixerContribution &getContribution(MIPAudioMixerBlock &block, uint64_t sourceID);
+	bool pullMixMinus(int64_t iteration, MIPMessage **pMsg);
+	void createMixMinusMessages();
+	void selectSpeakers();
+	void recycleMixMinusFrames();
+	void deleteMixMinusMessages();
+	void resetBlocks();
 	
 	bool m_init;
 	bool m_useTimeInfo;
@@ -133,14 +199,28 @@ private:
 	float *m_pSilenceFramesFloat;
 	uint16_t *m_pSilenceFramesInt;
 	float *m_pBlockFramesFloat;
+	int32_t *m_pBlockFramesAccum;
 	uint16_t *m_pBlockFramesInt;
 
 	MIPTime m_extraDelay;
 	
-	std::list<MIPAudioMixerBlock> m_audioBlocks;
-	std::list<MIPAudioMixerBlock>::iterator m_it;
+	std::vector<MIPAudioMixerBlock> m_blockRing;
+	size_t m_ringMask;
+	std::vector<float *> m_freeFloatFrames;
+	std::vector<int32_t *> m_freeIntFrames;
 
 	std::set<uint64_t> m_sourcesToIgnore;
+
+	bool m_mixMinus;
+	int m_maxSpeakers;
+	std::vector<MIPAudioMixerContribution> m_contributions;
+	std::map<uint64_t, MIPAudioMixerDestination> m_destinations;
+	std::vector<size_t> m_speakerOrder;
+	std::vector<MIPRawFloatAudioMessage *> m_mixMinusMsgsFloat;
+	std::vector<MIPRaw16bitAudioMessage *> m_mixMinusMsgsInt;
+	std::vector<float *> m_mixMinusFramesFloat;
+	std::vector<uint16_t *> m_mixMinusFramesInt, m_freeOutputFramesInt;
+	size_t m_numMixMinusMsgs, m_mixMinusMsgPos;
 };
 
 #endif // MIPAUDIOMIXER_H
@@ -25,6 +25,7 @@
 #include "mipconfig.h"
 #include "mipvideomixer.h"
 #include "mipfeedback.h"
+#include <cmath>
 
 #include "mipdebug.h"
 
@@ -34,11 +35,21 @@
 #define MIPVIDEOMIXER_ERRSTR_CANTSETPLAYBACKTIME			"Can't set playback time in feedback message"
 #define MIPVIDEOMIXER_ERRSTR_DELAYTOOLARGE			"The specified extra delay is too large"
 #define MIPVIDEOMIXER_ERRSTR_NEGATIVEDELAY			"Only positive delays are allowed"
+#define MIPVIDEOMIXER_ERRSTR_BADSIZE				"The width and height of the composited picture must be positive and even"
+
+#define MIPVIDEOMIXER_PIPMARGIN					8
 
 
 MIPVideoMixer::MIPVideoMixer() : MIPComponent("MIPVideoMixer"), m_playTime(0), m_frameTime(0), m_lastCheckTime(0)
 {
 	m_init = false;
+	m_layout = Separate;
+	m_width = 0;
+	m_height = 0;
+	m_mainSourceID = 0;
+	m_pCanvas = 0;
+	m_redrawAll = true;
+	m_prevNumActive = 0;
 }
 
 MIPVideoMixer::~MIPVideoMixer()
@@ -83,6 +94,14 @@ bool MIPVideoMixer::destroy()
 	
 	for (it = m_streams.begin() ; it != m_streams.end() ; it++)
 		delete *it;
+	m_streams.clear();
+	m_activeStreams.clear();
+
+	if (m_pCanvas)
+		m_pCanvas->release();
+	m_pCanvas = 0;
+	m_redrawAll = true;
+	m_prevNumActive = 0;
 	
 	m_init = false;
 	return true;
@@ -145,17 +164,10 @@ bool MIPVideoMixer::push(const MIPComponentChain &chain, int64_t iteration, MIPM
 	else
 		stream = *streamIt;
 	
-	// create a copy of the message
-	
-	int width = pVidMsg->getWidth();
-	int height = pVidMsg->getHeight();
-	int dataSize = (width*height*3)/2;
-	uint8_t *pNewFrameData = new uint8_t [dataSize];
-	
-	MIPRawYUV420PVideoMessage *pNewMsg = new MIPRawYUV420PVideoMessage(width, height, pNewFrameData, true);
+	// create a copy of the message; if the frame is stored in a shared buffer
+	// this only adds a reference to it
 	
-	memcpy(pNewFrameData, pVidMsg->getImageData(), dataSize);
-	pNewMsg->copyMediaInfoFrom(*pVidMsg);
+	MIPRawYUV420PVideoMessage *pNewMsg = static_cast<MIPRawYUV420PVideoMessage *>(pVidMsg->createCopy());
 
 	// insert it
 	
@@ -209,6 +221,13 @@ void MIPVideoMixer::clearOutputMessages()
 
 void MIPVideoMixer::createNewOutputMessages()
 {
+	if (m_layout != Separate)
+	{
+		createCompositeMessage();
+		m_msgIt = m_outputMessages.begin();
+		return;
+	}
+
 	std::list<SourceStream *>::iterator it;
 
 	for (it = m_streams.begin() ; it != m_streams.end() ; it++)
@@ -221,6 +240,248 @@ void MIPVideoMixer::createNewOutputMessages()
 	m_msgIt = m_outputMessages.begin();
 }
 
+void MIPVideoMixer::createCompositeMessage()
+{
+	// Collect the sources which have something to show, the main source first
+
+	std::list<SourceStream *>::iterator it;
+	int mainPos = -1;
+
+	m_activeStreams.clear();
+	for (it = m_streams.begin() ; it != m_streams.end() ; it++)
+	{
+		SourceStream *pStream = *it;
+		MIPRawYUV420PVideoMessage *pMsg = pStream->ExtractMessage(m_curInterval);
+
+		if (pMsg)
+			pStream->setCurrentFrame(pMsg);
+
+		if (pStream->getCurrentFrame())
+		{
+			if (pStream->getSourceID() == m_mainSourceID)
+				mainPos = (int)m_activeStreams.size();
+			m_activeStreams.push_back(pStream);
+		}
+	}
+
+	if (m_activeStreams.empty())
+		return;
+
+	if (mainPos > 0)
+	{
+		SourceStream *pMain = m_activeStreams[mainPos];
+
+		m_activeStreams.erase(m_activeStreams.begin() + mainPos);
+		m_activeStreams.insert(m_activeStreams.begin(), pMain);
+	}
+
+	// If a source was added or removed, or a tile moved, the whole picture is redrawn.
+	// The picture-in-picture tiles are on top of the main one, so they need to be
+	// redrawn whenever the main tile is. Otherwise only the tiles of the sources
+	// with a new frame are rendered again.
+
+	int numActive = (int)m_activeStreams.size();
+	bool redrawAll = m_redrawAll;
+	bool changed = false;
+
+	calculateTiles(numActive, m_tiles);
+	for (int i = 0 ; i < numActive ; i++)
+	{
+		if (m_activeStreams[i]->setTile(m_tiles[i*4], m_tiles[i*4+1], m_tiles[i*4+2], m_tiles[i*4+3]))
+			redrawAll = true;
+		if (m_activeStreams[i]->hasChanged())
+			changed = true;
+	}
+
+	// A source that has disappeared doesn't necessarily move the other tiles
+	if (numActive != m_prevNumActive)
+		redrawAll = true;
+	if (m_layout == PictureInPicture && m_activeStreams[0]->hasChanged())
+		redrawAll = true;
+
+	if (!redrawAll && !changed)
+		return; // same picture as before, nothing to send
+
+	// The previous picture may still be in use further on in the chain, in
+	// which case we continue on a copy of it
+
+	size_t canvasSize = (m_width*m_height*3)/2;
+
+	if (m_pCanvas == 0)
+	{
+		m_pCanvas = MIPSharedBuffer::allocate(canvasSize);
+		redrawAll = true;
+	}
+	else if (m_pCanvas->isShared())
+	{
+		MIPSharedBuffer *pNewCanvas = MIPSharedBuffer::createCopy(m_pCanvas->getData(), canvasSize);
+
+		m_pCanvas->release();
+		m_pCanvas = pNewCanvas;
+	}
+
+	if (redrawAll)
+		MIPYUV420Scaler::fill(m_pCanvas->getData(), m_width, m_height, 0, 0, m_width, m_height, 16, 128, 128);
+
+	for (int i = 0 ; i < numActive ; i++)
+	{
+		SourceStream *pStream = m_activeStreams[i];
+
+		if (redrawAll || pStream->hasChanged())
+			renderTile(pStream);
+		pStream->clearChanged();
+	}
+	m_redrawAll = false;
+	m_prevNumActive = numActive;
+
+	m_pCanvas->addReference();
+
+	MIPRawYUV420PVideoMessage *pMsg = new MIPRawYUV420PVideoMessage(m_width, m_height, m_pCanvas);
+
+	pMsg->setTime(m_playTime);
+	m_outputMessages.push_back(pMsg);
+}
+
+// Stores x, y, width and height of each tile in 'tiles'; everything is kept even
+// because of the chroma subsampling
+void MIPVideoMixer::calculateTiles(int numTiles, std::vector<int> &tiles)
+{
+	tiles.resize(numTiles*4);
+
+	if (m_layout == Grid || numTiles == 1)
+	{
+		int cols = (int)std::ceil(std::sqrt((double)numTiles));
+		int rows = (numTiles + cols - 1)/cols;
+		int tileWidth = (m_width/cols) & ~1;
+		int tileHeight = (m_height/rows) & ~1;
+
+		for (int i = 0 ; i < numTiles ; i++)
+		{
+			tiles[i*4] = (i%cols)*tileWidth;
+			tiles[i*4+1] = (i/cols)*tileHeight;
+			tiles[i*4+2] = tileWidth;
+			tiles[i*4+3] = tileHeight;
+		}
+	}
+	else if (m_layout == ActiveSpeaker)
+	{
+		int mainHeight = ((m_height*3)/4) & ~1;
+		int tileWidth = (m_width/(numTiles-1)) & ~1;
+
+		tiles[0] = 0;
+		tiles[1] = 0;
+		tiles[2] = m_width;
+		tiles[3] = mainHeight;
+
+		for (int i = 1 ; i < numTiles ; i++)
+		{
+			tiles[i*4] = (i-1)*tileWidth;
+			tiles[i*4+1] = mainHeight;
+			tiles[i*4+2] = tileWidth;
+			tiles[i*4+3] = m_height - mainHeight;
+		}
+	}
+	else // PictureInPicture
+	{
+		int tileWidth = (m_width/4) & ~1;
+		int tileHeight = (m_height/4) & ~1;
+		int perRow = (m_width - MIPVIDEOMIXER_PIPMARGIN)/(tileWidth + MIPVIDEOMIXER_PIPMARGIN);
+
+		if (perRow < 1)
+			perRow = 1;
+
+		tiles[0] = 0;
+		tiles[1] = 0;
+		tiles[2] = m_width;
+		tiles[3] = m_height;
+
+		// The small pictures are placed from the bottom right corner to the left, 
+		// and then upwards; the ones that don't fit are not shown
+		for (int i = 1 ; i < numTiles ; i++)
+		{
+			int col = (i-1)%perRow;
+			int row = (i-1)/perRow;
+			int x = m_width - (col+1)*(tileWidth + MIPVIDEOMIXER_PIPMARGIN);
+			int y = m_height - (row+1)*(tileHeight + MIPVIDEOMIXER_PIPMARGIN);
+
+			if (y < 0)
+			{
+				x = 0;
+				y = 0;
+				tileWidth = 0;
+				tileHeight = 0;
+			}
+
+			tiles[i*4] = x;
+			tiles[i*4+1] = y;
+			tiles[i*4+2] = tileWidth;
+			tiles[i*4+3] = tileHeight;
+		}
+	}
+}
+
+void MIPVideoMixer::renderTile(SourceStream *pStream)
+{
+	MIPRawYUV420PVideoMessage *pFrame = pStream->getCurrentFrame();
+	int tileX = pStream->getTileX();
+	int tileY = pStream->getTileY();
+	int tileWidth = pStream->getTileWidth();
+	int tileHeight = pStream->getTileHeight();
+	int srcWidth = pFrame->getWidth();
+	int srcHeight = pFrame->getHeight();
+
+	if (tileWidth < 2 || tileHeight < 2 || srcWidth < 2 || srcHeight < 2)
+		return;
+
+	// Fit the frame in the tile, keeping its aspect ratio
+
+	int width = tileWidth;
+	int height = (int)(((int64_t)tileWidth*srcHeight)/srcWidth) & ~1;
+
+	if (height > tileHeight)
+	{
+		height = tileHeight;
+		width = (int)(((int64_t)tileHeight*srcWidth)/srcHeight) & ~1;
+	}
+
+	if (width < 2 || height < 2)
+		return;
+
+	uint8_t *pCanvas = m_pCanvas->getData();
+
+	if (width != tileWidth || height != tileHeight)
+		MIPYUV420Scaler::fill(pCanvas, m_width, m_height, tileX, tileY, tileWidth, tileHeight, 16, 128, 128);
+
+	int x = tileX + (((tileWidth - width)/2) & ~1);
+	int y = tileY + (((tileHeight - height)/2) & ~1);
+
+	pStream->getScaler().scale(pFrame->getImageData(), srcWidth, srcHeight, pCanvas, m_width, m_height, x, y, width, height);
+}
+
+bool MIPVideoMixer::setLayout(Layout layout, int width, int height)
+{
+	if (layout != Separate)
+	{
+		if (width <= 0 || height <= 0 || (width&1) != 0 || (height&1) != 0)
+		{
+			setErrorString(MIPVIDEOMIXER_ERRSTR_BADSIZE);
+			return false;
+		}
+	}
+
+	if (m_pCanvas && (width != m_width || height != m_height))
+	{
+		m_pCanvas->release();
+		m_pCanvas = 0;
+	}
+
+	m_layout = layout;
+	m_width = width;
+	m_height = height;
+	m_redrawAll = true;
+	return true;
+}
+
 void MIPVideoMixer::deleteOldSources()
 {
 	MIPTime curTime = MIPTime::getCurrentTime();
@@ -235,7 +496,10 @@ void MIPVideoMixer::deleteOldSources()
 	while (it != m_streams.end())
 	{
 		if ((curTime.getValue() - (*it)->getLastInsertTime().getValue()) > 30.0) // remove after 30 seconds of inactivity
+		{
+			delete *it;
 			it = m_streams.erase(it);
+		}
 		else
 			it++;
 	}
@@ -34,16 +34,23 @@
 #include "mipcomponent.h"
 #include "miptime.h"
 #include "miprawvideomessage.h"
+#include "mipyuv420scaler.h"
 #include <list>
+#include <vector>
 
 /** This component creates video output streams.
- *  The name 'mixer' is a bit misleading for this component since it does not
- *  actually mix several video frames into one frame. However, it does work in
- *  a very similar way as the audio mixer, which is the reason for its name.
  *  The component accepts raw video messages in YUV420P format and stores them
  *  in an output queue based on the timing information contained in the messages.
- *  During each interval, a number of raw video frames in YUV420P format is 
- *  produced.
+ *  By default, it does not actually mix several video frames into one frame: during
+ *  each interval, a number of raw video frames in YUV420P format is produced, one for
+ *  each source which has a frame for that interval. It does however work in a very 
+ *  similar way as the audio mixer, which is the reason for its name.
+ *
+ *  Using MIPVideoMixer::setLayout, the component can also composite the most recent frame
+ *  of each source into one picture, like a video conferencing MCU would. In that case, at
+ *  most one frame is produced during each interval, with source ID zero, and only when the
+ *  picture has changed. Only the tiles of the sources that have a new frame are rendered 
+ *  again, the rest of the picture is kept from the previous interval.
  */
 class EMIPLIB_IMPORTEXPORT MIPVideoMixer : public MIPComponent
 {
@@ -69,6 +76,38 @@ public:
 	 *  Using this function, the synchronization can then be adjusted manually.
 	 */
 	bool setExtraDelay(MIPTime t);
+
+	/** The ways in which the video mixer can produce its output. */
+	enum Layout 
+	{ 
+		/** Each source is sent as a separate frame (the default). */
+		Separate,
+		/** All sources are shown in a grid of equally sized tiles. */
+		Grid,
+		/** The main source is shown in a large tile, the other ones in a row below it. */
+		ActiveSpeaker,
+		/** The main source fills the picture, the other ones are shown as small pictures on top of it. */
+		PictureInPicture
+	};
+
+	/** Selects how the output is produced.
+	 *  Selects how the output is produced. For all layouts other than MIPVideoMixer::Separate, the 
+	 *  sources are composited into a single picture, of which the size must be specified. The aspect
+	 *  ratio of each source is preserved, unused parts of the picture are black.
+	 *  \param layout The layout to use.
+	 *  \param width Width of the composited picture, must be even.
+	 *  \param height Height of the composited picture, must be even.
+	 */
+	bool setLayout(Layout layout, int width = 0, int height = 0);
+
+	/** Returns the current layout. */
+	Layout getLayout() const									{ return m_layout; }
+
+	/** Sets the source which is emphasized in the MIPVideoMixer::ActiveSpeaker and MIPVideoMixer::PictureInPicture layouts.
+	 *  Sets the source which is emphasized in the MIPVideoMixer::ActiveSpeaker and MIPVideoMixer::PictureInPicture 
+	 *  layouts. If no frames of this source are available, the first source is used instead.
+	 */
+	void setMainSource(uint64_t sourceID)								{ m_mainSourceID = sourceID; }
 	
 	bool push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg);
 	bool pull(const MIPComponentChain &chain, int64_t iteration, MIPMessage **pMsg);
@@ -88,9 +127,21 @@ private:
 	class SourceStream
 	{
 	public:
-		SourceStream(uint64_t sourceID)							{ m_sourceID = sourceID; }
-		~SourceStream()									{ std::list<VideoFrame>::iterator it; for (it = m_videoFrames.begin() ; it != m_videoFrames.end(); it++) if ((*it).getMessage()) delete (*it).getMessage(); }
+		SourceStream(uint64_t sourceID)							{ m_sourceID = sourceID; m_pCurFrame = 0; m_changed = false; m_tileX = -1; m_tileY = -1; m_tileWidth = -1; m_tileHeight = -1; }
+		~SourceStream()									{ std::list<VideoFrame>::iterator it; for (it = m_videoFrames.begin() ; it != m_videoFrames.end(); it++) if ((*it).getMessage()) delete (*it).getMessage(); delete m_pCurFrame; }
 		uint64_t getSourceID() const							{ return m_sourceID; }
+
+		// Used when compositing: the frame that's currently shown and the tile it's shown in
+		MIPRawYUV420PVideoMessage *getCurrentFrame()					{ return m_pCurFrame; }
+		void setCurrentFrame(MIPRawYUV420PVideoMessage *pMsg)				{ delete m_pCurFrame; m_pCurFrame = pMsg; m_changed = true; }
+		bool hasChanged() const								{ return m_changed; }
+		void clearChanged()								{ m_changed = false; }
+		bool setTile(int x, int y, int w, int h)					{ if (x == m_tileX && y == m_tileY && w == m_tileWidth && h == m_tileHeight) return false; m_tileX = x; m_tileY = y; m_tileWidth = w; m_tileHeight = h; return true; }
+		int getTileX() const								{ return m_tileX; }
+		int getTileY() const								{ return m_tileY; }
+		int getTileWidth() const							{ return m_tileWidth; }
+		int getTileHeight() const							{ return m_tileHeight; }
+		MIPYUV420Scaler &getScaler()							{ return m_scaler; }
 		std::list<VideoFrame> &getFrames()						{ return m_videoFrames; }
 		MIPTime getLastInsertTime() const						{ return m_lastInsertTime; }
 		MIPRawYUV420PVideoMessage *ExtractMessage(int64_t curInterval)
@@ -169,11 +220,18 @@ private:
 		uint64_t m_sourceID;
 		std::list<VideoFrame> m_videoFrames;
 		MIPTime m_lastInsertTime;
+		MIPRawYUV420PVideoMessage *m_pCurFrame;
+		bool m_changed;
+		int m_tileX, m_tileY, m_tileWidth, m_tileHeight;
+		MIPYUV420Scaler m_scaler;
 	};
 
 	bool initFrameSearch(uint64_t sourceID);
 	void clearOutputMessages();
 	void createNewOutputMessages();
+	void createCompositeMessage();
+	void calculateTiles(int numTiles, std::vector<int> &tiles);
+	void renderTile(SourceStream *pStream);
 	void deleteOldSources();
 	
 	bool m_init;
@@ -185,6 +243,15 @@ private:
 	std::list<SourceStream *> m_streams;
 	std::list<MIPRawYUV420PVideoMessage *> m_outputMessages;
 	std::list<MIPRawYUV420PVideoMessage *>::const_iterator m_msgIt;
+
+	Layout m_layout;
+	int m_width, m_height;
+	uint64_t m_mainSourceID;
+	MIPSharedBuffer *m_pCanvas;
+	bool m_redrawAll;
+	int m_prevNumActive;
+	std::vector<SourceStream *> m_activeStreams;
+	std::vector<int> m_tiles;
 };
 
 #endif // MIPVIDEOMIXER_H
@@ -28,7 +28,7 @@
 
 #include "mipopenslesandroidoutput.h"
 #include "miprawaudiomessage.h"
-#include "mipstreambuffer.h"
+#include "mipringbuffer.h"
 #include <vector>
 #include <sstream>
 
@@ -40,6 +40,8 @@ const int numBuffersInQueue = 2;
 #define MIPOPENSLESANDROIDOUTPUT_ERRSTR_NOTINIT "The OpenSL ES audio output component is not initialized"
 #define MIPOPENSLESANDROIDOUTPUT_ERRSTR_NOPULL "Pull is not supported"
 
+#define MIPOPENSLESANDROIDOUTPUT_BUFFEREDBLOCKS 16
+
 MIPOpenSLESAndroidOutput::MIPOpenSLESAndroidOutput() : MIPComponent("MIPOpenSLESAndroidOutput")
 {
 	m_init = false;
@@ -86,7 +88,8 @@ bool MIPOpenSLESAndroidOutput::open(int sampRate, int channels, MIPTime interval
 	m_sampRate = sampRate;
 	m_channels = channels;
 
-	m_pBuffer = new MIPStreamBuffer(m_blockSize, 10);
+	m_pBuffer = new MIPRingBuffer();
+	m_pBuffer->init(m_blockSize*MIPOPENSLESANDROIDOUTPUT_BUFFEREDBLOCKS);
 	m_pThread = new AudioThread(m_pBuffer, m_blockSize, sampRate, channels, interval);
 	if (m_pThread->Start() < 0)
 	{
@@ -185,7 +188,7 @@ bool MIPOpenSLESAndroidOutput::pull(const MIPComponentChain &chain, int64_t iter
 	return false;
 }
 
-MIPOpenSLESAndroidOutput::AudioThread::AudioThread(MIPStreamBuffer *pBuffer, int blockSize, int sampRate, int channels, MIPTime interval)
+MIPOpenSLESAndroidOutput::AudioThread::AudioThread(MIPRingBuffer *pBuffer, int blockSize, int sampRate, int channels, MIPTime interval)
 {
 	m_stopFlag = false;
 	m_successFullyStarted = false;
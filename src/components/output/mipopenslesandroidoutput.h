@@ -42,7 +42,7 @@
 #include <vector>
 #include <atomic>
 
-class MIPStreamBuffer;
+class MIPRingBuffer;
 
 /** TODO
  */
@@ -68,12 +68,12 @@ private:
 	int m_sampRate;
 	int m_channels;
 	int m_blockSize;
-	MIPStreamBuffer *m_pBuffer;
+	MIPRingBuffer *m_pBuffer;
 
 	class AudioThread : public jthread::JThread
 	{
 	public:
-		AudioThread(MIPStreamBuffer *pBuffer, int blockSize, int sampRate, int channels, MIPTime interval);
+		AudioThread(MIPRingBuffer *pBuffer, int blockSize, int sampRate, int channels, MIPTime interval);
 		~AudioThread();
 
 		void *Thread();
@@ -85,7 +85,7 @@ private:
 
 		std::string m_errorString;
 		std::atomic_bool m_stopFlag, m_successFullyStarted;
-		MIPStreamBuffer *m_pBuffer;
+		MIPRingBuffer *m_pBuffer;
 		int m_blockSize;
 		int m_sampRate, m_channels;
 		MIPTime m_interval;
@@ -26,7 +26,7 @@
 
 #ifdef MIPCONFIG_SUPPORT_QT5
 
-#include "mipstreambuffer.h"
+#include "mipringbuffer.h"
 #include "miprawaudiomessage.h"
 #include <QIODevice>
 #include <QAudioOutput>
@@ -58,7 +58,7 @@ public:
 		m_pBuffer = 0;
 	}
 
-	bool init(MIPStreamBuffer *pBuffer, int bytesPerBlock)
+	bool init(MIPRingBuffer *pBuffer, int bytesPerBlock)
 	{
 		if (!pBuffer)
 			return false;
@@ -103,7 +103,7 @@ public:
 		return avail;
 	}
 private:
-	MIPStreamBuffer *m_pBuffer;
+	MIPRingBuffer *m_pBuffer;
 	int m_bytesPerBlock;
 };
 
@@ -200,7 +200,9 @@ bool MIPQt5AudioOutput::open(int samplingRate, int numChannels, MIPTime interval
 		}
 	}
 
-	m_pBuffer = new MIPStreamBuffer(m_bytesPerFrame, 10);
+	// Make sure the buffer can hold the amount of data at which it is reset
+	m_pBuffer = new MIPRingBuffer();
+	m_pBuffer->init(m_bytesPerFrame * (sizeof(int16_t) * m_maxQueuedBuffers + 4));
 	MIPQt5AudioOutput_StreamBufferIODevice *pIODev = new MIPQt5AudioOutput_StreamBufferIODevice();
 	m_pIODev = pIODev;
 	if (!pIODev->init(m_pBuffer, m_bytesPerFrame))
@@ -280,7 +282,7 @@ bool MIPQt5AudioOutput::push(const MIPComponentChain &chain, int64_t iteration,
 
 	if (m_pBuffer->getAmountBuffered() > m_bytesPerFrame * sizeof(int16_t) * m_maxQueuedBuffers)
 	{
-		m_pBuffer->clear();
+		m_pBuffer->requestClear(); // the Qt audio thread will do the actual clearing
 		//cerr << "Data buildup, resetting buffer" << endl;
 	}
 
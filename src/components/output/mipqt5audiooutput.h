@@ -42,7 +42,7 @@
 class QAudioDeviceInfo;
 class QAudioOutput;
 class QIODevice;
-class MIPStreamBuffer;
+class MIPRingBuffer;
 
 /** TODO
  *  note: qt event loop must be running!
@@ -68,7 +68,7 @@ private:
 	int m_sampRate, m_numChannels;
 	int m_bytesPerFrame;
 	int m_maxQueuedBuffers;
-	MIPStreamBuffer *m_pBuffer;
+	MIPRingBuffer *m_pBuffer;
 	QIODevice *m_pIODev;
 	QAudioOutput *m_pAudioOutput;
 };
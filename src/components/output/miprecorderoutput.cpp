@@ -0,0 +1,666 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+#include "mipconfig.h"
+#include "miprecorderoutput.h"
+#include "miprawaudiomessage.h"
+#include "miptime.h"
+#include <string.h>
+#include <stdlib.h>
+#if !(defined(WIN32) || defined(_WIN32_WCE))
+	#include <sys/types.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <errno.h>
+#else
+	#include <stdio.h>
+#endif // !(WIN32 || _WIN32_WCE)
+
+#include "mipdebug.h"
+
+#define MIPRECORDEROUTPUT_ERRSTR_PULLUNSUPPORTED		"Pull is not supported"
+#define MIPRECORDEROUTPUT_ERRSTR_NOTOPEN			"No recording was started"
+#define MIPRECORDEROUTPUT_ERRSTR_ALREADYOPEN			"A recording was already started"
+#define MIPRECORDEROUTPUT_ERRSTR_BADPARAMETERS			"The sampling rate and number of channels must be positive"
+#define MIPRECORDEROUTPUT_ERRSTR_BADMESSAGE			"Only raw audio messages (floating point or signed 16 bit) are supported"
+#define MIPRECORDEROUTPUT_ERRSTR_INCOMPATIBLESAMPLINGRATE	"Sampling rate in audio message is not the same as the sampling rate of the recording"
+#define MIPRECORDEROUTPUT_ERRSTR_INCOMPATIBLECHANNELS		"Number of channels in audio message is not the same as the number of channels of the recording"
+#define MIPRECORDEROUTPUT_ERRSTR_CANTOPENFILE			"Can't create output file "
+#define MIPRECORDEROUTPUT_ERRSTR_ERRORWRITING			"Error writing to output file "
+
+// File offsets and sizes of writes must be multiples of this when O_DIRECT is used.
+// The WAV header is padded to this size, so that the audio data starts at an aligned
+// offset as well.
+#define MIPRECORDEROUTPUT_ALIGNMENT				4096
+
+// Time the writer thread sleeps when no data is available, and the time after which 
+// buffered data is written to disk even if less than a batch is available
+#define MIPRECORDEROUTPUT_WRITERINTERVAL			0.010
+#define MIPRECORDEROUTPUT_FLUSHINTERVAL				1.0
+
+static uint8_t *allocateAligned(size_t size)
+{
+#if !(defined(WIN32) || defined(_WIN32_WCE))
+	void *pMem = 0;
+
+	if (posix_memalign(&pMem, MIPRECORDEROUTPUT_ALIGNMENT, size) != 0)
+		return 0;
+	return (uint8_t *)pMem;
+#else
+	return (uint8_t *)malloc(size);
+#endif // !(WIN32 || _WIN32_WCE)
+}
+
+// A single output file, only used by the writer thread. Audio data is collected in
+// a buffer until MIPRecorderOutput::Track::flush is called.
+
+class MIPRecorderOutput::Track : public MIPErrorBase
+{
+public:
+	Track()
+	{
+#if !(defined(WIN32) || defined(_WIN32_WCE))
+		m_fd = -1;
+#else
+		m_pFile = 0;
+#endif // !(WIN32 || _WIN32_WCE)
+		m_pBuffer = 0;
+		m_bufferSize = 0;
+		m_bufferUsed = 0;
+		m_fileOffset = 0;
+		m_dataBytes = 0;
+		m_directIO = false;
+		m_failed = false;
+	}
+
+	~Track()
+	{
+		close();
+		free(m_pBuffer);
+	}
+
+	bool open(const std::string &fileName, int sampRate, int channels, bool directIO);
+	bool close();
+	bool hasFailed() const									{ return m_failed; }
+	size_t getAmountBuffered() const							{ return m_bufferUsed; }
+
+	// Returns room for 'length' more bytes at the end of the buffer, which are 
+	// added to the track by calling 'commit'
+	uint8_t *getWritePointer(size_t length);
+	void commit(size_t length)								{ m_bufferUsed += length; m_dataBytes += length; }
+
+	// Writes the buffered data; with O_DIRECT, a part which is not a multiple of 
+	// the alignment is kept in the buffer unless 'all' is set
+	bool flush(bool all);
+private:
+	bool isOpen() const;
+	bool writeAt(const uint8_t *pData, size_t length, uint64_t offset);
+	void disableDirectIO();
+	void fillHeader(uint8_t *pHeader);
+
+#if !(defined(WIN32) || defined(_WIN32_WCE))
+	int m_fd;
+#else
+	FILE *m_pFile;
+#endif // !(WIN32 || _WIN32_WCE)
+	std::string m_fileName;
+	int m_sampRate, m_channels;
+	uint8_t *m_pBuffer;
+	size_t m_bufferSize, m_bufferUsed;
+	uint64_t m_fileOffset, m_dataBytes;
+	bool m_directIO;
+	bool m_failed;
+};
+
+bool MIPRecorderOutput::Track::open(const std::string &fileName, int sampRate, int channels, bool directIO)
+{
+	m_fileName = fileName;
+	m_sampRate = sampRate;
+	m_channels = channels;
+	m_directIO = false;
+
+#if !(defined(WIN32) || defined(_WIN32_WCE))
+	int flags = O_WRONLY|O_CREAT|O_TRUNC;
+
+#ifdef O_DIRECT
+	if (directIO)
+	{
+		m_fd = ::open(fileName.c_str(), flags|O_DIRECT, 0644);
+		if (m_fd >= 0)
+			m_directIO = true;
+	}
+#endif // O_DIRECT
+
+	if (m_fd < 0) // also used if the file system doesn't support O_DIRECT
+		m_fd = ::open(fileName.c_str(), flags, 0644);
+#else
+	m_pFile = fopen(fileName.c_str(), "wb");
+#endif // !(WIN32 || _WIN32_WCE)
+
+	if (!isOpen())
+	{
+		m_failed = true;
+		setErrorString(std::string(MIPRECORDEROUTPUT_ERRSTR_CANTOPENFILE) + fileName);
+		return false;
+	}
+
+	m_bufferSize = MIPRECORDEROUTPUT_BATCHSIZE + MIPRECORDEROUTPUT_ALIGNMENT;
+	m_pBuffer = allocateAligned(m_bufferSize);
+
+	// The header is written again with the correct sizes when the file is closed, but 
+	// this way the data can start at an aligned offset
+
+	fillHeader(m_pBuffer);
+	m_bufferUsed = MIPRECORDEROUTPUT_ALIGNMENT;
+
+	return true;
+}
+
+bool MIPRecorderOutput::Track::close()
+{
+	if (!isOpen())
+		return !m_failed;
+
+	bool ok = flush(true);
+
+	if (ok)
+	{
+		// Rewrite the header with the sizes; this is a small unaligned write
+		disableDirectIO();
+
+		uint8_t header[MIPRECORDEROUTPUT_ALIGNMENT];
+
+		fillHeader(header);
+		ok = writeAt(header, MIPRECORDEROUTPUT_ALIGNMENT, 0);
+	}
+
+#if !(defined(WIN32) || defined(_WIN32_WCE))
+	if (::close(m_fd) != 0)
+		ok = false;
+	m_fd = -1;
+#else
+	if (fclose(m_pFile) != 0)
+		ok = false;
+	m_pFile = 0;
+#endif // !(WIN32 || _WIN32_WCE)
+
+	if (!ok)
+	{
+		m_failed = true;
+		setErrorString(std::string(MIPRECORDEROUTPUT_ERRSTR_ERRORWRITING) + m_fileName);
+	}
+	return ok;
+}
+
+uint8_t *MIPRecorderOutput::Track::getWritePointer(size_t length)
+{
+	if (m_bufferUsed + length > m_bufferSize)
+	{
+		size_t newSize = m_bufferUsed + length + MIPRECORDEROUTPUT_BATCHSIZE;
+		uint8_t *pNewBuffer = allocateAligned(newSize);
+
+		memcpy(pNewBuffer, m_pBuffer, m_bufferUsed);
+		free(m_pBuffer);
+		m_pBuffer = pNewBuffer;
+		m_bufferSize = newSize;
+	}
+	return m_pBuffer + m_bufferUsed;
+}
+
+bool MIPRecorderOutput::Track::flush(bool all)
+{
+	if (!isOpen())
+		return false;
+
+	size_t amount = m_bufferUsed;
+
+	if (m_directIO)
+	{
+		if (all)
+		{
+			if (amount % MIPRECORDEROUTPUT_ALIGNMENT != 0)
+				disableDirectIO();
+		}
+		else
+			amount -= amount % MIPRECORDEROUTPUT_ALIGNMENT;
+	}
+
+	if (amount == 0)
+		return true;
+
+	if (!writeAt(m_pBuffer, amount, m_fileOffset))
+	{
+		m_failed = true;
+		setErrorString(std::string(MIPRECORDEROUTPUT_ERRSTR_ERRORWRITING) + m_fileName);
+		return false;
+	}
+
+	m_fileOffset += amount;
+	m_bufferUsed -= amount;
+	if (m_bufferUsed > 0)
+		memmove(m_pBuffer, m_pBuffer + amount, m_bufferUsed);
+
+	return true;
+}
+
+bool MIPRecorderOutput::Track::isOpen() const
+{
+#if !(defined(WIN32) || defined(_WIN32_WCE))
+	return (m_fd >= 0);
+#else
+	return (m_pFile != 0);
+#endif // !(WIN32 || _WIN32_WCE)
+}
+
+bool MIPRecorderOutput::Track::writeAt(const uint8_t *pData, size_t length, uint64_t offset)
+{
+#if !(defined(WIN32) || defined(_WIN32_WCE))
+	while (length > 0)
+	{
+		ssize_t num = pwrite(m_fd, pData, length, (off_t)offset);
+
+		if (num < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		if (num == 0)
+			return false;
+
+		pData += num;
+		length -= (size_t)num;
+		offset += (uint64_t)num;
+	}
+	return true;
+#else
+	if (fseek(m_pFile, (long)offset, SEEK_SET) != 0)
+		return false;
+	return (fwrite(pData, 1, length, m_pFile) == length);
+#endif // !(WIN32 || _WIN32_WCE)
+}
+
+void MIPRecorderOutput::Track::disableDirectIO()
+{
+#if !(defined(WIN32) || defined(_WIN32_WCE)) && defined(O_DIRECT)
+	if (m_directIO)
+	{
+		int flags = fcntl(m_fd, F_GETFL);
+
+		if (flags != -1)
+			fcntl(m_fd, F_SETFL, flags & ~O_DIRECT);
+		m_directIO = false;
+	}
+#endif // !(WIN32 || _WIN32_WCE) && O_DIRECT
+}
+
+void MIPRecorderOutput::Track::fillHeader(uint8_t *pHeader)
+{
+	// A 16 bit PCM WAV header, with a JUNK chunk between the format and data
+	// chunks to pad it to MIPRECORDEROUTPUT_ALIGNMENT bytes
+
+	uint64_t dataBytes = m_dataBytes;
+
+	if (dataBytes > 0xffffffffULL - MIPRECORDEROUTPUT_ALIGNMENT)
+		dataBytes = 0xffffffffULL - MIPRECORDEROUTPUT_ALIGNMENT;
+
+	uint32_t values[8] = { (uint32_t)(dataBytes + MIPRECORDEROUTPUT_ALIGNMENT - 8),		// RIFF size, at offset 4
+	                       16,									// fmt size, at 16
+	                       (uint32_t)(1 | (m_channels << 16)),					// PCM format and channels, at 20
+	                       (uint32_t)m_sampRate,							// at 24
+	                       (uint32_t)(m_sampRate*m_channels*2),					// bytes per second, at 28
+	                       (uint32_t)((m_channels*2) | (16 << 16)),				// block align and bits per sample, at 32
+	                       MIPRECORDEROUTPUT_ALIGNMENT - 44 - 8,					// JUNK size, at 40
+	                       (uint32_t)dataBytes };							// data size, at 4092
+	size_t offsets[8] = { 4, 16, 20, 24, 28, 32, 40, MIPRECORDEROUTPUT_ALIGNMENT - 4 };
+
+	memset(pHeader, 0, MIPRECORDEROUTPUT_ALIGNMENT);
+	memcpy(pHeader, "RIFF", 4);
+	memcpy(pHeader + 8, "WAVE", 4);
+	memcpy(pHeader + 12, "fmt ", 4);
+	memcpy(pHeader + 36, "JUNK", 4);
+	memcpy(pHeader + MIPRECORDEROUTPUT_ALIGNMENT - 8, "data", 4);
+
+	for (int i = 0 ; i < 8 ; i++)
+	{
+		for (int j = 0 ; j < 4 ; j++)
+			pHeader[offsets[i] + j] = (uint8_t)((values[i] >> (j*8)) & 0xff);
+	}
+}
+
+MIPRecorderOutput::MIPRecorderOutput() : MIPComponent("MIPRecorderOutput"), m_droppedFrames(0), m_stopThread(false), m_writerFailed(false)
+{
+	m_init = false;
+}
+
+MIPRecorderOutput::~MIPRecorderOutput()
+{
+	close();
+}
+
+bool MIPRecorderOutput::open(const std::string &fileNamePrefix, int sampRate, int channels, bool directIO, int bufferSize)
+{
+	if (m_init)
+	{
+		setErrorString(MIPRECORDEROUTPUT_ERRSTR_ALREADYOPEN);
+		return false;
+	}
+
+	if (sampRate <= 0 || channels <= 0)
+	{
+		setErrorString(MIPRECORDEROUTPUT_ERRSTR_BADPARAMETERS);
+		return false;
+	}
+
+	if (!m_ringBuffer.init(bufferSize))
+	{
+		setErrorString(m_ringBuffer.getErrorString());
+		return false;
+	}
+
+	m_fileNamePrefix = fileNamePrefix;
+	m_sampRate = sampRate;
+	m_channels = channels;
+	m_directIO = directIO;
+	m_droppedFrames = 0;
+	m_stopThread = false;
+	m_writerFailed = false;
+	m_writerErrorString = std::string("");
+	m_havePendingHeader = false;
+
+	m_thread = std::thread(&MIPRecorderOutput::writerThread, this);
+
+	m_init = true;
+	return true;
+}
+
+bool MIPRecorderOutput::close()
+{
+	if (!m_init)
+	{
+		setErrorString(MIPRECORDEROUTPUT_ERRSTR_NOTOPEN);
+		return false;
+	}
+
+	// The writer thread stores everything that's still in the ring buffer before it exits
+	m_stopThread.store(true, std::memory_order_release);
+	m_thread.join();
+
+	m_ringBuffer.destroy();
+	m_conversionBuffer.clear();
+	m_discardBuffer.clear();
+	m_init = false;
+
+	if (m_writerFailed.load(std::memory_order_acquire))
+	{
+		setErrorString(m_writerErrorString);
+		return false;
+	}
+	return true;
+}
+
+bool MIPRecorderOutput::push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg)
+{
+	if (!m_init)
+	{
+		setErrorString(MIPRECORDEROUTPUT_ERRSTR_NOTOPEN);
+		return false;
+	}
+
+	if (m_writerFailed.load(std::memory_order_acquire))
+	{
+		setErrorString(m_writerErrorString);
+		return false;
+	}
+
+	uint32_t subtype = pMsg->getMessageSubtype();
+
+	if (!(pMsg->getMessageType() == MIPMESSAGE_TYPE_AUDIO_RAW && (subtype == MIPRAWAUDIOMESSAGE_TYPE_FLOAT ||
+	      subtype == MIPRAWAUDIOMESSAGE_TYPE_S16 || subtype == MIPRAWAUDIOMESSAGE_TYPE_S16LE || subtype == MIPRAWAUDIOMESSAGE_TYPE_S16BE)))
+	{
+		setErrorString(MIPRECORDEROUTPUT_ERRSTR_BADMESSAGE);
+		return false;
+	}
+
+	MIPAudioMessage *pAudioMsg = (MIPAudioMessage *)pMsg;
+
+	if (pAudioMsg->getSamplingRate() != m_sampRate)
+	{
+		setErrorString(MIPRECORDEROUTPUT_ERRSTR_INCOMPATIBLESAMPLINGRATE);
+		return false;
+	}
+	if (pAudioMsg->getNumberOfChannels() != m_channels)
+	{
+		setErrorString(MIPRECORDEROUTPUT_ERRSTR_INCOMPATIBLECHANNELS);
+		return false;
+	}
+
+	int numFrames = pAudioMsg->getNumberOfFrames();
+	size_t numSamples = (size_t)numFrames*(size_t)m_channels;
+	RecordHeader header;
+
+	header.m_sourceID = pAudioMsg->getSourceID();
+	header.m_length = (uint32_t)(numSamples*sizeof(int16_t));
+	header.m_reserved = 0;
+
+	// Only complete messages are stored; if there's no room we drop the message
+	// rather than wait for the writer thread. Since only this thread adds data,
+	// the available room can't shrink between this check and the writes below.
+
+	if ((size_t)(m_ringBuffer.getCapacity() - m_ringBuffer.getAmountBuffered()) < sizeof(RecordHeader) + header.m_length)
+	{
+		m_droppedFrames.fetch_add(numFrames, std::memory_order_relaxed);
+		return true;
+	}
+
+	const void *pData = 0;
+
+	if (subtype == MIPRAWAUDIOMESSAGE_TYPE_FLOAT)
+	{
+		const float *pFrames = ((MIPRawFloatAudioMessage *)pAudioMsg)->getFrames();
+
+		if (m_conversionBuffer.size() < numSamples)
+			m_conversionBuffer.resize(numSamples);
+
+		for (size_t i = 0 ; i < numSamples ; i++)
+		{
+			float v = pFrames[i]*32767.0f;
+
+			if (v > 32767.0f)
+				v = 32767.0f;
+			else if (v < -32768.0f)
+				v = -32768.0f;
+			m_conversionBuffer[i] = (int16_t)v;
+		}
+		pData = &m_conversionBuffer[0];
+	}
+	else
+	{
+		const uint16_t *pFrames = ((MIPRaw16bitAudioMessage *)pAudioMsg)->getFrames();
+#ifndef MIPCONFIG_BIGENDIAN
+		bool swap = (subtype == MIPRAWAUDIOMESSAGE_TYPE_S16BE);
+#else
+		bool swap = (subtype != MIPRAWAUDIOMESSAGE_TYPE_S16LE);
+#endif // MIPCONFIG_BIGENDIAN
+
+		if (swap)
+		{
+			if (m_conversionBuffer.size() < numSamples)
+				m_conversionBuffer.resize(numSamples);
+
+			for (size_t i = 0 ; i < numSamples ; i++)
+				m_conversionBuffer[i] = (int16_t)((pFrames[i] >> 8) | (pFrames[i] << 8));
+			pData = &m_conversionBuffer[0];
+		}
+		else
+			pData = pFrames;
+	}
+
+	m_ringBuffer.write(&header, sizeof(RecordHeader));
+	if (header.m_length > 0)
+		m_ringBuffer.write(pData, (int)header.m_length);
+
+	return true;
+}
+
+bool MIPRecorderOutput::pull(const MIPComponentChain &chain, int64_t iteration, MIPMessage **pMsg)
+{
+	setErrorString(MIPRECORDEROUTPUT_ERRSTR_PULLUNSUPPORTED);
+	return false;
+}
+
+void MIPRecorderOutput::writerThread()
+{
+	MIPTime lastFlushTime = MIPTime::getCurrentTime();
+	bool done = false;
+
+	while (!done)
+	{
+		// Read the flag first: anything that was pushed before close was called is
+		// in the ring buffer by then, and will still be processed
+		bool stop = m_stopThread.load(std::memory_order_acquire);
+
+		if (processRecords())
+			continue;
+
+		if (stop)
+			done = true;
+		else
+		{
+			MIPTime curTime = MIPTime::getCurrentTime();
+
+			if (curTime.getValue() - lastFlushTime.getValue() > MIPRECORDEROUTPUT_FLUSHINTERVAL)
+			{
+				// Don't keep data in memory too long, in case the application crashes
+				for (auto it = m_tracks.begin() ; it != m_tracks.end() ; it++)
+				{
+					Track *pTrack = (*it).second;
+
+					if (!pTrack->hasFailed() && !pTrack->flush(false))
+						setWriterError(pTrack->getErrorString());
+				}
+				lastFlushTime = curTime;
+			}
+
+			MIPTime::wait(MIPTime(MIPRECORDEROUTPUT_WRITERINTERVAL));
+		}
+	}
+
+	closeTracks();
+}
+
+bool MIPRecorderOutput::processRecords()
+{
+	bool gotRecord = false;
+
+	while (true)
+	{
+		if (!m_havePendingHeader)
+		{
+			if (m_ringBuffer.getAmountBuffered() < (int)sizeof(RecordHeader))
+				break;
+
+			m_ringBuffer.read(&m_pendingHeader, sizeof(RecordHeader));
+			m_havePendingHeader = true;
+		}
+
+		// The producer writes the data right after the header, so if it's not
+		// complete yet, it will be soon
+		if (m_ringBuffer.getAmountBuffered() < (int)m_pendingHeader.m_length)
+			break;
+
+		size_t length = m_pendingHeader.m_length;
+		Track *pTrack = getTrack(m_pendingHeader.m_sourceID);
+
+		if (pTrack->hasFailed())
+		{
+			if (m_discardBuffer.size() < length)
+				m_discardBuffer.resize(length);
+			if (length > 0)
+				m_ringBuffer.read(&m_discardBuffer[0], (int)length);
+		}
+		else
+		{
+			uint8_t *pDst = pTrack->getWritePointer(length);
+
+			m_ringBuffer.read(pDst, (int)length);
+			pTrack->commit(length);
+
+			if (pTrack->getAmountBuffered() >= MIPRECORDEROUTPUT_BATCHSIZE)
+			{
+				if (!pTrack->flush(false))
+					setWriterError(pTrack->getErrorString());
+			}
+		}
+
+		m_havePendingHeader = false;
+		gotRecord = true;
+	}
+	return gotRecord;
+}
+
+MIPRecorderOutput::Track *MIPRecorderOutput::getTrack(uint64_t sourceID)
+{
+	auto it = m_tracks.find(sourceID);
+
+	if (it != m_tracks.end())
+		return (*it).second;
+
+	// If the file can't be created, the failed track is kept so that we don't
+	// try again for each message of this source
+
+	Track *pTrack = new Track();
+
+	if (!pTrack->open(m_fileNamePrefix + std::to_string(sourceID) + std::string(".wav"), m_sampRate, m_channels, m_directIO))
+		setWriterError(pTrack->getErrorString());
+
+	m_tracks[sourceID] = pTrack;
+	return pTrack;
+}
+
+void MIPRecorderOutput::setWriterError(const std::string &errStr)
+{
+	// Only the first error is kept, it's made visible to the chain thread
+	// by the release store
+	if (m_writerFailed.load(std::memory_order_relaxed))
+		return;
+
+	m_writerErrorString = errStr;
+	m_writerFailed.store(true, std::memory_order_release);
+}
+
+void MIPRecorderOutput::closeTracks()
+{
+	for (auto it = m_tracks.begin() ; it != m_tracks.end() ; it++)
+	{
+		Track *pTrack = (*it).second;
+
+		if (!pTrack->hasFailed() && !pTrack->close())
+			setWriterError(pTrack->getErrorString());
+		delete pTrack;
+	}
+	m_tracks.clear();
+}
+
@@ -0,0 +1,138 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+/**
+ * \file miprecorderoutput.h
+ */
+
+#ifndef MIPRECORDEROUTPUT_H
+
+#define MIPRECORDEROUTPUT_H
+
+#include "mipconfig.h"
+#include "mipcomponent.h"
+#include "mipringbuffer.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <thread>
+
+/** Default size of the buffer between the chain thread and the writer thread (4 MB). */
+#define MIPRECORDEROUTPUT_DEFAULTBUFFERSIZE					(4*1024*1024)
+
+/** Amount of audio data that is collected for a track before it is written to disk (256 kB). */
+#define MIPRECORDEROUTPUT_BATCHSIZE						(256*1024)
+
+/** A sound file output component which writes to disk in a background thread.
+ *  This component records incoming audio to 16 bit PCM WAV files, one file for each
+ *  source ID, so that each participant of a conversation ends up in a separate track.
+ *  Unlike MIPWAVOutput, no file access is done in the thread of the component chain:
+ *  the push function only copies the audio data into a lock-free ring buffer, and a
+ *  dedicated writer thread takes it from there, collects it per track and writes it
+ *  to disk in large sequential blocks. A slow disk therefore cannot stall the chain.
+ *
+ *  If the writer thread can't keep up and the ring buffer is full, incoming frames are
+ *  dropped (see MIPRecorderOutput::getNumberOfDroppedFrames) instead of blocking the chain.
+ *  When the writer thread fails to create or write a file, the next call to the push
+ *  function reports the error.
+ *
+ *  Incoming messages should be raw audio messages, either floating point or signed 16 bit,
+ *  with the sampling rate and number of channels specified in MIPRecorderOutput::open. No
+ *  messages are generated by this component.
+ */
+class EMIPLIB_IMPORTEXPORT MIPRecorderOutput : public MIPComponent
+{
+public:
+	MIPRecorderOutput();
+	~MIPRecorderOutput();
+
+	/** Starts a recording.
+	 *  Starts a recording and the writer thread. The file for a source is only created when
+	 *  the first audio message for that source arrives.
+	 *  \param fileNamePrefix The name of the file for a source is this prefix, followed by the 
+	 *                        source ID as a decimal number and the extension \c .wav
+	 *  \param sampRate The sampling rate.
+	 *  \param channels The number of channels.
+	 *  \param directIO If \c true, the files are opened with \c O_DIRECT so that the written
+	 *                  data bypasses the page cache. This is only available on platforms which
+	 *                  support it, and is silently ignored for file systems which don't.
+	 *  \param bufferSize The size in bytes of the buffer between the chain thread and the
+	 *                    writer thread.
+	 */
+	bool open(const std::string &fileNamePrefix, int sampRate, int channels, bool directIO = false,
+	          int bufferSize = MIPRECORDEROUTPUT_DEFAULTBUFFERSIZE);
+
+	/** Stops the recording.
+	 *  Stops the recording: the writer thread stores all remaining audio data, completes
+	 *  the WAV headers and closes the files before this function returns.
+	 */
+	bool close();
+
+	/** Returns the number of frames which had to be dropped because the buffer to the writer thread was full. */
+	int64_t getNumberOfDroppedFrames() const						{ return m_droppedFrames.load(std::memory_order_relaxed); }
+
+	bool push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg);
+	bool pull(const MIPComponentChain &chain, int64_t iteration, MIPMessage **pMsg);
+private:
+	class Track;
+
+	// Precedes the audio data of each message in the ring buffer
+	struct RecordHeader
+	{
+		uint64_t m_sourceID;
+		uint32_t m_length;
+		uint32_t m_reserved;
+	};
+
+	void writerThread();
+	bool processRecords();
+	Track *getTrack(uint64_t sourceID);
+	void setWriterError(const std::string &errStr);
+	void closeTracks();
+
+	bool m_init;
+	std::string m_fileNamePrefix;
+	int m_sampRate;
+	int m_channels;
+	bool m_directIO;
+
+	MIPRingBuffer m_ringBuffer;
+	std::vector<int16_t> m_conversionBuffer;
+	std::atomic<int64_t> m_droppedFrames;
+
+	std::thread m_thread;
+	std::atomic<bool> m_stopThread;
+	std::atomic<bool> m_writerFailed;
+	std::string m_writerErrorString;
+
+	// Only used by the writer thread
+	std::unordered_map<uint64_t, Track *> m_tracks;
+	RecordHeader m_pendingHeader;
+	bool m_havePendingHeader;
+	std::vector<uint8_t> m_discardBuffer;
+};
+
+#endif // MIPRECORDEROUTPUT_H
+
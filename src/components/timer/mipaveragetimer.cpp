@@ -51,6 +51,35 @@ void MIPAverageTimer::reset()
 }
 
 bool MIPAverageTimer::push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg)
+{
+	if (!checkChain(chain))
+		return false;
+
+	if (!(pMsg->getMessageType() == MIPMESSAGE_TYPE_SYSTEM && pMsg->getMessageSubtype() == MIPSYSTEMMESSAGE_TYPE_WAITTIME))
+	{
+		setErrorString(MIPAVERAGETIMER_ERRSTR_BADMESSAGE);
+		return false;
+	}
+
+	// Waiting for an absolute deadline on the monotonic clock makes sure that
+	// adjustments of the system clock don't affect the timing. When the chain is
+	// run by a MIPChainScheduler, the deadline has already passed.
+	MIPTime::waitUntil(getDeadline(iteration));
+	
+	m_gotMsg = false;
+	return true;
+}
+
+bool MIPAverageTimer::getWakeUpTime(const MIPComponentChain &chain, int64_t iteration, MIPTime *pWakeUpTime)
+{
+	if (!checkChain(chain))
+		return false;
+
+	*pWakeUpTime = getDeadline(iteration);
+	return true;
+}
+
+bool MIPAverageTimer::checkChain(const MIPComponentChain &chain)
 {
 	if (m_pChain == 0)
 	{
@@ -65,28 +94,15 @@ bool MIPAverageTimer::push(const MIPComponentChain &chain, int64_t iteration, MI
 			return false;
 		}
 	}
-
-	if (!(pMsg->getMessageType() == MIPMESSAGE_TYPE_SYSTEM && pMsg->getMessageSubtype() == MIPSYSTEMMESSAGE_TYPE_WAITTIME))
-	{
-		setErrorString(MIPAVERAGETIMER_ERRSTR_BADMESSAGE);
-		return false;
-	}
-
-	MIPTime curTime = MIPTime::getCurrentTime();
-	real_t diff = (m_startTime.getValue()+((real_t)iteration)*m_interval.getValue())-curTime.getValue();
-//	std::cout << "Current time: " << curtime.getString() << std::endl;
-//	std::cout << "Starttime time: " << mStartTime.getString() << std::endl;
-//	std::cout << "Iteration: " << iteration << std::endl;
-//	std::cout << "Interval: " << mInterval.getString() << std::endl;
-//	std::cout << "diff: " << diff << std::endl;
-	
-	if (diff > 0)
-		MIPTime::wait(MIPTime(diff));
-	
-	m_gotMsg = false;
 	return true;
 }
 
+MIPTime MIPAverageTimer::getDeadline(int64_t iteration) const
+{
+	// Calculating the deadline from the start time in integer nanoseconds avoids drift
+	return MIPTime::fromNanoSeconds(m_startTime.getNanoSeconds() + iteration*m_interval.getNanoSeconds());
+}
+
 bool MIPAverageTimer::pull(const MIPComponentChain &chain, int64_t iteration, MIPMessage **pMsg)
 {
 	if (m_pChain != &chain)
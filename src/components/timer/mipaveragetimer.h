@@ -41,7 +41,8 @@ class MIPComponentChain;
  *  This is a simple timing component which accepts MIPSYSTEMMESSAGE_WAITTIME system
  *  messages. It generates a MIPSYSTEMMESSAGE_ISTIME system message each time the
  *  specified interval has elapsed. Note that this is only on average after each interval:
- *  fluctuation will be present.
+ *  fluctuation will be present. This component can also be used as the start of a chain
+ *  that is run by a MIPChainScheduler.
  */
 class EMIPLIB_IMPORTEXPORT MIPAverageTimer : public MIPComponent
 {
@@ -57,7 +58,11 @@ public:
 	void reset();
 	bool push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg);
 	bool pull(const MIPComponentChain &chain, int64_t iteration, MIPMessage **pMsg);
+	bool getWakeUpTime(const MIPComponentChain &chain, int64_t iteration, MIPTime *pWakeUpTime);
 private:
+	bool checkChain(const MIPComponentChain &chain);
+	MIPTime getDeadline(int64_t iteration) const;
+
 	const MIPComponentChain *m_pChain;
 	MIPTime m_startTime, m_interval;
 	MIPSystemMessage m_timeMsg;
@@ -24,7 +24,9 @@
 
 #include "mipconfig.h"
 #include "mipaudiofilter.h"
+#include "mipsharedbuffer.h"
 #include <math.h>
+#include <string.h>
 
 #include "mipdebug.h"
 
@@ -32,10 +34,18 @@
 #define MIPAUDIOFILTER_ERRSTR_BADMESSAGETYPE			"Component requires floating point raw audio messages"
 #define MIPAUDIOFILTER_ERRSTR_BADNUMCHANNELS			"Received an audio message containing a wrong number of channels"
 #define MIPAUDIOFILTER_ERRSTR_BADNUMFRAMES			"Received an audio message containing a wrong amount of samples"
+#define MIPAUDIOFILTER_ERRSTR_BADPARAMETERS			"Invalid sampling rate, number of channels or interval"
+#define MIPAUDIOFILTER_ERRSTR_BADRESPONSE			"The frequency response must contain the same number of frequencies and gains, with frequencies in increasing order"
 
-MIPAudioFilter::MIPAudioFilter() : MIPComponent("MIPAudioFilter")
+#define MIPAUDIOFILTER_PI 3.14159265358979323846
+
+MIPAudioFilter::MIPAudioFilter() : MIPOutputMessageQueueWithState("MIPAudioFilter")
 {
 	m_init = false;
+	m_useLow = false;
+	m_useHigh = false;
+	m_useMiddle = false;
+	m_filterChanged = true;
 }
 
 MIPAudioFilter::~MIPAudioFilter()
@@ -48,42 +58,79 @@ bool MIPAudioFilter::init(int sampRate, int channels, MIPTime interval)
 	if (m_init)
 		cleanUp();
 
+	int numFrames = (int)(interval.getValue()*(real_t)sampRate+0.5);
+
+	if (sampRate < 1 || channels < 1 || numFrames < 1)
+	{
+		setErrorString(MIPAUDIOFILTER_ERRSTR_BADPARAMETERS);
+		return false;
+	}
+
 	m_useLow = false;
 	m_useHigh = false;
 	m_useMiddle = false;
-	m_sampRate = sampRate; // TODO: perform check
-	m_channels = channels; // TODO: perform check
+	m_responseFrequencies.clear();
+	m_responseGains.clear();
+	m_sampRate = sampRate;
+	m_channels = channels;
 
-	m_numFrames = (int)(interval.getValue()*(real_t)sampRate+0.5);
+	m_numFrames = numFrames;
 	m_audioSize = m_numFrames*channels;
 	
-	m_pAM = new float[m_numFrames*m_numFrames];
-	m_pBM = new float[m_numFrames*m_numFrames];
-	m_pA = new float[m_numFrames];
-	m_pB = new float[m_numFrames];
+	// The FFT must be large enough to hold the linear convolution of a block
+	// and the filter; using at least twice the block size leaves room for a
+	// filter which is about as long as a block
+	
+	m_fftSize = 64;
+	while (m_fftSize < 2*m_numFrames)
+		m_fftSize <<= 1;
 
-#define MIPAUDIOFILTER_PI 3.14159265358979323844
+	m_filterLength = m_fftSize - m_numFrames + 1;
+	if ((m_filterLength & 1) == 0) // use an odd length so the delay is a whole number of samples
+		m_filterLength--;
+	m_tailSize = m_fftSize - m_numFrames;
 
-	int pos = 0;
-	for (int n = 0 ; n < m_numFrames ; n++)
+	if (!m_fft.init(m_fftSize))
 	{
-		for (int i = 0 ; i < m_numFrames ; i++)
-		{
-			m_pAM[i+n*m_numFrames] = (float)cosl(((real_t)(n*i))*MIPAUDIOFILTER_PI/(real_t)m_numFrames);
-			m_pBM[i+n*m_numFrames] = (float)sinl(((real_t)(n*i))*MIPAUDIOFILTER_PI/(real_t)m_numFrames);
-		}
+		setErrorString(m_fft.getErrorString());
+		return false;
 	}
-	
-	m_pBuf = new float[m_numFrames];
-	m_period = (float)(interval.getValue());
-	
-	m_prevIteration = -1;
-	m_msgIt = m_messages.begin();
+
+	m_filterSpectrum.resize(m_fftSize+2);
+	m_spectrumBuffer.resize(m_fftSize+2);
+	m_timeBuffer.resize(m_fftSize);
+
+	MIPOutputMessageQueueWithState::init(60.0);
+
+	m_filterChanged = true;
 	m_init = true;
 	
 	return true;
 }
 
+bool MIPAudioFilter::setFrequencyResponse(const std::vector<float> &frequencies, const std::vector<float> &gains)
+{
+	if (frequencies.size() != gains.size() || frequencies.empty())
+	{
+		setErrorString(MIPAUDIOFILTER_ERRSTR_BADRESPONSE);
+		return false;
+	}
+
+	for (size_t i = 1 ; i < frequencies.size() ; i++)
+	{
+		if (frequencies[i] < frequencies[i-1])
+		{
+			setErrorString(MIPAUDIOFILTER_ERRSTR_BADRESPONSE);
+			return false;
+		}
+	}
+
+	m_responseFrequencies = frequencies;
+	m_responseGains = gains;
+	m_filterChanged = true;
+	return true;
+}
+
 bool MIPAudioFilter::push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg)
 {
 	if (!m_init)
@@ -114,153 +161,142 @@ bool MIPAudioFilter::push(const MIPComponentChain &chain, int64_t iteration, MIP
 		setErrorString(MIPAUDIOFILTER_ERRSTR_BADNUMCHANNELS);
 		return false;
 	}
+
+	checkIteration(iteration);
+
+	if (m_filterChanged)
+		buildFilter();
+
+	uint64_t sourceID = pAudioMsg->getSourceID();
+	FilterStateInfo *pStateInfo = (FilterStateInfo *)findState(sourceID);
+
+	if (pStateInfo == 0)
+	{
+		pStateInfo = new FilterStateInfo(m_tailSize*m_channels);
+
+		if (!MIPOutputMessageQueueWithState::addState(sourceID, pStateInfo))
+			return false; // shouldn't happen, error message already set
+	}
+
+	pStateInfo->setUpdateTime();
 	
 	const float *pSamplesFloatIn = pAudioMsg->getFrames();
-	float *pSamplesFloat = new float[m_audioSize];
+	MIPSharedBuffer *pBuffer = MIPSharedBuffer::allocate(sizeof(float)*m_audioSize);
+	float *pSamplesFloat = (float *)pBuffer->getData();
+	float *pTime = &(m_timeBuffer[0]);
+	float *pSpectrum = &(m_spectrumBuffer[0]);
 
 	for (int channel = 0 ; channel < m_channels ; channel++)
 	{
+		float *pOverlap = pStateInfo->getOverlap() + channel*m_tailSize;
 		int pos = channel;
-		for (int i = 0 ; i < m_numFrames ; i++, pos += m_channels)
-			m_pBuf[i] = pSamplesFloatIn[pos];
-		
-		for (int n = 0 ; n < m_numFrames ; n++)
-		{
-			float a = 0;
-			float b = 0;
-			for (int i = 0 ; i < m_numFrames ; i++)
-			{
-				a += m_pAM[i+n*m_numFrames]*m_pBuf[i];
-				b += m_pBM[i+n*m_numFrames]*m_pBuf[i];
-			}
-			m_pA[n] = a;
-			m_pB[n] = b;
-		}
-
-	
-		if (m_useLow)
-		{
-			int idx = (int)(m_period*m_lowFreq+0.5f);
-
-			if (idx > numFrames-1)
-				idx = numFrames-1;
-
-			for (int n = 0 ; n <= idx ; n++)
-			{
-				m_pA[n] = 0;
-				m_pB[n] = 0;
-			}
-		}
-		
-		if (m_useHigh)
-		{
-			int idx = (int)(m_period*m_highFreq+0.5f);
 
-			if (idx < 0)
-				idx = 0;
-
-			for (int n = idx ; n < numFrames ; n++)
-			{
-				m_pA[n] = 0;
-				m_pB[n] = 0;
-			}
-		}
+		for (int i = 0 ; i < m_numFrames ; i++, pos += m_channels)
+			pTime[i] = pSamplesFloatIn[pos];
+		memset(pTime + m_numFrames, 0, sizeof(float)*(m_fftSize - m_numFrames));
 
-		if (m_useMiddle)
-		{
-			int idx1 = (int)(m_period*m_midLowFreq+0.5f);
-			int idx2 = (int)(m_period*m_midHighFreq+0.5f);
-
-			if (idx1 < 0)
-				idx1 = 0;
-			if (idx2 > numFrames-1)
-				idx2 = numFrames-1;
-
-			for (int n = idx1 ; n <= idx2 ; n++)
-			{
-				m_pA[n] = 0;
-				m_pB[n] = 0;
-			}
-		}
+		m_fft.forward(pTime, pSpectrum);
+		m_fft.multiply(pSpectrum, &(m_filterSpectrum[0]), pSpectrum);
+		m_fft.inverse(pSpectrum, pTime);
 
 		pos = channel;
 		for (int i = 0 ; i < m_numFrames ; i++, pos += m_channels)
+			pSamplesFloat[pos] = pTime[i] + pOverlap[i];
+
+		// shift the remaining part of the previous tail and add the new one
+		for (int i = 0 ; i < m_tailSize ; i++)
 		{
-			float f1 = 0;
-			float f2 = 0;
-			for (int n = 0 ; n < m_numFrames ; n++)
-			{
-				f1 += m_pAM[n+i*m_numFrames]*m_pA[n];
-				f2 += m_pBM[n+i*m_numFrames]*m_pB[n];
-			}
-			pSamplesFloat[pos] = ((f1+f2)/(float)m_numFrames);
+			float prev = (i + m_numFrames < m_tailSize)?pOverlap[i + m_numFrames]:0;
+
+			pOverlap[i] = prev + pTime[m_numFrames + i];
 		}
 	}
 
-	MIPAudioMessage *pNewMsg = new MIPRawFloatAudioMessage(0,0,0,pSamplesFloat,true);
+	MIPAudioMessage *pNewMsg = new MIPRawFloatAudioMessage(m_sampRate, m_channels, m_numFrames, pBuffer);
 	pNewMsg->copyAudioInfoFrom(*pAudioMsg);
 
-	if (m_prevIteration != iteration)
-	{
-		m_prevIteration = iteration;
-		clearMessages();
-	}
-
-	m_messages.push_back(pNewMsg);
-	m_msgIt = m_messages.begin();
+	MIPOutputMessageQueueWithState::addToOutputQueue(pNewMsg, true);
 	
 	return true;
 }
 
-bool MIPAudioFilter::pull(const MIPComponentChain &chain, int64_t iteration, MIPMessage **pMsg)
-{
-	if (!m_init)
-	{
-		setErrorString(MIPAUDIOFILTER_ERRSTR_NOTINIT);
-		return false;
-	}
-
-	if (m_prevIteration != iteration)
-	{
-		m_prevIteration = iteration;
-		clearMessages();
-	}
-
-	if (m_msgIt == m_messages.end())
-	{
-		*pMsg = 0;
-		m_msgIt = m_messages.begin();
-	}
-	else
-	{
-		*pMsg = *m_msgIt;
-		m_msgIt++;
-	}
-	return true;
-}
-
 void MIPAudioFilter::cleanUp()
 {
 	if (!m_init)
 		return;
 
-	delete [] m_pAM;
-	delete [] m_pBM;
-	delete [] m_pA;
-	delete [] m_pB;
-	delete [] m_pBuf;
-	clearMessages();
+	MIPOutputMessageQueueWithState::clear();
 	
 	m_init = false;
 }
 
-void MIPAudioFilter::clearMessages()
+float MIPAudioFilter::getGain(float frequency) const
+{
+	if (m_useLow && frequency < m_lowFreq)
+		return 0;
+	if (m_useHigh && frequency > m_highFreq)
+		return 0;
+	if (m_useMiddle && frequency >= m_midLowFreq && frequency <= m_midHighFreq)
+		return 0;
+
+	size_t num = m_responseFrequencies.size();
+
+	if (num == 0)
+		return 1.0f;
+	if (frequency <= m_responseFrequencies[0])
+		return m_responseGains[0];
+	if (frequency >= m_responseFrequencies[num-1])
+		return m_responseGains[num-1];
+
+	size_t i = 1;
+	while (m_responseFrequencies[i] < frequency)
+		i++;
+
+	float f0 = m_responseFrequencies[i-1];
+	float f1 = m_responseFrequencies[i];
+
+	if (f1 <= f0)
+		return m_responseGains[i];
+
+	float frac = (frequency - f0)/(f1 - f0);
+
+	return m_responseGains[i-1] + frac*(m_responseGains[i] - m_responseGains[i-1]);
+}
+
+void MIPAudioFilter::buildFilter()
 {
-	std::list<MIPAudioMessage *>::iterator it;
+	int numBins = m_fftSize/2+1;
+	float *pSpectrum = &(m_spectrumBuffer[0]);
+	float *pTime = &(m_timeBuffer[0]);
+
+	// Sample the desired (zero phase) response at the FFT bins, the inverse
+	// transform then gives a circular impulse response centered around zero
+
+	for (int k = 0 ; k < numBins ; k++)
+	{
+		float frequency = ((float)k*(float)m_sampRate)/(float)m_fftSize;
+
+		pSpectrum[2*k] = getGain(frequency);
+		pSpectrum[2*k+1] = 0;
+	}
+	m_fft.inverse(pSpectrum, pTime);
+
+	// Shift the central part of the response to obtain a causal filter and
+	// apply a Blackman window to limit the ripple caused by truncation
+
+	std::vector<float> impulseResponse(m_fftSize, 0);
+	int center = m_filterLength/2;
+	
+	for (int n = 0 ; n < m_filterLength ; n++)
+	{
+		int idx = (n - center + m_fftSize) % m_fftSize;
+		double x = 2.0*MIPAUDIOFILTER_PI*(double)n/(double)(m_filterLength-1);
+		double w = 0.42 - 0.5*cos(x) + 0.08*cos(2.0*x);
+
+		impulseResponse[n] = (float)(pTime[idx]*w);
+	}
 
-	for (it = m_messages.begin() ; it != m_messages.end() ; it++)
-		delete (*it);
-	m_messages.clear();
-	m_msgIt = m_messages.begin();
+	m_fft.forward(&(impulseResponse[0]), &(m_filterSpectrum[0]));
+	m_filterChanged = false;
 }
 
@@ -31,18 +31,30 @@
 #define MIPAUDIOFILTER_H
 
 #include "mipconfig.h"
-#include "mipcomponent.h"
+#include "mipoutputmessagequeuewithstate.h"
 #include "miprawaudiomessage.h"
 #include "miptime.h"
-#include <list>
+#include "mipfft.h"
+#include <vector>
 
 class MIPAudioMessage;
 
-/** Removes a frequency range from raw floating point audio.
- *  Removes a frequency range from audio messages.
+/** Filters frequency ranges from raw floating point audio.
+ *  Removes frequency ranges from audio messages, or shapes the spectrum according
+ *  to an arbitrary frequency response curve.
  *  It accepts floating point raw audio messages and produces similar audio messages.
+ *
+ *  The requested response is turned into a windowed linear phase FIR filter which
+ *  is applied using FFT based fast convolution, and the tail of each block is
+ *  overlap-added to the next block of the same source, so block boundaries do not
+ *  introduce discontinuities. As a consequence, the audio is delayed by about half
+ *  the filter length (see MIPAudioFilter::getFilterDelay). Messages from different
+ *  sources are filtered independently.
+ *
+ *  The filter settings can be changed while the component is in use; when the
+ *  component chain is running, do so while the component is locked.
  */
-class EMIPLIB_IMPORTEXPORT MIPAudioFilter : public MIPComponent
+class EMIPLIB_IMPORTEXPORT MIPAudioFilter : public MIPOutputMessageQueueWithState
 {
 public:
 	MIPAudioFilter();
@@ -57,42 +69,65 @@ public:
 	bool init(int sampRate, int channels, MIPTime interval);
 
 	/** This will remove frequencies below \c frequency from the audio messages. */
-	void setLowFilter(float frequency)						{ m_lowFreq = frequency; m_useLow = true; }
+	void setLowFilter(float frequency)						{ m_lowFreq = frequency; m_useLow = true; m_filterChanged = true; }
 
 	/** This will remove frequencies above \c frequency from the audio messages. */
-	void setHighFilter(float frequency)						{ m_highFreq = frequency; m_useHigh = true; }
+	void setHighFilter(float frequency)						{ m_highFreq = frequency; m_useHigh = true; m_filterChanged = true; }
 
 	/** This will remove frequencies between \c lowFrequency and \c highFrequency from the audio messages. */
-	void setMiddleFilter(float lowFrequency, float highFrequency)			{ m_midLowFreq = lowFrequency; m_midHighFreq = highFrequency; m_useMiddle = true; }
+	void setMiddleFilter(float lowFrequency, float highFrequency)			{ m_midLowFreq = lowFrequency; m_midHighFreq = highFrequency; m_useMiddle = true; m_filterChanged = true; }
 
 	/** Disables the low frequency filter. */
-	void clearLowFilter()								{ m_useLow = false; }
+	void clearLowFilter()								{ m_useLow = false; m_filterChanged = true; }
 
 	/** Disables the high frequency filter. */
-	void clearHighFilter()								{ m_useHigh = false; }
+	void clearHighFilter()								{ m_useHigh = false; m_filterChanged = true; }
 
 	/** Disables the frequency range filter. */
-	void clearMiddleFilter()							{ m_useMiddle = false; }
+	void clearMiddleFilter()							{ m_useMiddle = false; m_filterChanged = true; }
+
+	/** Sets an arbitrary frequency response.
+	 *  Sets an arbitrary frequency response, which is applied in addition to the
+	 *  low, high and middle filters.
+	 *  \param frequencies Frequencies (in Hz) at which the response is specified, in increasing order.
+	 *  \param gains The linear gain at each of these frequencies. In between, the gain
+	 *               is interpolated linearly; outside the range the nearest value is used.
+	 */
+	bool setFrequencyResponse(const std::vector<float> &frequencies, const std::vector<float> &gains);
+
+	/** Removes the frequency response set by MIPAudioFilter::setFrequencyResponse. */
+	void clearFrequencyResponse()							{ m_responseFrequencies.clear(); m_responseGains.clear(); m_filterChanged = true; }
+
+	/** Returns the delay introduced by the filter, which is only valid after initialization. */
+	MIPTime getFilterDelay() const							{ return MIPTime((real_t)(m_filterLength/2)/(real_t)m_sampRate); }
 
 	bool push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg);
-	bool pull(const MIPComponentChain &chain, int64_t iteration, MIPMessage **pMsg);
 private:
+	class FilterStateInfo : public MIPStateInfo
+	{
+	public:
+		FilterStateInfo(int size)							{ m_overlap.resize(size, 0); }
+		float *getOverlap()								{ return &(m_overlap[0]); }
+	private:
+		std::vector<float> m_overlap;
+	};
+
 	void cleanUp();
-	void clearMessages();
+	void buildFilter();
+	float getGain(float frequency) const;
 
 	bool m_useLow, m_useHigh, m_useMiddle;
 	float m_lowFreq, m_highFreq, m_midLowFreq, m_midHighFreq;
+	std::vector<float> m_responseFrequencies, m_responseGains;
+	bool m_filterChanged;
 	
 	bool m_init;
 	int m_sampRate, m_channels;
 	int m_audioSize, m_numFrames;
-	float *m_pAM, *m_pBM;
-	float *m_pA, *m_pB;
-	float *m_pBuf;
-	float m_period;
-	std::list<MIPAudioMessage *> m_messages;
-	std::list<MIPAudioMessage *>::const_iterator m_msgIt;
-	int64_t m_prevIteration;
+	int m_fftSize, m_filterLength, m_tailSize;
+	MIPFFT m_fft;
+	std::vector<float> m_filterSpectrum;
+	std::vector<float> m_timeBuffer, m_spectrumBuffer;
 };
 
 #endif // MIPAUDIOFILTER_H
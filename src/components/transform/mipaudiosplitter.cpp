@@ -25,6 +25,8 @@
 #include "mipconfig.h"
 #include "mipaudiosplitter.h"
 #include "miprawaudiomessage.h"
+#include "mipcomponentchain.h"
+#include "mipmessagearena.h"
 
 #include "mipdebug.h"
 
@@ -62,10 +64,7 @@ void MIPAudioSplitter::cleanUp()
 
 void MIPAudioSplitter::clearMessages()
 {
-	std::list<MIPAudioMessage *>::iterator it;
-
-	for (it = m_messages.begin() ; it != m_messages.end() ; it++)
-		delete (*it);
+	// The messages themselves are stored in the chain's message arena
 	m_messages.clear();
 	m_msgIt = m_messages.begin();
 }
@@ -112,11 +111,11 @@ bool MIPAudioSplitter::push(const MIPComponentChain &chain, int64_t iteration, M
 				num = numFramesLeft;
 			int numSamples = num * numChannels;
 			
-			float *pOutputFrames = new float [numSamples];
+			float *pOutputFrames = chain.getMessageArena().allocateArray<float>(numSamples);
 
 			memcpy(pOutputFrames, pInputFrames, numSamples*sizeof(float));
 
-			MIPRawFloatAudioMessage *pNewMsg = new MIPRawFloatAudioMessage(sampRate, numChannels, num, pOutputFrames, true);
+			MIPRawFloatAudioMessage *pNewMsg = chain.getMessageArena().createMessage<MIPRawFloatAudioMessage>(sampRate, numChannels, num, pOutputFrames, false);
 			pNewMsg->setTime(t);
 			pNewMsg->setSourceID(sourceID);
 			m_messages.push_back(pNewMsg);
@@ -138,11 +137,11 @@ bool MIPAudioSplitter::push(const MIPComponentChain &chain, int64_t iteration, M
 				num = numFramesLeft;
 			int numSamples = num * numChannels;
 			
-			uint8_t *pOutputFrames = new uint8_t [numSamples];
+			uint8_t *pOutputFrames = chain.getMessageArena().allocateArray<uint8_t>(numSamples);
 
 			memcpy(pOutputFrames, pInputFrames, numSamples*sizeof(uint8_t));
 
-			MIPRawU8AudioMessage *pNewMsg = new MIPRawU8AudioMessage(sampRate, numChannels, num, pOutputFrames, true);
+			MIPRawU8AudioMessage *pNewMsg = chain.getMessageArena().createMessage<MIPRawU8AudioMessage>(sampRate, numChannels, num, pOutputFrames, false);
 			pNewMsg->setTime(t);
 			pNewMsg->setSourceID(sourceID);
 			m_messages.push_back(pNewMsg);
@@ -169,11 +168,11 @@ bool MIPAudioSplitter::push(const MIPComponentChain &chain, int64_t iteration, M
 				num = numFramesLeft;
 			int numSamples = num * numChannels;
 			
-			uint16_t *pOutputFrames = new uint16_t [numSamples];
+			uint16_t *pOutputFrames = chain.getMessageArena().allocateArray<uint16_t>(numSamples);
 
 			memcpy(pOutputFrames, pInputFrames, numSamples*sizeof(uint16_t));
 
-			MIPRaw16bitAudioMessage *pNewMsg = new MIPRaw16bitAudioMessage(sampRate, numChannels, num, isSigned, sampEnc, pOutputFrames, true);
+			MIPRaw16bitAudioMessage *pNewMsg = chain.getMessageArena().createMessage<MIPRaw16bitAudioMessage>(sampRate, numChannels, num, isSigned, sampEnc, pOutputFrames, false);
 			pNewMsg->setTime(t);
 			pNewMsg->setSourceID(sourceID);
 			m_messages.push_back(pNewMsg);
@@ -33,7 +33,7 @@
 #include "mipconfig.h"
 #include "mipcomponent.h"
 #include "miptime.h"
-#include <list>
+#include <vector>
 
 class MIPAudioMessage;
 
@@ -62,8 +62,8 @@ private:
 
 	bool m_init;
 	MIPTime m_interval;
-	std::list<MIPAudioMessage *> m_messages;
-	std::list<MIPAudioMessage *>::const_iterator m_msgIt;
+	std::vector<MIPAudioMessage *> m_messages;
+	std::vector<MIPAudioMessage *>::const_iterator m_msgIt;
 	int64_t m_prevIteration;
 };
 
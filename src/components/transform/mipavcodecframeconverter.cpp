@@ -242,7 +242,8 @@ bool MIPAVCodecFrameConverter::push(const MIPComponentChain &chain, int64_t iter
 
 	if (m_targetSubtype == MIPRAWVIDEOMESSAGE_TYPE_YUV420P)
 	{
-		uint8_t *pData = new uint8_t[(targetWidth*targetHeight*3)/2];
+		MIPSharedBuffer *pBuffer = MIPSharedBuffer::allocate((targetWidth*targetHeight*3)/2);
+		uint8_t *pData = pBuffer->getData();
 		uint8_t *pDstPointers[3];
 		int dstStrides[3];
 	
@@ -255,7 +256,7 @@ bool MIPAVCodecFrameConverter::push(const MIPComponentChain &chain, int64_t iter
 
 		sws_scale(pCache->getSwsContext(), pSrcPointers, srcStrides, 0, height, pDstPointers, dstStrides);
 
-		pNewMsg = new MIPRawYUV420PVideoMessage(targetWidth, targetHeight, pData, true);
+		pNewMsg = new MIPRawYUV420PVideoMessage(targetWidth, targetHeight, pBuffer);
 	}
 	else if (m_targetSubtype == MIPRAWVIDEOMESSAGE_TYPE_RGB24)
 	{
@@ -34,6 +34,8 @@
 #include "mipaudio3dbase.h"
 #include <cmath>
 #include <list>
+#include <vector>
+#include <algorithm>
 
 /** Base class for HRIR based 3D audio components. */
 class EMIPLIB_IMPORTEXPORT MIPHRIRBase : public MIPAudio3DBase
@@ -59,6 +61,7 @@ protected:
 			m_numRight = numRight;
 			m_azimuthRad = (((real_t)azimuth)/180.0)*MIPAUDIO3DBASE_CONST_PI;
 			m_elevationRad = (((real_t)elevation)/180.0)*MIPAUDIO3DBASE_CONST_PI;
+			m_spectraBlockSize = 0;
 		}
 		~HRIRData()
 		{
@@ -75,17 +78,26 @@ protected:
 		float *getRightChannel() const							{ return m_pRightChannel; }
 		int getNumberOfLeftSamples() const						{ return m_numLeft; }
 		int getNumberOfRightSamples() const						{ return m_numRight; }
+
+		// Spectra of the filter partitions, as used by a partitioned convolution
+		// with a specific block size
+		int getSpectraBlockSize() const							{ return m_spectraBlockSize; }
+		void setSpectraBlockSize(int s)							{ m_spectraBlockSize = s; }
+		std::vector<float> &getLeftSpectra()						{ return m_leftSpectra; }
+		std::vector<float> &getRightSpectra()						{ return m_rightSpectra; }
 	private:
 		real_t m_radius, m_azimuthRad, m_elevationRad;
 		int m_azimuth, m_elevation;
 		int m_numLeft, m_numRight;
 		float *m_pLeftChannel, *m_pRightChannel;
+		int m_spectraBlockSize;
+		std::vector<float> m_leftSpectra, m_rightSpectra;
 	};
 	
 	class HRIRInfo
 	{
 	public:
-		HRIRInfo(int subjectNumber)							{ m_subjectNumber = subjectNumber; }
+		HRIRInfo(int subjectNumber)							{ m_subjectNumber = subjectNumber; m_indexBuilt = false; }
 		~HRIRInfo()
 		{
 			std::list<HRIRData *>::iterator it;
@@ -113,38 +125,143 @@ protected:
 				return false;
 			
 			m_HRIRSet.push_back(new HRIRData(radius, azimuth, elevation, pLeftChannel, numLeft, pRightChannel, numRight));
+			m_indexBuilt = false;
 			return true;
 		}
 
-		// both azimuth and elevation in radians
-		HRIRData *findBestMatch(real_t azimuth, real_t elevation)
+		const std::list<HRIRData *> &getHRIRSet() const					{ return m_HRIRSet; }
+
+		// Finds the (at most four) measurements surrounding a direction, together with
+		// their interpolation weights, which sum to one. Azimuth and elevation in radians.
+		int findNeighbours(real_t azimuth, real_t elevation, HRIRData *pData[4], real_t weights[4])
 		{
-			std::list<HRIRData *>::const_iterator it;
-			real_t minDist = 2.0*MIPAUDIO3DBASE_CONST_PI;
-			HRIRData *bestData = 0;
-			
-			for (it = m_HRIRSet.begin() ; it != m_HRIRSet.end() ; it++)
+			if (!m_indexBuilt)
+				buildIndex();
+			if (m_rings.empty())
+				return 0;
+
+			azimuth = fmod(azimuth, 2.0*MIPAUDIO3DBASE_CONST_PI);
+			if (azimuth < 0)
+				azimuth += 2.0*MIPAUDIO3DBASE_CONST_PI;
+
+			size_t ring1 = 0;
+
+			while (ring1 < m_rings.size() && m_rings[ring1].m_elevation < elevation)
+				ring1++;
+
+			int num = 0;
+
+			if (ring1 == 0 || ring1 == m_rings.size()) // outside the measured range, use the closest ring
+			{
+				size_t r = (ring1 == 0)?0:(ring1-1);
+
+				num = addRingNeighbours(m_rings[r], azimuth, 1.0, pData, weights, num);
+			}
+			else
+			{
+				const HRIRRing &r0 = m_rings[ring1-1];
+				const HRIRRing &r1 = m_rings[ring1];
+				real_t t = (elevation - r0.m_elevation)/(r1.m_elevation - r0.m_elevation);
+
+				num = addRingNeighbours(r0, azimuth, 1.0-t, pData, weights, num);
+				num = addRingNeighbours(r1, azimuth, t, pData, weights, num);
+			}
+			return num;
+		}
+	private:
+		// The measurements at the same elevation, sorted by azimuth
+		class HRIRRing
+		{
+		public:
+			real_t m_elevation;
+			std::vector<real_t> m_azimuths;
+			std::vector<HRIRData *> m_data;
+		};
+
+		static bool compareData(const HRIRData *pData1, const HRIRData *pData2)
+		{
+			if (pData1->getElevation() != pData2->getElevation())
+				return pData1->getElevation() < pData2->getElevation();
+			return normalizeAzimuth(pData1->getAzimuth()) < normalizeAzimuth(pData2->getAzimuth());
+		}
+
+		static int normalizeAzimuth(int azimuth)
+		{
+			azimuth %= 360;
+			return (azimuth < 0)?(azimuth+360):azimuth;
+		}
+
+		void buildIndex()
+		{
+			std::vector<HRIRData *> sortedData(m_HRIRSet.begin(), m_HRIRSet.end());
+
+			std::sort(sortedData.begin(), sortedData.end(), compareData);
+
+			m_rings.clear();
+			for (size_t i = 0 ; i < sortedData.size() ; i++)
 			{
-				real_t A2 = (*it)->getAzimuthRadians();
-				real_t E2 = (*it)->getElevationRadians();
+				HRIRData *pData = sortedData[i];
 
-				real_t b = MIPAUDIO3DBASE_CONST_PI/2.0-elevation;
-				real_t c = MIPAUDIO3DBASE_CONST_PI/2.0-E2;
-					
-				real_t cosDist = cos(b)*cos(c) + sin(b)*sin(c)*cos(A2-azimuth);
-				real_t dist = acos(cosDist);
+				if (m_rings.empty() || m_rings.back().m_data[0]->getElevation() != pData->getElevation())
+				{
+					m_rings.push_back(HRIRRing());
+					m_rings.back().m_elevation = pData->getElevationRadians();
+				}
+				m_rings.back().m_azimuths.push_back((((real_t)normalizeAzimuth(pData->getAzimuth()))/180.0)*MIPAUDIO3DBASE_CONST_PI);
+				m_rings.back().m_data.push_back(pData);
+			}
+			m_indexBuilt = true;
+		}
+
+		// Adds the two measurements on the ring around 'azimuth', which must lie in [0, 2*pi)
+		static int addRingNeighbours(const HRIRRing &ring, real_t azimuth, real_t ringWeight, HRIRData *pData[4], 
+		                             real_t weights[4], int num)
+		{
+			size_t count = ring.m_azimuths.size();
+			size_t i1 = std::upper_bound(ring.m_azimuths.begin(), ring.m_azimuths.end(), azimuth) - ring.m_azimuths.begin();
+			size_t i0 = (i1 == 0)?(count-1):(i1-1);
 
-				if (dist < minDist)
+			if (i1 == count)
+				i1 = 0;
+
+			real_t a0 = ring.m_azimuths[i0];
+			real_t span = ring.m_azimuths[i1] - a0;
+			real_t offset = azimuth - a0;
+
+			if (span <= 0) // wraps around, or only one measurement on this ring
+				span += 2.0*MIPAUDIO3DBASE_CONST_PI;
+			if (offset < 0)
+				offset += 2.0*MIPAUDIO3DBASE_CONST_PI;
+
+			real_t t = (i0 == i1)?0:(offset/span);
+
+			num = addNeighbour(ring.m_data[i0], ringWeight*(1.0-t), pData, weights, num);
+			num = addNeighbour(ring.m_data[i1], ringWeight*t, pData, weights, num);
+			return num;
+		}
+
+		static int addNeighbour(HRIRData *pNew, real_t weight, HRIRData *pData[4], real_t weights[4], int num)
+		{
+			if (weight <= 0)
+				return num;
+
+			for (int i = 0 ; i < num ; i++)
+			{
+				if (pData[i] == pNew)
 				{
-					minDist = dist;
-					bestData = (*it);
+					weights[i] += weight;
+					return num;
 				}
 			}
-			return bestData;
+			pData[num] = pNew;
+			weights[num] = weight;
+			return num+1;
 		}
-	private:
+
 		int m_subjectNumber;
 		std::list<HRIRData *> m_HRIRSet;
+		std::vector<HRIRRing> m_rings;
+		bool m_indexBuilt;
 	};
 };
 
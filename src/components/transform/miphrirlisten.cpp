@@ -28,6 +28,7 @@
 #include "mipdirectorybrowser.h"
 #include "mipwavreader.h"
 #include "mipcompat.h"
+#include <string.h>
 
 #include "mipdebug.h"
 
@@ -45,6 +46,8 @@
 #define MIPHRIRLISTEN_ERRSTR_NOHRIRMATCHFOUND			"Couldn't find a suitable set of HRIR data"
 #define MIPHRIRLISTEN_ERRSTR_CANTOPENINITIALDIRECTORY		"Can't open the initial directory"
 
+#define MIPHRIRLISTEN_STATETIMEOUT				60.0
+
 MIPHRIRListen::MIPHRIRListen() : MIPHRIRBase("MIPHRIRListen")
 {
 	m_init = false;
@@ -90,6 +93,8 @@ bool MIPHRIRListen::init(const std::string &baseDirectory, int maxFilterLength,
 	m_ambient = allowAmbientSound;
 	m_useDistance = useDistance;
 	m_maxFilterLength = maxFilterLength;
+	m_blockSize = 0;
+	m_lastStateExpireTime = MIPTime::getCurrentTime();
 	m_init = true;
 	
 	return true;
@@ -104,6 +109,7 @@ bool MIPHRIRListen::destroy()
 	}
 	
 	clearMessages();
+	clearSourceStates();
 	clearHRIRSets();
 	MIPAudio3DBase::cleanUp();
 	m_pCurHRIRSet = 0;
@@ -152,6 +158,10 @@ bool MIPHRIRListen::selectHRIRSet(int subjectNumber, bool compensated)
 		return false;
 	}
 
+	// The filters of the new set may be longer, the convolution will be set up
+	// again for the next message
+	m_blockSize = 0;
+
 	return true;
 }
 
@@ -168,6 +178,7 @@ bool MIPHRIRListen::push(const MIPComponentChain &chain, int64_t iteration, MIPM
 		clearMessages();
 		m_prevIteration = iteration;
 		expirePositionalInfo();
+		expireSourceStates();
 	}
 
 	if (!(pMsg->getMessageType() == MIPMESSAGE_TYPE_AUDIO_RAW && pMsg->getMessageSubtype() == MIPRAWAUDIOMESSAGE_TYPE_FLOAT))
@@ -221,10 +232,13 @@ bool MIPHRIRListen::push(const MIPComponentChain &chain, int64_t iteration, MIPM
 	}
 	else // entry found, add 3D effect
 	{
-		// look up the HRIR set to use
+		// look up the HRIR data to use
 
-		HRIRData *pHRIRData = m_pCurHRIRSet->findBestMatch(azimuth,elevation);
-		if (pHRIRData == 0)
+		HRIRData *pHRIRData[4];
+		real_t weights[4];
+		int numHRIRData = m_pCurHRIRSet->findNeighbours(azimuth, elevation, pHRIRData, weights);
+
+		if (numHRIRData == 0)
 		{
 			setErrorString(MIPHRIRLISTEN_ERRSTR_NOHRIRMATCHFOUND);
 			return false;
@@ -237,38 +251,42 @@ bool MIPHRIRListen::push(const MIPComponentChain &chain, int64_t iteration, MIPM
 			if (distance < 0.50)
 				distance = 0.50;
 
-			factor = pHRIRData->getRadius()/distance;
+			factor = pHRIRData[0]->getRadius()/distance;
 		}
 
-		float *pLeftChannel = pHRIRData->getLeftChannel();
-		float *pRightChannel = pHRIRData->getRightChannel();
 		const float *pFrames = pAudioMsg->getFrames();
 		int numFrames = pAudioMsg->getNumberOfFrames();
-		int numHRIRRightSamples = pHRIRData->getNumberOfRightSamples();
-		int numHRIRLeftSamples = pHRIRData->getNumberOfLeftSamples();
 
-		if (m_maxFilterLength > 0)
+		if (numFrames != m_blockSize)
 		{
-			if (numHRIRLeftSamples > m_maxFilterLength) 
-				numHRIRLeftSamples = m_maxFilterLength;
-			if (numHRIRRightSamples > m_maxFilterLength) 
-				numHRIRRightSamples = m_maxFilterLength;
+			if (!setupConvolution(numFrames))
+				return false;
 		}
-		
-		int numRightSamples = numFrames + numHRIRRightSamples - 1;
-		int numLeftSamples = numFrames + numHRIRLeftSamples - 1;
 
-	
-		int maxSamples = (numRightSamples > numLeftSamples) ? numRightSamples:numLeftSamples;
-		float *pNewFrames = new float [maxSamples*2]; // stereo sound
+		uint64_t sourceID = pAudioMsg->getSourceID();
+		SourceState *pState = 0;
+		auto it = m_sourceStates.find(sourceID);
 
-		// Perform the convolution
-		
-		convolve(pNewFrames,maxSamples,(float)factor,pFrames,numFrames,pLeftChannel,numHRIRLeftSamples,pRightChannel,numHRIRRightSamples);
+		if (it == m_sourceStates.end())
+		{
+			pState = new SourceState(m_numPartitions, m_spectrumSize, m_blockSize-1);
+			m_sourceStates[sourceID] = pState;
+		}
+		else
+		{
+			pState = it->second;
+			pState->m_lastUpdateTime = MIPTime::getCurrentTime();
+		}
+
+		updateFilter(pState, pHRIRData, weights, numHRIRData);
+
+		float *pNewFrames = new float [numFrames*2]; // stereo sound
+
+		filterBlock(pState, pFrames, (float)factor, pNewFrames);
 		
 		// create the audio message
 
-		MIPRawFloatAudioMessage *pNewMsg = new MIPRawFloatAudioMessage(m_sampingRate, 2, maxSamples, pNewFrames, true);
+		MIPRawFloatAudioMessage *pNewMsg = new MIPRawFloatAudioMessage(m_sampingRate, 2, numFrames, pNewFrames, true);
 		pNewMsg->setTime(pAudioMsg->getTime());
 		pNewMsg->setSourceID(pAudioMsg->getSourceID());
 
@@ -308,6 +326,207 @@ bool MIPHRIRListen::pull(const MIPComponentChain &chain, int64_t iteration, MIPM
 	return true;
 }
 
+bool MIPHRIRListen::setupConvolution(int blockSize)
+{
+	clearSourceStates();
+	m_blockSize = 0;
+
+	// Each block of input frames is transformed separately, and the filter is split
+	// into partitions of the same length, so that the FFT size must be at least twice
+	// the block size to avoid circular aliasing
+
+	int fftSize = 4;
+
+	while (fftSize < 2*blockSize)
+		fftSize <<= 1;
+
+	if (!m_fft.init(fftSize))
+	{
+		setErrorString(m_fft.getErrorString());
+		return false;
+	}
+
+	int maxLength = 1;
+	const std::list<HRIRData *> &HRIRSet = m_pCurHRIRSet->getHRIRSet();
+	std::list<HRIRData *>::const_iterator it;
+
+	for (it = HRIRSet.begin() ; it != HRIRSet.end() ; it++)
+	{
+		int len = ((*it)->getNumberOfLeftSamples() > (*it)->getNumberOfRightSamples())?(*it)->getNumberOfLeftSamples():(*it)->getNumberOfRightSamples();
+
+		if (len > maxLength)
+			maxLength = len;
+	}
+
+	if (m_maxFilterLength > 0 && maxLength > m_maxFilterLength)
+		maxLength = m_maxFilterLength;
+
+	m_blockSize = blockSize;
+	m_fftSize = fftSize;
+	m_spectrumSize = fftSize+2;
+	m_numPartitions = (maxLength + blockSize - 1)/blockSize;
+	m_timeBuffer.resize(fftSize);
+	m_spectrumBuffer.resize(m_spectrumSize);
+
+	return true;
+}
+
+void MIPHRIRListen::prepareSpectra(HRIRData *pData)
+{
+	int lengths[2] = { pData->getNumberOfLeftSamples(), pData->getNumberOfRightSamples() };
+	const float *pFilters[2] = { pData->getLeftChannel(), pData->getRightChannel() };
+	std::vector<float> *pSpectra[2] = { &(pData->getLeftSpectra()), &(pData->getRightSpectra()) };
+	float *pTime = &(m_timeBuffer[0]);
+
+	for (int channel = 0 ; channel < 2 ; channel++)
+	{
+		int length = lengths[channel];
+
+		if (m_maxFilterLength > 0 && length > m_maxFilterLength)
+			length = m_maxFilterLength;
+
+		pSpectra[channel]->resize(m_numPartitions*m_spectrumSize);
+
+		for (int p = 0 ; p < m_numPartitions ; p++)
+		{
+			int start = p*m_blockSize;
+			int num = length - start;
+
+			if (num > m_blockSize)
+				num = m_blockSize;
+			if (num < 0)
+				num = 0;
+
+			memset(pTime, 0, sizeof(float)*m_fftSize);
+			if (num > 0)
+				memcpy(pTime, pFilters[channel] + start, sizeof(float)*num);
+
+			m_fft.forward(pTime, &((*pSpectra[channel])[p*m_spectrumSize]));
+		}
+	}
+
+	pData->setSpectraBlockSize(m_blockSize);
+}
+
+void MIPHRIRListen::updateFilter(SourceState *pState, HRIRData *pData[4], real_t weights[4], int num)
+{
+	bool changed = (num != pState->m_numFilterData);
+
+	for (int i = 0 ; !changed && i < num ; i++)
+	{
+		if (pData[i] != pState->m_pFilterData[i] || weights[i] != pState->m_filterWeights[i])
+			changed = true;
+	}
+
+	if (!changed)
+		return;
+
+	// Since the convolution is linear, interpolating the filters is the same as 
+	// interpolating the filtered sound
+
+	size_t size = pState->m_leftFilter.size();
+	float *pLeft = &(pState->m_leftFilter[0]);
+	float *pRight = &(pState->m_rightFilter[0]);
+
+	memset(pLeft, 0, sizeof(float)*size);
+	memset(pRight, 0, sizeof(float)*size);
+
+	for (int i = 0 ; i < num ; i++)
+	{
+		if (pData[i]->getSpectraBlockSize() != m_blockSize || pData[i]->getLeftSpectra().size() != size)
+			prepareSpectra(pData[i]);
+
+		const float *pLeftSpectra = &(pData[i]->getLeftSpectra()[0]);
+		const float *pRightSpectra = &(pData[i]->getRightSpectra()[0]);
+		float w = (float)weights[i];
+
+		for (size_t j = 0 ; j < size ; j++)
+		{
+			pLeft[j] += w*pLeftSpectra[j];
+			pRight[j] += w*pRightSpectra[j];
+		}
+
+		pState->m_pFilterData[i] = pData[i];
+		pState->m_filterWeights[i] = weights[i];
+	}
+	pState->m_numFilterData = num;
+}
+
+void MIPHRIRListen::filterBlock(SourceState *pState, const float *pFrames, float scale, float *pDestStereo)
+{
+	float *pTime = &(m_timeBuffer[0]);
+	float *pSpectrum = &(m_spectrumBuffer[0]);
+
+	// The newest input spectrum is stored at position m_inputPos, partition p of the
+	// filter has to be applied to the spectrum which is p blocks older
+
+	pState->m_inputPos = (pState->m_inputPos + m_numPartitions - 1) % m_numPartitions;
+
+	for (int i = 0 ; i < m_blockSize ; i++)
+		pTime[i] = scale*pFrames[i];
+	memset(pTime + m_blockSize, 0, sizeof(float)*(m_fftSize - m_blockSize));
+
+	m_fft.forward(pTime, &(pState->m_inputSpectra[pState->m_inputPos*m_spectrumSize]));
+
+	const float *pFilters[2] = { &(pState->m_leftFilter[0]), &(pState->m_rightFilter[0]) };
+	float *pTails[2] = { &(pState->m_leftTail[0]), &(pState->m_rightTail[0]) };
+	int tailSize = m_blockSize-1;
+
+	for (int channel = 0 ; channel < 2 ; channel++)
+	{
+		memset(pSpectrum, 0, sizeof(float)*m_spectrumSize);
+
+		for (int p = 0 ; p < m_numPartitions ; p++)
+		{
+			int pos = (pState->m_inputPos + p) % m_numPartitions;
+
+			m_fft.multiplyAdd(&(pState->m_inputSpectra[pos*m_spectrumSize]), pFilters[channel] + p*m_spectrumSize, pSpectrum);
+		}
+
+		m_fft.inverse(pSpectrum, pTime);
+
+		float *pTail = pTails[channel];
+
+		// overlap-add the tail of the previous block and store the new one
+
+		for (int i = 0 ; i < tailSize ; i++)
+			pDestStereo[2*i+channel] = pTime[i] + pTail[i];
+		pDestStereo[2*tailSize+channel] = pTime[tailSize];
+		if (tailSize > 0)
+			memcpy(pTail, pTime + m_blockSize, sizeof(float)*tailSize);
+	}
+}
+
+void MIPHRIRListen::clearSourceStates()
+{
+	for (auto it = m_sourceStates.begin() ; it != m_sourceStates.end() ; it++)
+		delete it->second;
+	m_sourceStates.clear();
+}
+
+void MIPHRIRListen::expireSourceStates()
+{
+	MIPTime curTime = MIPTime::getCurrentTime();
+
+	if ((curTime.getValue() - m_lastStateExpireTime.getValue()) < MIPHRIRLISTEN_STATETIMEOUT)
+		return;
+
+	m_lastStateExpireTime = curTime;
+
+	auto it = m_sourceStates.begin();
+
+	while (it != m_sourceStates.end())
+	{
+		if ((curTime.getValue() - it->second->m_lastUpdateTime.getValue()) > MIPHRIRLISTEN_STATETIMEOUT)
+		{
+			delete it->second;
+			it = m_sourceStates.erase(it);
+		}
+		else
+			it++;
+	}
+}
+
 void MIPHRIRListen::clearHRIRSets()
 {
 	std::list<HRIRInfo *>::const_iterator it;
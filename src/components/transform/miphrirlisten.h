@@ -32,8 +32,12 @@
 
 #include "mipconfig.h"
 #include "miphrirbase.h"
+#include "mipfft.h"
+#include "miptime.h"
 #include <cmath>
 #include <list>
+#include <vector>
+#include <unordered_map>
 
 class MIPRawFloatAudioMessage;
 
@@ -41,6 +45,13 @@ class MIPRawFloatAudioMessage;
  *  Using this component, raw floating point mono audio messages can be converted into
  *  stereo raw floating point audio messages. The sound in the output messages will
  *  have a 3D effect, based upon your own location and the location of the sound source.
+ *
+ *  The filter for a direction is interpolated between the (at most four) surrounding 
+ *  measurements. Filtering is done by a uniformly partitioned FFT convolution, with the
+ *  partition size equal to the number of frames in the incoming messages. The part of 
+ *  the filtered sound which extends beyond a message is remembered for each source and
+ *  added to the next message of that source, so an output message contains as many
+ *  frames as the corresponding input message.
  */
 class EMIPLIB_IMPORTEXPORT MIPHRIRListen : public MIPHRIRBase
 {
@@ -86,6 +97,40 @@ public:
 	bool push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg);
 	bool pull(const MIPComponentChain &chain, int64_t iteration, MIPMessage **pMsg);
 private:
+	class SourceState
+	{
+	public:
+		SourceState(int numPartitions, int spectrumSize, int tailSize) : m_lastUpdateTime(MIPTime::getCurrentTime())
+		{
+			m_inputSpectra.resize(numPartitions*spectrumSize, 0);
+			m_leftFilter.resize(numPartitions*spectrumSize, 0);
+			m_rightFilter.resize(numPartitions*spectrumSize, 0);
+			m_leftTail.resize(tailSize, 0);
+			m_rightTail.resize(tailSize, 0);
+			m_inputPos = 0;
+			m_numFilterData = 0;
+		}
+
+		// frequency domain delay line: the spectra of the last input blocks
+		std::vector<float> m_inputSpectra;
+		int m_inputPos;
+
+		// the interpolated filter, and the measurements it was calculated from
+		std::vector<float> m_leftFilter, m_rightFilter;
+		HRIRData *m_pFilterData[4];
+		real_t m_filterWeights[4];
+		int m_numFilterData;
+
+		std::vector<float> m_leftTail, m_rightTail;
+		MIPTime m_lastUpdateTime;
+	};
+
+	bool setupConvolution(int blockSize);
+	void prepareSpectra(HRIRData *pData);
+	void updateFilter(SourceState *pState, HRIRData *pData[4], real_t weights[4], int num);
+	void filterBlock(SourceState *pState, const float *pFrames, float scale, float *pDestStereo);
+	void clearSourceStates();
+	void expireSourceStates();
 	void clearMessages();
 	void clearHRIRSets();
 	bool searchDirectory(const std::string &path, bool reportOpenError = false);
@@ -102,6 +147,12 @@ private:
 	
 	HRIRInfo *m_pCurHRIRSet;
 
+	int m_blockSize, m_fftSize, m_spectrumSize, m_numPartitions;
+	MIPFFT m_fft;
+	std::vector<float> m_timeBuffer, m_spectrumBuffer;
+	std::unordered_map<uint64_t, SourceState *> m_sourceStates;
+	MIPTime m_lastStateExpireTime;
+
 	int64_t m_prevIteration;
 	std::list<MIPRawFloatAudioMessage *> m_messages;
 	std::list<MIPRawFloatAudioMessage *>::const_iterator m_msgIt;
@@ -24,6 +24,8 @@
 
 #include "mipconfig.h"
 #include "mipsampleencoder.h"
+#include "mipcomponentchain.h"
+#include "mipmessagearena.h"
 
 #include "mipdebug.h"
 
@@ -87,11 +89,11 @@ bool MIPSampleEncoder::push(const MIPComponentChain &chain, int64_t iteration, M
 	uint16_t *pSamples16 = 0;
 
 	if (m_dstType == MIPRAWAUDIOMESSAGE_TYPE_U8)
-		pSamplesU8 = new uint8_t [numIn];
+		pSamplesU8 = chain.getMessageArena().allocateArray<uint8_t>(numIn);
 	else if (m_dstType == MIPRAWAUDIOMESSAGE_TYPE_FLOAT)
-		pSamplesFloat = new float [numIn];
+		pSamplesFloat = chain.getMessageArena().allocateArray<float>(numIn);
 	else
-		pSamples16 = new uint16_t [numIn];
+		pSamples16 = chain.getMessageArena().allocateArray<uint16_t>(numIn);
 	
 	uint32_t srcType = pAudioMsg->getMessageSubtype();
 	const float *pSamplesFloatIn = 0;
@@ -249,9 +251,9 @@ bool MIPSampleEncoder::push(const MIPComponentChain &chain, int64_t iteration, M
 	MIPAudioMessage *pNewMsg;
 
 	if (m_dstType == MIPRAWAUDIOMESSAGE_TYPE_U8)
-		pNewMsg = new MIPRawU8AudioMessage(0,0,0,pSamplesU8,true);
+		pNewMsg = chain.getMessageArena().createMessage<MIPRawU8AudioMessage>(0,0,0,pSamplesU8,false);
 	else if (m_dstType == MIPRAWAUDIOMESSAGE_TYPE_FLOAT)
-		pNewMsg = new MIPRawFloatAudioMessage(0,0,0,pSamplesFloat,true);
+		pNewMsg = chain.getMessageArena().createMessage<MIPRawFloatAudioMessage>(0,0,0,pSamplesFloat,false);
 	else
 	{
 		bool isSigned;
@@ -269,7 +271,7 @@ bool MIPSampleEncoder::push(const MIPComponentChain &chain, int64_t iteration, M
 		else
 			sampEnc = MIPRaw16bitAudioMessage::Native;
 		
-		pNewMsg = new MIPRaw16bitAudioMessage(0,0,0,isSigned,sampEnc,pSamples16,true);
+		pNewMsg = chain.getMessageArena().createMessage<MIPRaw16bitAudioMessage>(0,0,0,isSigned,sampEnc,pSamples16,false);
 	}
 
 	pNewMsg->copyAudioInfoFrom(*pAudioMsg);
@@ -325,10 +327,7 @@ void MIPSampleEncoder::cleanUp()
 
 void MIPSampleEncoder::clearMessages()
 {
-	std::list<MIPAudioMessage *>::iterator it;
-
-	for (it = m_messages.begin() ; it != m_messages.end() ; it++)
-		delete (*it);
+	// The messages themselves are stored in the chain's message arena
 	m_messages.clear();
 	m_msgIt = m_messages.begin();
 }
@@ -25,7 +25,7 @@
 #include "mipconfig.h"
 #include "mipsamplingrateconverter.h"
 #include "miprawaudiomessage.h"
-#include "mipresample.h"
+#include "mipsharedbuffer.h"
 
 #include "mipdebug.h"
 
@@ -34,7 +34,7 @@
 #define MIPSAMPLINGRATECONVERTER_ERRSTR_CANTHANDLECHANNELS		"Can't handle channel conversion"
 #define MIPSAMPLINGRATECONVERTER_ERRSTR_CANTRESAMPLE			"Unable to resample the data"
 
-MIPSamplingRateConverter::MIPSamplingRateConverter() : MIPComponent("MIPSamplingRateConverter")
+MIPSamplingRateConverter::MIPSamplingRateConverter() : MIPOutputMessageQueueWithState("MIPSamplingRateConverter")
 {
 	m_init = false;
 }
@@ -44,7 +44,7 @@ MIPSamplingRateConverter::~MIPSamplingRateConverter()
 	cleanUp();
 }
 
-bool MIPSamplingRateConverter::init(int outRate, int outChannels, bool floatSamples)
+bool MIPSamplingRateConverter::init(int outRate, int outChannels, bool floatSamples, MIPStreamResampler::Quality quality)
 {
 	if (m_init)
 		cleanUp();
@@ -52,8 +52,10 @@ bool MIPSamplingRateConverter::init(int outRate, int outChannels, bool floatSamp
 	m_outRate = outRate;
 	m_outChannels = outChannels;
 	m_floatSamples = floatSamples;
+	m_quality = quality;
+
+	MIPOutputMessageQueueWithState::init(60.0);
 
-	m_prevIteration = -1;
 	m_init = true;
 	
 	return true;
@@ -64,20 +66,10 @@ void MIPSamplingRateConverter::cleanUp()
 	if (!m_init)
 		return;
 
-	clearMessages();
+	MIPOutputMessageQueueWithState::clear();
 	m_init = false;
 }
 
-void MIPSamplingRateConverter::clearMessages()
-{
-	std::list<MIPAudioMessage *>::iterator it;
-
-	for (it = m_messages.begin() ; it != m_messages.end() ; it++)
-		delete (*it);
-	m_messages.clear();
-	m_msgIt = m_messages.begin();
-}
-
 bool MIPSamplingRateConverter::push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg)
 {
 	if (!m_init)
@@ -101,81 +93,78 @@ bool MIPSamplingRateConverter::push(const MIPComponentChain &chain, int64_t iter
 		setErrorString(MIPSAMPLINGRATECONVERTER_ERRSTR_CANTHANDLECHANNELS);
 		return false;
 	}
-	
+
+	checkIteration(iteration);
+
 	int numInChannels = pAudioMsg->getNumberOfChannels();
 	int numInFrames = pAudioMsg->getNumberOfFrames();
-	real_t frameTime = (((real_t)numInFrames)/((real_t)pAudioMsg->getSamplingRate()));
-	int numNewFrames = (int)((frameTime * ((real_t)m_outRate))+0.5);
-	int numNewSamples = numNewFrames * m_outChannels;
+	int inRate = pAudioMsg->getSamplingRate();
+	uint64_t sourceID = pAudioMsg->getSourceID();
+
+	ResamplerStateInfo *pStateInfo = (ResamplerStateInfo *)findState(sourceID);
+
+	if (pStateInfo == 0)
+	{
+		pStateInfo = new ResamplerStateInfo();
+
+		if (!MIPOutputMessageQueueWithState::addState(sourceID, pStateInfo))
+			return false; // shouldn't happen, error message already set
+	}
+	pStateInfo->setUpdateTime();
+
+	MIPStreamResampler &resampler = pStateInfo->getResampler();
+
+	// (Re)initialize the resampler when a source starts or changes its format
+	if (resampler.getInputSamplingRate() != inRate || resampler.getNumberOfInputChannels() != numInChannels)
+	{
+		if (!resampler.init(inRate, numInChannels, m_outRate, m_outChannels, m_quality))
+		{
+			setErrorString(MIPSAMPLINGRATECONVERTER_ERRSTR_CANTRESAMPLE);
+			return false;
+		}
+	}
+
+	int maxNewFrames = resampler.getMaximumOutputFrames(numInFrames);
+	int numNewSamples = maxNewFrames * m_outChannels;
 	MIPAudioMessage *pNewMsg = 0;
 	
 	if (m_floatSamples)
 	{
 		MIPRawFloatAudioMessage *pFloatAudioMsg = (MIPRawFloatAudioMessage *)pMsg;
 		const float *oldFrames = pFloatAudioMsg->getFrames();
-		float *newFrames = new float [numNewSamples];
+		MIPSharedBuffer *pBuffer = MIPSharedBuffer::allocate(sizeof(float)*numNewSamples);
+		float *newFrames = (float *)pBuffer->getData();
+		int numNewFrames = resampler.resample(oldFrames, numInFrames, newFrames);
 	
-		if (!MIPResample<float,float>(oldFrames, numInFrames, numInChannels, newFrames, numNewFrames, m_outChannels))
+		if (numNewFrames == 0)
 		{
-			setErrorString(MIPSAMPLINGRATECONVERTER_ERRSTR_CANTRESAMPLE);
-			return false;
+			pBuffer->release();
+			return true;
 		}
 		
-		pNewMsg = new MIPRawFloatAudioMessage(m_outRate, m_outChannels, numNewFrames, newFrames, true);
+		pNewMsg = new MIPRawFloatAudioMessage(m_outRate, m_outChannels, numNewFrames, pBuffer);
 		pNewMsg->copyMediaInfoFrom(*pAudioMsg); // copy time info and source ID
 	}
 	else // 16 bit signed
 	{
 		MIPRaw16bitAudioMessage *pIntAudioMsg = (MIPRaw16bitAudioMessage *)pMsg;
 		const uint16_t *oldFrames = pIntAudioMsg->getFrames();
-		uint16_t *newFrames = new uint16_t [numNewSamples];
+		MIPSharedBuffer *pBuffer = MIPSharedBuffer::allocate(sizeof(uint16_t)*numNewSamples);
+		uint16_t *newFrames = (uint16_t *)pBuffer->getData();
+		int numNewFrames = resampler.resample((const int16_t *)oldFrames, numInFrames, (int16_t *)newFrames);
 	
-		if (!MIPResample<int16_t,int32_t>((const int16_t *)oldFrames, numInFrames, numInChannels, (int16_t *)newFrames, numNewFrames, m_outChannels))
+		if (numNewFrames == 0)
 		{
-			setErrorString(MIPSAMPLINGRATECONVERTER_ERRSTR_CANTRESAMPLE);
-			return false;
+			pBuffer->release();
+			return true;
 		}
 		
-		pNewMsg = new MIPRaw16bitAudioMessage(m_outRate, m_outChannels, numNewFrames, true, MIPRaw16bitAudioMessage::Native, newFrames, true);
+		pNewMsg = new MIPRaw16bitAudioMessage(m_outRate, m_outChannels, numNewFrames, true, MIPRaw16bitAudioMessage::Native, pBuffer);
 		pNewMsg->copyMediaInfoFrom(*pAudioMsg); // copy time info and source ID
 	}
 	
-	if (m_prevIteration != iteration)
-	{
-		clearMessages();
-		m_prevIteration = iteration;
-	}
-	
-	m_messages.push_back(pNewMsg);
-	m_msgIt = m_messages.begin();
+	MIPOutputMessageQueueWithState::addToOutputQueue(pNewMsg, true);
 	
 	return true;
 }
 
-bool MIPSamplingRateConverter::pull(const MIPComponentChain &chain, int64_t iteration, MIPMessage **pMsg)
-{
-	if (!m_init)
-	{
-		setErrorString(MIPSAMPLINGRATECONVERTER_ERRSTR_NOTINIT);
-		return false;
-	}
-
-	if (m_prevIteration != iteration)
-	{
-		clearMessages();
-		m_prevIteration = iteration;
-	}
-
-	if (m_msgIt == m_messages.end())
-	{
-		*pMsg = 0;
-		m_msgIt = m_messages.begin();
-	}
-	else
-	{
-		*pMsg = *m_msgIt;
-		m_msgIt++;
-	}
-	return true;
-}
-
@@ -31,8 +31,8 @@
 #define MIPSAMPLINGRATECONVERTER_H
 
 #include "mipconfig.h"
-#include "mipcomponent.h"
-#include <list>
+#include "mipoutputmessagequeuewithstate.h"
+#include "mipstreamresampler.h"
 
 class MIPAudioMessage;
 
@@ -41,8 +41,12 @@ class MIPAudioMessage;
  *  messages and produces
  *  similar messages with a specific sampling rate and number of channels set during
  *  initialization.
+ *
+ *  Each source keeps its own MIPStreamResampler instance, so that the filter history
+ *  of a stream is carried over from one message to the next. Note that this introduces
+ *  a small delay (see MIPStreamResampler::getDelay).
  */
-class EMIPLIB_IMPORTEXPORT MIPSamplingRateConverter : public MIPComponent
+class EMIPLIB_IMPORTEXPORT MIPSamplingRateConverter : public MIPOutputMessageQueueWithState
 {
 public:
 	MIPSamplingRateConverter();
@@ -52,22 +56,28 @@ public:
 	 *  This function instructs the converter to generate raw audio 
 	 *  messages with sampling rate \c outRate and number of channels \c outChannels.
 	 *  If the \c floatSamples flag is set, floating point samples will be used,
-	 *  otherwise 16 bit signed native endian samples will be used.
+	 *  otherwise 16 bit signed native endian samples will be used. The \c quality
+	 *  parameter selects the length of the interpolation filter.
 	 */
-	bool init(int outRate, int outChannels, bool floatSamples = true);
+	bool init(int outRate, int outChannels, bool floatSamples = true, MIPStreamResampler::Quality quality = MIPStreamResampler::Medium);
 	
 	bool push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg);
-	bool pull(const MIPComponentChain &chain, int64_t iteration, MIPMessage **pMsg);
 private:
+	class ResamplerStateInfo : public MIPStateInfo
+	{
+	public:
+		ResamplerStateInfo()								{ }
+		MIPStreamResampler &getResampler()						{ return m_resampler; }
+	private:
+		MIPStreamResampler m_resampler;
+	};
+
 	void cleanUp();
-	void clearMessages();
 	
 	bool m_init;
-	std::list<MIPAudioMessage *> m_messages;
-	std::list<MIPAudioMessage *>::const_iterator m_msgIt;
-	int64_t m_prevIteration;
 	int m_outRate, m_outChannels;
 	bool m_floatSamples;
+	MIPStreamResampler::Quality m_quality;
 };
 
 #endif // MIPSAMPLINGRATECONVERTER_H
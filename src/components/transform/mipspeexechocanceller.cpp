@@ -27,6 +27,8 @@
 #ifdef MIPCONFIG_SUPPORT_SPEEX
 
 #include "mipspeexechocanceller.h"
+#include "mipcomponentchain.h"
+#include "mipmessagearena.h"
 #include <speex/speex_echo.h>
 #include <cmath>
 
@@ -141,11 +143,11 @@ bool MIPSpeexEchoCanceller::push(const MIPComponentChain &chain, int64_t iterati
 		return false;
 	}
 	
-	uint16_t *pFrames = new uint16_t[m_numFrames];
+	uint16_t *pFrames = chain.getMessageArena().allocateArray<uint16_t>(m_numFrames);
 
 	speex_echo_capture((SpeexEchoState *)m_pSpeexEchoState, (int16_t *)pAudioMsg->getFrames(), (int16_t *)pFrames);
 
-	MIPRaw16bitAudioMessage *pNewMsg = new MIPRaw16bitAudioMessage(m_sampRate, 1, m_numFrames, true, MIPRaw16bitAudioMessage::Native, pFrames, true);
+	MIPRaw16bitAudioMessage *pNewMsg = chain.getMessageArena().createMessage<MIPRaw16bitAudioMessage>(m_sampRate, 1, m_numFrames, true, MIPRaw16bitAudioMessage::Native, pFrames, false);
 	pNewMsg->copyMediaInfoFrom(*pAudioMsg);
 	m_messages.push_back(pNewMsg);
 
@@ -184,10 +186,7 @@ bool MIPSpeexEchoCanceller::pull(const MIPComponentChain &chain, int64_t iterati
 
 void MIPSpeexEchoCanceller::clearMessages()
 {
-	std::list<MIPRaw16bitAudioMessage *>::iterator it;
-
-	for (it = m_messages.begin() ; it != m_messages.end() ; it++)
-		delete (*it);
+	// The messages themselves are stored in the chain's message arena
 	m_messages.clear();
 	m_msgIt = m_messages.begin();
 }
@@ -36,7 +36,7 @@
 
 #include "mipcomponent.h"
 #include "miprawaudiomessage.h"
-#include <list>
+#include <vector>
 
 /** An echo cancellation component based on the Speex echo cancellation routines.
  *  An echo cancellation component based on the Speex echo cancellation routines. After
@@ -105,8 +105,8 @@ private:
 	int m_sampRate;
 	int m_numFrames;
 
-	std::list<MIPRaw16bitAudioMessage *> m_messages;
-	std::list<MIPRaw16bitAudioMessage *>::const_iterator m_msgIt;
+	std::vector<MIPRaw16bitAudioMessage *> m_messages;
+	std::vector<MIPRaw16bitAudioMessage *>::const_iterator m_msgIt;
 	int64_t m_prevIteration;
 };
 
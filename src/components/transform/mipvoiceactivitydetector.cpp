@@ -0,0 +1,363 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+#include "mipconfig.h"
+#include "mipvoiceactivitydetector.h"
+#include "miprawaudiomessage.h"
+#include "mipencodedaudiomessage.h"
+#include "mipcomponentchain.h"
+#include <math.h>
+
+#include "mipdebug.h"
+
+#define MIPVOICEACTIVITYDETECTOR_ERRSTR_NOTINIT			"Not initialized"
+#define MIPVOICEACTIVITYDETECTOR_ERRSTR_ALREADYINIT		"Already initialized"
+#define MIPVOICEACTIVITYDETECTOR_ERRSTR_BADMESSAGE		"Only floating point and 16 bit raw audio messages are accepted"
+#define MIPVOICEACTIVITYDETECTOR_ERRSTR_BADORDER		"The number of reflection coefficients must lie between 0 and 10"
+#define MIPVOICEACTIVITYDETECTOR_ERRSTR_BADTIME			"The hangover time and comfort noise interval can't be negative"
+
+// Largest transform used to calculate the spectral flatness
+#define MIPVOICEACTIVITYDETECTOR_MAXFFTSIZE			512
+#define MIPVOICEACTIVITYDETECTOR_MINFFTSIZE			16
+// Time constant with which the noise level follows a higher level when no speech is detected
+#define MIPVOICEACTIVITYDETECTOR_NOISEADAPTTIME			0.5
+// Rate (in dB per second) at which the noise level rises while speech is detected
+#define MIPVOICEACTIVITYDETECTOR_NOISERISERATE			2.0
+
+MIPVoiceActivityDetector::MIPVoiceActivityDetector() : MIPOutputMessageQueueWithState("MIPVoiceActivityDetector"),
+                                                       m_hangover(0), m_comfortNoiseInterval(0)
+{
+	m_init = false;
+	m_order = 0;
+	m_energyThreshold = 9.0;
+	m_flatnessThreshold = 0.4;
+	m_minimumLevel = -60.0;
+}
+
+MIPVoiceActivityDetector::~MIPVoiceActivityDetector()
+{
+	destroy();
+}
+
+bool MIPVoiceActivityDetector::init(MIPTime hangover, MIPTime comfortNoiseInterval, int comfortNoiseOrder)
+{
+	if (m_init)
+	{
+		setErrorString(MIPVOICEACTIVITYDETECTOR_ERRSTR_ALREADYINIT);
+		return false;
+	}
+
+	if (comfortNoiseOrder < 0 || comfortNoiseOrder > MIPCOMFORTNOISE_MAXORDER)
+	{
+		setErrorString(MIPVOICEACTIVITYDETECTOR_ERRSTR_BADORDER);
+		return false;
+	}
+
+	if (hangover.getValue() < 0 || comfortNoiseInterval.getValue() < 0)
+	{
+		setErrorString(MIPVOICEACTIVITYDETECTOR_ERRSTR_BADTIME);
+		return false;
+	}
+
+	m_hangover = hangover;
+	m_comfortNoiseInterval = comfortNoiseInterval;
+	m_order = comfortNoiseOrder;
+	m_autoCorrelation.resize(m_order+1);
+
+	MIPOutputMessageQueueWithState::init(60.0);
+	m_init = true;
+
+	return true;
+}
+
+bool MIPVoiceActivityDetector::destroy()
+{
+	if (!m_init)
+	{
+		setErrorString(MIPVOICEACTIVITYDETECTOR_ERRSTR_NOTINIT);
+		return false;
+	}
+
+	MIPOutputMessageQueueWithState::clear();
+	m_init = false;
+	return true;
+}
+
+bool MIPVoiceActivityDetector::push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg)
+{
+	if (!m_init)
+	{
+		setErrorString(MIPVOICEACTIVITYDETECTOR_ERRSTR_NOTINIT);
+		return false;
+	}
+
+	if (!getMonoSamples((pMsg->getMessageType() == MIPMESSAGE_TYPE_AUDIO_RAW)?(MIPAudioMessage *)pMsg:0))
+	{
+		setErrorString(MIPVOICEACTIVITYDETECTOR_ERRSTR_BADMESSAGE);
+		return false;
+	}
+
+	checkIteration(iteration);
+
+	MIPAudioMessage *pAudioMsg = (MIPAudioMessage *)pMsg;
+	int numFrames = pAudioMsg->getNumberOfFrames();
+	int sampRate = pAudioMsg->getSamplingRate();
+
+	if (numFrames <= 0 || sampRate <= 0)
+		return true;
+
+	// Level and spectral envelope of this message
+
+	const float *pSamples = &(m_samples[0]);
+
+	for (int lag = 0 ; lag <= m_order ; lag++)
+	{
+		double sum = 0;
+
+		for (int i = lag ; i < numFrames ; i++)
+			sum += (double)pSamples[i]*(double)pSamples[i-lag];
+		m_autoCorrelation[lag] = (float)(sum/(double)numFrames);
+	}
+
+	real_t level = (real_t)(10.0*log10((double)m_autoCorrelation[0] + 1e-12));
+	real_t flatness = calculateFlatness(numFrames);
+	uint64_t sourceID = pAudioMsg->getSourceID();
+	VADStateInfo *pStateInfo = (VADStateInfo *)findState(sourceID);
+
+	if (pStateInfo == 0)
+	{
+		// The first message of a source is assumed to contain background noise. If
+		// it doesn't, the noise level drops as soon as the speaker pauses.
+		pStateInfo = new VADStateInfo(level, m_order);
+		if (!MIPOutputMessageQueueWithState::addState(sourceID, pStateInfo))
+			return false; // shouldn't happen, error message already set
+	}
+	pStateInfo->setUpdateTime();
+
+	real_t noiseLevel = pStateInfo->m_noiseLevel;
+	real_t duration = (real_t)numFrames/(real_t)sampRate;
+	bool speech = false;
+
+	if (level > m_minimumLevel && level > noiseLevel + m_energyThreshold)
+	{
+		if (flatness < m_flatnessThreshold || level > noiseLevel + 2.0*m_energyThreshold)
+			speech = true;
+	}
+
+	// The noise level immediately follows lower levels, higher levels are followed
+	// gradually, and hardly at all while someone is speaking
+
+	if (level < noiseLevel)
+		noiseLevel = level;
+	else if (!speech)
+		noiseLevel += (level - noiseLevel)*(real_t)(1.0 - exp(-duration/MIPVOICEACTIVITYDETECTOR_NOISEADAPTTIME));
+	else
+		noiseLevel += MIPVOICEACTIVITYDETECTOR_NOISERISERATE*duration;
+	pStateInfo->m_noiseLevel = noiseLevel;
+
+	if (!speech)
+	{
+		std::vector<float> &noiseCorrelation = pStateInfo->m_autoCorrelation;
+
+		if (!pStateInfo->m_gotNoise)
+		{
+			noiseCorrelation = m_autoCorrelation;
+			pStateInfo->m_gotNoise = true;
+		}
+		else
+		{
+			float factor = (float)(1.0 - exp(-duration/MIPVOICEACTIVITYDETECTOR_NOISEADAPTTIME));
+
+			for (int lag = 0 ; lag <= m_order ; lag++)
+				noiseCorrelation[lag] += factor*(m_autoCorrelation[lag] - noiseCorrelation[lag]);
+		}
+	}
+
+	bool active = false;
+
+	if (speech)
+	{
+		pStateInfo->m_hangoverFrames = (int64_t)(m_hangover.getValue()*(real_t)sampRate + 0.5);
+		active = true;
+	}
+	else if (pStateInfo->m_hangoverFrames > 0)
+	{
+		pStateInfo->m_hangoverFrames -= numFrames;
+		active = true;
+	}
+
+	if (active)
+	{
+		pStateInfo->m_sentNoise = false;
+		addToOutputQueue(pMsg, false);
+		return true;
+	}
+
+	// Silence: the message is dropped, a comfort noise message is sent at the
+	// start of the silence and periodically afterwards
+
+	if (m_comfortNoiseInterval.getValue() <= 0)
+		return true;
+
+	int64_t intervalFrames = (int64_t)(m_comfortNoiseInterval.getValue()*(real_t)sampRate + 0.5);
+
+	if (!pStateInfo->m_sentNoise || pStateInfo->m_framesSinceNoise >= intervalFrames)
+	{
+		uint8_t *pPayload = allocateOutputData<uint8_t>(chain, m_order+1);
+		size_t length = MIPComfortNoise::createPayload(&(pStateInfo->m_autoCorrelation[0]), m_order, pPayload);
+		MIPEncodedAudioMessage *pNoiseMsg = createOutputMessage<MIPEncodedAudioMessage>(chain, (uint32_t)MIPENCODEDAUDIOMESSAGE_TYPE_CN, 
+		                                                                               sampRate, 1, numFrames, pPayload, length, false);
+
+		pNoiseMsg->copyMediaInfoFrom(*pAudioMsg); // copy time and sourceID
+		pStateInfo->m_sentNoise = true;
+		pStateInfo->m_framesSinceNoise = 0;
+	}
+	pStateInfo->m_framesSinceNoise += numFrames;
+
+	return true;
+}
+
+bool MIPVoiceActivityDetector::getMonoSamples(MIPAudioMessage *pAudioMsg)
+{
+	if (pAudioMsg == 0)
+		return false;
+
+	uint32_t subtype = pAudioMsg->getMessageSubtype();
+	int numFrames = pAudioMsg->getNumberOfFrames();
+	int channels = pAudioMsg->getNumberOfChannels();
+
+	if (numFrames < 0 || channels < 1)
+		return false;
+
+	if ((int)m_samples.size() < numFrames + 1)
+		m_samples.resize(numFrames + 1);
+
+	float scale = 1.0f/(float)channels;
+
+	if (subtype == MIPRAWAUDIOMESSAGE_TYPE_FLOAT)
+	{
+		const float *pFrames = ((MIPRawFloatAudioMessage *)pAudioMsg)->getFrames();
+
+		for (int i = 0 ; i < numFrames ; i++, pFrames += channels)
+		{
+			float sum = 0;
+
+			for (int j = 0 ; j < channels ; j++)
+				sum += pFrames[j];
+			m_samples[i] = sum*scale;
+		}
+		return true;
+	}
+
+	if (!(subtype == MIPRAWAUDIOMESSAGE_TYPE_S16 || subtype == MIPRAWAUDIOMESSAGE_TYPE_S16LE || subtype == MIPRAWAUDIOMESSAGE_TYPE_S16BE ||
+	      subtype == MIPRAWAUDIOMESSAGE_TYPE_U16 || subtype == MIPRAWAUDIOMESSAGE_TYPE_U16LE || subtype == MIPRAWAUDIOMESSAGE_TYPE_U16BE))
+		return false;
+
+	MIPRaw16bitAudioMessage *pMsg16 = (MIPRaw16bitAudioMessage *)pAudioMsg;
+	const uint16_t *pFrames = pMsg16->getFrames();
+	uint16_t signFlip = (pMsg16->isSigned())?0:0x8000;
+#ifndef MIPCONFIG_BIGENDIAN
+	bool swap = pMsg16->isBigEndian();
+#else
+	bool swap = pMsg16->isLittleEndian();
+#endif // MIPCONFIG_BIGENDIAN
+
+	scale /= 32768.0f;
+	for (int i = 0 ; i < numFrames ; i++, pFrames += channels)
+	{
+		float sum = 0;
+
+		for (int j = 0 ; j < channels ; j++)
+		{
+			uint16_t value = pFrames[j];
+
+			if (swap)
+				value = (uint16_t)((value << 8) | (value >> 8));
+			sum += (float)((int16_t)(value ^ signFlip));
+		}
+		m_samples[i] = sum*scale;
+	}
+	return true;
+}
+
+real_t MIPVoiceActivityDetector::calculateFlatness(int numFrames)
+{
+	// Use the largest power of two that fits in the message, and average the
+	// power spectra of consecutive parts of that size. When the message is
+	// too short, only the level is used to detect speech.
+
+	int fftSize = MIPVOICEACTIVITYDETECTOR_MINFFTSIZE;
+
+	if (numFrames < fftSize)
+		return 0;
+
+	while (fftSize*2 <= numFrames && fftSize < MIPVOICEACTIVITYDETECTOR_MAXFFTSIZE)
+		fftSize *= 2;
+
+	if (m_fft.getSize() != fftSize)
+	{
+		if (!m_fft.init(fftSize))
+			return 0;
+
+		m_window.resize(fftSize);
+		m_fftInput.resize(fftSize);
+		m_spectrum.resize(fftSize + 2);
+		m_power.resize(fftSize/2 + 1);
+		for (int i = 0 ; i < fftSize ; i++)
+			m_window[i] = (float)(0.5 - 0.5*cos(2.0*3.14159265358979323846*(double)i/(double)fftSize));
+	}
+
+	int numBins = fftSize/2;
+
+	for (int i = 0 ; i <= numBins ; i++)
+		m_power[i] = 0;
+
+	for (int offset = 0 ; offset + fftSize <= numFrames ; offset += fftSize)
+	{
+		for (int i = 0 ; i < fftSize ; i++)
+			m_fftInput[i] = m_samples[offset + i]*m_window[i];
+
+		m_fft.forward(&(m_fftInput[0]), &(m_spectrum[0]));
+
+		for (int i = 0 ; i <= numBins ; i++)
+			m_power[i] += m_spectrum[2*i]*m_spectrum[2*i] + m_spectrum[2*i+1]*m_spectrum[2*i+1];
+	}
+
+	// The DC and Nyquist bins are left out
+
+	double logSum = 0, sum = 0;
+
+	for (int i = 1 ; i < numBins ; i++)
+	{
+		double p = (double)m_power[i] + 1e-20;
+
+		logSum += log(p);
+		sum += p;
+	}
+
+	double n = (double)(numBins - 1);
+
+	return (real_t)(exp(logSum/n)/(sum/n));
+}
+
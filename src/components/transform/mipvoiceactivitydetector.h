@@ -0,0 +1,127 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+/**
+ * \file mipvoiceactivitydetector.h
+ */
+
+#ifndef MIPVOICEACTIVITYDETECTOR_H
+
+#define MIPVOICEACTIVITYDETECTOR_H
+
+#include "mipconfig.h"
+#include "mipoutputmessagequeuewithstate.h"
+#include "mipcomfortnoise.h"
+#include "mipfft.h"
+#include "miptime.h"
+#include <vector>
+
+class MIPAudioMessage;
+
+/** Suppresses silent audio and replaces it by comfort noise parameters.
+ *  This component decides for each incoming raw audio message whether it contains speech, and
+ *  can be placed in front of any encoder to avoid encoding and transmitting silence. Floating
+ *  point messages and 16 bit messages are accepted. Messages which contain speech are passed on
+ *  unchanged, silent messages are dropped.
+ *
+ *  A message is considered to contain speech when its level is sufficiently above an estimate of
+ *  the background noise level, and its spectrum is not as flat as that of noise. After speech, 
+ *  messages are passed on for a while longer (the hangover time), so that the ends of words are
+ *  not cut off. When the silence starts, and periodically during the silence, an encoded
+ *  audio message with subtype MIPENCODEDAUDIOMESSAGE_TYPE_CN is produced instead of the 
+ *  dropped message. It contains an RFC 3389 payload which describes the background noise (see
+ *  MIPComfortNoise), so that the receiving side can generate similar noise. Each source is
+ *  handled separately.
+ *
+ *  Use message filters on the connections to send the raw audio to the encoder and the comfort
+ *  noise messages to a MIPRTPCNEncoder component. If the component is used in a chain that 
+ *  transmits the audio using MIPRTPComponent, each message should correspond to one iteration
+ *  of the chain, and the silent timestamp increment of the RTP component should be set to the
+ *  number of frames in such a message. That way, the RTP timestamps remain correct and the first
+ *  packet of each talk spurt is marked.
+ */
+class EMIPLIB_IMPORTEXPORT MIPVoiceActivityDetector : public MIPOutputMessageQueueWithState
+{
+public:
+	MIPVoiceActivityDetector();
+	~MIPVoiceActivityDetector();
+
+	/** Initializes the component.
+	 *  Initializes the component.
+	 *  \param hangover Audio is passed on for this amount of time after the last message in which
+	 *                  speech was detected.
+	 *  \param comfortNoiseInterval During silence, a comfort noise message is generated at this 
+	 *                              interval. Set to zero to only drop the silent messages.
+	 *  \param comfortNoiseOrder The number of reflection coefficients in the comfort noise payload,
+	 *                           at most MIPCOMFORTNOISE_MAXORDER.
+	 */
+	bool init(MIPTime hangover = MIPTime(0.2), MIPTime comfortNoiseInterval = MIPTime(0.2), int comfortNoiseOrder = 4);
+
+	/** De-initializes the component. */
+	bool destroy();
+
+	/** Speech is only detected when the level is at least this many dB above the noise level (default: 9 dB). */
+	void setEnergyThreshold(real_t dB)								{ m_energyThreshold = dB; }
+
+	/** Sets the spectral flatness below which audio is considered to be speech.
+	 *  The spectral flatness is the ratio of the geometric and the arithmetic mean of the power
+	 *  spectrum, which is close to one for noise and much lower for voiced speech. Audio which 
+	 *  is at least twice the energy threshold above the noise level is always considered to be
+	 *  speech. The default is 0.4.
+	 */
+	void setFlatnessThreshold(real_t flatness)							{ m_flatnessThreshold = flatness; }
+
+	/** Audio with a level below this value (in dBov) is never considered to be speech (default: -60 dBov). */
+	void setMinimumLevel(real_t dBov)								{ m_minimumLevel = dBov; }
+
+	bool push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg);
+private:
+	class VADStateInfo : public MIPStateInfo
+	{
+	public:
+		VADStateInfo(real_t noiseLevel, int order) : m_autoCorrelation(order+1, 0)	{ m_noiseLevel = noiseLevel; m_hangoverFrames = 0; m_framesSinceNoise = 0; m_sentNoise = false; m_gotNoise = false; }
+
+		real_t m_noiseLevel;
+		int64_t m_hangoverFrames;
+		int64_t m_framesSinceNoise;
+		bool m_sentNoise;
+		bool m_gotNoise;
+		std::vector<float> m_autoCorrelation;
+	};
+
+	bool getMonoSamples(MIPAudioMessage *pAudioMsg);
+	real_t calculateFlatness(int numFrames);
+
+	bool m_init;
+	MIPTime m_hangover, m_comfortNoiseInterval;
+	int m_order;
+	real_t m_energyThreshold, m_flatnessThreshold, m_minimumLevel;
+
+	MIPFFT m_fft;
+	std::vector<float> m_samples, m_autoCorrelation;
+	std::vector<float> m_window, m_fftInput, m_spectrum, m_power;
+};
+
+#endif // MIPVOICEACTIVITYDETECTOR_H
+
@@ -25,6 +25,8 @@
 #include "mipconfig.h"
 #include "mipyuv420framecutter.h"
 #include "miprawvideomessage.h"
+#include "mipcomponentchain.h"
+#include "mipmessagearena.h"
 
 #include "mipdebug.h"
 
@@ -144,10 +146,11 @@ bool MIPYUV420FrameCutter::push(const MIPComponentChain &chain, int64_t iteratio
 	int dstWidth = m_x1-m_x0;
 	int dstHeight = m_y1-m_y0;
 	int dstSize = (dstWidth*dstHeight*3)/2;
-	uint8_t *pData = new uint8_t[dstSize];
+	MIPSharedBuffer *pBuffer = MIPSharedBuffer::allocate(dstSize);
+	uint8_t *pData = pBuffer->getData();
 	const uint8_t *pInputData = pInputMsg->getImageData();
 
-	MIPRawYUV420PVideoMessage *pNewMsg = new MIPRawYUV420PVideoMessage(dstWidth, dstHeight, pData, true);
+	MIPRawYUV420PVideoMessage *pNewMsg = chain.getMessageArena().createMessage<MIPRawYUV420PVideoMessage>(dstWidth, dstHeight, pBuffer);
 
 	int dstOffset = 0;
 	int srcPos = m_x0+m_y0*m_inputWidth;
@@ -208,10 +211,7 @@ bool MIPYUV420FrameCutter::pull(const MIPComponentChain &chain, int64_t iteratio
 
 void MIPYUV420FrameCutter::clearMessages()
 {
-	std::list<MIPVideoMessage *>::iterator it;
-
-	for (it = m_messages.begin() ; it != m_messages.end() ; it++)
-		delete (*it);
+	// The messages themselves are stored in the chain's message arena
 	m_messages.clear();
 	m_msgIt = m_messages.begin();
 }
@@ -33,7 +33,7 @@
 #include "mipconfig.h"
 #include "mipcomponent.h"
 #include "miptime.h"
-#include <list>
+#include <vector>
 
 class MIPVideoMessage;
 
@@ -71,8 +71,8 @@ private:
 	void clearMessages();
 
 	bool m_init;
-	std::list<MIPVideoMessage *> m_messages;
-	std::list<MIPVideoMessage *>::const_iterator m_msgIt;
+	std::vector<MIPVideoMessage *> m_messages;
+	std::vector<MIPVideoMessage *>::const_iterator m_msgIt;
 	int64_t m_lastIteration;
 
 	int m_x0, m_x1, m_y0, m_y1;
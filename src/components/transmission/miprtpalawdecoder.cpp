@@ -53,15 +53,33 @@ bool MIPRTPALawDecoder::validatePacket(const RTPPacket *pRTPPack, real_t &timest
 	return true;
 }
 
-void MIPRTPALawDecoder::createNewMessages(const RTPPacket *pRTPPack, std::list<MIPMediaMessage *> &messages, std::list<uint32_t> &timestamps)
+void MIPRTPALawDecoder::createNewMessages(MIPRTPReceiveMessage *pRTPMsg, std::vector<MIPMediaMessage *> &messages, std::vector<uint32_t> &timestamps)
 {
+	const RTPPacket *pRTPPack = pRTPMsg->getPacket();
 	size_t length = pRTPPack->GetPayloadLength();
-	uint8_t *pData = new uint8_t [length];
-	
-	memcpy(pData, pRTPPack->GetPayloadData(), length);
-	MIPEncodedAudioMessage *pEncMsg = new MIPEncodedAudioMessage(MIPENCODEDAUDIOMESSAGE_TYPE_ALAW, 8000, 1, (int)length, pData, length, true);
+	MIPSharedBuffer *pBuffer = pRTPMsg->getPayloadBuffer();
+
+	MIPEncodedAudioMessage *pEncMsg = new MIPEncodedAudioMessage(MIPENCODEDAUDIOMESSAGE_TYPE_ALAW, 8000, 1, (int)length, pBuffer, length);
 
 	messages.push_back(pEncMsg);
 	timestamps.push_back(pRTPPack->GetTimestamp());
 }
 
+void MIPRTPALawDecoder::createConcealmentMessages(MIPRTPReceiveMessage *pRTPMsg, int numLost, uint32_t timestampsPerPacket,
+                                                  std::vector<MIPMediaMessage *> &messages, std::vector<uint32_t> &timestamps)
+{
+	const RTPPacket *pRTPPack = pRTPMsg->getPacket();
+
+	if (timestampsPerPacket == 0)
+		return;
+
+	for (int i = 0 ; i < numLost ; i++)
+	{
+		MIPEncodedAudioMessage *pEncMsg = new MIPEncodedAudioMessage(MIPENCODEDAUDIOMESSAGE_TYPE_ALAW, 8000, 1, (int)timestampsPerPacket, 0, 0, true);
+
+		pEncMsg->setConcealment(false);
+		messages.push_back(pEncMsg);
+		timestamps.push_back(pRTPPack->GetTimestamp() - ((uint32_t)(numLost-i))*timestampsPerPacket);
+	}
+}
+
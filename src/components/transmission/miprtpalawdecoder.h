@@ -44,7 +44,9 @@ public:
 	~MIPRTPALawDecoder();
 private:
 	bool validatePacket(const jrtplib::RTPPacket *pRTPPack, real_t &timestampUnit, real_t timestampUnitEstimate);
-	void createNewMessages(const jrtplib::RTPPacket *pRTPPack, std::list<MIPMediaMessage *> &messages, std::list<uint32_t> &timestamps);
+	void createNewMessages(MIPRTPReceiveMessage *pRTPMsg, std::vector<MIPMediaMessage *> &messages, std::vector<uint32_t> &timestamps);
+	void createConcealmentMessages(MIPRTPReceiveMessage *pRTPMsg, int numLost, uint32_t timestampsPerPacket,
+	                               std::vector<MIPMediaMessage *> &messages, std::vector<uint32_t> &timestamps);
 };
 
 #endif // MIPRTPALAWDECODER_H
@@ -25,6 +25,8 @@
 #include "mipconfig.h"
 #include "miprtpalawencoder.h"
 #include "miprtpmessage.h"
+#include "mipcomponentchain.h"
+#include "mipmessagearena.h"
 #include "miprawaudiomessage.h"
 #include "mipencodedaudiomessage.h"
 
@@ -93,13 +95,13 @@ bool MIPRTPALawEncoder::push(const MIPComponentChain &chain, int64_t iteration,
 	const void *pData = pEncMsg->getData();
 	bool marker = false;
 	size_t length = pEncMsg->getDataLength();
-	uint8_t *pPayload = new uint8_t [length];
+	uint8_t *pPayload = chain.getMessageArena().allocateArray<uint8_t>(length);
 
 	memcpy(pPayload,pData,length);
 
 	MIPRTPSendMessage *pNewMsg;
 
-	pNewMsg = new MIPRTPSendMessage(pPayload,length,getPayloadType(),marker,pEncMsg->getNumberOfFrames());
+	pNewMsg = chain.getMessageArena().createMessage<MIPRTPSendMessage>(pPayload,length,getPayloadType(),marker,pEncMsg->getNumberOfFrames(),false);
 	pNewMsg->setSamplingInstant(pEncMsg->getTime());
 	
 	m_messages.push_back(pNewMsg);
@@ -143,10 +145,7 @@ void MIPRTPALawEncoder::cleanUp()
 
 void MIPRTPALawEncoder::clearMessages()
 {
-	std::list<MIPRTPSendMessage *>::iterator it;
-
-	for (it = m_messages.begin() ; it != m_messages.end() ; it++)
-		delete (*it);
+	// The messages themselves are stored in the chain's message arena
 	m_messages.clear();
 	m_msgIt = m_messages.begin();
 }
@@ -32,7 +32,7 @@
 
 #include "mipconfig.h"
 #include "miprtpencoder.h"
-#include <list>
+#include <vector>
 
 class MIPRTPSendMessage;
 
@@ -56,8 +56,8 @@ private:
 	void clearMessages();
 
 	bool m_init;
-	std::list<MIPRTPSendMessage *> m_messages;
-	std::list<MIPRTPSendMessage *>::const_iterator m_msgIt;
+	std::vector<MIPRTPSendMessage *> m_messages;
+	std::vector<MIPRTPSendMessage *>::const_iterator m_msgIt;
 	int64_t m_prevIteration;
 };
 
@@ -0,0 +1,65 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+#include "mipconfig.h"
+#include "miprtpcndecoder.h"
+#include "miprtpmessage.h"
+#include "mipencodedaudiomessage.h"
+#include <jrtplib3/rtppacket.h>
+
+#include "mipdebug.h"
+
+using namespace jrtplib;
+
+MIPRTPCNDecoder::MIPRTPCNDecoder(int sampRate, MIPTime noiseDuration)
+{
+	m_sampRate = sampRate;
+	m_numFrames = (int)(noiseDuration.getValue()*(real_t)sampRate + 0.5);
+}
+
+MIPRTPCNDecoder::~MIPRTPCNDecoder()
+{
+}
+
+bool MIPRTPCNDecoder::validatePacket(const RTPPacket *pRTPPack, real_t &timestampUnit, real_t timestampUnitEstimate)
+{
+	if (pRTPPack->GetPayloadLength() < 1 || m_sampRate <= 0)
+		return false;
+
+	timestampUnit = 1.0/(real_t)m_sampRate;
+	return true;
+}
+
+void MIPRTPCNDecoder::createNewMessages(MIPRTPReceiveMessage *pRTPMsg, std::vector<MIPMediaMessage *> &messages, std::vector<uint32_t> &timestamps)
+{
+	const RTPPacket *pRTPPack = pRTPMsg->getPacket();
+	size_t length = pRTPPack->GetPayloadLength();
+	MIPSharedBuffer *pBuffer = pRTPMsg->getPayloadBuffer();
+
+	MIPEncodedAudioMessage *pEncMsg = new MIPEncodedAudioMessage(MIPENCODEDAUDIOMESSAGE_TYPE_CN, m_sampRate, 1, m_numFrames, pBuffer, length);
+
+	messages.push_back(pEncMsg);
+	timestamps.push_back(pRTPPack->GetTimestamp());
+}
+
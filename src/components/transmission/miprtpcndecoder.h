@@ -0,0 +1,65 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+/**
+ * \file miprtpcndecoder.h
+ */
+
+#ifndef MIPRTPCNDECODER_H
+
+#define MIPRTPCNDECODER_H
+
+#include "mipconfig.h"
+#include "miprtppacketdecoder.h"
+#include "miptime.h"
+
+/** Decodes incoming RTP data into comfort noise messages.
+ *  This class takes RTP packets containing RFC 3389 comfort noise parameters and produces
+ *  encoded audio messages with subtype MIPENCODEDAUDIOMESSAGE_TYPE_CN, which can be turned
+ *  into audio by MIPComfortNoiseDecoder. Since a comfort noise packet does not say for how 
+ *  long the noise should be played, each message covers a fixed amount of time. This should
+ *  correspond to the interval at which the sender transmits comfort noise packets (see
+ *  MIPVoiceActivityDetector::init).
+ */
+class EMIPLIB_IMPORTEXPORT MIPRTPCNDecoder : public MIPRTPPacketDecoder
+{
+public:
+	/** Creates a decoder for comfort noise packets.
+	 *  Creates a decoder for comfort noise packets.
+	 *  \param sampRate The sampling rate of the audio, which also determines the timestamp unit.
+	 *                  For the static payload type 13, this is 8000 Hz.
+	 *  \param noiseDuration The amount of noise each message describes.
+	 */
+	MIPRTPCNDecoder(int sampRate = 8000, MIPTime noiseDuration = MIPTime(0.2));
+	~MIPRTPCNDecoder();
+private:
+	bool validatePacket(const jrtplib::RTPPacket *pRTPPack, real_t &timestampUnit, real_t timestampUnitEstimate);
+	void createNewMessages(MIPRTPReceiveMessage *pRTPMsg, std::vector<MIPMediaMessage *> &messages, std::vector<uint32_t> &timestamps);
+
+	int m_sampRate;
+	int m_numFrames;
+};
+
+#endif // MIPRTPCNDECODER_H
+
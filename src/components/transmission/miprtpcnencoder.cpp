@@ -0,0 +1,102 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+#include "mipconfig.h"
+#include "miprtpcnencoder.h"
+#include "miprtpmessage.h"
+#include "mipencodedaudiomessage.h"
+#include <string.h>
+
+#include "mipdebug.h"
+
+#define MIPRTPCNENCODER_ERRSTR_BADMESSAGE		"Can't understand message"
+#define MIPRTPCNENCODER_ERRSTR_NOTINIT			"RTP comfort noise encoder not initialized"
+#define MIPRTPCNENCODER_ERRSTR_BADCHANNELS		"Only mono audio is allowed"
+
+MIPRTPCNEncoder::MIPRTPCNEncoder() : MIPRTPEncoder("MIPRTPCNEncoder")
+{
+	m_init = false;
+	setPayloadType(13);
+}
+
+MIPRTPCNEncoder::~MIPRTPCNEncoder()
+{
+	cleanUp();
+}
+
+bool MIPRTPCNEncoder::init()
+{
+	if (m_init)
+		cleanUp();
+
+	MIPOutputMessageQueue::init();
+	m_init = true;
+	return true;
+}
+
+bool MIPRTPCNEncoder::push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg)
+{
+	if (!m_init)
+	{
+		setErrorString(MIPRTPCNENCODER_ERRSTR_NOTINIT);
+		return false;
+	}
+
+	checkIteration(iteration);
+
+	if (!(pMsg->getMessageType() == MIPMESSAGE_TYPE_AUDIO_ENCODED && pMsg->getMessageSubtype() == MIPENCODEDAUDIOMESSAGE_TYPE_CN))
+	{
+		setErrorString(MIPRTPCNENCODER_ERRSTR_BADMESSAGE);
+		return false;
+	}
+
+	MIPEncodedAudioMessage *pEncMsg = (MIPEncodedAudioMessage *)pMsg;
+
+	if (pEncMsg->getNumberOfChannels() != 1)
+	{
+		setErrorString(MIPRTPCNENCODER_ERRSTR_BADCHANNELS);
+		return false;
+	}
+
+	size_t length = pEncMsg->getDataLength();
+	uint8_t *pPayload = allocateOutputData<uint8_t>(chain, length);
+
+	memcpy(pPayload, pEncMsg->getData(), length);
+
+	// The marker bit is never set on comfort noise packets, the timestamp is
+	// increased by the interval the comfort noise message replaces
+	MIPRTPSendMessage *pNewMsg = createOutputMessage<MIPRTPSendMessage>(chain, pPayload, length, getPayloadType(), false,
+	                                                                    (uint32_t)pEncMsg->getNumberOfFrames(), false);
+	pNewMsg->setSamplingInstant(pEncMsg->getTime());
+	pNewMsg->setComfortNoise(true);
+
+	return true;
+}
+
+void MIPRTPCNEncoder::cleanUp()
+{
+	clearMessages();
+	m_init = false;
+}
+
@@ -0,0 +1,61 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+/**
+ * \file miprtpcnencoder.h
+ */
+
+#ifndef MIPRTPCNENCODER_H
+
+#define MIPRTPCNENCODER_H
+
+#include "mipconfig.h"
+#include "miprtpencoder.h"
+
+/** Creates RTP packets for comfort noise messages.
+ *  This component accepts encoded audio messages with subtype MIPENCODEDAUDIOMESSAGE_TYPE_CN,
+ *  like the ones produced by MIPVoiceActivityDetector, and generates MIPRTPSendMessage objects 
+ *  which can then be transferred to a MIPRTPComponent instance. The payload format is the one
+ *  from RFC 3389. The static payload type 13 can only be used for audio with a sampling rate 
+ *  of 8000 Hz, for other rates a dynamic payload type should be set.
+ */
+class EMIPLIB_IMPORTEXPORT MIPRTPCNEncoder : public MIPRTPEncoder
+{
+public:
+	MIPRTPCNEncoder();
+	~MIPRTPCNEncoder();
+
+	/** Initializes the encoder. */
+	bool init();
+
+	bool push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg);
+	// pull is provided by MIPOutputMessageQueue
+private:
+	void cleanUp();
+
+	bool m_init;
+};
+
+#endif // MIPRTPCNENCODER_H
+
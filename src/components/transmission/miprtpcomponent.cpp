@@ -26,6 +26,7 @@
 #include "miprtpcomponent.h"
 #include "miprtpmessage.h"
 #include "mipsystemmessage.h"
+#include "mipudpbatchtransport.h"
 #include <jrtplib3/rtpsession.h>
 #include <jrtplib3/rtpsourcedata.h>
 
@@ -39,16 +40,20 @@ using namespace jrtplib;
 #define MIPRTPCOMPONENT_ERRSTR_BADMESSAGE		"Not a valid message"
 #define MIPRTPCOMPONENT_ERRSTR_NORTPSESSION		"The RTP session is not created yet"
 #define MIPRTPCOMPONENT_ERRSTR_RTPERROR			"Detected JRTPLIB error: "
+#define MIPRTPCOMPONENT_ERRSTR_TRANSPORTERROR		"Error in UDP batch transport: "
 
 MIPRTPComponent::MIPRTPComponent() : MIPComponent("MIPRTPComponent")
 {
 	m_pRTPSession = 0;
-	m_msgIt = m_messages.begin();
+	m_numMessages = 0;
+	m_msgPos = 0;
+	m_pBatchTransport = 0;
 }
 
 MIPRTPComponent::~MIPRTPComponent()
 {
 	destroy();
+	deleteMessages();
 }
 
 bool MIPRTPComponent::init(RTPSession *pSess, uint32_t silentTimestampIncrement)
@@ -69,8 +74,10 @@ bool MIPRTPComponent::init(RTPSession *pSess, uint32_t silentTimestampIncrement)
 	m_prevIteration = -1;
 	m_prevSendIteration = -1;
 	m_silentTimestampIncrease = silentTimestampIncrement;
+	m_prevComfortNoise = false;
 	m_enableSending = true;
-	m_msgIt = m_messages.begin();
+	m_numMessages = 0;
+	m_msgPos = 0;
 	
 	return true;
 }
@@ -82,8 +89,9 @@ bool MIPRTPComponent::destroy()
 		setErrorString(MIPRTPCOMPONENT_ERRSTR_NOTINIT);
 		return false;
 	}
+	deleteMessages();
 	m_pRTPSession = 0;
-	clearMessages();
+	m_pBatchTransport = 0;
 	return true;
 }
 
@@ -102,10 +110,15 @@ bool MIPRTPComponent::push(const MIPComponentChain &chain, int64_t iteration, MI
 	
 	if (pMsg->getMessageType() == MIPMESSAGE_TYPE_RTP && pMsg->getMessageSubtype() == MIPRTPMESSAGE_TYPE_SEND)
 	{
+		MIPRTPSendMessage *pRTPMsg = (MIPRTPSendMessage *)pMsg;
+		bool marker = pRTPMsg->getMarker();
+
 		// Check if the timestamp needs to be increased first
 
 		if (m_silentTimestampIncrease != 0)
 		{
+			bool talkSpurtStart = true;
+
 			if (m_prevSendIteration != -1)
 			{
 				int64_t intervals = iteration - m_prevSendIteration - 1;
@@ -116,14 +129,24 @@ bool MIPRTPComponent::push(const MIPComponentChain &chain, int64_t iteration, MI
 
 					m_pRTPSession->IncrementTimestamp(tsInc);
 				}
+				else if (!m_prevComfortNoise)
+					talkSpurtStart = false;
 			}
+
+			// As described in RFC 3551, the first packet of a talk spurt gets the
+			// marker bit, comfort noise packets never do
+			if (pRTPMsg->isComfortNoise())
+				marker = false;
+			else if (talkSpurtStart)
+				marker = true;
+
+			m_prevComfortNoise = pRTPMsg->isComfortNoise();
 		}
 
 		m_prevSendIteration = iteration;
 
 		// Send message
 		
-		MIPRTPSendMessage *pRTPMsg = (MIPRTPSendMessage *)pMsg;
 		int status;
 
 		MIPTime sampInst = pRTPMsg->getSamplingInstant();
@@ -136,7 +159,7 @@ bool MIPRTPComponent::push(const MIPComponentChain &chain, int64_t iteration, MI
 		if (m_enableSending)
 		{
 			status = m_pRTPSession->SendPacket(pRTPMsg->getPayload(),pRTPMsg->getPayloadLength(),
-							pRTPMsg->getPayloadType(),pRTPMsg->getMarker(),
+							pRTPMsg->getPayloadType(),marker,
 							pRTPMsg->getTimestampIncrement());
 		}
 		else
@@ -180,15 +203,15 @@ bool MIPRTPComponent::pull(const MIPComponentChain &chain, int64_t iteration, MI
 	if (!processNewPackets(iteration))
 		return false;
 
-	if (m_msgIt == m_messages.end())
+	if (m_msgPos == m_numMessages)
 	{
-		m_msgIt = m_messages.begin();
+		m_msgPos = 0;
 		*pMsg = 0;
 	}
 	else
 	{
-		*pMsg = *m_msgIt;
-		m_msgIt++;
+		*pMsg = m_messages[m_msgPos];
+		m_msgPos++;
 	}
 	return true;
 }
@@ -199,6 +222,15 @@ bool MIPRTPComponent::processNewPackets(int64_t iteration)
 	{
 		m_prevIteration = iteration;
 		clearMessages();
+
+#if !(defined(WIN32) || defined(_WIN32_WCE))
+		if (m_pBatchTransport && m_pBatchTransport->receivePackets() < 0)
+		{
+			setErrorString(std::string(MIPRTPCOMPONENT_ERRSTR_TRANSPORTERROR) + m_pBatchTransport->getErrorString());
+			return false;
+		}
+#endif // !(WIN32 || _WIN32_WCE)
+
 		m_pRTPSession->Poll(); // This is a dummy function if the RTPSession background thread is used.
 		m_pRTPSession->BeginDataAccess();
 		if (m_pRTPSession->GotoFirstSourceWithData())
@@ -244,7 +276,19 @@ bool MIPRTPComponent::processNewPackets(int64_t iteration)
 				
 				while ((pPack = m_pRTPSession->GetNextPacket()) != 0)
 				{
-					MIPRTPReceiveMessage *pRTPMsg = new MIPRTPReceiveMessage(pPack,pCName,cnameLength,true,m_pRTPSession);
+					MIPRTPReceiveMessage *pRTPMsg;
+
+					if (m_numMessages < m_messages.size())
+					{
+						pRTPMsg = m_messages[m_numMessages];
+						pRTPMsg->setPacket(pPack,pCName,cnameLength,true,m_pRTPSession);
+					}
+					else
+					{
+						pRTPMsg = new MIPRTPReceiveMessage(pPack,pCName,cnameLength,true,m_pRTPSession);
+						m_messages.push_back(pRTPMsg);
+					}
+					m_numMessages++;
 
 					pRTPMsg->setJitter(MIPTime(jitterSeconds));
 					if (tsUnit > 0)
@@ -255,24 +299,30 @@ bool MIPRTPComponent::processNewPackets(int64_t iteration)
 						pRTPMsg->setTimingInfo(timingInfWallclock, timingInfTimestamp);
 
 					pRTPMsg->setSourceID(getSourceID(pPack, srcData));
-					m_messages.push_back(pRTPMsg);
 				}
 			} while (m_pRTPSession->GotoNextSourceWithData());
 		}
 		m_pRTPSession->EndDataAccess();
-  		m_msgIt = m_messages.begin();
+		m_msgPos = 0;
 	}
 	return true;
 }
 
 void MIPRTPComponent::clearMessages()
 {
-	std::list<MIPRTPReceiveMessage *>::iterator it;
+	// Only the packets are released, the message objects are kept for the next iteration
+	for (size_t i = 0 ; i < m_numMessages ; i++)
+		m_messages[i]->releasePacket();
+	m_numMessages = 0;
+	m_msgPos = 0;
+}
 
-	for (it = m_messages.begin() ; it != m_messages.end() ; it++)
-		delete (*it);
+void MIPRTPComponent::deleteMessages()
+{
+	clearMessages();
+	for (size_t i = 0 ; i < m_messages.size() ; i++)
+		delete m_messages[i];
 	m_messages.clear();
-	m_msgIt = m_messages.begin();
 }
 
 uint64_t MIPRTPComponent::getSourceID(const RTPPacket *pPack, const RTPSourceData *pSourceData) const
@@ -32,9 +32,10 @@
 
 #include "mipconfig.h"
 #include "mipcomponent.h"
-#include <list>
+#include <vector>
 
 class MIPRTPReceiveMessage;
+class MIPUDPBatchTransport;
 
 namespace jrtplib
 {
@@ -64,6 +65,10 @@ public:
 	 *                                  system, it is possible that during certain intervals no
 	 *                                  messages will reach this component. For these 'skipped'
 	 *                                  intervals, the RTP timestamp will be increased by this amount.
+	 *                                  When this is non-zero, the marker bit is also set on the first
+	 *                                  packet after such a gap, or after a comfort noise packet (see
+	 *                                  MIPRTPSendMessage::setComfortNoise), to mark the start of a
+	 *                                  talk spurt.
 	 */
 	bool init(jrtplib::RTPSession *pSess, uint32_t silentTimestampIncrement = 0);
 
@@ -76,6 +81,14 @@ public:
 	/** This flag controls if RTP packets are actually sent out, useful for a push-to-talk system for example (enabled by default). */
 	void setEnableSending(bool f)										{ m_enableSending = f; }
 
+	/** Sets the transport from which incoming packets should be read at the start of each iteration.
+	 *  When the RTP session uses a MIPUDPBatchTransport instance as its sender, incoming packets
+	 *  are only read when MIPUDPBatchTransport::receivePackets is called. If such a transport is
+	 *  set using this function, this component calls it each time new packets are processed,
+	 *  right before polling the RTP session. Set to null to disable this again.
+	 */
+	void setUDPBatchTransport(MIPUDPBatchTransport *pTransport)						{ m_pBatchTransport = pTransport; }
+
 	bool push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg);
 	bool pull(const MIPComponentChain &chain, int64_t iteration, MIPMessage **pMsg);
 protected:
@@ -89,13 +102,19 @@ protected:
 private:
 	bool processNewPackets(int64_t iteration);	
 	void clearMessages();
+	void deleteMessages();
 	
-	std::list<MIPRTPReceiveMessage *> m_messages;
-	std::list<MIPRTPReceiveMessage *>::const_iterator m_msgIt;
+	// The message objects are reused in subsequent iterations, only the first
+	// m_numMessages entries contain a packet of the current iteration
+	std::vector<MIPRTPReceiveMessage *> m_messages;
+	size_t m_numMessages;
+	size_t m_msgPos;
+	MIPUDPBatchTransport *m_pBatchTransport;
 	int64_t m_prevIteration;
 	int64_t m_prevSendIteration;
 	jrtplib::RTPSession *m_pRTPSession;
 	uint32_t m_silentTimestampIncrease;
+	bool m_prevComfortNoise;
 	bool m_enableSending;
 };
 
@@ -41,10 +41,26 @@ using namespace jrtplib;
 #define MIPRTPDECODER_ERRSTR_NOTINIT				"Not initialized"
 #define MIPRTPDECODER_ERRSTR_BADMESSAGE				"Bad message"
 #define MIPRTPDECODER_ERRSTR_NOPACKETDECODERINSTALLED		"No RTP packet decoder installed for received payload type"
+#define MIPRTPDECODER_ERRSTR_BADLATELOSSRATE			"The late loss rate must lie between 0 and 1"
+#define MIPRTPDECODER_ERRSTR_SSRCNOTFOUND			"No jitter buffer information is available for the specified SSRC"
+
+#define MINOFFSET 0.000005
+
+// Parameters of the adaptive jitter buffer
+#define MIPRTPDECODER_HISTBINSIZE				5000000 // 5 ms, in nanoseconds
+#define MIPRTPDECODER_MINDELAYWINDOW				2000000000 // 2 s, in nanoseconds
+#define MIPRTPDECODER_HISTFORGETFACTOR				0.998
+#define MIPRTPDECODER_LATEFORGETFACTOR				0.99
+#define MIPRTPDECODER_MINARRIVALS				16
+#define MIPRTPDECODER_COMPRESSINTERVAL				1000000000 // 1 s, in nanoseconds
+#define MIPRTPDECODER_DEFAULTLATELOSSRATE			0.02
+#define MIPRTPDECODER_DEFAULTMAXCONCEALEDPACKETS		5
 
 MIPRTPDecoder::MIPRTPDecoder() : MIPComponent("MIPRTPDecoder"), m_playbackOffset(0), m_prevCleanTableTime(0), m_maxJitterBuffer(-1)
 {
 	m_init = false;
+	m_lateLossRate = MIPRTPDECODER_DEFAULTLATELOSSRATE;
+	m_maxConcealedPackets = MIPRTPDECODER_DEFAULTMAXCONCEALEDPACKETS;
 }
 
 MIPRTPDecoder::~MIPRTPDecoder()
@@ -58,7 +74,7 @@ bool MIPRTPDecoder::init(bool calcStreamTime, MIPRTPSynchronizer *pSynchronizer,
 		cleanUp();
 
 	m_prevIteration = -1;
-	m_msgIt = m_messages.begin();
+	m_msgPos = 0;
 	m_gotPlaybackFeedback = false;
 	m_prevCleanTableTime = MIPTime::getCurrentTime();
 	m_calcStreamTime = calcStreamTime;
@@ -106,6 +122,41 @@ bool MIPRTPDecoder::setPacketDecoder(uint8_t payloadType, MIPRTPPacketDecoder *p
 	return true;
 }
 
+bool MIPRTPDecoder::setTargetLateLossRate(real_t rate)
+{
+	if (rate < 0 || rate >= 1.0)
+	{
+		setErrorString(MIPRTPDECODER_ERRSTR_BADLATELOSSRATE);
+		return false;
+	}
+	m_lateLossRate = rate;
+	return true;
+}
+
+bool MIPRTPDecoder::getJitterBufferInfo(uint32_t ssrc, MIPTime &currentDelay, MIPTime &targetDelay, real_t &lateLossRate) const
+{
+	std::unordered_map<uint32_t, SSRCInfo>::const_iterator it = m_sourceTable.find(ssrc);
+
+	if (it == m_sourceTable.end() || !(*it).second.hasPlaybackOffset())
+	{
+		setErrorString(MIPRTPDECODER_ERRSTR_SSRCNOTFOUND);
+		return false;
+	}
+
+	const SSRCInfo &info = (*it).second;
+	int64_t minDelay = info.getMinimumArrivalDelay().getNanoSeconds();
+
+	currentDelay = MIPTime::fromNanoSeconds(info.getPlaybackOffset().getNanoSeconds() - minDelay);
+	targetDelay = MIPTime::fromNanoSeconds(info.getTargetOffset().getNanoSeconds() - minDelay);
+	if (m_useFixedJitterBuffer)
+	{
+		currentDelay += m_fixedJitterBuffer;
+		targetDelay += m_fixedJitterBuffer;
+	}
+	lateLossRate = info.getLateLossRate();
+	return true;
+}
+
 bool MIPRTPDecoder::push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg)
 {
 	if (!m_init)
@@ -182,14 +233,15 @@ bool MIPRTPDecoder::push(const MIPComponentChain &chain, int64_t iteration, MIPM
 		}
 	}
 
-	std::list<MIPMediaMessage *> messages;
-	std::list<MIPMediaMessage *>::iterator it;
-	std::list<uint32_t> timestamps;
-	std::list<uint32_t>::iterator it2;
+	// The vectors are members so that their memory can be reused for each packet
+	m_newMessages.clear();
+	m_newTimestamps.clear();
+	m_concealMessages.clear();
+	m_concealTimestamps.clear();
 
-	pDecoder->createNewMessages(pRTPPack, messages, timestamps);
+	pDecoder->createNewMessages(pRTPMsg, m_newMessages, m_newTimestamps);
 
-	if (messages.empty())
+	if (m_newMessages.empty())
 	{
 		// Either something went wrong, or the RTP packet was only part of a composite packet
 		// Ignore packet
@@ -201,36 +253,68 @@ bool MIPRTPDecoder::push(const MIPComponentChain &chain, int64_t iteration, MIPM
 	const uint8_t *pCName = pRTPMsg->getCName();
 	size_t cnameLength = pRTPMsg->getCNameLength();
 	MIPTime jitterValue = pRTPMsg->getJitter();
+	uint32_t msgType = m_newMessages[0]->getMessageType();
+	bool isAudio = (msgType == MIPMESSAGE_TYPE_AUDIO_RAW || msgType == MIPMESSAGE_TYPE_AUDIO_ENCODED);
 
-	for (it = messages.begin(), it2 = timestamps.begin() ; it != messages.end() ; it++, it2++)
+	for (size_t i = 0 ; i < m_newMessages.size() ; i++)
 	{
-		MIPMediaMessage *pNewMsg = *it;
+		MIPMediaMessage *pNewMsg = m_newMessages[i];
+		uint32_t timestamp = m_newTimestamps[i];
 
 		if (m_calcStreamTime)
 		{
 			bool shouldSync = false;
-			uint32_t timestamp = *it2;
 
 			if (!lookUpStreamTime(ssrc, timestamp, pCName, cnameLength, timestampUnit, streamTime, shouldSync))
 			{
 				// something went wrong, ignore packet
+				deleteNewMessages(i);
 				return true;
 			}
 
-			MIPTime insertOffset(0);
+			MIPTime mediaTime = streamTime;
 
-			if (!adjustToPlaybackTime(jitterValue, streamTime, insertOffset))
+			if (i == 0) // the playout delay is adjusted on a per packet basis
 			{
-				// something went wrong, ignore packet
-				return true;
+				bool dropPacket = false;
+				uint32_t seqNr = pRTPPack->GetExtendedSequenceNumber();
+				uint32_t timestampsPerPacket = 0;
+				int numLost = m_pSSRCInfo->checkSequenceNumber(seqNr, timestamp, timestampsPerPacket);
+
+				if (numLost < 0) // this packet has already been concealed
+					dropPacket = true;
+				else
+					updatePlayoutDelay(jitterValue, streamTime, isAudio, pRTPPack->HasMarker(), seqNr, dropPacket);
+
+				if (dropPacket)
+				{
+					// Skipping this packet reduces the playout delay
+					deleteNewMessages(i);
+					return true;
+				}
+
+				if (numLost > 0 && numLost <= m_maxConcealedPackets)
+				{
+					pDecoder->createConcealmentMessages(pRTPMsg, numLost, timestampsPerPacket, m_concealMessages, m_concealTimestamps);
+					if (!m_concealMessages.empty())
+						m_pSSRCInfo->setConcealedPackets(seqNr - (uint32_t)numLost, numLost);
+				}
 			}
 
+			MIPTime insertOffset(0);
+
+			adjustToPlaybackTime(streamTime, insertOffset);
+
 			if (m_pSynchronizer != 0) // a synchronization object is available
 			{
-				MIPTime syncOffset;
+				MIPTime syncOffset = m_pSSRCInfo->getSyncOffset(mediaTime);
 
 				if (shouldSync)
 				{
+					MIPTime targetOffset;
+					real_t maxSlewRate;
+					bool gotTarget;
+
 					m_pSynchronizer->lock();
 					if (pRTPMsg->isTimingInfoSet())
 					{
@@ -241,27 +325,52 @@ bool MIPRTPDecoder::push(const MIPComponentChain &chain, int64_t iteration, MIPM
 						m_pSynchronizer->setStreamInfo(m_pSSRCInfo->getSyncStreamID(), SRwallclock, SRtimestamp,
 								       timestamp, insertOffset, m_totalComponentDelay);
 					}
-					syncOffset = m_pSynchronizer->calculateSynchronizationOffset(m_pSSRCInfo->getSyncStreamID());
+					gotTarget = m_pSynchronizer->calculateSynchronizationOffset(m_pSSRCInfo->getSyncStreamID(), syncOffset, &targetOffset);
+					maxSlewRate = m_pSynchronizer->getMaximumSlewRate();
 					m_pSynchronizer->unlock();
 				
-					m_pSSRCInfo->setSyncOffset(syncOffset);
+					if (gotTarget)
+					{
+						m_pSSRCInfo->setSyncTargetOffset(targetOffset, maxSlewRate);
+						syncOffset = m_pSSRCInfo->getSyncOffset(mediaTime);
+					}
 				}
-				else
-					syncOffset = m_pSSRCInfo->getSyncOffset();
 
 				streamTime += syncOffset;
 			}
 		}
 		
+		if (!m_concealMessages.empty())
+		{
+			// The concealment messages are placed just before the first message of
+			// this packet, both in time and in the order in which they're processed
+
+			for (size_t j = 0 ; j < m_concealMessages.size() ; j++)
+			{
+				MIPMediaMessage *pConcealMsg = m_concealMessages[j];
+				MIPTime concealTime = streamTime;
+
+				concealTime -= MIPTime(((real_t)(timestamp - m_concealTimestamps[j]))*timestampUnit);
+				pConcealMsg->setSourceID(sourceID);
+				pConcealMsg->setTime(concealTime);
+
+				onNewMediaMessage(ssrc, m_concealTimestamps[j], pConcealMsg);
+
+				m_messages.push_back(pConcealMsg);
+			}
+			m_concealMessages.clear();
+			m_concealTimestamps.clear();
+		}
+
 		pNewMsg->setSourceID(sourceID);
 		pNewMsg->setTime(streamTime);
 
-		onNewMediaMessage(ssrc, *it2, pNewMsg);
+		onNewMediaMessage(ssrc, timestamp, pNewMsg);
 		
 		m_messages.push_back(pNewMsg);
 	}
 
-	m_msgIt = m_messages.begin();
+	m_msgPos = 0;
 	
 	return true;
 }
@@ -281,15 +390,15 @@ bool MIPRTPDecoder::pull(const MIPComponentChain &chain, int64_t iteration, MIPM
 		cleanUpSourceTable();
 	}
 	
-	if (m_msgIt == m_messages.end())
+	if (m_msgPos >= m_messages.size())
 	{
 		*pMsg = 0;
-		m_msgIt = m_messages.begin();
+		m_msgPos = 0;
 	}
 	else
 	{
-		*pMsg = *m_msgIt;
-		m_msgIt++;
+		*pMsg = m_messages[m_msgPos];
+		m_msgPos++;
 	}
 	return true;
 }
@@ -322,12 +431,22 @@ void MIPRTPDecoder::cleanUp()
 
 void MIPRTPDecoder::clearMessages()
 {
-	std::list<MIPMediaMessage *>::iterator it;
-
-	for (it = m_messages.begin() ; it != m_messages.end() ; it++)
-		delete (*it);
+	for (size_t i = 0 ; i < m_messages.size() ; i++)
+		delete m_messages[i];
 	m_messages.clear();
-	m_msgIt = m_messages.begin();
+	m_msgPos = 0;
+}
+
+void MIPRTPDecoder::deleteNewMessages(size_t startPos)
+{
+	for (size_t i = startPos ; i < m_newMessages.size() ; i++)
+		delete m_newMessages[i];
+	for (size_t i = 0 ; i < m_concealMessages.size() ; i++)
+		delete m_concealMessages[i];
+	m_newMessages.clear();
+	m_newTimestamps.clear();
+	m_concealMessages.clear();
+	m_concealTimestamps.clear();
 }
 
 void MIPRTPDecoder::cleanUpSourceTable()
@@ -419,145 +538,240 @@ bool MIPRTPDecoder::lookUpStreamTime(uint32_t ssrc, uint32_t timestamp, const ui
 	return true;
 }
 
-#define MINOFFSET 0.000005
-
-bool MIPRTPDecoder::adjustToPlaybackTime(MIPTime jitterValue, MIPTime &streamTime, MIPTime &insertOffset)
+bool MIPRTPDecoder::updatePlayoutDelay(MIPTime jitterValue, MIPTime streamTime, bool audio, bool marker, uint32_t sequenceNumber, bool &dropPacket)
 {
-	// The current SSRCInfo is in m_pSSRCInfo;
-	
-	if (!m_pSSRCInfo->hasLastOffsetAdjustTime())
+	// The current SSRCInfo is in m_pSSRCInfo; the stream time does not include
+	// the playback offset yet
+
+	dropPacket = false;
+
+	MIPTime now = m_playbackOffset;
+	MIPTime arrivalDelay = MIPTime::fromNanoSeconds(now.getNanoSeconds() - streamTime.getNanoSeconds());
+
+	if (!m_pSSRCInfo->hasPlaybackOffset())
 	{
 		MIPTime defaultOffset = MIPTime(jitterValue.getValue()*2.0);
 
 		defaultOffset += MIPTime(MINOFFSET);
-		defaultOffset += m_playbackOffset;
+		defaultOffset += arrivalDelay;
 		
-		m_pSSRCInfo->setPlaybackOffset(defaultOffset);
+		m_pSSRCInfo->setPlaybackOffset(defaultOffset, now);
+	}
+
+	// Without playback feedback we can't tell when packets arrive, and with a
+	// fixed jitter buffer nothing needs to be adjusted
+	if (m_useFixedJitterBuffer || !m_gotPlaybackFeedback)
+		return true;
+
+	bool boundary = m_pSSRCInfo->checkBoundary(streamTime, audio, marker, sequenceNumber);
+
+	m_pSSRCInfo->addArrivalDelay(now, arrivalDelay);
+	if (!m_pSSRCInfo->calculateTargetOffset(m_lateLossRate, m_maxJitterBuffer)) // need several packets for a good estimate
+		return true;
+
+	int64_t offset = m_pSSRCInfo->getPlaybackOffset().getNanoSeconds();
+	int64_t target = m_pSSRCInfo->getTargetOffset().getNanoSeconds();
+
+	if (target == offset)
+		return true;
+
+	if (arrivalDelay.getNanoSeconds() + MIPTime(MINOFFSET).getNanoSeconds() > offset) 
+	{
+		// This packet would be too late: if the statistics say we need more buffering,
+		// increase it right away. The mixer will fill the gap with silence.
+		if (target > offset)
+			m_pSSRCInfo->setPlaybackOffset(MIPTime::fromNanoSeconds(target), now);
+	}
+	else if (boundary)
+	{
+		// At the start of a talk spurt (or a new video frame) the offset can be changed
+		// without being noticed, as long as consecutive audio packets don't overlap
+		if (audio && target < offset)
+		{
+			int64_t minOffset = offset - m_pSSRCInfo->getSilenceLength().getNanoSeconds();
+
+			if (target < minOffset)
+				target = minOffset;
+		}
+		m_pSSRCInfo->setPlaybackOffset(MIPTime::fromNanoSeconds(target), now);
+	}
+	else if (audio && target < offset)
+	{
+		// For a continuous stream we reduce the delay by skipping a packet now and then
+		int64_t duration = m_pSSRCInfo->getPacketDuration().getNanoSeconds();
+		int64_t sinceAdjust = now.getNanoSeconds() - m_pSSRCInfo->getLastOffsetAdjustTime().getNanoSeconds();
+
+		if (duration > 0 && offset - target >= duration && sinceAdjust >= MIPRTPDECODER_COMPRESSINTERVAL)
+		{
+			m_pSSRCInfo->setPlaybackOffset(MIPTime::fromNanoSeconds(offset - duration), now);
+			dropPacket = true;
+		}
 	}
+	return true;
+}
+
+void MIPRTPDecoder::adjustToPlaybackTime(MIPTime &streamTime, MIPTime &insertOffset)
+{
+	// The current SSRCInfo is in m_pSSRCInfo;
 	
 	streamTime += m_pSSRCInfo->getPlaybackOffset();
 
-	// TODO: search for a decent jitter buffer algorithm
+	if (m_useFixedJitterBuffer)
+		streamTime += m_fixedJitterBuffer;
 	
-	// Jitter buffer
+	MIPTime x = streamTime;
+	x -= m_playbackOffset;
+	insertOffset = x;
+}
+
+void MIPRTPDecoder::SSRCInfo::addArrivalDelay(MIPTime now, MIPTime arrivalDelay)
+{
+	int64_t t = now.getNanoSeconds();
+	int64_t delay = arrivalDelay.getNanoSeconds();
 
-	if (!m_useFixedJitterBuffer)
+	if (m_gotPlaybackOffset)
 	{
-		MIPTime diff = streamTime;
-		diff -= m_playbackOffset;
-	//	std::cerr << "Diff:            " << diff.getString() << std::endl;
-		
-		m_pSSRCInfo->addInsertTime(diff);
+		bool late = (delay + MIPTime(MINOFFSET).getNanoSeconds() > m_playbackOffset.getNanoSeconds());
 
-	//	std::cerr << "Insert average:  " << m_pSSRCInfo->getInsertTimeAverage().getString() << std::endl;
-	//	std::cerr << "Insert variance: " << m_pSSRCInfo->getInsertTimeVariance().getString() << std::endl;
-	//	std::cerr << "Jitter:          " << jitterValue.getString() << std::endl;
-		
-		real_t insertDiff = m_pSSRCInfo->getInsertTimeAverage().getValue();
-		real_t variance = m_pSSRCInfo->getInsertTimeVariance().getValue();
-	//	real_t jitter = jitterValue.getValue();
-	//
-	//	if (jitter > variance)
-	//		variance = jitter;
+		m_lateLossRate *= MIPRTPDECODER_LATEFORGETFACTOR;
+		if (late)
+			m_lateLossRate += (1.0 - MIPRTPDECODER_LATEFORGETFACTOR);
+	}
+
+	// Keep track of the minimum arrival delay in a sliding window; the deque
+	// is kept sorted so that the front always contains the minimum
+
+	while (!m_minDelays.empty() && m_minDelays.back().second >= arrivalDelay)
+		m_minDelays.pop_back();
+	m_minDelays.push_back(std::pair<MIPTime, MIPTime>(now, arrivalDelay));
+	while (m_minDelays.front().first.getNanoSeconds() < t - MIPRTPDECODER_MINDELAYWINDOW)
+		m_minDelays.pop_front();
+
+	// Update the histogram of the delays relative to this minimum
+
+	int64_t bin = (delay - m_minDelays.front().second.getNanoSeconds())/MIPRTPDECODER_HISTBINSIZE;
+
+	if (bin >= MIPRTPDECODER_HISTBINS)
+		bin = MIPRTPDECODER_HISTBINS-1;
+
+	for (int i = 0 ; i < MIPRTPDECODER_HISTBINS ; i++)
+		m_histogram[i] *= MIPRTPDECODER_HISTFORGETFACTOR;
+	m_histogram[bin] += (1.0 - MIPRTPDECODER_HISTFORGETFACTOR);
+
+	m_numArrivals++;
+}
+
+bool MIPRTPDecoder::SSRCInfo::calculateTargetOffset(real_t lateLossRate, MIPTime maxBuffering)
+{
+	if (m_numArrivals < MIPRTPDECODER_MINARRIVALS || m_minDelays.empty())
+		return false;
+
+	real_t total = 0;
+
+	for (int i = 0 ; i < MIPRTPDECODER_HISTBINS ; i++)
+		total += m_histogram[i];
+	if (total <= 0)
+		return false;
+
+	// Look for the bin which contains the (1-lateLossRate) quantile
+	real_t threshold = (1.0 - lateLossRate)*total;
+	real_t sum = 0;
+	int bin = 0;
 
-		//real_t offset = insertDiff - 2.0*variance;
-		real_t offset = insertDiff - 3.0*variance; // TODO: which is best
+	for ( ; bin < MIPRTPDECODER_HISTBINS-1 ; bin++)
+	{
+		sum += m_histogram[bin];
+		if (sum >= threshold)
+			break;
+	}
+
+	int64_t buffering = ((int64_t)(bin+1))*MIPRTPDECODER_HISTBINSIZE;
+
+	if (maxBuffering.getNanoSeconds() > 0 && buffering > maxBuffering.getNanoSeconds())
+		buffering = maxBuffering.getNanoSeconds();
+
+	m_targetOffset = MIPTime::fromNanoSeconds(m_minDelays.front().second.getNanoSeconds() + buffering + MIPTime(MINOFFSET).getNanoSeconds());
+	return true;
+}
+
+bool MIPRTPDecoder::SSRCInfo::checkBoundary(MIPTime streamTime, bool audio, bool marker, uint32_t sequenceNumber)
+{
+	bool boundary = false;
+
+	m_silenceLength = MIPTime(0);
+
+	if (m_gotPrevPacket)
+	{
+		if ((int32_t)(sequenceNumber - m_prevSequenceNumber) <= 0) // duplicate or out of order packet
+			return false;
 
-		// Limit the maximum offset
-		if (m_maxJitterBuffer.getValue() > 0 && offset > m_maxJitterBuffer.getValue())
-			offset = m_maxJitterBuffer.getValue();
+		int64_t diff = streamTime.getNanoSeconds() - m_prevStreamTime.getNanoSeconds();
+		int64_t duration = m_packetDuration.getNanoSeconds();
 
-		if (m_pSSRCInfo->getNumberOfInsertTimes() == MIPRTPDECODER_HISTLEN) // need several packets for a good estimate
+		if (audio)
 		{
-			if (offset < MINOFFSET) // need more buffering
-			{
-				MIPTime curTime = MIPTime::getCurrentTime();
-		
-				if ((curTime.getValue() - m_pSSRCInfo->getLastOffsetAdjustTime().getValue()) > 0.200)
-				{
-					// we'll use 5 msec boundary
-			
-					real_t diff = MINOFFSET - offset;
-					int64_t diffi = ((int64_t)((diff*200.0)+0.5));
-		
-					if (diffi > 0)
-					{
-						diff = ((real_t)diffi)/200.0;
-		
-						MIPTime newOffset = m_pSSRCInfo->getPlaybackOffset();
-						newOffset += MIPTime(diff);
-		
-		//	std::cerr << "Insert average:  " << m_pSSRCInfo->getInsertTimeAverage().getString() << std::endl;
-		//	std::cerr << "Insert variance: " << m_pSSRCInfo->getInsertTimeVariance().getString() << std::endl;
-		//	std::cerr << "Jitter:          " << jitterValue.getString() << std::endl;
-			
-						m_pSSRCInfo->setPlaybackOffset(newOffset);
-		//				std::cerr << "Increasing playback offset by " << MIPTime(diff).getString() << std::endl;
-		//				std::cerr << "New offset is " << newOffset.getString() << std::endl;
-					}
-				}
-			}
-			else // perhaps we kan decrease the buffering somewhat, but we'll only make gradual adjustments every 5 seconds
+			// A talk spurt starts at a packet with the marker bit set, or when the
+			// timestamp jumps while the sequence numbers are consecutive
+			if (sequenceNumber == m_prevSequenceNumber + 1)
 			{
-				MIPTime curTime = MIPTime::getCurrentTime();
-				real_t delay;
-				real_t ins = insertDiff;
-		
-				if (ins < 0)
-					ins = 0;
-		
-				delay = 500.0/(1.0+100.0*ins);
-				if (delay < 5.0)
-					delay = 5.0;
-				else if (delay > 60.0)
-					delay = 60.0;
-		
-				if ((curTime.getValue() - m_pSSRCInfo->getLastOffsetAdjustTime().getValue()) > delay)
-				{
-	//				std::cout << "Delay: " << MIPTime(delay).getString() << std::endl;
-					
-					// we'll use 5 msec boundary
-			
-					real_t diff = offset - MINOFFSET;
-					
-					if (diff > 0.005)
-					{
-						real_t diff2 = ((real_t)((int64_t)((diff*200.0)+0.5)))/200.0;
-			
-						if (diff2 > diff)
-							diff2 -= 0.005;
-						
-						MIPTime newOffset = m_pSSRCInfo->getPlaybackOffset();
-						newOffset -= MIPTime(diff2);
-		
-		//	std::cerr << "Insert average:  " << m_pSSRCInfo->getInsertTimeAverage().getString() << std::endl;
-		//	std::cerr << "Insert variance: " << m_pSSRCInfo->getInsertTimeVariance().getString() << std::endl;
-		//	std::cerr << "Jitter:          " << jitterValue.getString() << std::endl;
-			
-						m_pSSRCInfo->setPlaybackOffset(newOffset);
-		//				std::cerr << "Decreasing playback offset by " << MIPTime(diff2).getString() << std::endl;
-		//				std::cerr << "New offset is " << newOffset.getString() << std::endl;
-					}
-					else
-					{
-						// reinstall old offset so the adjustment time is initialized again
-						MIPTime oldOffset = m_pSSRCInfo->getPlaybackOffset();
-						m_pSSRCInfo->setPlaybackOffset(oldOffset);
-					}
-				}
+				if (duration > 0 && diff > 2*duration)
+					boundary = true;
+				else if (diff > 0)
+					m_packetDuration = MIPTime::fromNanoSeconds(diff);
 			}
+			if (marker)
+				boundary = true;
+			if (boundary && duration > 0 && diff > duration)
+				m_silenceLength = MIPTime::fromNanoSeconds(diff - duration);
+		}
+		else
+		{
+			if (diff > 0) // a new video frame
+				boundary = true;
 		}
 	}
-	else
+
+	m_gotPrevPacket = true;
+	m_prevSequenceNumber = sequenceNumber;
+	m_prevStreamTime = streamTime;
+	return boundary;
+}
+
+int MIPRTPDecoder::SSRCInfo::checkSequenceNumber(uint32_t sequenceNumber, uint32_t timestamp, uint32_t &timestampsPerPacket)
+{
+	int numLost = 0;
+
+	if (m_gotPrevSeqNr)
 	{
-		streamTime += m_fixedJitterBuffer;
+		int32_t seqDiff = (int32_t)(sequenceNumber - m_prevSeqNr);
+
+		if (seqDiff <= 0) // duplicate or out of order packet
+		{
+			int32_t concealPos = (int32_t)(sequenceNumber - m_firstConcealedSeqNr);
+
+			if (m_numConcealed > 0 && concealPos >= 0 && concealPos < m_numConcealed)
+				return -1;
+			timestampsPerPacket = m_timestampsPerPacket;
+			return 0;
+		}
+
+		uint32_t tsDiff = timestamp - m_prevSeqNrTimestamp;
+
+		if (seqDiff == 1)
+		{
+			// Larger jumps are caused by silence suppression
+			if (tsDiff != 0 && (m_timestampsPerPacket == 0 || tsDiff <= 2*m_timestampsPerPacket))
+				m_timestampsPerPacket = tsDiff;
+		}
+		else if (m_timestampsPerPacket != 0 && tsDiff == ((uint32_t)seqDiff)*m_timestampsPerPacket)
+			numLost = seqDiff - 1;
 	}
-	
-	MIPTime x = streamTime;
-	x -= m_playbackOffset;
-	insertOffset = x;
 
-	return true;
+	m_gotPrevSeqNr = true;
+	m_prevSeqNr = sequenceNumber;
+	m_prevSeqNrTimestamp = timestamp;
+	timestampsPerPacket = m_timestampsPerPacket;
+	return numLost;
 }
 
 uint64_t MIPRTPDecoder::SSRCInfo::getExtendedTimestamp(uint32_t ts)
@@ -629,3 +843,16 @@ uint64_t MIPRTPDecoder::SSRCInfo::getExtendedTimestamp(uint32_t ts)
 	return m_baseTimestamp;
 }
 
+MIPTime MIPRTPDecoder::SSRCInfo::getSyncOffset(MIPTime mediaTime)
+{
+	// Only the time that elapsed in the stream itself is used, so that the offset 
+	// doesn't change faster than the maximum slew rate during playback. Going back
+	// in time (reordered packets, a reset of the stream) doesn't change the offset.
+
+	real_t elapsed = mediaTime.getValue() - m_syncMediaTime.getValue();
+
+	m_syncMediaTime = mediaTime;
+	if (m_gotSyncOffset && elapsed > 0)
+		m_syncOffset = MIPRTPSynchronizer::slewOffset(m_syncOffset, m_syncTargetOffset, m_maxSlewRate, elapsed);
+	return m_syncOffset;
+}
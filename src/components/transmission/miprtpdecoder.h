@@ -35,7 +35,8 @@
 #include "miptime.h"
 #include <unordered_map>
 #include <cmath>
-#include <list>
+#include <deque>
+#include <vector>
 
 namespace jrtplib
 {
@@ -48,6 +49,7 @@ class MIPMediaMessage;
 class MIPRTPPacketDecoder;
 
 #define MIPRTPDECODER_MAXPAYLOADDECODERS							256
+#define MIPRTPDECODER_HISTBINS									200
 
 /** A base class for RTP decoding objects.
  *  This class provides some general functions for decoding RTP packets. It analyzes
@@ -96,6 +98,37 @@ public:
 	 */
 	void setMaximumJitterBuffering(MIPTime t)								{ m_maxJitterBuffer = t; }
 
+	/** Sets the fraction of packets that may arrive too late to be played back.
+	 *  For each SSRC, a histogram of packet arrival delays is kept, and the amount of
+	 *  jitter buffering is chosen so that approximately this fraction of the packets
+	 *  arrives too late. The default is 0.02, lower values lead to larger delays.
+	 */
+	bool setTargetLateLossRate(real_t rate);
+
+	/** Retrieves information about the jitter buffer of a specific SSRC.
+	 *  Retrieves information about the jitter buffer of a specific SSRC. If the
+	 *  component chain is running, the component must be locked when calling
+	 *  this function.
+	 *  \param ssrc The SSRC of the source.
+	 *  \param currentDelay Receives the amount of buffering that's currently being used,
+	 *                      relative to the packet which arrived fastest recently.
+	 *  \param targetDelay Receives the amount of buffering the decoder will move to at
+	 *                     the next suitable moment (e.g. the start of a talk spurt).
+	 *  \param lateLossRate Receives an estimate of the fraction of packets which
+	 *                      currently arrive too late.
+	 *  \return \c false if no information about this SSRC is available.
+	 */
+	bool getJitterBufferInfo(uint32_t ssrc, MIPTime &currentDelay, MIPTime &targetDelay, real_t &lateLossRate) const;
+
+	/** Sets the maximum number of consecutive lost packets that will be concealed.
+	 *  When a gap in the sequence numbers of a source is detected, the RTP packet decoder
+	 *  can create messages which let the codec component synthesize the missing audio (see
+	 *  MIPRTPPacketDecoder::createConcealmentMessages). Larger gaps are left silent. Packets
+	 *  which arrive after they have been concealed are discarded. Setting this to zero disables
+	 *  the concealment, the default is five packets.
+	 */
+	void setMaximumConcealedPackets(int num)								{ m_maxConcealedPackets = num; }
+
 	bool push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg);
 	bool pull(const MIPComponentChain &chain, int64_t iteration, MIPMessage **pMsg);
 	bool processFeedback(const MIPComponentChain &chain, int64_t feedbackChainID, MIPFeedback *feedback);
@@ -105,15 +138,19 @@ protected:
 	virtual void onNewMediaMessage(uint32_t ssrc, uint32_t rtpTimestamp, MIPMediaMessage *pMsg)		{ }
 private:
 	void clearMessages();
+	void deleteNewMessages(size_t startPos);
 	void cleanUp();
 	void cleanUpSourceTable();
 	bool lookUpStreamTime(uint32_t ssrc, uint32_t timestamp, const uint8_t *pCName, size_t cnameLength, real_t timestampUnit, MIPTime &streamTime, bool &shouldSync);
-	bool adjustToPlaybackTime(MIPTime jitterValue, MIPTime &streamTime, MIPTime &insertOffset);
+	bool updatePlayoutDelay(MIPTime jitterValue, MIPTime streamTime, bool audio, bool marker, uint32_t sequenceNumber, bool &dropPacket);
+	void adjustToPlaybackTime(MIPTime &streamTime, MIPTime &insertOffset);
 
 	bool m_init;	
 	int64_t m_prevIteration;
-	std::list<MIPMediaMessage *> m_messages;
-	std::list<MIPMediaMessage *>::const_iterator m_msgIt;
+	std::vector<MIPMediaMessage *> m_messages;
+	size_t m_msgPos;
+	std::vector<MIPMediaMessage *> m_newMessages, m_concealMessages;
+	std::vector<uint32_t> m_newTimestamps, m_concealTimestamps;
 
 	bool m_gotPlaybackFeedback;
 	MIPTime m_playbackOffset;
@@ -121,73 +158,62 @@ private:
 	class SSRCInfo
 	{
 	public:
-		SSRCInfo(uint32_t baseTimestamp = 0) : m_lastAccessTime(0), m_playbackOffset(0), m_avgInsertTime(0),
-							m_insertTimeSpread(0), m_lastOffsetAdjustTime(0), m_lastSyncTime(0), m_syncOffset(0)
-									{ reset(baseTimestamp); m_syncStreamID = -1; }
+		SSRCInfo(uint32_t baseTimestamp = 0) : m_lastAccessTime(0), m_playbackOffset(0), m_targetOffset(0), m_lastOffsetAdjustTime(0), 
+		                                       m_prevStreamTime(0), m_packetDuration(0), m_silenceLength(0), m_lastSyncTime(0), m_syncOffset(0),
+		                                       m_syncTargetOffset(0), m_syncMediaTime(0)
+									{ m_histogram.resize(MIPRTPDECODER_HISTBINS, 0); m_lateLossRate = 0; reset(baseTimestamp); m_syncStreamID = -1; m_gotSyncOffset = false; m_maxSlewRate = 0; }
 		void setSyncStreamID(int64_t id)			{ m_syncStreamID = id; }
 		int64_t getSyncStreamID() const				{ return m_syncStreamID; }
 		MIPTime getLastSyncTime() const				{ return m_lastSyncTime; }
 		void setLastSyncTime(MIPTime t)				{ m_lastSyncTime = t; }
-		MIPTime getSyncOffset() const				{ return m_syncOffset; }
-		void setSyncOffset(MIPTime t)				{ m_syncOffset = t; }
+
+		// The synchronizer only provides the offset to move towards; the offset that's
+		// applied is slewed on every message, based on the elapsed media time
+		void setSyncTargetOffset(MIPTime t, real_t maxSlewRate)	{ if (!m_gotSyncOffset) m_syncOffset = t; m_syncTargetOffset = t; m_maxSlewRate = maxSlewRate; m_gotSyncOffset = true; }
+		MIPTime getSyncOffset(MIPTime mediaTime);
 
 		MIPTime getLastAccessTime() const			{ return m_lastAccessTime; }
 		uint64_t getBaseTimestamp() const			{ return m_baseTimestamp; }
 		uint64_t getExtendedTimestamp(uint32_t ts);
 		void setLastAccessTime(MIPTime t)			{ m_lastAccessTime = t; }
 		
+		bool hasPlaybackOffset() const				{ return m_gotPlaybackOffset; }
 		MIPTime getPlaybackOffset() const			{ return m_playbackOffset; }
-		MIPTime getInsertTimeAverage() const			{ return m_avgInsertTime; }
-		MIPTime getInsertTimeVariance() const			{ return m_insertTimeSpread; }
 		MIPTime getLastOffsetAdjustTime() const			{ return m_lastOffsetAdjustTime; }
-		bool hasLastOffsetAdjustTime() const			{ return m_gotPlaybackOffset; }
-		int64_t getNumberOfRecentPacket() const			{ return m_recentPacksReceived; }
-		
-		int getNumberOfInsertTimes() const			{ return m_numInsertTimes; }
-			
-		void setPlaybackOffset(MIPTime offset)			{ clearAdjustmentInfo(); m_playbackOffset = offset; m_gotPlaybackOffset = true; m_lastOffsetAdjustTime = MIPTime::getCurrentTime(); }
-		void addInsertTime(MIPTime t)
-		{
-#define MIPRTPDECODER_HISTLEN 16
-			m_insertTimes[m_curInsertTimePos] = t;
-			m_curInsertTimePos++;
-			if (m_curInsertTimePos == MIPRTPDECODER_HISTLEN)
-				m_curInsertTimePos = 0;
-			if (m_numInsertTimes < MIPRTPDECODER_HISTLEN)
-				m_numInsertTimes++;
-
-			real_t avg = 0;
-			real_t sigma2 = 0;
-			for (int i = 0 ; i < m_numInsertTimes ; i++)
-				avg += m_insertTimes[i].getValue();
-			avg /= (real_t)m_numInsertTimes;
-
-			for (int i = 0 ; i < m_numInsertTimes ; i++)
-			{
-				real_t diff = m_insertTimes[i].getValue() - avg;
-				real_t diff2 = diff*diff;
-				sigma2 += diff2;
-			}
-			sigma2 /= (real_t)m_numInsertTimes;
-			real_t sigma = (real_t)sqrt(sigma2);
-
-			m_avgInsertTime = MIPTime(avg);
-			m_insertTimeSpread = MIPTime(sigma);
-		}
-
+		void setPlaybackOffset(MIPTime offset, MIPTime now)	{ if (!m_gotPlaybackOffset) m_targetOffset = offset; m_playbackOffset = offset; m_gotPlaybackOffset = true; m_lastOffsetAdjustTime = now; }
+
+		// Arrival statistics: 'arrivalDelay' is the playback time at which a packet
+		// arrived minus its position in the stream
+		void addArrivalDelay(MIPTime now, MIPTime arrivalDelay);
+		bool calculateTargetOffset(real_t lateLossRate, MIPTime maxBuffering);
+		MIPTime getTargetOffset() const				{ return m_targetOffset; }
+		MIPTime getMinimumArrivalDelay() const			{ return (m_minDelays.empty())?MIPTime(0):m_minDelays.front().second; }
+		real_t getLateLossRate() const				{ return m_lateLossRate; }
+
+		// Returns true if the packet starts a new talk spurt (or a new video frame)
+		bool checkBoundary(MIPTime streamTime, bool audio, bool marker, uint32_t sequenceNumber);
+		MIPTime getPacketDuration() const			{ return m_packetDuration; }
+		MIPTime getSilenceLength() const			{ return m_silenceLength; }
+
+		// Returns the number of packets that are missing before this one, or -1 if
+		// this packet was already concealed
+		int checkSequenceNumber(uint32_t sequenceNumber, uint32_t timestamp, uint32_t &timestampsPerPacket);
+		void setConcealedPackets(uint32_t firstSequenceNumber, int num)	{ m_firstConcealedSeqNr = firstSequenceNumber; m_numConcealed = num; }
+	private:
 		void clearAdjustmentInfo()
 		{
 			m_playbackOffset = MIPTime(0);
-			m_avgInsertTime = MIPTime(0);
-			m_insertTimeSpread = MIPTime(0);
+			m_targetOffset = MIPTime(0);
 			m_lastOffsetAdjustTime = MIPTime(0);
 			m_gotPlaybackOffset = false;
-			m_recentPacksReceived = 0;
-			m_numInsertTimes = 0;
-			m_curInsertTimePos = 0;
+			m_minDelays.clear();
+			m_numArrivals = 0;
+			m_gotPrevPacket = false;
+			m_gotPrevSeqNr = false;
+			m_timestampsPerPacket = 0;
+			m_numConcealed = 0;
 		}
-		
-	private:
+
 		void reset(uint32_t baseTimestamp)			
 		{ 
 			m_baseTimestamp = (uint64_t)baseTimestamp; 
@@ -202,20 +228,35 @@ private:
 		uint32_t m_prevTimestamp;
 		MIPTime m_lastAccessTime;
 		MIPTime m_playbackOffset;
-		
-		MIPTime m_avgInsertTime;
-		MIPTime m_insertTimeSpread;
-		MIPTime m_insertTimes[MIPRTPDECODER_HISTLEN];
-		int m_numInsertTimes;
-		int m_curInsertTimePos;
-		
+		MIPTime m_targetOffset;
 		MIPTime m_lastOffsetAdjustTime;
 		bool m_gotPlaybackOffset;
-		int64_t m_recentPacksReceived;
+
+		std::vector<real_t> m_histogram;
+		std::deque<std::pair<MIPTime, MIPTime> > m_minDelays;
+		int64_t m_numArrivals;
+		real_t m_lateLossRate;
+
+		bool m_gotPrevPacket;
+		uint32_t m_prevSequenceNumber;
+		MIPTime m_prevStreamTime;
+		MIPTime m_packetDuration;
+		MIPTime m_silenceLength;
+
+		bool m_gotPrevSeqNr;
+		uint32_t m_prevSeqNr;
+		uint32_t m_prevSeqNrTimestamp;
+		uint32_t m_timestampsPerPacket;
+		uint32_t m_firstConcealedSeqNr;
+		int m_numConcealed;
 
 		int64_t m_syncStreamID;
 		MIPTime m_lastSyncTime;
 		MIPTime m_syncOffset;
+		MIPTime m_syncTargetOffset;
+		MIPTime m_syncMediaTime;
+		real_t m_maxSlewRate;
+		bool m_gotSyncOffset;
 	};
 
 	std::unordered_map<uint32_t, SSRCInfo> m_sourceTable;
@@ -232,6 +273,8 @@ private:
 
 	bool m_useFixedJitterBuffer;
 	MIPTime m_fixedJitterBuffer;
+	real_t m_lateLossRate;
+	int m_maxConcealedPackets;
 };
 
 #endif // MIPRTPDECODER_H
@@ -47,8 +47,8 @@ public:
 	~MIPRTPDummyDecoder()											{ }
 private:
 	bool validatePacket(const jrtplib::RTPPacket *pRTPPack, real_t &timestampUnit, real_t timestampUnitEstimate)					{ return false; }
-	void createNewMessages(const jrtplib::RTPPacket *pRTPPack, std::list<MIPMediaMessage *> &messages, 
-	                       std::list<uint32_t> &timestamps)							{ }
+	void createNewMessages(MIPRTPReceiveMessage *pRTPMsg, std::vector<MIPMediaMessage *> &messages, 
+	                       std::vector<uint32_t> &timestamps)							{ }
 };
 
 #endif // MIPRTPDUMMYDECODER_H
@@ -0,0 +1,652 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+#include "mipconfig.h"
+#include "miprtpforwarder.h"
+#include "miprtpmessage.h"
+#include "mipg711.h"
+#include <jrtplib3/rtpsession.h>
+#include <jrtplib3/rtppacket.h>
+#include <jrtplib3/rtperrors.h>
+#include <algorithm>
+#include <iostream>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mipdebug.h"
+
+using namespace jrtplib;
+using namespace jthread;
+
+#define MIPRTPFORWARDER_ERRSTR_NOTINIT			"Not initialized"
+#define MIPRTPFORWARDER_ERRSTR_ALREADYINIT		"Already initialized"
+#define MIPRTPFORWARDER_ERRSTR_BADPARAMETERS		"The number of speakers and the clock rate must be positive"
+#define MIPRTPFORWARDER_ERRSTR_BADMESSAGE		"Only received RTP packets are accepted"
+#define MIPRTPFORWARDER_ERRSTR_BADSESSIONS		"Exactly one non-null RTP session is needed for each speaker slot"
+#define MIPRTPFORWARDER_ERRSTR_RECEIVEREXISTS		"A receiver with this ID already exists"
+#define MIPRTPFORWARDER_ERRSTR_RECEIVERNOTFOUND		"No receiver with this ID exists"
+#define MIPRTPFORWARDER_ERRSTR_PULLUNSUPPORTED		"Pull is not supported"
+#define MIPRTPFORWARDER_ERRSTR_RTPERROR			"Detected JRTPLIB error: "
+
+// Time constant of the smoothing of the audio level of a source, in seconds
+#define MIPRTPFORWARDER_SMOOTHINGTIME			0.3
+// A source which hasn't sent packets for this long can't be selected
+#define MIPRTPFORWARDER_ACTIVITYTIMEOUT			1.0
+// The information about a source is removed when it hasn't sent packets for this long
+#define MIPRTPFORWARDER_SOURCETIMEOUT			60.0
+// The level used for silence, as in RFC 6464
+#define MIPRTPFORWARDER_MINLEVEL			-127.0
+// Packets which arrive this many sequence numbers late are assumed to be lost
+#define MIPRTPFORWARDER_MAXREORDER			1000
+
+MIPRTPForwarder::MIPRTPForwarder() : MIPComponent("MIPRTPForwarder"), m_now(0)
+{
+	int status;
+
+	if ((status = m_lock.Init()) < 0)
+	{
+		std::cerr << "Error: can't initialize RTP forwarder mutex (JMutex error code " << status << ")" << std::endl;
+		exit(-1);
+	}
+
+	m_init = false;
+	m_numSpeakers = 0;
+	m_clockRate = 0;
+	m_levelExtensionID = 1;
+	m_switchMargin = 3.0;
+	m_prevIteration = -1;
+}
+
+MIPRTPForwarder::~MIPRTPForwarder()
+{
+	destroy();
+}
+
+bool MIPRTPForwarder::init(int numSpeakers, int clockRate)
+{
+	if (m_init)
+	{
+		setErrorString(MIPRTPFORWARDER_ERRSTR_ALREADYINIT);
+		return false;
+	}
+
+	if (numSpeakers < 1 || clockRate < 1)
+	{
+		setErrorString(MIPRTPFORWARDER_ERRSTR_BADPARAMETERS);
+		return false;
+	}
+
+	m_numSpeakers = numSpeakers;
+	m_clockRate = clockRate;
+	m_prevIteration = -1;
+	m_init = true;
+
+	return true;
+}
+
+bool MIPRTPForwarder::destroy()
+{
+	if (!m_init)
+	{
+		setErrorString(MIPRTPFORWARDER_ERRSTR_NOTINIT);
+		return false;
+	}
+
+	m_lock.Lock();
+	m_sources.clear();
+	m_receivers.clear();
+	m_selected.clear();
+	m_init = false;
+	m_lock.Unlock();
+
+	return true;
+}
+
+bool MIPRTPForwarder::addReceiver(uint64_t receiverID, const std::vector<RTPSession *> &sessions)
+{
+	if (!m_init)
+	{
+		setErrorString(MIPRTPFORWARDER_ERRSTR_NOTINIT);
+		return false;
+	}
+
+	if ((int)sessions.size() != m_numSpeakers || std::find(sessions.begin(), sessions.end(), (RTPSession *)0) != sessions.end())
+	{
+		setErrorString(MIPRTPFORWARDER_ERRSTR_BADSESSIONS);
+		return false;
+	}
+
+	m_lock.Lock();
+
+	if (m_receivers.find(receiverID) != m_receivers.end())
+	{
+		m_lock.Unlock();
+		setErrorString(MIPRTPFORWARDER_ERRSTR_RECEIVEREXISTS);
+		return false;
+	}
+
+	std::vector<Slot> &slots = m_receivers[receiverID];
+
+	for (size_t i = 0 ; i < sessions.size() ; i++)
+		slots.push_back(Slot(sessions[i]));
+
+	// The slots will be filled when the selection is updated in the next iteration
+	m_lock.Unlock();
+
+	return true;
+}
+
+bool MIPRTPForwarder::deleteReceiver(uint64_t receiverID)
+{
+	if (!m_init)
+	{
+		setErrorString(MIPRTPFORWARDER_ERRSTR_NOTINIT);
+		return false;
+	}
+
+	m_lock.Lock();
+	if (m_receivers.erase(receiverID) == 0)
+	{
+		m_lock.Unlock();
+		setErrorString(MIPRTPFORWARDER_ERRSTR_RECEIVERNOTFOUND);
+		return false;
+	}
+	m_lock.Unlock();
+
+	return true;
+}
+
+bool MIPRTPForwarder::getActiveSpeakers(std::vector<uint64_t> &speakers)
+{
+	if (!m_init)
+	{
+		setErrorString(MIPRTPFORWARDER_ERRSTR_NOTINIT);
+		return false;
+	}
+
+	m_lock.Lock();
+	// One speaker more than the number of slots is selected, so that a receiver
+	// which is among the loudest speakers still gets all slots filled
+	speakers.assign(m_selected.begin(), m_selected.begin() + std::min(m_selected.size(), (size_t)m_numSpeakers));
+	m_lock.Unlock();
+
+	return true;
+}
+
+bool MIPRTPForwarder::push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg)
+{
+	if (!m_init)
+	{
+		setErrorString(MIPRTPFORWARDER_ERRSTR_NOTINIT);
+		return false;
+	}
+
+	if (!(pMsg->getMessageType() == MIPMESSAGE_TYPE_RTP && pMsg->getMessageSubtype() == MIPRTPMESSAGE_TYPE_RECEIVE))
+	{
+		setErrorString(MIPRTPFORWARDER_ERRSTR_BADMESSAGE);
+		return false;
+	}
+
+	MIPRTPReceiveMessage *pRTPMsg = (MIPRTPReceiveMessage *)pMsg;
+	uint64_t sourceID = pRTPMsg->getSourceID();
+
+	m_lock.Lock();
+
+	// The selection is only updated once per iteration, using the levels of the
+	// packets that were received up to now
+	if (iteration != m_prevIteration)
+	{
+		m_prevIteration = iteration;
+		m_now = MIPTime::getCurrentTime();
+		updateSelection();
+	}
+
+	std::map<uint64_t, SourceInfo>::iterator srcIt = m_sources.find(sourceID);
+
+	if (srcIt == m_sources.end())
+		srcIt = m_sources.insert(std::pair<uint64_t, SourceInfo>(sourceID, SourceInfo(m_now))).first;
+
+	updateLevel(srcIt->second, pRTPMsg);
+
+	// Packets of sources which aren't selected only contribute to the ranking
+	if (std::find(m_selected.begin(), m_selected.end(), sourceID) == m_selected.end())
+	{
+		m_lock.Unlock();
+		return true;
+	}
+
+	std::map<uint64_t, std::vector<Slot> >::iterator it;
+
+	for (it = m_receivers.begin() ; it != m_receivers.end() ; it++)
+	{
+		if (it->first == sourceID)
+			continue;
+
+		std::vector<Slot> &slots = it->second;
+
+		for (size_t i = 0 ; i < slots.size() ; i++)
+		{
+			if (slots[i].m_active && slots[i].m_sourceID == sourceID)
+			{
+				if (!forward(slots[i], pRTPMsg))
+				{
+					m_lock.Unlock();
+					return false; // error string was set
+				}
+				break;
+			}
+		}
+	}
+
+	m_lock.Unlock();
+
+	return true;
+}
+
+bool MIPRTPForwarder::pull(const MIPComponentChain &chain, int64_t iteration, MIPMessage **pMsg)
+{
+	setErrorString(MIPRTPFORWARDER_ERRSTR_PULLUNSUPPORTED);
+	return false;
+}
+
+void MIPRTPForwarder::updateSelection()
+{
+	std::vector<std::pair<real_t, uint64_t> > candidates;
+	std::map<uint64_t, SourceInfo>::iterator srcIt = m_sources.begin();
+
+	while (srcIt != m_sources.end())
+	{
+		real_t idleTime = m_now.getValue() - srcIt->second.m_lastTime.getValue();
+
+		if (idleTime > MIPRTPFORWARDER_SOURCETIMEOUT)
+		{
+			m_sources.erase(srcIt++);
+			continue;
+		}
+
+		if (idleTime <= MIPRTPFORWARDER_ACTIVITYTIMEOUT)
+		{
+			real_t score = srcIt->second.m_level;
+
+			// Selected speakers get a bonus, to avoid switching back and forth
+			// between speakers with a similar level
+			if (std::find(m_selected.begin(), m_selected.end(), srcIt->first) != m_selected.end())
+				score += m_switchMargin;
+
+			// Negated, so that sorting puts the loudest first and equal scores in
+			// order of their ID
+			candidates.push_back(std::pair<real_t, uint64_t>(-score, srcIt->first));
+		}
+		srcIt++;
+	}
+
+	size_t num = std::min(candidates.size(), (size_t)m_numSpeakers + 1);
+
+	std::partial_sort(candidates.begin(), candidates.begin() + num, candidates.end());
+
+	m_selected.resize(num);
+	for (size_t i = 0 ; i < num ; i++)
+		m_selected[i] = candidates[i].second;
+
+	// A slot keeps its speaker as long as that speaker remains selected for the
+	// receiver. Newly selected speakers take the slots that became free.
+
+	std::vector<uint64_t> wanted;
+	std::vector<bool> placed;
+	std::map<uint64_t, std::vector<Slot> >::iterator it;
+
+	for (it = m_receivers.begin() ; it != m_receivers.end() ; it++)
+	{
+		std::vector<Slot> &slots = it->second;
+
+		wanted.clear();
+		for (size_t i = 0 ; i < m_selected.size() && (int)wanted.size() < m_numSpeakers ; i++)
+		{
+			if (m_selected[i] != it->first)
+				wanted.push_back(m_selected[i]);
+		}
+		placed.assign(wanted.size(), false);
+
+		for (size_t i = 0 ; i < slots.size() ; i++)
+		{
+			if (!slots[i].m_active)
+				continue;
+
+			std::vector<uint64_t>::iterator wantedIt = std::find(wanted.begin(), wanted.end(), slots[i].m_sourceID);
+
+			if (wantedIt == wanted.end())
+				slots[i].m_active = false;
+			else
+				placed[wantedIt - wanted.begin()] = true;
+		}
+
+		size_t slotPos = 0;
+
+		for (size_t i = 0 ; i < wanted.size() ; i++)
+		{
+			if (placed[i])
+				continue;
+
+			while (slots[slotPos].m_active)
+				slotPos++;
+
+			slots[slotPos].m_sourceID = wanted[i];
+			slots[slotPos].m_active = true;
+			slots[slotPos].m_switched = true;
+		}
+	}
+}
+
+void MIPRTPForwarder::updateLevel(SourceInfo &source, MIPRTPReceiveMessage *pRTPMsg)
+{
+	const RTPPacket *pPack = pRTPMsg->getPacket();
+	uint32_t timestamp = pPack->GetTimestamp();
+	real_t duration = 0;
+
+	source.m_lastTime = m_now;
+
+	// The duration of a packet is derived from the timestamps rather than from the
+	// arrival times, which depend on the network jitter
+	if (source.m_gotTimestamp)
+	{
+		int32_t diff = (int32_t)(timestamp - source.m_lastTimestamp);
+
+		if (diff < 0) // an old packet, doesn't say anything about the current level
+			return;
+
+		duration = (real_t)diff/getClockRate(pRTPMsg);
+	}
+	source.m_lastTimestamp = timestamp;
+	source.m_gotTimestamp = true;
+
+	real_t level;
+
+	if (!getAudioLevel(pPack, level))
+		return;
+
+	if (level < MIPRTPFORWARDER_MINLEVEL)
+		level = MIPRTPFORWARDER_MINLEVEL;
+	else if (level > 0)
+		level = 0;
+
+	if (!source.m_gotLevel)
+	{
+		source.m_level = level;
+		source.m_gotLevel = true;
+	}
+	else
+	{
+		real_t factor = (real_t)(1.0 - exp(-duration/MIPRTPFORWARDER_SMOOTHINGTIME));
+
+		source.m_level += factor*(level - source.m_level);
+	}
+}
+
+bool MIPRTPForwarder::forward(Slot &slot, MIPRTPReceiveMessage *pRTPMsg)
+{
+	const RTPPacket *pPack = pRTPMsg->getPacket();
+	uint32_t timestamp = pPack->GetTimestamp();
+	uint16_t seqNr = pPack->GetSequenceNumber();
+	bool marker = pPack->HasMarker();
+
+	if (slot.m_sent && !slot.m_switched)
+	{
+		// Packets from before the moment this speaker got the slot would get the 
+		// sequence numbers of the previous speaker
+		if ((int16_t)(seqNr - slot.m_firstSeqNr) < 0)
+			return true;
+	}
+	else
+	{
+		// A new speaker in this slot: continue the timeline of the slot according
+		// to the time that has passed, and mark the start of the talk spurt. From
+		// now on, the sequence numbers and timestamps of the speaker are shifted
+		// by a fixed amount, so that lost and reordered packets can still be 
+		// detected by the receiver.
+		uint16_t newSeqNr = seqNr; // the first speaker of a slot keeps its own numbering
+		uint32_t newTimestamp = timestamp;
+
+		if (slot.m_sent)
+		{
+			real_t elapsed = m_now.getValue() - slot.m_lastSendTime.getValue();
+			uint32_t tsInc = (uint32_t)(elapsed*getClockRate(pRTPMsg) + 0.5);
+
+			if (tsInc == 0)
+				tsInc = 1;
+
+			newSeqNr = slot.m_lastSeqNr + 1;
+			newTimestamp = slot.m_lastTimestamp + tsInc;
+		}
+
+		slot.m_seqNrOffset = newSeqNr - seqNr;
+		slot.m_timestampOffset = newTimestamp - timestamp;
+		slot.m_firstSeqNr = seqNr;
+		slot.m_lastSeqNr = newSeqNr - 1;
+		slot.m_lastTimestamp = newTimestamp;
+		slot.m_switched = false;
+		slot.m_sent = true;
+		marker = true;
+	}
+
+	uint16_t outSeqNr = seqNr + slot.m_seqNrOffset;
+	uint32_t outTimestamp = timestamp + slot.m_timestampOffset;
+	int numCSRCs = pPack->GetCSRCCount();
+	size_t extLength = (pPack->HasExtension())?pPack->GetExtensionLength():0;
+	size_t headerLength = 12 + 4*(size_t)numCSRCs + ((pPack->HasExtension())?(4 + extLength):0);
+	size_t length = headerLength + pPack->GetPayloadLength();
+
+	if (m_packet.size() < length)
+		m_packet.resize(length);
+
+	uint8_t *pBuf = &m_packet[0];
+	uint32_t ssrc = slot.m_pSession->GetLocalSSRC();
+
+	pBuf[0] = (uint8_t)(0x80 | ((pPack->HasExtension())?0x10:0) | numCSRCs);
+	pBuf[1] = (uint8_t)(((marker)?0x80:0) | (pPack->GetPayloadType() & 0x7f));
+	pBuf[2] = (uint8_t)(outSeqNr >> 8);
+	pBuf[3] = (uint8_t)(outSeqNr & 0xff);
+	pBuf[4] = (uint8_t)(outTimestamp >> 24);
+	pBuf[5] = (uint8_t)((outTimestamp >> 16) & 0xff);
+	pBuf[6] = (uint8_t)((outTimestamp >> 8) & 0xff);
+	pBuf[7] = (uint8_t)(outTimestamp & 0xff);
+	pBuf[8] = (uint8_t)(ssrc >> 24);
+	pBuf[9] = (uint8_t)((ssrc >> 16) & 0xff);
+	pBuf[10] = (uint8_t)((ssrc >> 8) & 0xff);
+	pBuf[11] = (uint8_t)(ssrc & 0xff);
+
+	size_t pos = 12;
+
+	for (int i = 0 ; i < numCSRCs ; i++, pos += 4)
+	{
+		uint32_t csrc = pPack->GetCSRC(i);
+
+		pBuf[pos] = (uint8_t)(csrc >> 24);
+		pBuf[pos+1] = (uint8_t)((csrc >> 16) & 0xff);
+		pBuf[pos+2] = (uint8_t)((csrc >> 8) & 0xff);
+		pBuf[pos+3] = (uint8_t)(csrc & 0xff);
+	}
+
+	if (pPack->HasExtension())
+	{
+		uint16_t extID = pPack->GetExtensionID();
+		uint16_t extWords = (uint16_t)(extLength/4);
+
+		pBuf[pos] = (uint8_t)(extID >> 8);
+		pBuf[pos+1] = (uint8_t)(extID & 0xff);
+		pBuf[pos+2] = (uint8_t)(extWords >> 8);
+		pBuf[pos+3] = (uint8_t)(extWords & 0xff);
+		if (extLength > 0)
+			memcpy(pBuf + pos + 4, pPack->GetExtensionData(), extLength);
+		pos += 4 + extLength;
+	}
+
+	if (pPack->GetPayloadLength() > 0)
+		memcpy(pBuf + pos, pPack->GetPayloadData(), pPack->GetPayloadLength());
+
+	int status;
+
+	if ((status = slot.m_pSession->SendRawData(pBuf, length, true)) < 0)
+	{
+		setErrorString(std::string(MIPRTPFORWARDER_ERRSTR_RTPERROR) + RTPGetErrorString(status));
+		return false;
+	}
+
+	// Only packets which extend the stream move the point from which the next
+	// speaker in this slot continues
+	if ((int16_t)(outSeqNr - slot.m_lastSeqNr) > 0)
+	{
+		slot.m_lastSeqNr = outSeqNr;
+		slot.m_lastSendTime = m_now;
+
+		// Keep the first sequence number within reach of the comparison above, once
+		// packets from before the switch can no longer arrive
+		if ((uint16_t)(seqNr - slot.m_firstSeqNr) > MIPRTPFORWARDER_MAXREORDER)
+			slot.m_firstSeqNr = seqNr - MIPRTPFORWARDER_MAXREORDER;
+	}
+	if ((int32_t)(outTimestamp - slot.m_lastTimestamp) > 0)
+		slot.m_lastTimestamp = outTimestamp;
+
+	return true;
+}
+
+real_t MIPRTPForwarder::getClockRate(const MIPRTPReceiveMessage *pRTPMsg) const
+{
+	real_t tsUnit = pRTPMsg->getTimestampUnit();
+
+	if (tsUnit > 0)
+		return 1.0/tsUnit;
+	return (real_t)m_clockRate;
+}
+
+bool MIPRTPForwarder::getAudioLevel(const RTPPacket *pPack, real_t &level)
+{
+	if (m_levelExtensionID > 0 && pPack->HasExtension())
+	{
+		const uint8_t *pData = pPack->GetExtensionData();
+		size_t length = pPack->GetExtensionLength();
+		uint16_t profile = pPack->GetExtensionID();
+		size_t pos = 0;
+
+		if (profile == 0xBEDE) // one-byte header elements (RFC 8285)
+		{
+			while (pos < length)
+			{
+				int id = pData[pos] >> 4;
+				size_t len = (size_t)(pData[pos] & 0x0f) + 1;
+
+				if (pData[pos] == 0) // padding
+				{
+					pos++;
+					continue;
+				}
+				if (id == 15 || pos + 1 + len > length)
+					break;
+				if (id == m_levelExtensionID)
+				{
+					level = -(real_t)(pData[pos+1] & 0x7f);
+					return true;
+				}
+				pos += 1 + len;
+			}
+		}
+		else if ((profile & 0xfff0) == 0x1000) // two-byte header elements
+		{
+			while (pos + 1 < length)
+			{
+				int id = pData[pos];
+				size_t len = pData[pos+1];
+
+				if (id == 0) // padding
+				{
+					pos++;
+					continue;
+				}
+				if (pos + 2 + len > length)
+					break;
+				if (id == m_levelExtensionID && len > 0)
+				{
+					level = -(real_t)(pData[pos+2] & 0x7f);
+					return true;
+				}
+				pos += 2 + len;
+			}
+		}
+	}
+
+	// Without the extension, the level can still be determined cheaply for the
+	// uncompressed static payload types
+
+	const uint8_t *pPayload = pPack->GetPayloadData();
+	size_t length = pPack->GetPayloadLength();
+
+	switch (pPack->GetPayloadType())
+	{
+	case 0: // u-law
+	case 8: // A-law
+		if (length == 0)
+			return false;
+		if (m_samples.size() < length)
+			m_samples.resize(length);
+		if (pPack->GetPayloadType() == 0)
+			MIPG711::decodeULaw(pPayload, &m_samples[0], length);
+		else
+			MIPG711::decodeALaw(pPayload, &m_samples[0], length);
+		level = calculateLevel(&m_samples[0], length);
+		return true;
+	case 10: // L16 stereo
+	case 11: // L16 mono
+		length /= 2;
+		if (length == 0)
+			return false;
+		if (m_samples.size() < length)
+			m_samples.resize(length);
+		for (size_t i = 0 ; i < length ; i++)
+			m_samples[i] = (int16_t)(((uint16_t)pPayload[2*i] << 8) | (uint16_t)pPayload[2*i+1]);
+		level = calculateLevel(&m_samples[0], length);
+		return true;
+	case 13: // comfort noise, the source isn't speaking
+		level = MIPRTPFORWARDER_MINLEVEL;
+		return true;
+	default:
+		break;
+	}
+	return false;
+}
+
+real_t MIPRTPForwarder::calculateLevel(const int16_t *pSamples, size_t numSamples)
+{
+	double sum = 0;
+
+	for (size_t i = 0 ; i < numSamples ; i++)
+		sum += (double)pSamples[i]*(double)pSamples[i];
+
+	// 0 dBov corresponds to a full scale square wave
+	double meanSquare = sum/((double)numSamples*32768.0*32768.0);
+
+	if (meanSquare <= 0)
+		return MIPRTPFORWARDER_MINLEVEL;
+	return (real_t)(10.0*log10(meanSquare));
+}
+
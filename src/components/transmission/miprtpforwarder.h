@@ -0,0 +1,182 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+/**
+ * \file miprtpforwarder.h
+ */
+
+#ifndef MIPRTPFORWARDER_H
+
+#define MIPRTPFORWARDER_H
+
+#include "mipconfig.h"
+#include "mipcomponent.h"
+#include "miptime.h"
+#include <jthread/jmutex.h>
+#include <map>
+#include <vector>
+
+class MIPRTPReceiveMessage;
+
+namespace jrtplib
+{
+	class RTPSession;
+	class RTPPacket;
+}
+
+/** Forwards the RTP packets of the most active speakers without decoding them.
+ *  This component can be used to build a selective forwarding server for an audio conference.
+ *  Instead of decoding all incoming streams, mixing them and encoding the result again, the
+ *  packets of the few participants who are speaking the loudest are sent on to each receiver
+ *  as they are: the payload is never touched.
+ *
+ *  The component accepts MIPRTPReceiveMessage messages, as produced by a MIPRTPComponent which
+ *  receives the packets of all participants. For each source, the audio level is tracked using
+ *  MIPRTPForwarder::getAudioLevel, which by default reads the RFC 6464 client-to-mixer audio 
+ *  level header extension, or estimates the level from the payload for the uncompressed and
+ *  G.711 payload types. Once per iteration, the sources are ranked by their smoothed level.
+ *
+ *  Each receiver is registered with one JRTPLIB RTPSession per slot, and each session should
+ *  send to that receiver only. A slot carries the packets of one of the selected speakers,
+ *  never those of the receiver itself. The packets get the SSRC of the slot's session, and 
+ *  their sequence numbers and timestamps are shifted onto the timeline of the slot: while a 
+ *  slot carries the same speaker, a fixed offset is added to them, so that gaps caused by
+ *  packet loss remain visible to the receiver. When a slot switches to another speaker, the
+ *  sequence numbers continue where they left off, the timestamp advances according to the
+ *  elapsed time and the marker bit is set. CSRC lists and header extensions are forwarded as
+ *  well.
+ *
+ *  The packets are built by the component itself and sent using RTPSession::SendRawData, so
+ *  the session is only used for its SSRC, its destinations and RTCP. Since JRTPLIB doesn't 
+ *  know about the sent packets, the session does not send sender reports, only receiver
+ *  reports. The slot sessions need to be polled by the application (or use the JRTPLIB 
+ *  background thread) so that RTCP packets are sent.
+ *
+ *  No messages are produced by this component.
+ */
+class EMIPLIB_IMPORTEXPORT MIPRTPForwarder : public MIPComponent
+{
+public:
+	MIPRTPForwarder();
+	~MIPRTPForwarder();
+
+	/** Initializes the component.
+	 *  Initializes the component.
+	 *  \param numSpeakers The number of speakers that each receiver gets, which is also the number
+	 *                     of sessions that must be specified in MIPRTPForwarder::addReceiver.
+	 *  \param clockRate The RTP clock rate of the forwarded streams, used when the timestamp unit
+	 *                   of a packet is not known.
+	 */
+	bool init(int numSpeakers = 3, int clockRate = 48000);
+
+	/** Clears the receivers and speaker information and de-initializes the component. */
+	bool destroy();
+
+	/** Adds a receiver.
+	 *  Adds a receiver.
+	 *  \param receiverID The source ID of the receiver's own stream, which will never be forwarded to it.
+	 *  \param sessions The RTP sessions which send to this receiver, one for each slot. These sessions
+	 *                  must exist until the receiver is deleted again.
+	 */
+	bool addReceiver(uint64_t receiverID, const std::vector<jrtplib::RTPSession *> &sessions);
+
+	/** Removes the receiver with ID \c receiverID. */
+	bool deleteReceiver(uint64_t receiverID);
+
+	/** Stores the source IDs of the currently selected speakers, loudest first, in \c speakers. */
+	bool getActiveSpeakers(std::vector<uint64_t> &speakers);
+
+	/** Sets the ID of the RFC 6464 header extension, as negotiated with the participants (default: 1, 0 disables it). */
+	void setAudioLevelExtensionID(int id)								{ m_levelExtensionID = id; }
+
+	/** A speaker that is not selected yet must be this many dB louder to replace a selected one (default: 3 dB). */
+	void setSwitchMargin(real_t dB)									{ m_switchMargin = dB; }
+
+	bool push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg);
+	bool pull(const MIPComponentChain &chain, int64_t iteration, MIPMessage **pMsg);
+protected:
+	/** Determines the audio level of a packet.
+	 *  This virtual function determines the audio level of packet \c pPack in dBov, a value between
+	 *  -127 (silence) and 0. If the audio level extension is present, its value is used. Otherwise,
+	 *  the level is calculated from the payload for the static L16, u-law and A-law payload types,
+	 *  and comfort noise packets (payload type 13) count as silence. For other packets, \c false is 
+	 *  returned and the level of the source is left unchanged. Re-implement this function if the 
+	 *  level should be determined differently, e.g. for a dynamic payload type.
+	 */
+	virtual bool getAudioLevel(const jrtplib::RTPPacket *pPack, real_t &level);
+private:
+	class SourceInfo
+	{
+	public:
+		SourceInfo(MIPTime t) : m_lastTime(t)							{ m_level = -127; m_gotLevel = false; m_lastTimestamp = 0; m_gotTimestamp = false; }
+
+		real_t m_level;
+		bool m_gotLevel;
+		MIPTime m_lastTime;
+		uint32_t m_lastTimestamp;
+		bool m_gotTimestamp;
+	};
+
+	class Slot
+	{
+	public:
+		Slot(jrtplib::RTPSession *pSess) : m_lastSendTime(0)					{ m_pSession = pSess; m_sourceID = 0; m_active = false; m_switched = false; m_sent = false; m_lastTimestamp = 0; m_lastSeqNr = 0; m_timestampOffset = 0; m_seqNrOffset = 0; m_firstSeqNr = 0; }
+
+		jrtplib::RTPSession *m_pSession;
+		uint64_t m_sourceID;
+		bool m_active, m_switched, m_sent;
+		MIPTime m_lastSendTime;
+		uint32_t m_lastTimestamp;
+		uint16_t m_lastSeqNr;
+
+		// Added to the timestamps and sequence numbers of the current speaker
+		uint32_t m_timestampOffset;
+		uint16_t m_seqNrOffset;
+		uint16_t m_firstSeqNr;
+	};
+
+	void updateSelection();
+	void updateLevel(SourceInfo &source, MIPRTPReceiveMessage *pRTPMsg);
+	bool forward(Slot &slot, MIPRTPReceiveMessage *pRTPMsg);
+	real_t getClockRate(const MIPRTPReceiveMessage *pRTPMsg) const;
+	static real_t calculateLevel(const int16_t *pSamples, size_t numSamples);
+
+	bool m_init;
+	int m_numSpeakers;
+	int m_clockRate;
+	int m_levelExtensionID;
+	real_t m_switchMargin;
+	int64_t m_prevIteration;
+	MIPTime m_now;
+
+	jthread::JMutex m_lock;
+	std::map<uint64_t, SourceInfo> m_sources;
+	std::map<uint64_t, std::vector<Slot> > m_receivers;
+	std::vector<uint64_t> m_selected;
+	std::vector<int16_t> m_samples;
+	std::vector<uint8_t> m_packet;
+};
+
+#endif // MIPRTPFORWARDER_H
+
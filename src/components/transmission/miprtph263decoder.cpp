@@ -60,8 +60,9 @@ bool MIPRTPH263Decoder::validatePacket(const RTPPacket *pRTPPack, real_t &timest
 	return true;
 }
 
-void MIPRTPH263Decoder::createNewMessages(const RTPPacket *pRTPPack, std::list<MIPMediaMessage *> &messages, std::list<uint32_t> &timestamps)
+void MIPRTPH263Decoder::createNewMessages(MIPRTPReceiveMessage *pRTPMsg, std::vector<MIPMediaMessage *> &messages, std::vector<uint32_t> &timestamps)
 {
+	const RTPPacket *pRTPPack = pRTPMsg->getPacket();
 	const uint8_t *pPayload = pRTPPack->GetPayloadData();
 	bool firstFramePart = false;
 
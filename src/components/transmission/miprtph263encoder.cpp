@@ -25,6 +25,8 @@
 #include "mipconfig.h"
 #include "miprtph263encoder.h"
 #include "miprtpmessage.h"
+#include "mipcomponentchain.h"
+#include "mipmessagearena.h"
 #include "miprawvideomessage.h"
 #include "mipencodedvideomessage.h"
 
@@ -115,7 +117,7 @@ bool MIPRTPH263Encoder::push(const MIPComponentChain &chain, int64_t iteration,
 			else
 				partTSInc = tsInc;
 
-			uint8_t *pMsgData = new uint8_t [partSize];
+			uint8_t *pMsgData = chain.getMessageArena().allocateArray<uint8_t>(partSize);
 		
 			memcpy(pMsgData + extraBytes, pVidMsg->getImageData() + offset, partSize-extraBytes);
 
@@ -136,7 +138,7 @@ bool MIPRTPH263Encoder::push(const MIPComponentChain &chain, int64_t iteration,
 
 			MIPRTPSendMessage *pNewMsg;
 
-			pNewMsg = new MIPRTPSendMessage(pMsgData, partSize, payloadType, marker, partTSInc);
+			pNewMsg = chain.getMessageArena().createMessage<MIPRTPSendMessage>(pMsgData, partSize, payloadType, marker, partTSInc, false);
 			pNewMsg->setSamplingInstant(pVidMsg->getTime());
 
 			m_messages.push_back(pNewMsg);
@@ -191,10 +193,7 @@ void MIPRTPH263Encoder::cleanUp()
 
 void MIPRTPH263Encoder::clearMessages()
 {
-	std::list<MIPRTPSendMessage *>::iterator it;
-
-	for (it = m_messages.begin() ; it != m_messages.end() ; it++)
-		delete (*it);
+	// The messages themselves are stored in the chain's message arena
 	m_messages.clear();
 	m_msgIt = m_messages.begin();
 }
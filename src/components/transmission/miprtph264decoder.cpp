@@ -0,0 +1,301 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+#include "mipconfig.h"
+#include "miprtph264decoder.h"
+#include "mipencodedvideomessage.h"
+#include "miprtpmessage.h"
+#include <jrtplib3/rtppacket.h>
+#include <string.h>
+
+#include "mipdebug.h"
+
+using namespace jrtplib;
+
+#define MIPRTPH264DECODER_NALTYPE_SLICE			1
+#define MIPRTPH264DECODER_NALTYPE_IDR			5
+#define MIPRTPH264DECODER_NALTYPE_SEI			6
+#define MIPRTPH264DECODER_NALTYPE_SPS			7
+#define MIPRTPH264DECODER_NALTYPE_PPS			8
+#define MIPRTPH264DECODER_NALTYPE_AUD			9
+#define MIPRTPH264DECODER_NALTYPE_STAPA			24
+#define MIPRTPH264DECODER_NALTYPE_FUA			28
+
+MIPRTPH264Decoder::MIPRTPH264Decoder()
+{
+}
+
+MIPRTPH264Decoder::~MIPRTPH264Decoder()
+{
+	for (auto it = m_packetGroupers.begin() ; it != m_packetGroupers.end() ; it++)
+		delete (*it).second;
+	m_packetGroupers.clear();
+}
+
+bool MIPRTPH264Decoder::validatePacket(const RTPPacket *pRTPPack, real_t &timestampUnit, real_t timestampUnitEstimate)
+{
+	const uint8_t *pPayload = pRTPPack->GetPayloadData();
+	size_t length = (size_t)pRTPPack->GetPayloadLength();
+
+	if (length < 2)
+		return false;
+
+	if (pPayload[0] & 0x80) // forbidden_zero_bit
+		return false;
+
+	// Only the packet types of the non-interleaved mode are supported
+
+	uint8_t nalType = pPayload[0] & 0x1F;
+
+	if (!((nalType >= 1 && nalType <= 23) || nalType == MIPRTPH264DECODER_NALTYPE_STAPA || nalType == MIPRTPH264DECODER_NALTYPE_FUA))
+		return false;
+
+	timestampUnit = 1.0/90000.0;
+	
+	return true;
+}
+
+void MIPRTPH264Decoder::createNewMessages(MIPRTPReceiveMessage *pRTPMsg, std::vector<MIPMediaMessage *> &messages, std::vector<uint32_t> &timestamps)
+{
+	const RTPPacket *pRTPPack = pRTPMsg->getPacket();
+
+	expireGroupers();
+
+	uint32_t ssrc = pRTPPack->GetSSRC();
+	MIPRTPPacketGrouper *pGrouper = 0;
+
+	auto it = m_packetGroupers.find(ssrc);
+	if (it == m_packetGroupers.end()) // no entry exists yet
+	{
+		pGrouper = new MIPRTPPacketGrouper();
+
+		if (!pGrouper->init(ssrc))
+		{
+			// TODO: report error somehow?
+			delete pGrouper;
+			return;
+		}
+
+		m_packetGroupers[ssrc] = new PacketGrouper(pGrouper);
+	}
+	else
+		pGrouper = (*it).second->getGrouper();
+
+	bool firstFramePart = isFirstFramePart(pRTPPack->GetPayloadData(), pRTPPack->GetPayloadLength());
+
+	if (!pGrouper->processPacket(pRTPPack, firstFramePart)) // TODO: error reporting?
+		return;
+
+	bool done = false;
+
+	while (!done)
+	{
+		std::vector<uint8_t *> parts;
+		std::vector<size_t> sizes;
+		uint32_t timestamp;
+
+		pGrouper->getNextQueuedPacket(parts, sizes, timestamp);
+
+		if (parts.size() == 0)
+			done = true;
+		else
+		{
+			size_t totalSize = depacketize(parts, sizes, 0);
+
+			if (totalSize > 0)
+			{
+				uint8_t *pData = new uint8_t [totalSize];
+
+				depacketize(parts, sizes, pData);
+
+				MIPEncodedVideoMessage *pVidMsg = new MIPEncodedVideoMessage(MIPENCODEDVIDEOMESSAGE_TYPE_H264, 0, 0, pData, totalSize, true);
+			
+				messages.push_back(pVidMsg);
+				timestamps.push_back(timestamp);
+			}
+
+			for (size_t i = 0 ; i < parts.size() ; i++)
+				delete [] parts[i];
+		}
+	}
+}
+
+bool MIPRTPH264Decoder::isFirstFramePart(const uint8_t *pPayload, size_t length)
+{
+	// An access unit starts with an access unit delimiter, parameter sets or SEI,
+	// or otherwise with the slice that has first_mb_in_slice equal to zero. That 
+	// value is coded as the single bit '1', the first bit after the NAL header.
+
+	if (length < 2)
+		return false;
+
+	uint8_t nalType = pPayload[0] & 0x1F;
+	uint8_t firstByte = pPayload[1];
+
+	if (nalType == MIPRTPH264DECODER_NALTYPE_STAPA) // look at the first aggregated NAL unit
+	{
+		if (length < 5)
+			return false;
+		nalType = pPayload[3] & 0x1F;
+		firstByte = pPayload[4];
+	}
+	else if (nalType == MIPRTPH264DECODER_NALTYPE_FUA)
+	{
+		if (length < 3 || !(pPayload[1] & 0x80)) // only the fragment with the start bit
+			return false;
+		nalType = pPayload[1] & 0x1F;
+		firstByte = pPayload[2];
+	}
+
+	switch (nalType)
+	{
+	case MIPRTPH264DECODER_NALTYPE_AUD:
+	case MIPRTPH264DECODER_NALTYPE_SPS:
+	case MIPRTPH264DECODER_NALTYPE_PPS:
+	case MIPRTPH264DECODER_NALTYPE_SEI:
+		return true;
+	case MIPRTPH264DECODER_NALTYPE_SLICE:
+	case MIPRTPH264DECODER_NALTYPE_IDR:
+		return (firstByte & 0x80) != 0;
+	}
+	return false;
+}
+
+size_t MIPRTPH264Decoder::depacketize(const std::vector<uint8_t *> &parts, const std::vector<size_t> &sizes, uint8_t *pDst)
+{
+	// Converts the RTP payloads of a frame into an Annex B byte stream. If pDst is NULL,
+	// only the length of the result is calculated.
+
+	static const uint8_t startCode[4] = { 0x00, 0x00, 0x00, 0x01 };
+	size_t offset = 0;
+	bool inFragmentedNAL = false;
+
+	for (size_t i = 0 ; i < parts.size() ; i++)
+	{
+		const uint8_t *pPart = parts[i];
+		size_t partSize = sizes[i];
+
+		if (partSize < 1)
+			continue;
+
+		uint8_t nalType = pPart[0] & 0x1F;
+
+		if (nalType >= 1 && nalType <= 23) // single NAL unit packet
+		{
+			if (pDst)
+			{
+				memcpy(pDst + offset, startCode, 4);
+				memcpy(pDst + offset + 4, pPart, partSize);
+			}
+			offset += 4 + partSize;
+			inFragmentedNAL = false;
+		}
+		else if (nalType == MIPRTPH264DECODER_NALTYPE_STAPA)
+		{
+			size_t pos = 1;
+
+			while (pos + 2 < partSize)
+			{
+				size_t nalSize = ((size_t)pPart[pos] << 8) | (size_t)pPart[pos+1];
+
+				pos += 2;
+				if (nalSize == 0 || pos + nalSize > partSize) // invalid, ignore the rest
+					break;
+
+				if (pDst)
+				{
+					memcpy(pDst + offset, startCode, 4);
+					memcpy(pDst + offset + 4, pPart + pos, nalSize);
+				}
+				offset += 4 + nalSize;
+				pos += nalSize;
+			}
+			inFragmentedNAL = false;
+		}
+		else if (nalType == MIPRTPH264DECODER_NALTYPE_FUA)
+		{
+			if (partSize < 2)
+			{
+				inFragmentedNAL = false;
+				continue;
+			}
+
+			uint8_t fuHeader = pPart[1];
+
+			if (fuHeader & 0x80) // start bit, reconstruct the NAL unit header
+			{
+				if (pDst)
+				{
+					memcpy(pDst + offset, startCode, 4);
+					pDst[offset + 4] = (pPart[0] & 0xE0) | (fuHeader & 0x1F);
+					memcpy(pDst + offset + 5, pPart + 2, partSize - 2);
+				}
+				offset += 5 + partSize - 2;
+				inFragmentedNAL = true;
+			}
+			else if (inFragmentedNAL) // if we missed the start, the fragment is useless
+			{
+				if (pDst)
+					memcpy(pDst + offset, pPart + 2, partSize - 2);
+				offset += partSize - 2;
+			}
+
+			if (fuHeader & 0x40) // end bit
+				inFragmentedNAL = false;
+		}
+		else
+			inFragmentedNAL = false;
+	}
+
+	return offset;
+}
+
+void MIPRTPH264Decoder::expireGroupers()
+{
+	MIPTime curTime = MIPTime::getCurrentTime();
+	if ((curTime.getValue() - m_lastCheckTime.getValue()) < 10.0)
+		return;
+
+	m_lastCheckTime = curTime;
+
+	auto it = m_packetGroupers.begin(); 
+
+	while (it != m_packetGroupers.end())
+	{
+		PacketGrouper *pPackGroup = (*it).second;
+
+		if (curTime.getValue() - pPackGroup->getLastAccessTime().getValue() > 10.0) // TODO: make this configurable?
+		{
+			auto it2 = it;
+
+			it++;
+
+			delete (*it2).second;
+			m_packetGroupers.erase(it2);
+		}
+		else
+			it++;
+	}
+}
+
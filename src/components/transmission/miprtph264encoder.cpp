@@ -0,0 +1,248 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+#include "mipconfig.h"
+#include "miprtph264encoder.h"
+#include "miprtpmessage.h"
+#include "mipencodedvideomessage.h"
+#include <string.h>
+
+#include "mipdebug.h"
+
+#define MIPRTPH264ENCODER_ERRSTR_BADMESSAGE		"Can't understand message"
+#define MIPRTPH264ENCODER_ERRSTR_NOTINIT		"RTP encoder not initialized"
+#define MIPRTPH264ENCODER_ERRSTR_BADPAYLOADSIZE		"The maximum RTP payload size should be at least 128"
+
+#define MIPRTPH264ENCODER_NALTYPE_STAPA			24
+#define MIPRTPH264ENCODER_NALTYPE_FUA			28
+
+MIPRTPH264Encoder::MIPRTPH264Encoder() : MIPRTPEncoder("MIPRTPH264Encoder")
+{
+	m_init = false;
+}
+
+MIPRTPH264Encoder::~MIPRTPH264Encoder()
+{
+	cleanUp();
+}
+
+bool MIPRTPH264Encoder::init(real_t frameRate, size_t maxPayloadSize)
+{
+	if (maxPayloadSize < 128)
+	{
+		setErrorString(MIPRTPH264ENCODER_ERRSTR_BADPAYLOADSIZE);
+		return false;
+	}
+
+	if (m_init)
+		cleanUp();
+
+	// We'll use a timestamp unit of 1.0/90000.0
+
+	m_tsInc = (uint32_t)((90000.0/frameRate)+0.5);
+	m_maxPayloadSize = maxPayloadSize;
+
+	MIPOutputMessageQueue::init();
+
+	m_init = true;
+	return true;
+}
+
+bool MIPRTPH264Encoder::push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg)
+{
+	if (!m_init)
+	{
+		setErrorString(MIPRTPH264ENCODER_ERRSTR_NOTINIT);
+		return false;
+	}
+
+	checkIteration(iteration);
+
+	if (!(pMsg->getMessageType() == MIPMESSAGE_TYPE_VIDEO_ENCODED && pMsg->getMessageSubtype() == MIPENCODEDVIDEOMESSAGE_TYPE_H264))
+	{
+		setErrorString(MIPRTPH264ENCODER_ERRSTR_BADMESSAGE);
+		return false;
+	}
+
+	MIPEncodedVideoMessage *pVidMsg = (MIPEncodedVideoMessage *)pMsg;
+
+	findNALUnits(pVidMsg->getImageData(), pVidMsg->getDataLength());
+
+	size_t numNALUnits = m_nalUnits.size();
+	size_t i = 0;
+
+	while (i < numNALUnits)
+	{
+		const uint8_t *pNAL = m_nalUnits[i].first;
+		size_t nalSize = m_nalUnits[i].second;
+
+		if (nalSize > m_maxPayloadSize)
+		{
+			// Split the NAL unit into FU-A packets. The NAL unit header is not sent 
+			// as such, its fields are stored in the FU indicator and FU header.
+
+			uint8_t fuIndicator = (pNAL[0] & 0xE0) | MIPRTPH264ENCODER_NALTYPE_FUA;
+			uint8_t fuHeader = 0x80 | (pNAL[0] & 0x1F); // start bit
+			const uint8_t *pData = pNAL + 1;
+			size_t remaining = nalSize - 1;
+
+			while (remaining > 0)
+			{
+				size_t partSize = remaining;
+
+				if (partSize > m_maxPayloadSize - 2)
+					partSize = m_maxPayloadSize - 2;
+				else
+					fuHeader |= 0x40; // end bit
+
+				uint8_t *pPayload = allocateOutputData<uint8_t>(chain, partSize + 2);
+
+				pPayload[0] = fuIndicator;
+				pPayload[1] = fuHeader;
+				memcpy(pPayload + 2, pData, partSize);
+
+				pData += partSize;
+				remaining -= partSize;
+				fuHeader &= ~0x80;
+
+				addPacket(chain, pVidMsg, pPayload, partSize + 2, (remaining == 0 && i + 1 == numNALUnits));
+			}
+			i++;
+		}
+		else
+		{
+			// Check how many of the following NAL units fit in a STAP-A packet together
+			// with this one (the NAL unit sizes are stored in 16 bits)
+
+			size_t stapSize = 1 + 2 + nalSize;
+			size_t j = i + 1;
+
+			if (nalSize <= 0xffff)
+			{
+				while (j < numNALUnits && m_nalUnits[j].second <= 0xffff && stapSize + 2 + m_nalUnits[j].second <= m_maxPayloadSize)
+				{
+					stapSize += 2 + m_nalUnits[j].second;
+					j++;
+				}
+			}
+
+			if (j == i + 1) // single NAL unit packet
+			{
+				uint8_t *pPayload = allocateOutputData<uint8_t>(chain, nalSize);
+
+				memcpy(pPayload, pNAL, nalSize);
+				addPacket(chain, pVidMsg, pPayload, nalSize, (j == numNALUnits));
+			}
+			else
+			{
+				uint8_t *pPayload = allocateOutputData<uint8_t>(chain, stapSize);
+				uint8_t forbiddenBit = 0;
+				uint8_t nri = 0;
+				size_t offset = 1;
+
+				for (size_t k = i ; k < j ; k++)
+				{
+					const uint8_t *pAggNAL = m_nalUnits[k].first;
+					size_t aggSize = m_nalUnits[k].second;
+
+					pPayload[offset] = (uint8_t)(aggSize >> 8);
+					pPayload[offset + 1] = (uint8_t)(aggSize & 0xff);
+					memcpy(pPayload + offset + 2, pAggNAL, aggSize);
+					offset += 2 + aggSize;
+
+					// The STAP-A header must use the highest NRI of the aggregated NAL units
+					forbiddenBit |= (pAggNAL[0] & 0x80);
+					if ((pAggNAL[0] & 0x60) > nri)
+						nri = (pAggNAL[0] & 0x60);
+				}
+
+				pPayload[0] = forbiddenBit | nri | MIPRTPH264ENCODER_NALTYPE_STAPA;
+				addPacket(chain, pVidMsg, pPayload, stapSize, (j == numNALUnits));
+			}
+			i = j;
+		}
+	}
+
+	return true;
+}
+
+void MIPRTPH264Encoder::cleanUp()
+{
+	clearMessages();
+	m_nalUnits.clear();
+	m_init = false;
+}
+
+void MIPRTPH264Encoder::findNALUnits(const uint8_t *pData, size_t length)
+{
+	m_nalUnits.clear();
+
+	size_t nalStart = 0;
+	bool foundStart = false;
+	size_t i = 0;
+
+	while (i + 2 < length)
+	{
+		if (pData[i+2] > 1) // no start code can begin at i, i+1 or i+2
+			i += 3;
+		else if (pData[i+2] == 1 && pData[i+1] == 0 && pData[i] == 0)
+		{
+			if (foundStart)
+				addNALUnit(pData + nalStart, i - nalStart);
+
+			i += 3;
+			nalStart = i;
+			foundStart = true;
+		}
+		else
+			i++;
+	}
+
+	if (foundStart)
+		addNALUnit(pData + nalStart, length - nalStart);
+}
+
+void MIPRTPH264Encoder::addNALUnit(const uint8_t *pNAL, size_t length)
+{
+	// Trailing zero bytes belong to the next four byte start code or are 
+	// trailing_zero_8bits, they're not part of the NAL unit itself
+	while (length > 0 && pNAL[length-1] == 0)
+		length--;
+
+	if (length > 0)
+		m_nalUnits.push_back(std::pair<const uint8_t *, size_t>(pNAL, length));
+}
+
+void MIPRTPH264Encoder::addPacket(const MIPComponentChain &chain, const MIPEncodedVideoMessage *pVidMsg, uint8_t *pPayload, 
+                                  size_t length, bool marker)
+{
+	// All packets of a frame share the same timestamp, the increment is applied
+	// after the last one
+
+	uint32_t tsInc = (marker)?m_tsInc:0;
+	MIPRTPSendMessage *pNewMsg = createOutputMessage<MIPRTPSendMessage>(chain, pPayload, length, getPayloadType(), marker, tsInc, false);
+
+	pNewMsg->setSamplingInstant(pVidMsg->getTime());
+}
+
@@ -0,0 +1,77 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+/**
+ * \file miprtph264encoder.h
+ */
+
+#ifndef MIPRTPH264ENCODER_H
+
+#define MIPRTPH264ENCODER_H
+
+#include "mipconfig.h"
+#include "miprtpencoder.h"
+#include <vector>
+#include <utility>
+
+class MIPEncodedVideoMessage;
+
+/** Creates RTP packets for incoming video packets in H.264 encoded format.
+ *  This component accepts incoming video packets using H.264 compression, stored
+ *  as an Annex B byte stream, and generates MIPRTPSendMessage objects which can then
+ *  be transferred to a MIPRTPComponent instance. The payload format is the non-interleaved
+ *  mode of RFC 6184: consecutive NAL units which are small enough are aggregated into
+ *  STAP-A packets, NAL units which are larger than the maximum payload size are split
+ *  into FU-A packets. The marker bit is set on the last packet of each video frame.
+ */
+class EMIPLIB_IMPORTEXPORT MIPRTPH264Encoder : public MIPRTPEncoder
+{
+public:
+	MIPRTPH264Encoder();
+	~MIPRTPH264Encoder();
+
+	/** Initializes the encoder. 
+	 *  Initializes the encoder.
+	 *  \param frameRate Frame rate of incoming video frames. 
+	 *  \param maxPayloadSize Maximum length the payload of an RTP packet can have
+	 */
+	bool init(real_t frameRate, size_t maxPayloadSize);
+
+	bool push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg);
+	// pull is provided by MIPOutputMessageQueue
+private:
+	void cleanUp();
+	void findNALUnits(const uint8_t *pData, size_t length);
+	void addNALUnit(const uint8_t *pNAL, size_t length);
+	void addPacket(const MIPComponentChain &chain, const MIPEncodedVideoMessage *pVidMsg, uint8_t *pPayload, 
+	               size_t length, bool marker);
+
+	bool m_init;
+	size_t m_maxPayloadSize;
+	uint32_t m_tsInc;
+	std::vector<std::pair<const uint8_t *, size_t> > m_nalUnits;
+};
+
+#endif // MIPRTPH264ENCODER_H
+
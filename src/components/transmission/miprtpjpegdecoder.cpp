@@ -324,8 +324,9 @@ bool MIPRTPJPEGDecoder::validatePacket(const RTPPacket *pRTPPack, real_t &timest
 	return true;
 }
 
-void MIPRTPJPEGDecoder::createNewMessages(const RTPPacket *pRTPPack, std::list<MIPMediaMessage *> &messages, std::list<uint32_t> &timestamps)
+void MIPRTPJPEGDecoder::createNewMessages(MIPRTPReceiveMessage *pRTPMsg, std::vector<MIPMediaMessage *> &messages, std::vector<uint32_t> &timestamps)
 {
+	const RTPPacket *pRTPPack = pRTPMsg->getPacket();
 	const uint8_t *pPayload = pRTPPack->GetPayloadData();
 
 	expireGroupers();
@@ -384,7 +385,7 @@ void MIPRTPJPEGDecoder::createNewMessages(const RTPPacket *pRTPPack, std::list<M
 
 void MIPRTPJPEGDecoder::processJPEGParts(const std::vector<uint8_t *> &parts, const std::vector<size_t> &sizes, 
 					 const std::vector<real_t> &receiveTimes, uint32_t timestamp,
- 			                 std::list<MIPMediaMessage *> &messages, std::list<uint32_t> &timestamps)
+ 			                 std::vector<MIPMediaMessage *> &messages, std::vector<uint32_t> &timestamps)
 
 {
 	int maxPacketSize = 0;
@@ -47,10 +47,10 @@ public:
 	~MIPRTPJPEGDecoder();
 private:
 	bool validatePacket(const jrtplib::RTPPacket *pRTPPack, real_t &timestampUnit, real_t timestampUnitEstimate);
-	void createNewMessages(const jrtplib::RTPPacket *pRTPPack, std::list<MIPMediaMessage *> &messages, std::list<uint32_t> &timestamps);
+	void createNewMessages(MIPRTPReceiveMessage *pRTPMsg, std::vector<MIPMediaMessage *> &messages, std::vector<uint32_t> &timestamps);
 	void processJPEGParts(const std::vector<uint8_t *> &parts, const std::vector<size_t> &sizes, 
 			      const std::vector<real_t> &receiveTimes, uint32_t timestamp,
- 			      std::list<MIPMediaMessage *> &messages, std::list<uint32_t> &timestamps);
+ 			      std::vector<MIPMediaMessage *> &messages, std::vector<uint32_t> &timestamps);
 
 	void expireGroupers();
 
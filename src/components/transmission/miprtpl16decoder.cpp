@@ -68,16 +68,15 @@ bool MIPRTPL16Decoder::validatePacket(const RTPPacket *pRTPPack, real_t &timesta
 	return true;
 }
 
-void MIPRTPL16Decoder::createNewMessages(const RTPPacket *pRTPPack, std::list<MIPMediaMessage *> &messages, std::list<uint32_t> &timestamps)
+void MIPRTPL16Decoder::createNewMessages(MIPRTPReceiveMessage *pRTPMsg, std::vector<MIPMediaMessage *> &messages, std::vector<uint32_t> &timestamps)
 {
+	const RTPPacket *pRTPPack = pRTPMsg->getPacket();
 	size_t length = pRTPPack->GetPayloadLength();
 	size_t numSamples = length/2; // 2 bytes per sample
 
-	uint16_t *pFrames = new uint16_t [numSamples];
-
-	memcpy(pFrames, pRTPPack->GetPayloadData(), length);
-
-	MIPRaw16bitAudioMessage *pRawMsg = new MIPRaw16bitAudioMessage(m_sampRate, m_channels, numSamples/m_channels, true, MIPRaw16bitAudioMessage::BigEndian, pFrames, true);
+	// The big endian samples are used as they are, without copying them out of the packet
+	MIPSharedBuffer *pBuffer = pRTPMsg->getPayloadBuffer();
+	MIPRaw16bitAudioMessage *pRawMsg = new MIPRaw16bitAudioMessage(m_sampRate, m_channels, numSamples/m_channels, true, MIPRaw16bitAudioMessage::BigEndian, pBuffer);
 
 	messages.push_back(pRawMsg);
 	timestamps.push_back(pRTPPack->GetTimestamp());
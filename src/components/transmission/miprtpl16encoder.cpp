@@ -25,6 +25,8 @@
 #include "mipconfig.h"
 #include "miprtpl16encoder.h"
 #include "miprtpmessage.h"
+#include "mipcomponentchain.h"
+#include "mipmessagearena.h"
 #include "miprawaudiomessage.h"
 #include "mipencodedaudiomessage.h"
 
@@ -100,13 +102,13 @@ bool MIPRTPL16Encoder::push(const MIPComponentChain &chain, int64_t iteration, M
 	const uint16_t *pFrames = pRawMsg->getFrames();
 	bool marker = false;
 	size_t length = pRawMsg->getNumberOfFrames() * m_channels * sizeof(uint16_t);
-	uint8_t *pPayload = new uint8_t [length];
+	uint8_t *pPayload = chain.getMessageArena().allocateArray<uint8_t>(length);
 
 	memcpy(pPayload,pFrames,length);
 
 	MIPRTPSendMessage *pNewMsg;
 
-	pNewMsg = new MIPRTPSendMessage(pPayload,length,getPayloadType(),marker,pRawMsg->getNumberOfFrames());
+	pNewMsg = chain.getMessageArena().createMessage<MIPRTPSendMessage>(pPayload,length,getPayloadType(),marker,pRawMsg->getNumberOfFrames(),false);
 	pNewMsg->setSamplingInstant(pRawMsg->getTime());
 	
 	m_messages.push_back(pNewMsg);
@@ -150,10 +152,7 @@ void MIPRTPL16Encoder::cleanUp()
 
 void MIPRTPL16Encoder::clearMessages()
 {
-	std::list<MIPRTPSendMessage *>::iterator it;
-
-	for (it = m_messages.begin() ; it != m_messages.end() ; it++)
-		delete (*it);
+	// The messages themselves are stored in the chain's message arena
 	m_messages.clear();
 	m_msgIt = m_messages.begin();
 }
@@ -32,7 +32,7 @@
 
 #include "mipconfig.h"
 #include "miprtpencoder.h"
-#include <list>
+#include <vector>
 
 class MIPRTPSendMessage;
 
@@ -59,8 +59,8 @@ private:
 
 	bool m_init;
 	int m_channels, m_sampRate;
-	std::list<MIPRTPSendMessage *> m_messages;
-	std::list<MIPRTPSendMessage *>::const_iterator m_msgIt;
+	std::vector<MIPRTPSendMessage *> m_messages;
+	std::vector<MIPRTPSendMessage *>::const_iterator m_msgIt;
 	int64_t m_prevIteration;
 };
 
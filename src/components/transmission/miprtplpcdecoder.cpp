@@ -56,15 +56,33 @@ bool MIPRTPLPCDecoder::validatePacket(const RTPPacket *pRTPPack, real_t &timesta
 	return true;
 }
 
-void MIPRTPLPCDecoder::createNewMessages(const RTPPacket *pRTPPack, std::list<MIPMediaMessage *> &messages, std::list<uint32_t> &timestamps)
+void MIPRTPLPCDecoder::createNewMessages(MIPRTPReceiveMessage *pRTPMsg, std::vector<MIPMediaMessage *> &messages, std::vector<uint32_t> &timestamps)
 {
+	const RTPPacket *pRTPPack = pRTPMsg->getPacket();
 	size_t length = pRTPPack->GetPayloadLength();
-	uint8_t *pData = new uint8_t [length];
-	
-	memcpy(pData, pRTPPack->GetPayloadData(), length);
-	MIPEncodedAudioMessage *pEncMsg = new MIPEncodedAudioMessage(MIPENCODEDAUDIOMESSAGE_TYPE_LPC, 8000, 1, MIPRTPLPCDECODER_NUMFRAMES, pData, length, true);
+	MIPSharedBuffer *pBuffer = pRTPMsg->getPayloadBuffer();
+
+	MIPEncodedAudioMessage *pEncMsg = new MIPEncodedAudioMessage(MIPENCODEDAUDIOMESSAGE_TYPE_LPC, 8000, 1, MIPRTPLPCDECODER_NUMFRAMES, pBuffer, length);
 
 	messages.push_back(pEncMsg);
 	timestamps.push_back(pRTPPack->GetTimestamp());
 }
 
+void MIPRTPLPCDecoder::createConcealmentMessages(MIPRTPReceiveMessage *pRTPMsg, int numLost, uint32_t timestampsPerPacket,
+                                                  std::vector<MIPMediaMessage *> &messages, std::vector<uint32_t> &timestamps)
+{
+	const RTPPacket *pRTPPack = pRTPMsg->getPacket();
+
+	if (timestampsPerPacket == 0)
+		return;
+
+	for (int i = 0 ; i < numLost ; i++)
+	{
+		MIPEncodedAudioMessage *pEncMsg = new MIPEncodedAudioMessage(MIPENCODEDAUDIOMESSAGE_TYPE_LPC, 8000, 1, (int)timestampsPerPacket, 0, 0, true);
+
+		pEncMsg->setConcealment(false);
+		messages.push_back(pEncMsg);
+		timestamps.push_back(pRTPPack->GetTimestamp() - ((uint32_t)(numLost-i))*timestampsPerPacket);
+	}
+}
+
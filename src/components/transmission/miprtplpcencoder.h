@@ -35,7 +35,7 @@
 #ifdef MIPCONFIG_SUPPORT_LPC
 
 #include "miprtpencoder.h"
-#include <list>
+#include <vector>
 
 class MIPRTPSendMessage;
 
@@ -59,8 +59,8 @@ private:
 	void clearMessages();
 
 	bool m_init;
-	std::list<MIPRTPSendMessage *> m_messages;
-	std::list<MIPRTPSendMessage *>::const_iterator m_msgIt;
+	std::vector<MIPRTPSendMessage *> m_messages;
+	std::vector<MIPRTPSendMessage *>::const_iterator m_msgIt;
 	int64_t m_prevIteration;
 };
 
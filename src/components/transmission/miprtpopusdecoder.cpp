@@ -57,17 +57,44 @@ bool MIPRTPOpusDecoder::validatePacket(const RTPPacket *pRTPPack, real_t &timest
 	return true;
 }
 
-void MIPRTPOpusDecoder::createNewMessages(const RTPPacket *pRTPPack, std::list<MIPMediaMessage *> &messages, std::list<uint32_t> &timestamps)
+void MIPRTPOpusDecoder::createNewMessages(MIPRTPReceiveMessage *pRTPMsg, std::vector<MIPMediaMessage *> &messages, std::vector<uint32_t> &timestamps)
 {
+	const RTPPacket *pRTPPack = pRTPMsg->getPacket();
 	size_t length = pRTPPack->GetPayloadLength();
-	uint8_t *pData = new uint8_t [length];
-	
-	memcpy(pData, pRTPPack->GetPayloadData(), length);
-	MIPEncodedAudioMessage *pEncMsg = new MIPEncodedAudioMessage(MIPENCODEDAUDIOMESSAGE_TYPE_OPUS, -1, 1, -1, pData, length, true);
+	MIPSharedBuffer *pBuffer = pRTPMsg->getPayloadBuffer();
+
+	MIPEncodedAudioMessage *pEncMsg = new MIPEncodedAudioMessage(MIPENCODEDAUDIOMESSAGE_TYPE_OPUS, -1, 1, -1, pBuffer, length);
 
 	messages.push_back(pEncMsg);
 	timestamps.push_back(pRTPPack->GetTimestamp());
 }
 
+void MIPRTPOpusDecoder::createConcealmentMessages(MIPRTPReceiveMessage *pRTPMsg, int numLost, uint32_t timestampsPerPacket,
+                                                  std::vector<MIPMediaMessage *> &messages, std::vector<uint32_t> &timestamps)
+{
+	const RTPPacket *pRTPPack = pRTPMsg->getPacket();
+
+	if (timestampsPerPacket == 0)
+		return;
+
+	// The packet which did arrive may contain FEC data for the one right before it;
+	// for earlier packets, the decoder's own concealment is used
+
+	for (int i = 0 ; i < numLost ; i++)
+	{
+		bool useFEC = (i == numLost-1);
+		MIPEncodedAudioMessage *pEncMsg = 0;
+
+		if (useFEC) // shares the payload with the message for the packet itself
+			pEncMsg = new MIPEncodedAudioMessage(MIPENCODEDAUDIOMESSAGE_TYPE_OPUS, 48000, 1, (int)timestampsPerPacket, pRTPMsg->getPayloadBuffer(), pRTPPack->GetPayloadLength());
+		else
+			pEncMsg = new MIPEncodedAudioMessage(MIPENCODEDAUDIOMESSAGE_TYPE_OPUS, 48000, 1, (int)timestampsPerPacket, 0, 0, true);
+
+		pEncMsg->setConcealment(useFEC);
+		messages.push_back(pEncMsg);
+		timestamps.push_back(pRTPPack->GetTimestamp() - ((uint32_t)(numLost-i))*timestampsPerPacket);
+	}
+}
+
 #endif // MIPCONFIG_SUPPORT_OPUS
 
@@ -86,17 +86,15 @@ bool MIPRTPOpusEncoder::push(const MIPComponentChain &chain, int64_t iteration,
 	const void *pData = pEncMsg->getData();
 	bool marker = false; // Not needed
 	size_t length = pEncMsg->getDataLength();
-	uint8_t *pPayload = new uint8_t [length];
+	uint8_t *pPayload = allocateOutputData<uint8_t>(chain, length);
 	int numFrames = pEncMsg->getNumberOfFrames();
 
 	int tsInc = (48000/sampRate)*numFrames; // Opus uses an timestamp increment of 48000 each second
 
 	memcpy(pPayload,pData,length);
 
-	MIPRTPSendMessage *pNewMsg = new MIPRTPSendMessage(pPayload, length, getPayloadType(), marker, tsInc);
+	MIPRTPSendMessage *pNewMsg = createOutputMessage<MIPRTPSendMessage>(chain, pPayload, length, getPayloadType(), marker, (uint32_t)tsInc, false);
 	pNewMsg->setSamplingInstant(pEncMsg->getTime());
-	
-	addToOutputQueue(pNewMsg, true);
 		
 	return true;
 }
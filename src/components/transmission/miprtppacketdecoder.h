@@ -32,7 +32,7 @@
 
 #include "mipconfig.h"
 #include "miptypes.h"
-#include <list>
+#include <vector>
 
 namespace jrtplib
 {
@@ -40,6 +40,7 @@ namespace jrtplib
 }
 
 class MIPMediaMessage;
+class MIPRTPReceiveMessage;
 
 /** Abstract base class for RTP packet decoders for a specific kind of payload. */
 class EMIPLIB_IMPORTEXPORT MIPRTPPacketDecoder
@@ -58,14 +59,35 @@ public:
 
 	/** Creates a new message from an RTP packet.
 	 *  This function has to be implemented by a derived class. Based on the validated
-	 *  RTP packet \c pRTPPack, one or more appropriate messages should be generated.
-	 *  \param pRTPPack The RTP packet which should be processed.
-	 *  \param messages A list in which the resulting messages should be stored.
-	 *  \param timestamps A list containing the RTP timestamp for each message in the
-	 *                    'messages' list.
+	 *  RTP packet stored in \c pRTPMsg, one or more appropriate messages should be generated.
+	 *  When the payload can be used as is, the message's MIPRTPReceiveMessage::getPayloadBuffer
+	 *  function can be used to create messages which refer to the packet data instead of copying
+	 *  it. The vectors are cleared by the caller and reused for each packet, so the implementation
+	 *  should only append to them.
+	 *  \param pRTPMsg The message containing the RTP packet which should be processed.
+	 *  \param messages A vector in which the resulting messages should be stored.
+	 *  \param timestamps A vector containing the RTP timestamp for each message in the
+	 *                    'messages' vector.
 	 */
-	virtual void createNewMessages(const jrtplib::RTPPacket *pRTPPack, std::list<MIPMediaMessage *> &messages, 
-			               std::list<uint32_t> &timestamps) = 0;
+	virtual void createNewMessages(MIPRTPReceiveMessage *pRTPMsg, std::vector<MIPMediaMessage *> &messages, 
+			               std::vector<uint32_t> &timestamps) = 0;
+
+	/** Creates messages which conceal lost packets.
+	 *  When the MIPRTPDecoder detects that packets are missing from a source, this function is
+	 *  called before the messages for the next packet are created. A packet decoder which supports
+	 *  packet loss concealment can generate messages which ask the codec component to synthesize
+	 *  audio for the missing interval (see MIPEncodedAudioMessage::setConcealment), possibly using
+	 *  forward error correction data from the packet which did arrive. The default implementation 
+	 *  does not create any messages.
+	 *  \param pRTPMsg The message containing the first RTP packet that was received after the gap.
+	 *  \param numLost The number of packets that are missing.
+	 *  \param timestampsPerPacket The number of RTP timestamp units each packet covers.
+	 *  \param messages A vector in which the concealment messages should be stored, in playback order.
+	 *  \param timestamps A vector containing the RTP timestamp for each message in the
+	 *                    'messages' vector.
+	 */
+	virtual void createConcealmentMessages(MIPRTPReceiveMessage *pRTPMsg, int numLost, uint32_t timestampsPerPacket,
+	                                       std::vector<MIPMediaMessage *> &messages, std::vector<uint32_t> &timestamps)	{ }
 };
 
 #endif // MIPRTPPACKETDECODER_H
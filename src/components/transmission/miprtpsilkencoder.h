@@ -35,7 +35,7 @@
 #ifdef MIPCONFIG_SUPPORT_SILK
 
 #include "miprtpencoder.h"
-#include <list>
+#include <vector>
 
 class MIPRTPSendMessage;
 
@@ -64,8 +64,8 @@ private:
 
 	bool m_init;
 	int m_timestampsPerSecond;
-	std::list<MIPRTPSendMessage *> m_messages;
-	std::list<MIPRTPSendMessage *>::const_iterator m_msgIt;
+	std::vector<MIPRTPSendMessage *> m_messages;
+	std::vector<MIPRTPSendMessage *>::const_iterator m_msgIt;
 	int64_t m_prevIteration;
 };
 
@@ -63,8 +63,9 @@ bool MIPRTPVideoDecoder::validatePacket(const RTPPacket *pRTPPack, real_t &times
 	return true;
 }
 
-void MIPRTPVideoDecoder::createNewMessages(const RTPPacket *pRTPPack, std::list<MIPMediaMessage *> &messages, std::list<uint32_t> &timestamps)
+void MIPRTPVideoDecoder::createNewMessages(MIPRTPReceiveMessage *pRTPMsg, std::vector<MIPMediaMessage *> &messages, std::vector<uint32_t> &timestamps)
 {
+	const RTPPacket *pRTPPack = pRTPMsg->getPacket();
 	const uint8_t *pPayload = pRTPPack->GetPayloadData();
 	bool firstFramePart = true;
 
@@ -25,6 +25,8 @@
 #include "mipconfig.h"
 #include "miprtpvideoencoder.h"
 #include "miprtpmessage.h"
+#include "mipcomponentchain.h"
+#include "mipmessagearena.h"
 #include "miprawvideomessage.h"
 #include "mipencodedvideomessage.h"
 
@@ -155,7 +157,7 @@ bool MIPRTPVideoEncoder::push(const MIPComponentChain &chain, int64_t iteration,
 			else
 				partTSInc = tsInc;
 
-			uint8_t *pMsgData = new uint8_t [partSize];
+			uint8_t *pMsgData = chain.getMessageArena().allocateArray<uint8_t>(partSize);
 		
 			memcpy(pMsgData + extraBytes, pVideoData + offset, partSize-extraBytes);
 
@@ -178,7 +180,7 @@ bool MIPRTPVideoEncoder::push(const MIPComponentChain &chain, int64_t iteration,
 
 			MIPRTPSendMessage *pNewMsg;
 
-			pNewMsg = new MIPRTPSendMessage(pMsgData, partSize, payloadType, marker, partTSInc);
+			pNewMsg = chain.getMessageArena().createMessage<MIPRTPSendMessage>(pMsgData, partSize, payloadType, marker, partTSInc, false);
 			pNewMsg->setSamplingInstant(sampTime);
 
 			m_messages.push_back(pNewMsg);
@@ -232,10 +234,7 @@ void MIPRTPVideoEncoder::cleanUp()
 
 void MIPRTPVideoEncoder::clearMessages()
 {
-	std::list<MIPRTPSendMessage *>::iterator it;
-
-	for (it = m_messages.begin() ; it != m_messages.end() ; it++)
-		delete (*it);
+	// The messages themselves are stored in the chain's message arena
 	m_messages.clear();
 	m_msgIt = m_messages.begin();
 }
@@ -32,7 +32,7 @@
 
 #include "mipconfig.h"
 #include "miprtpencoder.h"
-#include <list>
+#include <vector>
 
 class MIPRTPSendMessage;
 
@@ -74,8 +74,8 @@ private:
 
 	bool m_init;
 	real_t m_frameRate;
-	std::list<MIPRTPSendMessage *> m_messages;
-	std::list<MIPRTPSendMessage *>::const_iterator m_msgIt;
+	std::vector<MIPRTPSendMessage *> m_messages;
+	std::vector<MIPRTPSendMessage *>::const_iterator m_msgIt;
 	int64_t m_prevIteration;
 
 	uint8_t m_encodingType;
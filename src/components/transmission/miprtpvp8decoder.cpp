@@ -0,0 +1,205 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+#include "mipconfig.h"
+#include "miprtpvp8decoder.h"
+#include "mipencodedvideomessage.h"
+#include "miprtpmessage.h"
+#include <jrtplib3/rtppacket.h>
+#include <string.h>
+
+#include "mipdebug.h"
+
+using namespace jrtplib;
+
+MIPRTPVP8Decoder::MIPRTPVP8Decoder()
+{
+}
+
+MIPRTPVP8Decoder::~MIPRTPVP8Decoder()
+{
+	for (auto it = m_packetGroupers.begin() ; it != m_packetGroupers.end() ; it++)
+		delete (*it).second;
+	m_packetGroupers.clear();
+}
+
+bool MIPRTPVP8Decoder::validatePacket(const RTPPacket *pRTPPack, real_t &timestampUnit, real_t timestampUnitEstimate)
+{
+	if (getDescriptorLength(pRTPPack->GetPayloadData(), (size_t)pRTPPack->GetPayloadLength()) == 0)
+		return false;
+
+	timestampUnit = 1.0/90000.0;
+	
+	return true;
+}
+
+void MIPRTPVP8Decoder::createNewMessages(MIPRTPReceiveMessage *pRTPMsg, std::vector<MIPMediaMessage *> &messages, std::vector<uint32_t> &timestamps)
+{
+	const RTPPacket *pRTPPack = pRTPMsg->getPacket();
+	const uint8_t *pPayload = pRTPPack->GetPayloadData();
+
+	// The S bit together with partition index 0 marks the start of a frame
+	bool firstFramePart = ((pPayload[0] & 0x1F) == 0x10);
+
+	expireGroupers();
+
+	uint32_t ssrc = pRTPPack->GetSSRC();
+	MIPRTPPacketGrouper *pGrouper = 0;
+
+	auto it = m_packetGroupers.find(ssrc);
+	if (it == m_packetGroupers.end()) // no entry exists yet
+	{
+		pGrouper = new MIPRTPPacketGrouper();
+
+		if (!pGrouper->init(ssrc))
+		{
+			// TODO: report error somehow?
+			delete pGrouper;
+			return;
+		}
+
+		m_packetGroupers[ssrc] = new PacketGrouper(pGrouper);
+	}
+	else
+		pGrouper = (*it).second->getGrouper();
+
+	if (!pGrouper->processPacket(pRTPPack, firstFramePart)) // TODO: error reporting?
+		return;
+
+	bool done = false;
+
+	while (!done)
+	{
+		std::vector<uint8_t *> parts;
+		std::vector<size_t> sizes;
+		uint32_t timestamp;
+
+		pGrouper->getNextQueuedPacket(parts, sizes, timestamp);
+
+		if (parts.size() == 0)
+			done = true;
+		else
+		{
+			size_t totalSize = 0;
+			bool valid = ((parts[0][0] & 0x1F) == 0x10); // we need the start of the frame
+
+			for (size_t i = 0 ; valid && i < parts.size() ; i++)
+			{
+				size_t descLen = getDescriptorLength(parts[i], sizes[i]);
+
+				if (descLen == 0) // shouldn't happen, was validated
+					valid = false;
+				else
+					totalSize += sizes[i] - descLen;
+			}
+
+			if (valid)
+			{
+				uint8_t *pData = new uint8_t [totalSize];
+				size_t offset = 0;
+
+				for (size_t i = 0 ; i < parts.size() ; i++)
+				{
+					size_t descLen = getDescriptorLength(parts[i], sizes[i]);
+
+					memcpy(pData + offset, parts[i] + descLen, sizes[i] - descLen);
+					offset += sizes[i] - descLen;
+				}
+
+				MIPEncodedVideoMessage *pVidMsg = new MIPEncodedVideoMessage(MIPENCODEDVIDEOMESSAGE_TYPE_VP8, 0, 0, pData, totalSize, true);
+			
+				messages.push_back(pVidMsg);
+				timestamps.push_back(timestamp);
+			}
+
+			for (size_t i = 0 ; i < parts.size() ; i++)
+				delete [] parts[i];
+		}
+	}
+}
+
+size_t MIPRTPVP8Decoder::getDescriptorLength(const uint8_t *pPayload, size_t length)
+{
+	// Returns the length of the VP8 payload descriptor from RFC 7741, or zero
+	// if the descriptor is invalid or isn't followed by any VP8 data
+
+	if (length < 1)
+		return 0;
+
+	size_t pos = 1;
+
+	if (pPayload[0] & 0x80) // X bit, an extension byte follows
+	{
+		if (length < 2)
+			return 0;
+
+		uint8_t ext = pPayload[1];
+
+		pos = 2;
+		if (ext & 0x80) // I bit: picture ID, 7 or 15 bits depending on the M bit
+		{
+			if (pos >= length)
+				return 0;
+			pos += (pPayload[pos] & 0x80)?2:1;
+		}
+		if (ext & 0x40) // L bit: TL0PICIDX
+			pos++;
+		if (ext & 0x30) // T or K bit: TID/Y/KEYIDX
+			pos++;
+	}
+
+	if (pos >= length)
+		return 0;
+
+	return pos;
+}
+
+void MIPRTPVP8Decoder::expireGroupers()
+{
+	MIPTime curTime = MIPTime::getCurrentTime();
+	if ((curTime.getValue() - m_lastCheckTime.getValue()) < 10.0)
+		return;
+
+	m_lastCheckTime = curTime;
+
+	auto it = m_packetGroupers.begin(); 
+
+	while (it != m_packetGroupers.end())
+	{
+		PacketGrouper *pPackGroup = (*it).second;
+
+		if (curTime.getValue() - pPackGroup->getLastAccessTime().getValue() > 10.0) // TODO: make this configurable?
+		{
+			auto it2 = it;
+
+			it++;
+
+			delete (*it2).second;
+			m_packetGroupers.erase(it2);
+		}
+		else
+			it++;
+	}
+}
+
@@ -0,0 +1,134 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+#include "mipconfig.h"
+#include "miprtpvp8encoder.h"
+#include "miprtpmessage.h"
+#include "mipencodedvideomessage.h"
+#include <string.h>
+
+#include "mipdebug.h"
+
+#define MIPRTPVP8ENCODER_ERRSTR_BADMESSAGE		"Can't understand message"
+#define MIPRTPVP8ENCODER_ERRSTR_NOTINIT			"RTP encoder not initialized"
+#define MIPRTPVP8ENCODER_ERRSTR_BADPAYLOADSIZE		"The maximum RTP payload size should be at least 128"
+
+#define MIPRTPVP8ENCODER_DESCRIPTORSIZE			4
+
+MIPRTPVP8Encoder::MIPRTPVP8Encoder() : MIPRTPEncoder("MIPRTPVP8Encoder")
+{
+	m_init = false;
+}
+
+MIPRTPVP8Encoder::~MIPRTPVP8Encoder()
+{
+	cleanUp();
+}
+
+bool MIPRTPVP8Encoder::init(real_t frameRate, size_t maxPayloadSize)
+{
+	if (maxPayloadSize < 128)
+	{
+		setErrorString(MIPRTPVP8ENCODER_ERRSTR_BADPAYLOADSIZE);
+		return false;
+	}
+
+	if (m_init)
+		cleanUp();
+
+	// We'll use a timestamp unit of 1.0/90000.0
+
+	m_tsInc = (uint32_t)((90000.0/frameRate)+0.5);
+	m_maxPayloadSize = maxPayloadSize;
+	m_pictureID = 0;
+
+	MIPOutputMessageQueue::init();
+
+	m_init = true;
+	return true;
+}
+
+bool MIPRTPVP8Encoder::push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg)
+{
+	if (!m_init)
+	{
+		setErrorString(MIPRTPVP8ENCODER_ERRSTR_NOTINIT);
+		return false;
+	}
+
+	checkIteration(iteration);
+
+	if (!(pMsg->getMessageType() == MIPMESSAGE_TYPE_VIDEO_ENCODED && pMsg->getMessageSubtype() == MIPENCODEDVIDEOMESSAGE_TYPE_VP8))
+	{
+		setErrorString(MIPRTPVP8ENCODER_ERRSTR_BADMESSAGE);
+		return false;
+	}
+
+	MIPEncodedVideoMessage *pVidMsg = (MIPEncodedVideoMessage *)pMsg;
+	const uint8_t *pFrame = pVidMsg->getImageData();
+	size_t frameSize = pVidMsg->getDataLength();
+	size_t maxPartSize = m_maxPayloadSize - MIPRTPVP8ENCODER_DESCRIPTORSIZE;
+	size_t offset = 0;
+
+	while (offset < frameSize)
+	{
+		size_t partSize = frameSize - offset;
+		bool marker = true;
+
+		if (partSize > maxPartSize)
+		{
+			partSize = maxPartSize;
+			marker = false;
+		}
+
+		uint8_t *pPayload = allocateOutputData<uint8_t>(chain, partSize + MIPRTPVP8ENCODER_DESCRIPTORSIZE);
+
+		// VP8 payload descriptor: X bit and, for the first packet, the S bit with
+		// partition index 0, followed by the extension byte with the I bit and the
+		// 15 bit picture ID (M bit set)
+
+		pPayload[0] = (offset == 0)?0x90:0x80;
+		pPayload[1] = 0x80;
+		pPayload[2] = 0x80 | (uint8_t)((m_pictureID >> 8) & 0x7F);
+		pPayload[3] = (uint8_t)(m_pictureID & 0xFF);
+		memcpy(pPayload + MIPRTPVP8ENCODER_DESCRIPTORSIZE, pFrame + offset, partSize);
+
+		MIPRTPSendMessage *pNewMsg = createOutputMessage<MIPRTPSendMessage>(chain, pPayload, partSize + MIPRTPVP8ENCODER_DESCRIPTORSIZE, 
+		                                                                    getPayloadType(), marker, (marker)?m_tsInc:0, false);
+		pNewMsg->setSamplingInstant(pVidMsg->getTime());
+
+		offset += partSize;
+	}
+
+	m_pictureID = (m_pictureID + 1) & 0x7FFF;
+
+	return true;
+}
+
+void MIPRTPVP8Encoder::cleanUp()
+{
+	clearMessages();
+	m_init = false;
+}
+
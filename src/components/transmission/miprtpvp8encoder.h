@@ -0,0 +1,68 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+/**
+ * \file miprtpvp8encoder.h
+ */
+
+#ifndef MIPRTPVP8ENCODER_H
+
+#define MIPRTPVP8ENCODER_H
+
+#include "mipconfig.h"
+#include "miprtpencoder.h"
+
+/** Creates RTP packets for incoming video packets in VP8 encoded format.
+ *  This component accepts incoming video packets using VP8 compression and 
+ *  generates MIPRTPSendMessage objects which can then be transferred to a
+ *  MIPRTPComponent instance. The payload format is the one from RFC 7741: each
+ *  packet starts with a VP8 payload descriptor containing a 15 bit picture ID,
+ *  and the marker bit is set on the last packet of each video frame.
+ */
+class EMIPLIB_IMPORTEXPORT MIPRTPVP8Encoder : public MIPRTPEncoder
+{
+public:
+	MIPRTPVP8Encoder();
+	~MIPRTPVP8Encoder();
+
+	/** Initializes the encoder. 
+	 *  Initializes the encoder.
+	 *  \param frameRate Frame rate of incoming video frames. 
+	 *  \param maxPayloadSize Maximum length the payload of an RTP packet can have
+	 */
+	bool init(real_t frameRate, size_t maxPayloadSize);
+
+	bool push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg);
+	// pull is provided by MIPOutputMessageQueue
+private:
+	void cleanUp();
+
+	bool m_init;
+	size_t m_maxPayloadSize;
+	uint32_t m_tsInc;
+	uint16_t m_pictureID;
+};
+
+#endif // MIPRTPVP8ENCODER_H
+
@@ -80,7 +80,7 @@ bool MIPOutputMessageQueue::pull(const MIPComponentChain &chain, int64_t iterati
 
 void MIPOutputMessageQueue::clearMessages()
 {
-	std::list<std::pair<MIPMessage *, bool > >::iterator it;
+	std::vector<std::pair<MIPMessage *, bool > >::iterator it;
 
 	for (it = m_messages.begin() ; it != m_messages.end() ; it++)
 	{
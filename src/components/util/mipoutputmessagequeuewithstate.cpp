@@ -104,7 +104,7 @@ bool MIPOutputMessageQueueWithState::pull(const MIPComponentChain &chain, int64_
 
 void MIPOutputMessageQueueWithState::clearMessages()
 {
-	std::list<std::pair<MIPMessage *, bool > >::iterator it;
+	std::vector<std::pair<MIPMessage *, bool > >::iterator it;
 
 	for (it = m_messages.begin() ; it != m_messages.end() ; it++)
 	{
@@ -32,9 +32,12 @@
 
 #include "mipconfig.h"
 #include "mipcomponent.h"
+#include "mipcomponentchain.h"
+#include "mipmessagearena.h"
 #include "miptime.h"
 #include <unordered_map>
-#include <list>
+#include <vector>
+#include <utility>
 
 class MIPMessage;
 
@@ -103,6 +106,23 @@ protected:
 	 *  iteration. */
 	void addToOutputQueue(MIPMessage *pMsg, bool deleteMessage);
 
+	/** Creates an output message in the message arena of \c chain and adds it to the output queue.
+	 *  Creates an output message of type \c T in the message arena of \c chain (see
+	 *  MIPMessageArena), passing \c args to its constructor, and adds it to the output queue.
+	 *  The message is destroyed automatically when the chain starts its next iteration.
+	 */
+	template<class T, class... Args>
+	T *createOutputMessage(const MIPComponentChain &chain, Args&&... args)
+	{
+		T *pMsg = chain.getMessageArena().createMessage<T>(std::forward<Args>(args)...);
+		addToOutputQueue(pMsg, false);
+		return pMsg;
+	}
+
+	/** Returns room for \c num elements of type \c T in the message arena of \c chain, to store the data of an output message. */
+	template<class T>
+	T *allocateOutputData(const MIPComponentChain &chain, size_t num)			{ return chain.getMessageArena().allocateArray<T>(num); }
+
 	/** Look for the state information for the source with the specified ID,
 	 *  returning NULL if no state for this ID exists yet. 
 	 *  Look for the state information for the source with the specified ID,
@@ -125,8 +145,8 @@ private:
 	bool pull(const MIPComponentChain &chain, int64_t iteration, MIPMessage **pMsg);
 	void expire();
 
-	std::list<std::pair<MIPMessage *, bool> > m_messages;
-	std::list<std::pair<MIPMessage *, bool> >::const_iterator m_msgIt;
+	std::vector<std::pair<MIPMessage *, bool> > m_messages;
+	std::vector<std::pair<MIPMessage *, bool> >::const_iterator m_msgIt;
 	int64_t m_prevIteration;
 
 	double m_expirationDelay;
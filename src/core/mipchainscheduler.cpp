@@ -0,0 +1,355 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+#include "mipconfig.h"
+#include "mipchainscheduler.h"
+#include "mipcomponentchain.h"
+#include <algorithm>
+
+#include "mipdebug.h"
+
+#define MIPCHAINSCHEDULER_ERRSTR_ALREADYINIT			"Already initialized"
+#define MIPCHAINSCHEDULER_ERRSTR_NOTINIT			"Not initialized"
+#define MIPCHAINSCHEDULER_ERRSTR_BADWORKERCOUNT			"The number of worker threads must be at least one"
+#define MIPCHAINSCHEDULER_ERRSTR_BADTICKINTERVAL		"The tick interval must be positive"
+#define MIPCHAINSCHEDULER_ERRSTR_BADNUMSLOTS			"The timer wheel must have at least one slot"
+#define MIPCHAINSCHEDULER_ERRSTR_CANTSTARTTHREADS		"Unable to start the scheduler threads"
+#define MIPCHAINSCHEDULER_ERRSTR_CHAINSREGISTERED		"Some chains are still registered with the scheduler"
+#define MIPCHAINSCHEDULER_ERRSTR_ALREADYREGISTERED		"The chain is already registered with the scheduler"
+
+MIPChainScheduler::MIPChainScheduler() : m_startTime(0)
+{
+	m_currentTick = 0;
+	m_tickNanoSeconds = 0;
+	m_stopThreads = false;
+	m_pTimerThread = 0;
+	m_init = false;
+}
+
+MIPChainScheduler::~MIPChainScheduler()
+{
+	if (!m_init)
+		return;
+
+	// Chains should have been stopped already, but we can't leave the threads running
+	stopThreads();
+
+	std::map<MIPComponentChain *, ChainEntry *>::iterator it;
+
+	for (it = m_chains.begin() ; it != m_chains.end() ; it++)
+		delete it->second;
+	m_chains.clear();
+}
+
+bool MIPChainScheduler::init(int numWorkers, MIPTime tickInterval, int numSlots)
+{
+	if (m_init)
+	{
+		setErrorString(MIPCHAINSCHEDULER_ERRSTR_ALREADYINIT);
+		return false;
+	}
+
+	if (numWorkers < 1)
+	{
+		setErrorString(MIPCHAINSCHEDULER_ERRSTR_BADWORKERCOUNT);
+		return false;
+	}
+
+	if (tickInterval.getNanoSeconds() <= 0)
+	{
+		setErrorString(MIPCHAINSCHEDULER_ERRSTR_BADTICKINTERVAL);
+		return false;
+	}
+
+	if (numSlots < 1)
+	{
+		setErrorString(MIPCHAINSCHEDULER_ERRSTR_BADNUMSLOTS);
+		return false;
+	}
+
+	m_wheel.clear();
+	m_wheel.resize(numSlots);
+	m_readyChains.clear();
+	m_currentTick = 0;
+	m_startTime = MIPTime::getCurrentTime();
+	m_tickNanoSeconds = tickInterval.getNanoSeconds();
+	m_stopThreads = false;
+
+	m_pTimerThread = new SchedulerThread(*this, true);
+	if (m_pTimerThread->Start() < 0)
+	{
+		stopThreads();
+		setErrorString(MIPCHAINSCHEDULER_ERRSTR_CANTSTARTTHREADS);
+		return false;
+	}
+
+	for (int i = 0 ; i < numWorkers ; i++)
+	{
+		SchedulerThread *pWorker = new SchedulerThread(*this, false);
+
+		m_workers.push_back(pWorker);
+		if (pWorker->Start() < 0)
+		{
+			stopThreads();
+			setErrorString(MIPCHAINSCHEDULER_ERRSTR_CANTSTARTTHREADS);
+			return false;
+		}
+	}
+
+	m_init = true;
+	return true;
+}
+
+bool MIPChainScheduler::destroy()
+{
+	if (!m_init)
+	{
+		setErrorString(MIPCHAINSCHEDULER_ERRSTR_NOTINIT);
+		return false;
+	}
+
+	if (getNumberOfChains() != 0)
+	{
+		setErrorString(MIPCHAINSCHEDULER_ERRSTR_CHAINSREGISTERED);
+		return false;
+	}
+
+	stopThreads();
+	m_wheel.clear();
+	m_readyChains.clear();
+	m_init = false;
+	return true;
+}
+
+int MIPChainScheduler::getNumberOfChains() const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	return (int)m_chains.size();
+}
+
+bool MIPChainScheduler::addChain(MIPComponentChain *pChain, MIPTime wakeUpTime)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	if (!m_init)
+	{
+		setErrorString(MIPCHAINSCHEDULER_ERRSTR_NOTINIT);
+		return false;
+	}
+
+	if (m_chains.find(pChain) != m_chains.end())
+	{
+		setErrorString(MIPCHAINSCHEDULER_ERRSTR_ALREADYREGISTERED);
+		return false;
+	}
+
+	ChainEntry *pEntry = new ChainEntry(pChain);
+
+	m_chains[pChain] = pEntry;
+	scheduleEntry(pEntry, wakeUpTime);
+	return true;
+}
+
+void MIPChainScheduler::removeChain(MIPComponentChain *pChain)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	std::map<MIPComponentChain *, ChainEntry *>::iterator it = m_chains.find(pChain);
+
+	if (it == m_chains.end()) // already removed by a worker thread after an error
+		return;
+
+	ChainEntry *pEntry = it->second;
+
+	// A worker thread that's processing the chain will not schedule it again 
+	pEntry->m_removeRequested = true;
+	while (pEntry->m_running)
+		m_idleCondition.wait(lock);
+
+	unscheduleEntry(pEntry);
+	m_chains.erase(pChain);
+	delete pEntry;
+}
+
+void MIPChainScheduler::scheduleEntry(ChainEntry *pEntry, MIPTime wakeUpTime)
+{
+	// The tick is rounded up, so the chain is never processed before its wake-up time
+	// and the timing component at its start doesn't need to wait anymore
+
+	int64_t offset = wakeUpTime.getNanoSeconds() - m_startTime.getNanoSeconds();
+	int64_t tick = (offset <= 0)?0:((offset + m_tickNanoSeconds - 1)/m_tickNanoSeconds);
+
+	pEntry->m_wakeUpTick = tick;
+	if (tick <= m_currentTick)
+	{
+		m_readyChains.push_back(pEntry);
+		m_readyCondition.notify_one();
+	}
+	else
+		m_wheel[(size_t)(tick % (int64_t)m_wheel.size())].push_back(pEntry);
+}
+
+void MIPChainScheduler::unscheduleEntry(ChainEntry *pEntry)
+{
+	std::vector<ChainEntry *> &slot = m_wheel[(size_t)(pEntry->m_wakeUpTick % (int64_t)m_wheel.size())];
+	std::vector<ChainEntry *>::iterator it = std::find(slot.begin(), slot.end(), pEntry);
+
+	if (it != slot.end())
+		slot.erase(it);
+
+	std::deque<ChainEntry *>::iterator it2 = std::find(m_readyChains.begin(), m_readyChains.end(), pEntry);
+
+	if (it2 != m_readyChains.end())
+		m_readyChains.erase(it2);
+}
+
+void MIPChainScheduler::timerLoop()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	int64_t numSlots = (int64_t)m_wheel.size();
+
+	while (!m_stopThreads)
+	{
+		MIPTime nextTick = MIPTime::fromNanoSeconds(m_startTime.getNanoSeconds() + (m_currentTick+1)*m_tickNanoSeconds);
+
+		lock.unlock();
+		MIPTime::waitUntil(nextTick);
+		lock.lock();
+
+		int64_t tick = (MIPTime::getCurrentTime().getNanoSeconds() - m_startTime.getNanoSeconds())/m_tickNanoSeconds;
+		int64_t firstTick = m_currentTick+1;
+		bool gotReadyChains = false;
+
+		// If the thread was delayed for more than a full turn of the wheel,
+		// each slot only needs to be inspected once
+		if (tick - firstTick >= numSlots)
+			firstTick = tick - numSlots + 1;
+
+		for (int64_t t = firstTick ; t <= tick ; t++)
+		{
+			std::vector<ChainEntry *> &slot = m_wheel[(size_t)(t % numSlots)];
+			size_t i = 0;
+
+			// Entries in this slot which are due in a later turn of the wheel are kept
+			while (i < slot.size())
+			{
+				if (slot[i]->m_wakeUpTick <= tick)
+				{
+					m_readyChains.push_back(slot[i]);
+					slot[i] = slot.back();
+					slot.pop_back();
+					gotReadyChains = true;
+				}
+				else
+					i++;
+			}
+		}
+
+		if (tick > m_currentTick)
+			m_currentTick = tick;
+		if (gotReadyChains)
+			m_readyCondition.notify_all();
+	}
+}
+
+void MIPChainScheduler::workerLoop()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	while (!m_stopThreads)
+	{
+		if (m_readyChains.empty())
+		{
+			m_readyCondition.wait(lock);
+			continue;
+		}
+
+		ChainEntry *pEntry = m_readyChains.front();
+		MIPComponentChain *pChain = pEntry->m_pChain;
+		MIPTime wakeUpTime(0);
+
+		m_readyChains.pop_front();
+		pEntry->m_running = true;
+
+		lock.unlock();
+		bool keep = pChain->runScheduledIteration(&wakeUpTime);
+		if (!keep) // the chain was stopped or an error occurred
+			pChain->finishScheduledRun();
+		lock.lock();
+
+		pEntry->m_running = false;
+		
+		if (pEntry->m_removeRequested) // removeChain takes care of the rest
+			m_idleCondition.notify_all();
+		else if (keep)
+			scheduleEntry(pEntry, wakeUpTime);
+		else
+		{
+			m_chains.erase(pChain);
+			delete pEntry;
+		}
+	}
+}
+
+void MIPChainScheduler::stopThreads()
+{
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		m_stopThreads = true;
+		m_readyCondition.notify_all();
+	}
+
+	std::vector<SchedulerThread *> threads = m_workers;
+
+	if (m_pTimerThread)
+		threads.push_back(m_pTimerThread);
+
+	for (size_t i = 0 ; i < threads.size() ; i++)
+	{
+		SchedulerThread *pThread = threads[i];
+		MIPTime curTime = MIPTime::getCurrentTime();
+		
+		while (pThread->IsRunning() && (MIPTime::getCurrentTime().getValue() - curTime.getValue()) < 5.0) // wait maximum five seconds
+			MIPTime::wait(MIPTime(0.010));
+
+		if (pThread->IsRunning())
+			pThread->Kill();
+
+		delete pThread;
+	}
+	m_workers.clear();
+	m_pTimerThread = 0;
+}
+
+void *MIPChainScheduler::SchedulerThread::Thread()
+{
+	JThread::ThreadStarted();
+
+	if (m_timer)
+		m_scheduler.timerLoop();
+	else
+		m_scheduler.workerLoop();
+	return 0;
+}
+
@@ -0,0 +1,136 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+/**
+ * \file mipchainscheduler.h
+ */
+
+#ifndef MIPCHAINSCHEDULER_H
+
+#define MIPCHAINSCHEDULER_H
+
+#include "mipconfig.h"
+#include "miperrorbase.h"
+#include "miptime.h"
+#include <jthread/jthread.h>
+#include <vector>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+
+class MIPComponentChain;
+
+#define MIPCHAINSCHEDULER_DEFAULTNUMSLOTS				256
+
+/** Runs many component chains using a fixed number of threads.
+ *  Normally, each MIPComponentChain has its own background thread, which spends most of its
+ *  time waiting in the timing component at the start of the chain. When a large number of
+ *  chains is needed, e.g. in a server which handles many sessions, these threads cause a lot 
+ *  of overhead. A chain for which MIPComponentChain::setScheduler was called is not given its
+ *  own thread when started, but is registered with a scheduler instead. The scheduler asks the
+ *  start component of the chain when the next iteration is due (see MIPComponent::getWakeUpTime) 
+ *  and stores the chain in a timer wheel. A single timer thread advances the wheel and hands 
+ *  the chains that are due to a pool of worker threads, which process one iteration of the
+ *  chain each time.
+ *
+ *  The start component of such a chain must implement MIPComponent::getWakeUpTime, as 
+ *  MIPAverageTimer does. Chains which are driven by a sound card or another event source should
+ *  keep using their own thread. All chains which use the scheduler must be stopped before the 
+ *  scheduler is destroyed.
+ */
+class EMIPLIB_IMPORTEXPORT MIPChainScheduler : public MIPErrorBase
+{
+public:
+	MIPChainScheduler();
+	~MIPChainScheduler();
+
+	/** Starts the timer thread and the worker threads.
+	 *  Starts the timer thread and the worker threads.
+	 *  \param numWorkers The number of threads which process the chains.
+	 *  \param tickInterval The resolution of the timer wheel: a chain is processed at most
+	 *                      this amount of time after its wake-up time.
+	 *  \param numSlots The number of slots in the timer wheel.
+	 */
+	bool init(int numWorkers, MIPTime tickInterval = MIPTime(0.001), int numSlots = MIPCHAINSCHEDULER_DEFAULTNUMSLOTS);
+
+	/** Stops the threads; this fails if chains are still registered. */
+	bool destroy();
+
+	/** Returns the number of worker threads. */
+	int getNumberOfWorkers() const									{ return (int)m_workers.size(); }
+
+	/** Returns the number of chains which are currently registered. */
+	int getNumberOfChains() const;
+private:
+	class ChainEntry
+	{
+	public:
+		ChainEntry(MIPComponentChain *pChain)							{ m_pChain = pChain; m_wakeUpTick = 0; m_running = false; m_removeRequested = false; }
+
+		MIPComponentChain *m_pChain;
+		int64_t m_wakeUpTick;
+		bool m_running;
+		bool m_removeRequested;
+	};
+
+	class SchedulerThread : public jthread::JThread
+	{
+	public:
+		SchedulerThread(MIPChainScheduler &scheduler, bool timer) : m_scheduler(scheduler)	{ m_timer = timer; }
+		void *Thread();
+	private:
+		MIPChainScheduler &m_scheduler;
+		bool m_timer;
+	};
+
+	friend class MIPComponentChain;
+
+	bool addChain(MIPComponentChain *pChain, MIPTime wakeUpTime);
+	void removeChain(MIPComponentChain *pChain);
+
+	void timerLoop();
+	void workerLoop();
+	void scheduleEntry(ChainEntry *pEntry, MIPTime wakeUpTime);
+	void unscheduleEntry(ChainEntry *pEntry);
+	void stopThreads();
+
+	mutable std::mutex m_mutex;
+	std::condition_variable m_readyCondition;
+	std::condition_variable m_idleCondition;
+	std::vector<std::vector<ChainEntry *> > m_wheel;
+	std::deque<ChainEntry *> m_readyChains;
+	std::map<MIPComponentChain *, ChainEntry *> m_chains;
+	int64_t m_currentTick;
+	MIPTime m_startTime;
+	int64_t m_tickNanoSeconds;
+	bool m_stopThreads;
+
+	SchedulerThread *m_pTimerThread;
+	std::vector<SchedulerThread *> m_workers;
+	bool m_init;
+};
+
+#endif // MIPCHAINSCHEDULER_H
+
@@ -39,6 +39,7 @@
 class MIPComponentChain;
 class MIPMessage;
 class MIPFeedback;
+class MIPTime;
 
 /** Base class of a component which can be placed in a component chain.
  *  This class serves as a base class from which actual components can be derived. A working component
@@ -104,6 +105,17 @@ public:
 	 */
 	virtual bool processFeedback(const MIPComponentChain &chain, int64_t feedbackChainID, MIPFeedback *feedback)			
 													{ return true; }
+	/** Returns the time at which the chain can process the given iteration.
+	 *  A timing component which is used as the start of a chain that is run by a MIPChainScheduler
+	 *  must implement this function. It should store in \c pWakeUpTime the moment (as returned by
+	 *  MIPTime::getCurrentTime) from which the MIPSYSTEMMESSAGE_TYPE_WAITTIME message for iteration
+	 *  \c iteration can be handled without waiting. The scheduler only processes the chain at that
+	 *  moment, so no thread needs to be blocked in the meantime. The default implementation returns
+	 *  false, which means that the component can only start a chain which has its own thread.
+	 */
+	virtual bool getWakeUpTime(const MIPComponentChain &chain, int64_t iteration, MIPTime *pWakeUpTime)
+													{ return false; }
+
 	/** Returns the name of the component.
 	 *  This function returns the name of the component, as it was specified in the constructor.
 	 */
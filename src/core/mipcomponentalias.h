@@ -161,6 +161,7 @@ public:
 	bool push(const MIPComponentChain &chain, int64_t iteration, MIPMessage *pMsg)				{ bool status = m_pComponent->push(chain, iteration, pMsg); if (!status) setErrorString(m_pComponent->getErrorString()); return status; }
 	bool pull(const MIPComponentChain &chain, int64_t iteration, MIPMessage **pMsg)				{ bool status = m_pComponent->pull(chain, iteration, pMsg); if (!status) setErrorString(m_pComponent->getErrorString()); return status; }
 	bool processFeedback(const MIPComponentChain &chain, int64_t feedbackChainID, MIPFeedback *feedback)	{ bool status = m_pComponent->processFeedback(chain, feedbackChainID, feedback); if (!status) setErrorString(m_pComponent->getErrorString()); return status; }
+	bool getWakeUpTime(const MIPComponentChain &chain, int64_t iteration, MIPTime *pWakeUpTime)		{ return m_pComponent->getWakeUpTime(chain, iteration, pWakeUpTime); }
 
 	const MIPComponent *getComponentPointer() const								{ return m_pComponent; }
 private:
@@ -28,8 +28,13 @@
 #include "mipcomponent.h"
 #include "miptime.h"
 #include "mipfeedback.h"
+#include "mipchainscheduler.h"
+#include "mipmessagearena.h"
 #include <cstdlib>
 #include <iostream>
+#include <map>
+#include <set>
+#include <algorithm>
 
 #include "mipdebug.h"
 
@@ -45,6 +50,10 @@
 #define MIPCOMPONENTCHAIN_ERRSTR_UNUSEDCONNECTION	"Detected an unused connection"
 #define MIPCOMPONENTCHAIN_ERRSTR_CANTMERGEFEEDBACK	"Can't merge multiple feedback chains"
 #define MIPCOMPONENTCHAIN_ERRSTR_CONNECTIONNOTFOUND	"Connection not found"
+#define MIPCOMPONENTCHAIN_ERRSTR_BADTHREADCOUNT		"The number of threads must be at least one"
+#define MIPCOMPONENTCHAIN_ERRSTR_CANTSTARTWORKERS	"Can't start worker threads"
+#define MIPCOMPONENTCHAIN_ERRSTR_NOWAKEUPTIME		"The start component can't be used in a chain that is run by a scheduler"
+#define MIPCOMPONENTCHAIN_ERRSTR_CANTREGISTER		"Can't register the chain with the scheduler: "
 
 MIPComponentChain::MIPComponentChain(const std::string &chainName)
 {
@@ -68,16 +77,31 @@ MIPComponentChain::MIPComponentChain(const std::string &chainName)
 	m_chainName = chainName;
 	m_pInputChainStart = 0;
 	m_pInternalChainStart = 0;
+	m_numConnections = 0;
+	m_numThreads = 1;
+	m_stopWorkers = false;
+	m_schedIteration = 0;
+	m_nodesLeft = 0;
+	m_nodesRunning = 0;
+	m_schedError = false;
+	m_pScheduler = 0;
+	m_pMessageArena = new MIPMessageArena();
+	m_scheduledRunning = false;
+	m_scheduledExitHandled = true;
+	m_scheduledError = false;
+	m_scheduledIteration = 0;
 }
 
 MIPComponentChain::~MIPComponentChain()
 {
 	stop();
+	stopWorkers();
+	delete m_pMessageArena;
 }
 
 bool MIPComponentChain::start()
 {
-	if (JThread::IsRunning())
+	if (isRunning())
 	{
 		setErrorString(MIPCOMPONENTCHAIN_ERRSTR_THREADRUNNING);
 		return false;
@@ -89,19 +113,56 @@ bool MIPComponentChain::start()
 		return false;
 	}
 
-	std::list<MIPConnection> orderedList;
-	std::list<MIPComponent *> feedbackChain;
-	
-	if (!orderConnections(orderedList))
-		return false;
-	if (!buildFeedbackList(orderedList, feedbackChain))
+	if (!buildConnectionInfo())
 		return false;
 
-	copyConnectionInfo(orderedList, feedbackChain);
+	if (!startWorkers())
+	{
+		setErrorString(MIPCOMPONENTCHAIN_ERRSTR_CANTSTARTWORKERS);
+		return false;
+	}
 
 	m_stopLoop = false;
+
+	if (m_pScheduler)
+	{
+		MIPTime wakeUpTime(0);
+
+		m_pInternalChainStart->lock();
+		bool ok = m_pInternalChainStart->getWakeUpTime(*this, 1, &wakeUpTime);
+		m_pInternalChainStart->unlock();
+
+		if (!ok)
+		{
+			stopWorkers();
+			setErrorString(MIPCOMPONENTCHAIN_ERRSTR_NOWAKEUPTIME);
+			return false;
+		}
+
+		m_loopMutex.Lock();
+		m_scheduledRunning = true;
+		m_scheduledExitHandled = false;
+		m_scheduledError = false;
+		m_scheduledIteration = 1;
+		m_loopMutex.Unlock();
+
+		if (!m_pScheduler->addChain(this, wakeUpTime))
+		{
+			m_loopMutex.Lock();
+			m_scheduledRunning = false;
+			m_scheduledExitHandled = true;
+			m_loopMutex.Unlock();
+
+			stopWorkers();
+			setErrorString(std::string(MIPCOMPONENTCHAIN_ERRSTR_CANTREGISTER) + m_pScheduler->getErrorString());
+			return false;
+		}
+		return true;
+	}
+
 	if (JThread::Start() < 0)
 	{
+		stopWorkers();
 		setErrorString(MIPCOMPONENTCHAIN_ERRSTR_CANTSTARTTHREAD);
 		return false;
 	}
@@ -110,7 +171,7 @@ bool MIPComponentChain::start()
 
 bool MIPComponentChain::stop()
 {
-	if (!JThread::IsRunning())
+	if (!isRunning())
 	{
 		setErrorString(MIPCOMPONENTCHAIN_ERRSTR_THREADNOTRUNNING);
 		return false;
@@ -119,6 +180,15 @@ bool MIPComponentChain::stop()
 	m_loopMutex.Lock();
 	m_stopLoop = true;
 	m_loopMutex.Unlock();
+
+	if (m_pScheduler)
+	{
+		// This waits until an iteration that's being processed has finished
+		m_pScheduler->removeChain(this);
+		finishScheduledRun();
+		stopWorkers();
+		return true;
+	}
 	
 	MIPTime curTime = MIPTime::getCurrentTime();
 	while (JThread::IsRunning() && (MIPTime::getCurrentTime().getValue() - curTime.getValue()) < 5.0) // wait maximum five seconds
@@ -128,13 +198,15 @@ bool MIPComponentChain::stop()
 
 	if (JThread::IsRunning())
 		JThread::Kill();
+
+	stopWorkers();
 	
 	return true;
 }
 
 bool MIPComponentChain::rebuild()
 {
-	if (!JThread::IsRunning())
+	if (!isRunning())
 	{
 		setErrorString(MIPCOMPONENTCHAIN_ERRSTR_THREADNOTRUNNING);
 		return false;
@@ -146,22 +218,43 @@ bool MIPComponentChain::rebuild()
 		return false;
 	}
 
-	std::list<MIPConnection> orderedList;
-	std::list<MIPComponent *> feedbackChain;
-	
-	if (!orderConnections(orderedList))
+	return buildConnectionInfo();
+}
+
+bool MIPComponentChain::setNumberOfThreads(int numThreads)
+{
+	if (isRunning())
+	{
+		setErrorString(MIPCOMPONENTCHAIN_ERRSTR_THREADRUNNING);
 		return false;
-	if (!buildFeedbackList(orderedList, feedbackChain))
+	}
+
+	if (numThreads < 1)
+	{
+		setErrorString(MIPCOMPONENTCHAIN_ERRSTR_BADTHREADCOUNT);
 		return false;
+	}
 
-	copyConnectionInfo(orderedList, feedbackChain);
-	
+	m_numThreads = numThreads;
+	return true;
+}
+
+bool MIPComponentChain::setScheduler(MIPChainScheduler *pScheduler)
+{
+	if (isRunning())
+	{
+		setErrorString(MIPCOMPONENTCHAIN_ERRSTR_THREADRUNNING);
+		return false;
+	}
+
+	m_pScheduler = pScheduler;
 	return true;
 }
 
 bool MIPComponentChain::clearChain()
 {
-	m_inputConnections.clear();
+	m_outgoingConnections.clear();
+	m_numConnections = 0;
 	m_pInputChainStart = 0;
 	return true;
 }
@@ -186,7 +279,8 @@ bool MIPComponentChain::addConnection(MIPComponent *pPullComponent, MIPComponent
 		return false;
 	}
 	
-	m_inputConnections.push_back(MIPConnection(pPullComponent, pPushComponent, feedback, allowedMessageTypes, allowedSubmessageTypes));
+	m_outgoingConnections[pPullComponent].push_back(MIPConnection(pPullComponent, pPushComponent, feedback, allowedMessageTypes, allowedSubmessageTypes));
+	m_numConnections++;
 	return true;
 }
 
@@ -199,19 +293,25 @@ bool MIPComponentChain::deleteConnection(MIPComponent *pPullComponent, MIPCompon
 		return false;
 	}
 	
-	std::list<MIPConnection>::iterator it;
-	MIPConnection conn(pPullComponent, pPushComponent, feedback, allowedMessageTypes, allowedSubmessageTypes);
+	std::map<MIPComponent *, std::list<MIPConnection> >::iterator adjIt = m_outgoingConnections.find(pPullComponent);
 
-	it = m_inputConnections.begin();
-	while (it != m_inputConnections.end())
+	if (adjIt != m_outgoingConnections.end())
 	{
-		if ((*it) == conn)
+		std::list<MIPConnection> &connections = adjIt->second;
+		std::list<MIPConnection>::iterator it;
+		MIPConnection conn(pPullComponent, pPushComponent, feedback, allowedMessageTypes, allowedSubmessageTypes);
+
+		for (it = connections.begin() ; it != connections.end() ; it++)
 		{
-			m_inputConnections.erase(it);
-			return true;
+			if ((*it) == conn)
+			{
+				connections.erase(it);
+				if (connections.empty())
+					m_outgoingConnections.erase(adjIt);
+				m_numConnections--;
+				return true;
+			}
 		}
-		else
-			it++;
 	}
 
 	setErrorString(MIPCOMPONENTCHAIN_ERRSTR_CONNECTIONNOTFOUND);
@@ -235,200 +335,544 @@ void *MIPComponentChain::Thread()
 	
 	JThread::ThreadStarted();
 	
-	MIPSystemMessage startMsg(MIPSYSTEMMESSAGE_TYPE_WAITTIME);
-	
 	while (!done && !error)
 	{
 		MIPTime::wait(MIPTime(0,0));
-		m_chainMutex.Lock();
-		m_pInternalChainStart->lock();
-#ifdef MIPDEBUG2
-		std::cout << std::endl << m_chainName << " START " << iteration << std::endl;
-		std::cout << m_chainName << " push start: " << m_pInternalChainStart->getComponentName() << std::endl;
-#endif // MIPDEBUG2
-#ifdef MIPDEBUG3
-		std::cout << std::endl << "I " << iteration << " start in chain \"" << m_chainName << std::endl;
-		std::cout << "    pushing WaitTime to: " << m_pInternalChainStart->getComponentName() << std::endl;
-#endif // MIPDEBUG3
 
-		if (!m_pInternalChainStart->push(*this, iteration, &startMsg))
+		if (!processIteration(iteration, errorComponent, errorString))
 		{
 			error = true;
-			errorComponent = m_pInternalChainStart->getComponentName();
-			errorString = m_pInternalChainStart->getErrorString();
-			m_pInternalChainStart->unlock();
-			m_chainMutex.Unlock();
 			break;
 		}
+		
+		m_loopMutex.Lock();
+		done = m_stopLoop;
+		m_loopMutex.Unlock();
+		iteration++;
+	}
+	
+	onThreadExit(error, errorComponent, errorString);
+	
+#ifdef MIPDEBUG
+	std::cout << "MIPComponentChain::Thread stopped" << std::endl;
+#endif // MIPDEBUG
+	
+	return 0;
+}
+
+bool MIPComponentChain::isRunning()
+{
+	if (JThread::IsRunning())
+		return true;
+
+	m_loopMutex.Lock();
+	bool running = m_scheduledRunning;
+	m_loopMutex.Unlock();
+
+	return running;
+}
+
+bool MIPComponentChain::processIteration(int64_t iteration, std::string &errorComponent, std::string &errorString)
+{
+	MIPSystemMessage startMsg(MIPSYSTEMMESSAGE_TYPE_WAITTIME);
+	bool error = false;
+
+	m_chainMutex.Lock();
+
+	// The messages of the previous iteration are no longer used
+	m_pMessageArena->reset();
+
+	m_pInternalChainStart->lock();
 #ifdef MIPDEBUG2
-		std::cout << m_chainName << " push stop:  " << m_pInternalChainStart->getComponentName() << std::endl;
+	std::cout << std::endl << m_chainName << " START " << iteration << std::endl;
+	std::cout << m_chainName << " push start: " << m_pInternalChainStart->getComponentName() << std::endl;
 #endif // MIPDEBUG2
+#ifdef MIPDEBUG3
+	std::cout << std::endl << "I " << iteration << " start in chain \"" << m_chainName << std::endl;
+	std::cout << "    pushing WaitTime to: " << m_pInternalChainStart->getComponentName() << std::endl;
+#endif // MIPDEBUG3
+
+	if (!m_pInternalChainStart->push(*this, iteration, &startMsg))
+	{
+		errorComponent = m_pInternalChainStart->getComponentName();
+		errorString = m_pInternalChainStart->getErrorString();
 		m_pInternalChainStart->unlock();
+		m_chainMutex.Unlock();
+		return false;
+	}
+#ifdef MIPDEBUG2
+	std::cout << m_chainName << " push stop:  " << m_pInternalChainStart->getComponentName() << std::endl;
+#endif // MIPDEBUG2
+	m_pInternalChainStart->unlock();
 
-#ifdef MIPDEBUG
-	//	MIPTime curTime = MIPTime::getCurrentTime();
-#endif // MIPDEBUG
-		
+	if (m_numThreads > 1)
+	{
+		if (!processConnectionsParallel(iteration, errorComponent, errorString))
+			error = true;
+	}
+	else
+	{
 		std::list<MIPConnection>::const_iterator it;
 
 		for (it = m_orderedConnections.begin() ; !error && it != m_orderedConnections.end() ; it++)
 		{
-			MIPComponent *pPullComp = (*it).getPullComponent();
-			MIPComponent *pPushComp = (*it).getPushComponent();
-			uint32_t mask1 = (*it).getMask1();
-			uint32_t mask2 = (*it).getMask2();
+			if (!transferMessages(*it, iteration, errorComponent, errorString))
+				error = true;
+		}
+	}
+
+	if (error)
+	{
+		m_chainMutex.Unlock();
+		return false;
+	}
+	
+	std::list<MIPComponent *>::const_iterator fbIt;
+	MIPFeedback feedback;
+	int64_t chainID = 0;
+	
+#ifdef MIPDEBUG4
+	std::cerr << "\tNEW CHAIN" << std::endl;
+#endif // MIPDEBUG4
+
+	for (fbIt = m_feedbackChain.begin() ; !error && fbIt != m_feedbackChain.end() ; fbIt++)
+	{
+		if ((*fbIt) == 0)
+		{
+			feedback = MIPFeedback(); // reinitialize feedback
+			chainID++;
+#ifdef MIPDEBUG4
+			std::cerr << "\tNEW CHAIN" << std::endl;
+#endif // MIPDEBUG4
+		}
+		else
+		{
+			MIPComponent *pFbComp = *fbIt;
+			pFbComp->lock();
+#ifdef MIPDEBUG4
+			std::cerr << "\t\t" << pFbComp->getComponentName() << " " << ((void *)pFbComp) << std::endl;
+#endif // MIPDEBUG4
+			if (!pFbComp->processFeedback(*this, chainID, &feedback))
+			{
+				error = true;
+				errorComponent = pFbComp->getComponentName();
+				errorString = pFbComp->getErrorString();
+			}
+			pFbComp->unlock();
+		}
+	}
+
+	m_chainMutex.Unlock();
+	
+	return !error;
+}
+
+bool MIPComponentChain::runScheduledIteration(MIPTime *pWakeUpTime)
+{
+	m_loopMutex.Lock();
+	bool done = m_stopLoop;
+	m_loopMutex.Unlock();
+
+	if (done)
+		return false;
+
+	if (!processIteration(m_scheduledIteration, m_scheduledErrorComponent, m_scheduledErrorString))
+	{
+		m_scheduledError = true;
+		return false;
+	}
+
+	m_scheduledIteration++;
+
+	m_chainMutex.Lock();
+	m_pInternalChainStart->lock();
+	if (!m_pInternalChainStart->getWakeUpTime(*this, m_scheduledIteration, pWakeUpTime))
+	{
+		m_scheduledError = true;
+		m_scheduledErrorComponent = m_pInternalChainStart->getComponentName();
+		m_scheduledErrorString = MIPCOMPONENTCHAIN_ERRSTR_NOWAKEUPTIME;
+	}
+	m_pInternalChainStart->unlock();
+	m_chainMutex.Unlock();
+
+	return !m_scheduledError;
+}
+
+void MIPComponentChain::finishScheduledRun()
+{
+	// This can be called both from a worker thread of the scheduler and from
+	// MIPComponentChain::stop, but onThreadExit must only be called once. The
+	// chain is only marked as stopped afterwards, so that MIPComponentChain::stop
+	// waits until the worker thread no longer uses the chain.
+
+	m_loopMutex.Lock();
+	bool handled = m_scheduledExitHandled;
+	m_scheduledExitHandled = true;
+	m_loopMutex.Unlock();
+
+	if (handled)
+		return;
+
+	onThreadExit(m_scheduledError, m_scheduledErrorComponent, m_scheduledErrorString);
 
-			pPullComp->lock();
-			if (pPushComp->getComponentPointer() != pPullComp->getComponentPointer())
-				pPushComp->lock();
+	m_loopMutex.Lock();
+	m_scheduledRunning = false;
+	m_loopMutex.Unlock();
+}
+
+bool MIPComponentChain::transferMessages(const MIPConnection &connection, int64_t iteration, std::string &errorComponent, std::string &errorString)
+{
+	bool error = false;
+	MIPComponent *pPullComp = connection.getPullComponent();
+	MIPComponent *pPushComp = connection.getPushComponent();
+	uint32_t mask1 = connection.getMask1();
+	uint32_t mask2 = connection.getMask2();
+
+	pPullComp->lock();
+	if (pPushComp->getComponentPointer() != pPullComp->getComponentPointer())
+		pPushComp->lock();
 
-			MIPMessage *msg = 0;
+	MIPMessage *msg = 0;
 #ifdef MIPDEBUG3
-			int msgCount = 0;
+	int msgCount = 0;
 #endif // MIPDEBUG3
-			do
-			{
+	do
+	{
 #ifdef MIPDEBUG2
-				std::cout << m_chainName << " pull start: " << pPullComp->getComponentName() << std::endl;
+		std::cout << m_chainName << " pull start: " << pPullComp->getComponentName() << std::endl;
 #endif // MIPDEBUG2
-				if (!pPullComp->pull(*this, iteration, &msg))
-				{
-					error = true;
-					errorComponent = pPullComp->getComponentName();
-					errorString = pPullComp->getErrorString();
-				}
-				else
-				{
+		if (!pPullComp->pull(*this, iteration, &msg))
+		{
+			error = true;
+			errorComponent = pPullComp->getComponentName();
+			errorString = pPullComp->getErrorString();
+		}
+		else
+		{
 #ifdef MIPDEBUG2
-					std::cout << m_chainName << " pull stop:  " << pPullComp->getComponentName() << std::endl;
+			std::cout << m_chainName << " pull stop:  " << pPullComp->getComponentName() << std::endl;
 #endif // MIPDEBUG2
-					if (msg) // Ok, pass the message
-					{
-						uint32_t msgType = msg->getMessageType();
-						uint32_t msgSubtype = msg->getMessageSubtype();
+			if (msg) // Ok, pass the message
+			{
+				uint32_t msgType = msg->getMessageType();
+				uint32_t msgSubtype = msg->getMessageSubtype();
 
-						if ((msgType&mask1) && (msgSubtype&mask2))
-						{
+				if ((msgType&mask1) && (msgSubtype&mask2))
+				{
 #ifdef MIPDEBUG3
-							msgCount++;
+					msgCount++;
 #endif // MIPDEBUG3
 
 #ifdef MIPDEBUG2
-							std::cout << m_chainName << " push start: " << pPushComp->getComponentName() << std::endl;
+					std::cout << m_chainName << " push start: " << pPushComp->getComponentName() << std::endl;
 #endif // MIPDEBUG2
-							if(!pPushComp->push(*this, iteration, msg))
-							{
-								error = true;
-								errorComponent = pPushComp->getComponentName();
-								errorString = pPushComp->getErrorString();
-							}
+					if(!pPushComp->push(*this, iteration, msg))
+					{
+						error = true;
+						errorComponent = pPushComp->getComponentName();
+						errorString = pPushComp->getErrorString();
+					}
 #ifdef MIPDEBUG2
-							std::cout << m_chainName << " push stop:  " << pPushComp->getComponentName() << std::endl;
+					std::cout << m_chainName << " push stop:  " << pPushComp->getComponentName() << std::endl;
 #endif // MIPDEBUG2
-						}
-					}
+				}
+			}
 #ifdef MIPDEBUG2
-					std::cout << m_chainName << " all messages pushed" << std::endl;
+			std::cout << m_chainName << " all messages pushed" << std::endl;
 #endif // MIPDEBUG2
 
-				}
-			} while (!error && msg);
-			
-			pPullComp->unlock();
-			if (pPushComp->getComponentPointer() != pPullComp->getComponentPointer())
-				pPushComp->unlock();
+		}
+	} while (!error && msg);
+	
+	pPullComp->unlock();
+	if (pPushComp->getComponentPointer() != pPullComp->getComponentPointer())
+		pPushComp->unlock();
 #ifdef MIPDEBUG3
-			std::cout << "   Transferred " << msgCount << " messages from " << pPullComp->getComponentName() << " (" << (void *)pPullComp << ") to " << pPushComp->getComponentName() << " (" << (void  *)pPushComp << ")" << std::endl;
+	std::cout << "   Transferred " << msgCount << " messages from " << pPullComp->getComponentName() << " (" << (void *)pPullComp << ") to " << pPushComp->getComponentName() << " (" << (void  *)pPushComp << ")" << std::endl;
 #endif // MIPDEBUG3
-		}
 
-		if (error)
+	return !error;
+}
+
+bool MIPComponentChain::processNode(MIPConnectionNode &node, int64_t iteration, std::string &errorComponent, std::string &errorString)
+{
+	const MIPConnection &connection = node.m_connection;
+	MIPComponent *pPullComp = connection.getPullComponent();
+	MIPComponent *pPushComp = connection.getPushComponent();
+
+	if (pPushComp->getComponentPointer() == pPullComp->getComponentPointer())
+		return transferMessages(connection, iteration, errorComponent, errorString);
+
+	// Other connections may be pulling messages from the same component at this
+	// point, so we'll only keep the pull component locked while collecting its
+	// messages. The dependency graph makes sure that no messages are pushed into
+	// that component until we're done.
+
+	uint32_t mask1 = connection.getMask1();
+	uint32_t mask2 = connection.getMask2();
+	MIPMessage *msg = 0;
+	bool error = false;
+
+	node.m_messages.clear();
+	
+	pPullComp->lock();
+	do
+	{
+		if (!pPullComp->pull(*this, iteration, &msg))
 		{
-			m_chainMutex.Unlock();
-			break;
+			error = true;
+			errorComponent = pPullComp->getComponentName();
+			errorString = pPullComp->getErrorString();
 		}
-		
-		std::list<MIPComponent *>::const_iterator fbIt;
-		MIPFeedback feedback;
-		int64_t chainID = 0;
-		
-#ifdef MIPDEBUG4
-		//std::cerr << "Processing feedback:" << std::endl;
-#endif // MIPDEBUG4
-		
-#ifdef MIPDEBUG4
-		std::cerr << "\tNEW CHAIN" << std::endl;
-#endif // MIPDEBUG4
+		else if (msg)
+		{
+			if ((msg->getMessageType()&mask1) && (msg->getMessageSubtype()&mask2))
+				node.m_messages.push_back(msg);
+		}
+	} while (!error && msg);
+	pPullComp->unlock();
 
-		for (fbIt = m_feedbackChain.begin() ; !error && fbIt != m_feedbackChain.end() ; fbIt++)
+	if (error)
+		return false;
+	
+	pPushComp->lock();
+	for (size_t i = 0 ; !error && i < node.m_messages.size() ; i++)
+	{
+		if (!pPushComp->push(*this, iteration, node.m_messages[i]))
 		{
-			if ((*fbIt) == 0)
-			{
-				feedback = MIPFeedback(); // reinitialize feedback
-				chainID++;
-#ifdef MIPDEBUG4
-				std::cerr << "\tNEW CHAIN" << std::endl;
-#endif // MIPDEBUG4
-			}
-			else
-			{
-				MIPComponent *pFbComp = *fbIt;
-				pFbComp->lock();
-#ifdef MIPDEBUG4
-				std::cerr << "\t\t" << pFbComp->getComponentName() << " " << ((void *)pFbComp) << std::endl;
-#endif // MIPDEBUG4
-				if (!pFbComp->processFeedback(*this, chainID, &feedback))
-				{
-					error = true;
-					errorComponent = pFbComp->getComponentName();
-					errorString = pFbComp->getErrorString();
-				}
-				pFbComp->unlock();
-			}
+			error = true;
+			errorComponent = pPushComp->getComponentName();
+			errorString = pPushComp->getErrorString();
 		}
+	}
+	pPushComp->unlock();
 
-		m_chainMutex.Unlock();
-		
-		if (error)
-			break;
-		
-		//std::cerr << std::endl;
-		
-		m_loopMutex.Lock();
-		done = m_stopLoop;
-		m_loopMutex.Unlock();
-		iteration++;
+	return !error;
+}
 
-#ifdef MIPDEBUG
-//		MIPTime diff = MIPTime::getCurrentTime();
-//		diff -= curTime;
-//		std::cout << "Loop time: " << diff.getString() << std::endl;
-#endif // MIPDEBUG
+bool MIPComponentChain::processConnectionsParallel(int64_t iteration, std::string &errorComponent, std::string &errorString)
+{
+	std::unique_lock<std::mutex> lock(m_schedMutex);
+
+	m_readyNodes.clear();
+	for (size_t i = 0 ; i < m_connectionNodes.size() ; i++)
+	{
+		MIPConnectionNode &node = m_connectionNodes[i];
+
+		node.m_pendingDependencies = node.m_numDependencies;
+		if (node.m_numDependencies == 0)
+			m_readyNodes.push_back((int)i);
 	}
 	
-	onThreadExit(error, errorComponent, errorString);
-	
-#ifdef MIPDEBUG
-	std::cout << "MIPComponentChain::Thread stopped" << std::endl;
-#endif // MIPDEBUG
+	m_schedIteration = iteration;
+	m_nodesLeft = (int)m_connectionNodes.size();
+	m_nodesRunning = 0;
+	m_schedError = false;
+	m_schedCondition.notify_all();
+
+	// The chain's own thread helps processing the connections until all of them
+	// are done, or until an error occurred and no connection is being processed
+	// anymore
+
+	while (m_nodesLeft > 0 && !(m_schedError && m_nodesRunning == 0))
+	{
+		if (!processNextNode(lock))
+			m_schedCondition.wait(lock);
+	}
+
+	m_readyNodes.clear();
+
+	if (m_schedError)
+	{
+		errorComponent = m_schedErrorComponent;
+		errorString = m_schedErrorString;
+		return false;
+	}
+	return true;
+}
+
+bool MIPComponentChain::processNextNode(std::unique_lock<std::mutex> &lock)
+{
+	if (m_schedError || m_readyNodes.empty())
+		return false;
+
+	int nodeIndex = m_readyNodes.front();
+	m_readyNodes.pop_front();
+	m_nodesRunning++;
+
+	std::string errorComponent, errorString;
 	
+	lock.unlock();
+	bool success = processNode(m_connectionNodes[nodeIndex], m_schedIteration, errorComponent, errorString);
+	lock.lock();
+
+	m_nodesRunning--;
+	m_nodesLeft--;
+
+	if (!success)
+	{
+		if (!m_schedError)
+		{
+			m_schedError = true;
+			m_schedErrorComponent = errorComponent;
+			m_schedErrorString = errorString;
+		}
+	}
+	else
+	{
+		const std::vector<int> &dependents = m_connectionNodes[nodeIndex].m_dependents;
+
+		for (size_t i = 0 ; i < dependents.size() ; i++)
+		{
+			MIPConnectionNode &node = m_connectionNodes[dependents[i]];
+
+			node.m_pendingDependencies--;
+			if (node.m_pendingDependencies == 0)
+				m_readyNodes.push_back(dependents[i]);
+		}
+	}
+
+	m_schedCondition.notify_all();
+	return true;
+}
+
+void MIPComponentChain::workerLoop()
+{
+	std::unique_lock<std::mutex> lock(m_schedMutex);
+
+	while (!m_stopWorkers)
+	{
+		if (!processNextNode(lock))
+			m_schedCondition.wait(lock);
+	}
+}
+
+void *MIPComponentChain::MIPWorkerThread::Thread()
+{
+	JThread::ThreadStarted();
+	m_chain.workerLoop();
 	return 0;
 }
 
+bool MIPComponentChain::startWorkers()
+{
+	stopWorkers();
+
+	m_stopWorkers = false;
+	for (int i = 1 ; i < m_numThreads ; i++)
+	{
+		MIPWorkerThread *pWorker = new MIPWorkerThread(*this);
+
+		m_workers.push_back(pWorker);
+		if (pWorker->Start() < 0)
+		{
+			stopWorkers();
+			return false;
+		}
+	}
+	return true;
+}
+
+void MIPComponentChain::stopWorkers()
+{
+	if (m_workers.empty())
+		return;
+
+	{
+		std::lock_guard<std::mutex> guard(m_schedMutex);
+		m_stopWorkers = true;
+		m_schedCondition.notify_all();
+	}
+
+	for (size_t i = 0 ; i < m_workers.size() ; i++)
+	{
+		MIPWorkerThread *pWorker = m_workers[i];
+		MIPTime curTime = MIPTime::getCurrentTime();
+		
+		while (pWorker->IsRunning() && (MIPTime::getCurrentTime().getValue() - curTime.getValue()) < 5.0) // wait maximum five seconds
+			MIPTime::wait(MIPTime(0.010));
+
+		if (pWorker->IsRunning())
+			pWorker->Kill();
+
+		delete pWorker;
+	}
+	m_workers.clear();
+}
+
+void MIPComponentChain::buildConnectionGraph(const std::list<MIPConnection> &orderedList, std::vector<MIPConnectionNode> &connectionNodes)
+{
+	// Connections which pull messages from the same component can run at the same
+	// time, as long as no connection which pushes messages into that component runs
+	// concurrently. Connections which push messages into a component are processed in
+	// the same order as in the ordered list, and after all previous connections which
+	// used this component.
+
+	std::map<const MIPComponent *, int> lastWriter;
+	std::map<const MIPComponent *, std::vector<int> > readers;
+	std::list<MIPConnection>::const_iterator it;
+
+	connectionNodes.clear();
+	connectionNodes.reserve(orderedList.size());
+	for (it = orderedList.begin() ; it != orderedList.end() ; it++)
+		connectionNodes.push_back(MIPConnectionNode(*it));
+	
+	for (size_t i = 0 ; i < connectionNodes.size() ; i++)
+	{
+		MIPConnectionNode &node = connectionNodes[i];
+		const MIPComponent *pPullComp = node.m_connection.getPullComponent()->getComponentPointer();
+		const MIPComponent *pPushComp = node.m_connection.getPushComponent()->getComponentPointer();
+		std::vector<int> dependencies;
+		std::map<const MIPComponent *, int>::const_iterator writerIt;
+
+		if (pPullComp != pPushComp)
+		{
+			writerIt = lastWriter.find(pPullComp);
+			if (writerIt != lastWriter.end())
+				dependencies.push_back(writerIt->second);
+			readers[pPullComp].push_back((int)i);
+		}
+
+		writerIt = lastWriter.find(pPushComp);
+		if (writerIt != lastWriter.end())
+			dependencies.push_back(writerIt->second);
+
+		std::vector<int> &pushCompReaders = readers[pPushComp];
+
+		for (size_t j = 0 ; j < pushCompReaders.size() ; j++)
+		{
+			if (pushCompReaders[j] != (int)i)
+				dependencies.push_back(pushCompReaders[j]);
+		}
+		pushCompReaders.clear();
+		lastWriter[pPushComp] = (int)i;
+
+		std::sort(dependencies.begin(), dependencies.end());
+		dependencies.erase(std::unique(dependencies.begin(), dependencies.end()), dependencies.end());
+
+		for (size_t j = 0 ; j < dependencies.size() ; j++)
+			connectionNodes[dependencies[j]].m_dependents.push_back((int)i);
+		node.m_numDependencies = (int)dependencies.size();
+	}
+}
+
 bool MIPComponentChain::orderConnections(std::list<MIPConnection> &orderedConnections)
 {
-	std::list<MIPConnection> orderedList;
-	std::list<MIPConnection>::iterator it;
-	std::list<MIPComponent *> componentLayer;
+	// The connections are ordered layer by layer, starting from the chain's start
+	// component. Since the connections are indexed by the component they pull messages
+	// from, all connections starting at a component can be added at once, the first
+	// time that component is encountered. This way, each connection is only looked at
+	// once.
 
-	for (it = m_inputConnections.begin() ; it != m_inputConnections.end() ; it++)
-		(*it).setMark(false);
+	std::list<MIPConnection> orderedList;
+	std::vector<MIPComponent *> componentLayer, newLayer;
+	std::set<MIPComponent *> processedComponents, newLayerComponents;
 
 #ifdef MIPDEBUG3
 	int layerNumber = 0;
 	std::cout << "Start of connection ordering" << std::endl;
 #endif // MIPDEBUG3
-	
+
 	componentLayer.push_back(m_pInputChainStart);
 	while (!componentLayer.empty())
 	{
@@ -436,185 +880,183 @@ bool MIPComponentChain::orderConnections(std::list<MIPConnection> &orderedConnec
 		layerNumber++;
 		std::cout << "Layer " << layerNumber << ":" << std::endl;
 #endif // MIPDEBUG3
-		std::list<MIPComponent *> newLayer;
-		std::list<MIPComponent *>::const_iterator compit;
-		
-		for (compit = componentLayer.begin() ; compit != componentLayer.end() ; compit++)
+		newLayer.clear();
+		newLayerComponents.clear();
+
+		for (size_t i = 0 ; i < componentLayer.size() ; i++)
 		{
-			for (it = m_inputConnections.begin() ; it != m_inputConnections.end() ; it++)
+			MIPComponent *pComponent = componentLayer[i];
+
+			if (!processedComponents.insert(pComponent).second) // its connections are already in the ordered list
+				continue;
+
+			std::map<MIPComponent *, std::list<MIPConnection> >::const_iterator adjIt = m_outgoingConnections.find(pComponent);
+
+			if (adjIt == m_outgoingConnections.end())
+				continue;
+
+			std::list<MIPConnection>::const_iterator it;
+
+			for (it = adjIt->second.begin() ; it != adjIt->second.end() ; it++)
 			{
-				if (!(*it).isMarked()) // check that we haven't processed this connection yet
-				{
-					if ((*it).getPullComponent() == (*compit)) // check that this connection starts from the component under consideration
-					{
-						// mark the connection as processed
-						(*it).setMark(true);
-						// copy the connection in the ordered list
-						orderedList.push_back(*it);
-
-						// get the other end of the connection and add that
-						// component to the new layer
-						// we'll make sure that the component isn't already
-						// in the list
-
-						bool found = false;
-						MIPComponent *component = (*it).getPushComponent();
-						std::list<MIPComponent *>::const_iterator compit2;
+				// copy the connection in the ordered list
+				orderedList.push_back(*it);
+
+				// get the other end of the connection and add that
+				// component to the new layer, if it still has to be
+				// processed and isn't already in the list
+
+				MIPComponent *pPushComponent = (*it).getPushComponent();
 #ifdef MIPDEBUG3
-						std::cout << "   " << (*it).getPullComponent()->getComponentName() << " (" << (void *)((*it).getPullComponent()) << ") -> " << (*it).getPushComponent()->getComponentName() << " (" << (void*)((*it).getPushComponent()) << ")" <<std::endl;
+				std::cout << "   " << (*it).getPullComponent()->getComponentName() << " (" << (void *)((*it).getPullComponent()) << ") -> " << (*it).getPushComponent()->getComponentName() << " (" << (void*)((*it).getPushComponent()) << ")" <<std::endl;
 #endif // MIPDEBUG3
 
-						for (compit2 = newLayer.begin() ; !found && compit2 != newLayer.end() ; compit2++)
-						{
-							if ((*compit2) == component)
-								found = true;
-						}
-
-						if (!found)
-							newLayer.push_back(component);
-					}
-				}
+				if (processedComponents.find(pPushComponent) == processedComponents.end() &&
+				    newLayerComponents.insert(pPushComponent).second)
+					newLayer.push_back(pPushComponent);
 			}
 		}
-		
-		componentLayer = newLayer;
+
+		componentLayer.swap(newLayer);
 	}
-	
+
 #ifdef MIPDEBUG3
 	std::cout << "End of connection ordering" << std::endl;
 #endif // MIPDEBUG3
 
-	for (it = m_inputConnections.begin() ; it != m_inputConnections.end() ; it++)
+	if (orderedList.size() != m_numConnections)
 	{
-		if (!(*it).isMarked())
-		{
-			setErrorString(MIPCOMPONENTCHAIN_ERRSTR_UNUSEDCONNECTION);
-			return false;		
-		}
+		setErrorString(MIPCOMPONENTCHAIN_ERRSTR_UNUSEDCONNECTION);
+		return false;
 	}
 
-	orderedConnections = orderedList;
-	
+	orderedConnections.swap(orderedList);
+
 	return true;
 }
 
 bool MIPComponentChain::buildFeedbackList(std::list<MIPConnection> &orderedList, std::list<MIPComponent *> &feedbackComponentChain)
 {
+	// For each component, the positions in the ordered list of the feedback connections
+	// which pull messages from it. Since the connections are ordered, the next link of a
+	// feedback chain is the first one of these positions after the current link.
+
+	std::vector<MIPConnection *> connections;
+	std::map<const MIPComponent *, std::vector<int> > feedbackLinks;
 	std::list<MIPConnection>::iterator it;
 	std::list<MIPComponent *> subChain;
 	std::list<MIPComponent *> feedbackChain;
-	bool done = false;
 
+	connections.reserve(orderedList.size());
 	for (it = orderedList.begin() ; it != orderedList.end() ; it++)
 	{
 		if (!(*it).giveFeedback())
 			(*it).setMark(true);
 		else
+		{
 			(*it).setMark(false);
+			feedbackLinks[(*it).getPullComponent()].push_back((int)connections.size());
+		}
+		connections.push_back(&(*it));
 	}
-	
-	while (!done)
+
+	for (size_t start = 0 ; start < connections.size() ; start++)
 	{
-		bool found = false;
+		if (connections[start]->isMarked())
+			continue;
 
-		it = orderedList.begin();
-		while (!found && it != orderedList.end())
-		{
-			if (!(*it).isMarked() && (*it).giveFeedback())
-				found = true;
-			else
-				it++;
-		}
+		// ok, found a starting point, build the subchain
 
-		if (found) // ok, found a starting point, build the subchain
-		{
-			(*it).setMark(true);
-			
-			// The connections are ordered! We'll make use of this by only
-			// considering connections further down the road
-			
-			subChain.clear();
+		int current = (int)start;
+		bool done = false;
 
-			// connection is from pull to push
-			subChain.push_back((*it).getPullComponent());
-			subChain.push_back((*it).getPushComponent());
+		subChain.clear();
 
-			(*it).setMark(true);
+		// connection is from pull to push
+		subChain.push_back(connections[current]->getPullComponent());
+		subChain.push_back(connections[current]->getPushComponent());
+
+		connections[current]->setMark(true);
 
-			std::list<MIPConnection>::iterator startIt = it;
-			bool done2 = false;
-			
-			while (!done2)
+		while (!done)
+		{
+			std::map<const MIPComponent *, std::vector<int> >::const_iterator linkIt;
+
+			done = true;
+			linkIt = feedbackLinks.find(connections[current]->getPushComponent());
+			if (linkIt != feedbackLinks.end())
 			{
-				std::list<MIPConnection>::iterator nextStartIt;
-				bool foundNextStartIt = false;
+				// Marked connections are considered as well: when a feedback chain splits
+				// into two parts, two separate chains are created, which both have a
+				// common part
+				const std::vector<int> &links = linkIt->second;
+				std::vector<int>::const_iterator nextIt = std::upper_bound(links.begin(), links.end(), current);
 
-				it = startIt;
-				it++;
-				while (it != orderedList.end())
+				if (nextIt != links.end())
 				{
-					// The check for isMarked causes some problems when a feedback chain splits
-					// into two parts. By omitting this check, two separate chains should be
-					// created, which both have a common part
-					if (/*!(*it).isMarked() &&*/ (*it).giveFeedback())
+					if (nextIt + 1 != links.end())
 					{
-						if ((*it).getPullComponent() == (*startIt).getPushComponent())
-						{
-							if (foundNextStartIt)
-							{
-								setErrorString(MIPCOMPONENTCHAIN_ERRSTR_CANTMERGEFEEDBACK);
-								return false;
-							}
-							foundNextStartIt = true;
-							nextStartIt = it;
-							subChain.push_back((*it).getPushComponent());
-							(*it).setMark(true);
-						}
+						setErrorString(MIPCOMPONENTCHAIN_ERRSTR_CANTMERGEFEEDBACK);
+						return false;
 					}
-					it++;
-				}
 
-				if (!foundNextStartIt)
-					done2 = true;
-				else
-					startIt = nextStartIt;
+					current = *nextIt;
+					subChain.push_back(connections[current]->getPushComponent());
+					connections[current]->setMark(true);
+					done = false;
+				}
 			}
+		}
 
-			// add the subchain to the feedbacklist in reverse
-		
-			if (!feedbackChain.empty())
-				feedbackChain.push_front(0); // mark new subchain
+		// add the subchain to the feedbacklist in reverse
 
-			std::list<MIPComponent *>::const_iterator it2;
+		if (!feedbackChain.empty())
+			feedbackChain.push_front(0); // mark new subchain
 
-			for (it2 = subChain.begin() ; it2 != subChain.end() ; it2++)
-				feedbackChain.push_front(*it2);
-		}
-		else
-			done = true;
+		std::list<MIPComponent *>::const_iterator it2;
+
+		for (it2 = subChain.begin() ; it2 != subChain.end() ; it2++)
+			feedbackChain.push_front(*it2);
 	}
 
-	feedbackComponentChain = feedbackChain;
-	
+	feedbackComponentChain.swap(feedbackChain);
+
 	return true;
 }
 
-void MIPComponentChain::copyConnectionInfo(const std::list<MIPConnection> &orderedList, const std::list<MIPComponent *> &feedbackChain)
+bool MIPComponentChain::buildConnectionInfo()
 {
-	std::list<MIPConnection>::const_iterator it;
-	std::list<MIPComponent *>::const_iterator it2;
+	// All the work is done without holding the chain mutex, so that a running
+	// chain is only blocked while the new connection info is being swapped in.
+
+	std::list<MIPConnection> orderedList;
+	std::list<MIPComponent *> feedbackChain;
+	std::vector<MIPConnectionNode> connectionNodes;
+
+	if (!orderConnections(orderedList))
+		return false;
+	if (!buildFeedbackList(orderedList, feedbackChain))
+		return false;
+
+	buildConnectionGraph(orderedList, connectionNodes);
+	installConnectionInfo(orderedList, feedbackChain, connectionNodes);
+
+	return true;
+}
+
+void MIPComponentChain::installConnectionInfo(std::list<MIPConnection> &orderedList, std::list<MIPComponent *> &feedbackChain,
+                                              std::vector<MIPConnectionNode> &connectionNodes)
+{
+	// Since an iteration holds the chain mutex, the new connection info takes effect
+	// between two iterations. The old info ends up in the arguments and is released
+	// by the caller, after the mutex has been unlocked again.
 
 	m_chainMutex.Lock();
-	
-	m_orderedConnections.clear();
-	m_feedbackChain.clear();
-	
-	for (it = orderedList.begin() ; it != orderedList.end() ; it++)
-		m_orderedConnections.push_back(*it);
-	for (it2 = feedbackChain.begin() ; it2 != feedbackChain.end() ; it2++)
-		m_feedbackChain.push_back(*it2);
-	
+
+	m_orderedConnections.swap(orderedList);
+	m_feedbackChain.swap(feedbackChain);
+	m_connectionNodes.swap(connectionNodes);
 	m_pInternalChainStart = m_pInputChainStart;
 
 	m_chainMutex.Unlock();
-}	
+}
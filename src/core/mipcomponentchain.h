@@ -36,8 +36,16 @@
 #include <jthread/jthread.h>
 #include <string>
 #include <list>
+#include <vector>
+#include <map>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
 
 class MIPComponent;
+class MIPChainScheduler;
+class MIPMessageArena;
+class MIPTime;
 
 /** A chain of components.
  *  This class describes a collection of links which exist between specific components. When the
@@ -101,7 +109,11 @@ public:
 	                  uint32_t allowedMessageTypes = MIPMESSAGE_TYPE_ALL, 
 	                  uint32_t allowedSubmessageTypes = MIPMESSAGE_TYPE_ALL);
 
-	/** Removes a connection previously added by the addConnection function. */
+	/** Removes a connection previously added by the addConnection function.
+	 *  Removes a connection previously added by the addConnection function. The connections
+	 *  are indexed by the component they pull messages from, so this only needs to look at the
+	 *  connections which start at \c pPullComponent.
+	 */
 	bool deleteConnection(MIPComponent *pPullComponent, MIPComponent *pPushCompontent, bool feedback = false,
 	                  uint32_t allowedMessageTypes = MIPMESSAGE_TYPE_ALL, 
 	                  uint32_t allowedSubmessageTypes = MIPMESSAGE_TYPE_ALL);
@@ -111,8 +123,51 @@ public:
 	 */
 	std::string getName() const									{ return m_chainName; }
 	
-	/** Rebuilds a running chain. */
+	/** Rebuilds a running chain.
+	 *  Rebuilds a running chain, so that connections which were added or removed since the chain was
+	 *  started take effect. The new ordering of the connections is computed in the calling thread,
+	 *  while the chain keeps running; the result is then swapped in between two iterations of the
+	 *  chain. When this function returns, the new connections are used and components which are no
+	 *  longer part of the chain will not be accessed by it anymore.
+	 */
 	bool rebuild();
+
+	/** Sets the number of threads which will be used to process the chain.
+	 *  By default, the connections of a chain are processed one after another in the chain's
+	 *  background thread. When \c numThreads is larger than one, a dependency graph is built from the
+	 *  ordered connections and independent branches of the chain are processed by a pool of
+	 *  \c numThreads - 1 worker threads, together with the chain's own thread. Connections which
+	 *  push messages into a component are processed in the same order as in the single threaded
+	 *  case, and only after all messages have been pushed into the component they pull messages
+	 *  from. Several connections can extract messages from the same component concurrently, in
+	 *  which case the component is only locked while its messages are being collected. For this
+	 *  reason, components which are also used in another chain, or which share state in another
+	 *  way than through the chain's connections, should not be used in a chain which is processed
+	 *  by several threads. This setting can only be changed when the chain is not running.
+	 */
+	bool setNumberOfThreads(int numThreads);
+
+	/** Returns the number of threads that will be used to process the chain. */
+	int getNumberOfThreads() const									{ return m_numThreads; }
+
+	/** Lets the chain be run by a MIPChainScheduler instead of by its own thread.
+	 *  When a scheduler is set, starting the chain does not create a background thread. Instead,
+	 *  the chain is registered with \c pScheduler, which processes each iteration in one of its
+	 *  worker threads at the time reported by the MIPComponent::getWakeUpTime function of the start
+	 *  component. This only works if the start component implements that function, like MIPAverageTimer
+	 *  does; chains which are driven by a sound card should keep their own thread. Pass null to use 
+	 *  a background thread again. This setting can only be changed when the chain is not running.
+	 */
+	bool setScheduler(MIPChainScheduler *pScheduler);
+
+	/** Returns the scheduler set by MIPComponentChain::setScheduler, or null if the chain uses its own thread. */
+	MIPChainScheduler *getScheduler() const								{ return m_pScheduler; }
+
+	/** Returns the arena in which components can store the messages they produce in the current iteration.
+	 *  Returns the arena in which components can store the messages they produce in the current iteration.
+	 *  The arena is reset at the start of each iteration of the chain, see MIPMessageArena for details.
+	 */
+	MIPMessageArena &getMessageArena() const							{ return *m_pMessageArena; }
 protected:
 	/** Function called when the background thread exits.
 	 *  This function is called when the background thread exits. This can happen if the 
@@ -146,13 +201,51 @@ private:
 		bool m_feedback;
 	};
 
+	class MIPConnectionNode
+	{
+	public:
+		MIPConnectionNode(const MIPConnection &conn) : m_connection(conn)			{ m_numDependencies = 0; m_pendingDependencies = 0; }
+
+		MIPConnection m_connection;
+		std::vector<MIPMessage *> m_messages;
+		std::vector<int> m_dependents;
+		int m_numDependencies;
+		int m_pendingDependencies;
+	};
+
+	class MIPWorkerThread : public jthread::JThread
+	{
+	public:
+		MIPWorkerThread(MIPComponentChain &chain) : m_chain(chain)				{ }
+		void *Thread();
+	private:
+		MIPComponentChain &m_chain;
+	};
+
+	friend class MIPChainScheduler;
+
 	void *Thread();
+	bool isRunning();
+	bool processIteration(int64_t iteration, std::string &errorComponent, std::string &errorString);
+	bool runScheduledIteration(MIPTime *pWakeUpTime);
+	void finishScheduledRun();
+	bool transferMessages(const MIPConnection &connection, int64_t iteration, std::string &errorComponent, std::string &errorString);
+	bool processNode(MIPConnectionNode &node, int64_t iteration, std::string &errorComponent, std::string &errorString);
+	bool processConnectionsParallel(int64_t iteration, std::string &errorComponent, std::string &errorString);
+	bool processNextNode(std::unique_lock<std::mutex> &lock);
+	void workerLoop();
+	bool startWorkers();
+	void stopWorkers();
+	bool buildConnectionInfo();
+	void buildConnectionGraph(const std::list<MIPConnection> &orderedList, std::vector<MIPConnectionNode> &connectionNodes);
 	bool orderConnections(std::list<MIPConnection> &orderedConnections);
 	bool buildFeedbackList(std::list<MIPConnection> &orderedList, std::list<MIPComponent *> &feedbackChain);
-	void copyConnectionInfo(const std::list<MIPConnection> &orderedList, const std::list<MIPComponent *> &feedbackChain);
+	void installConnectionInfo(std::list<MIPConnection> &orderedList, std::list<MIPComponent *> &feedbackChain,
+	                           std::vector<MIPConnectionNode> &connectionNodes);
 	
 	std::string m_chainName;
-	std::list<MIPConnection> m_inputConnections;
+	std::map<MIPComponent *, std::list<MIPConnection> > m_outgoingConnections;
+	size_t m_numConnections;
 	std::list<MIPConnection> m_orderedConnections;
 	std::list<MIPComponent *> m_feedbackChain;
 	MIPComponent *m_pInputChainStart;	
@@ -162,6 +255,23 @@ private:
 	jthread::JMutex m_chainMutex;
 	bool m_stopLoop;
 
+	int m_numThreads;
+	std::vector<MIPConnectionNode> m_connectionNodes;
+	std::vector<MIPWorkerThread *> m_workers;
+	std::mutex m_schedMutex;
+	std::condition_variable m_schedCondition;
+	std::deque<int> m_readyNodes;
+	int64_t m_schedIteration;
+	int m_nodesLeft, m_nodesRunning;
+	bool m_schedError, m_stopWorkers;
+	std::string m_schedErrorComponent, m_schedErrorString;
+
+	MIPChainScheduler *m_pScheduler;
+	MIPMessageArena *m_pMessageArena;
+	bool m_scheduledRunning, m_scheduledExitHandled, m_scheduledError;
+	int64_t m_scheduledIteration;
+	std::string m_scheduledErrorComponent, m_scheduledErrorString;
+
 	uint32_t m_dummy;
 };
 
@@ -33,6 +33,7 @@
 #include "mipconfig.h"
 #include "mipaudiomessage.h"
 #include "miptime.h"
+#include "mipsharedbuffer.h"
 #include <string.h>
 
 /**
@@ -50,6 +51,8 @@
  * 	\brief Subtype for encoded audio messages containing SILK data.
  * \def MIPENCODEDAUDIOMESSAGE_TYPE_OPUS
  * 	\brief Subtype for encoded audio messages containing Opus data.
+ * \def MIPENCODEDAUDIOMESSAGE_TYPE_CN
+ * 	\brief Subtype for encoded audio messages containing RFC 3389 comfort noise parameters.
  */
 
 #define MIPENCODEDAUDIOMESSAGE_TYPE_SPEEX							0x00000001
@@ -59,6 +62,7 @@
 #define MIPENCODEDAUDIOMESSAGE_TYPE_LPC								0x00000010
 #define MIPENCODEDAUDIOMESSAGE_TYPE_SILK							0x00000020
 #define MIPENCODEDAUDIOMESSAGE_TYPE_OPUS							0x00000040
+#define MIPENCODEDAUDIOMESSAGE_TYPE_CN								0x00000080
 
 /** Container for encoded audio data.
  */
@@ -78,35 +82,100 @@ public:
 	 */
 	MIPEncodedAudioMessage(uint32_t subType, int samplingRate, int numChannels, 
 	                       int numFrames, uint8_t *pData, size_t numBytes, bool deleteData) : MIPAudioMessage(false, subType, samplingRate, numChannels, numFrames)
-													{ m_deleteData = deleteData; m_pData = pData; m_dataLength = numBytes; }
-	~MIPEncodedAudioMessage()									{ if (m_deleteData) delete [] m_pData; }
+													{ m_deleteData = deleteData; m_pData = pData; m_dataLength = numBytes; m_pBuffer = 0; m_conceal = false; m_useFEC = false; m_tier = 0; }
+
+	/** Creates an encoded audio message which stores its data in a shared buffer.
+	 *  Creates an encoded audio message which stores its data in a shared buffer. Copies of
+	 *  this message will refer to the same buffer instead of copying the encoded data. The
+	 *  buffer can for example refer directly to the payload of a received RTP packet (see
+	 *  MIPRTPReceiveMessage::getPayloadBuffer).
+	 *  \param subType The subtype of the message.
+	 *  \param samplingRate The sampling rate.
+	 *  \param numChannels The number of channels.
+	 *  \param numFrames The number of frames contained in the message.
+	 *  \param pBuffer Buffer containing the encoded audio data. The message takes over the 
+	 *                 caller's reference to this buffer.
+	 *  \param numBytes The length of the encoded audio data.
+	 */
+	MIPEncodedAudioMessage(uint32_t subType, int samplingRate, int numChannels, 
+	                       int numFrames, MIPSharedBuffer *pBuffer, size_t numBytes) : MIPAudioMessage(false, subType, samplingRate, numChannels, numFrames)
+													{ m_deleteData = false; m_pData = pBuffer->getData(); m_dataLength = numBytes; m_pBuffer = pBuffer; m_conceal = false; m_useFEC = false; m_tier = 0; }
+	~MIPEncodedAudioMessage()									{ if (m_pBuffer) m_pBuffer->release(); else if (m_deleteData) delete [] m_pData; }
 
 	/** Returns a pointer to the encoded audio data. */
 	const uint8_t *getData() const									{ return m_pData; }
 
+	/** Returns the shared buffer in which the data is stored, or NULL if no such buffer is used. */
+	MIPSharedBuffer *getSharedBuffer() const							{ return m_pBuffer; }
+
 	/** Returns the length of the encoded audio. */
 	size_t getDataLength() const									{ return m_dataLength; }
 
 	/** Sets the length of the encoded audio to 'l'. */
 	void setDataLength(size_t l)									{ m_dataLength = l; }
 
-	/** Creates a copy of this message. */
+	/** Marks this message as a request to conceal lost audio.
+	 *  Marks this message as a request to conceal lost audio. Such a message does not contain
+	 *  the encoded audio for its own time interval: the decoder should synthesize a number of
+	 *  frames, as given by the sampling rate and number of frames of this message, to hide the 
+	 *  loss. If \c useFEC is \c true, the data of this message is the packet which follows the
+	 *  lost one, and the decoder may use forward error correction information contained in it.
+	 *  Otherwise, the message contains no data.
+	 */
+	void setConcealment(bool useFEC)								{ m_conceal = true; m_useFEC = useFEC; }
+
+	/** Returns \c true if this message is a request to conceal lost audio. */
+	bool isConcealment() const									{ return m_conceal; }
+
+	/** Returns \c true if forward error correction data from the next packet should be used for concealment. */
+	bool useFEC() const										{ return m_useFEC; }
+
+	/** Sets the encoding tier of this message.
+	 *  When an encoder produces several versions of the same audio, for example at different
+	 *  bitrates, this number indicates which version the message contains. By default it is 0.
+	 */
+	void setEncodingTier(int tier)									{ m_tier = tier; }
+
+	/** Returns the encoding tier of this message (see MIPEncodedAudioMessage::setEncodingTier). */
+	int getEncodingTier() const									{ return m_tier; }
+
+	/** Creates a copy of this message.
+	 *  Creates a copy of this message. If the data is stored in a shared buffer, the copy will
+	 *  refer to the same buffer. Otherwise, the data is copied into a new shared buffer, so
+	 *  that further copies of the copy are cheap.
+	 */
 	MIPMediaMessage *createCopy() const;
 private:
 	bool m_deleteData;
 	uint8_t *m_pData;
 	size_t m_dataLength;
+	MIPSharedBuffer *m_pBuffer;
+	bool m_conceal;
+	bool m_useFEC;
+	int m_tier;
 };
 
 inline MIPMediaMessage *MIPEncodedAudioMessage::createCopy() const
 {
-	uint8_t *pBytes = new uint8_t [m_dataLength];
+	MIPEncodedAudioMessage *pMsg = 0;
+
+	if (m_pBuffer)
+	{
+		m_pBuffer->addReference();
+		pMsg = new MIPEncodedAudioMessage(getMessageSubtype(), getSamplingRate(), getNumberOfChannels(), 
+		                                  getNumberOfFrames(), m_pBuffer, m_dataLength);
+	}
+	else if (m_pData == 0) // can happen for concealment messages
+		pMsg = new MIPEncodedAudioMessage(getMessageSubtype(), getSamplingRate(), getNumberOfChannels(),
+		                                  getNumberOfFrames(), 0, 0, true);
+	else
+		pMsg = new MIPEncodedAudioMessage(getMessageSubtype(), getSamplingRate(), getNumberOfChannels(), 
+		                                  getNumberOfFrames(), MIPSharedBuffer::createCopy(m_pData, m_dataLength), m_dataLength);
 
-	memcpy(pBytes, m_pData, m_dataLength);
-	MIPMediaMessage *pMsg = new MIPEncodedAudioMessage(getMessageSubtype(), getSamplingRate(),
-			                                   getNumberOfChannels(), getNumberOfFrames(),
-							   pBytes, m_dataLength, true);
 	pMsg->copyMediaInfoFrom(*this);
+	if (m_conceal)
+		pMsg->setConcealment(m_useFEC);
+	pMsg->setEncodingTier(m_tier);
 	return pMsg;
 }
 
@@ -41,8 +41,20 @@
  * 	\brief Subtype for encoded video message using H.263+ encoding.
  */
 
+/**
+ * \def MIPENCODEDVIDEOMESSAGE_TYPE_H264
+ * 	\brief Subtype for encoded video message using H.264 encoding, stored as an Annex B byte stream.
+ */
+
+/**
+ * \def MIPENCODEDVIDEOMESSAGE_TYPE_VP8
+ * 	\brief Subtype for encoded video message using VP8 encoding.
+ */
+
 #define MIPENCODEDVIDEOMESSAGE_TYPE_H263P							0x00000001
 #define MIPENCODEDVIDEOMESSAGE_TYPE_JPEG							0x00000002
+#define MIPENCODEDVIDEOMESSAGE_TYPE_H264							0x00000004
+#define MIPENCODEDVIDEOMESSAGE_TYPE_VP8								0x00000008
 
 /** Container for encoded video data. */
 class EMIPLIB_IMPORTEXPORT MIPEncodedVideoMessage : public MIPVideoMessage
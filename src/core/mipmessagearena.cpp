@@ -0,0 +1,123 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+#include "mipconfig.h"
+#include "mipmessagearena.h"
+
+#include "mipdebug.h"
+
+#define MIPMESSAGEARENA_ALIGNMENT						16
+
+MIPMessageArena::MIPMessageArena(size_t blockSize)
+{
+	m_blockSize = blockSize;
+	m_currentBlock = 0;
+	m_offset = 0;
+	m_bytesUsed = 0;
+}
+
+MIPMessageArena::~MIPMessageArena()
+{
+	reset();
+
+	for (size_t i = 0 ; i < m_blocks.size() ; i++)
+		delete [] m_blocks[i].m_pData;
+}
+
+void *MIPMessageArena::allocate(size_t size)
+{
+	size = (size + MIPMESSAGEARENA_ALIGNMENT - 1) & ~((size_t)(MIPMESSAGEARENA_ALIGNMENT - 1));
+	if (size == 0)
+		size = MIPMESSAGEARENA_ALIGNMENT;
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	// Look for the first block, starting at the current one, which still has room.
+	// Blocks which were added in earlier iterations are reused this way.
+	while (m_currentBlock < m_blocks.size())
+	{
+		Block &block = m_blocks[m_currentBlock];
+
+		if (m_offset + size <= block.m_size)
+		{
+			uint8_t *pMem = block.m_pData + m_offset;
+
+			m_offset += size;
+			m_bytesUsed += size;
+			return pMem;
+		}
+		m_currentBlock++;
+		m_offset = 0;
+	}
+
+	size_t blockSize = (size > m_blockSize)?size:m_blockSize;
+
+	// The memory returned by new is suitably aligned for any type, which is
+	// at least MIPMESSAGEARENA_ALIGNMENT on the platforms we support
+	m_blocks.push_back(Block(new uint8_t[blockSize], blockSize));
+	m_currentBlock = m_blocks.size() - 1;
+	m_offset = size;
+	m_bytesUsed += size;
+
+	return m_blocks.back().m_pData;
+}
+
+void MIPMessageArena::addMessage(MIPMessage *pMsg)
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	m_messages.push_back(pMsg);
+}
+
+void MIPMessageArena::reset()
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	// Destroy the messages in reverse order, in case a later one refers to an earlier one
+	for (size_t i = m_messages.size() ; i > 0 ; i--)
+		m_messages[i-1]->~MIPMessage();
+
+	m_messages.clear();
+	m_currentBlock = 0;
+	m_offset = 0;
+	m_bytesUsed = 0;
+}
+
+size_t MIPMessageArena::getBytesUsed() const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+
+	return m_bytesUsed;
+}
+
+size_t MIPMessageArena::getCapacity() const
+{
+	std::lock_guard<std::mutex> guard(m_mutex);
+	size_t capacity = 0;
+
+	for (size_t i = 0 ; i < m_blocks.size() ; i++)
+		capacity += m_blocks[i].m_size;
+	return capacity;
+}
+
@@ -0,0 +1,120 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+/**
+ * \file mipmessagearena.h
+ */
+
+#ifndef MIPMESSAGEARENA_H
+
+#define MIPMESSAGEARENA_H
+
+#include "mipconfig.h"
+#include "miptypes.h"
+#include "mipmessage.h"
+#include <stddef.h>
+#include <new>
+#include <utility>
+#include <vector>
+#include <mutex>
+
+#define MIPMESSAGEARENA_DEFAULTBLOCKSIZE					(256*1024)
+
+/** Memory for the messages that are produced during a single iteration of a chain.
+ *  Memory for the messages that are produced during a single iteration of a chain. Each
+ *  MIPComponentChain owns such an arena and resets it at the start of every iteration, so
+ *  everything which was allocated in the arena stays valid until the next iteration starts.
+ *  This is exactly the lifetime of the output messages of most components, which can
+ *  therefore allocate both the message and its data here instead of with \c new, and don't
+ *  need to delete them afterwards. Allocation simply advances a pointer in a block of memory.
+ *  The blocks are kept when the arena is reset, so once the chain has been running for a few
+ *  iterations, no more memory needs to be allocated from the heap.
+ *
+ *  Messages must be created with MIPMessageArena::createMessage, which makes sure that their
+ *  destructor is called when the arena is reset. A component which stores such a message in
+ *  its output queue must not delete it. Messages which need to live longer, for example 
+ *  because they are buffered, should be copied using their \c createCopy function. Components 
+ *  which pass their output to another chain should not use the arena of the chain in which
+ *  their \c push function was called.
+ */
+class EMIPLIB_IMPORTEXPORT MIPMessageArena
+{
+public:
+	/** Creates an arena which allocates memory from the heap in blocks of \c blockSize bytes. */
+	MIPMessageArena(size_t blockSize = MIPMESSAGEARENA_DEFAULTBLOCKSIZE);
+	~MIPMessageArena();
+
+	/** Returns \c size bytes of memory, aligned on a 16 byte boundary.
+	 *  Returns \c size bytes of memory, aligned on a 16 byte boundary. The memory remains
+	 *  valid until the arena is reset.
+	 */
+	void *allocate(size_t size);
+
+	/** Returns room for \c num elements of type \c T, which must not need a destructor. */
+	template<class T>
+	T *allocateArray(size_t num)								{ return (T *)allocate(num*sizeof(T)); }
+
+	/** Creates a message of type \c T in the arena.
+	 *  Creates a message of type \c T in the arena, passing \c args to its constructor. The
+	 *  message is destroyed when the arena is reset, so it must not be deleted.
+	 */
+	template<class T, class... Args>
+	T *createMessage(Args&&... args)
+	{
+		T *pMsg = new (allocate(sizeof(T))) T(std::forward<Args>(args)...);
+		addMessage(pMsg);
+		return pMsg;
+	}
+
+	/** Destroys the messages in the arena and makes all memory available again. */
+	void reset();
+
+	/** Returns the number of bytes that were allocated since the last reset. */
+	size_t getBytesUsed() const;
+
+	/** Returns the amount of memory that the arena has obtained from the heap. */
+	size_t getCapacity() const;
+private:
+	class Block
+	{
+	public:
+		Block(uint8_t *pData, size_t size)						{ m_pData = pData; m_size = size; }
+
+		uint8_t *m_pData;
+		size_t m_size;
+	};
+
+	void addMessage(MIPMessage *pMsg);
+
+	size_t m_blockSize;
+	std::vector<Block> m_blocks;
+	std::vector<MIPMessage *> m_messages;
+	size_t m_currentBlock;
+	size_t m_offset;
+	size_t m_bytesUsed;
+	mutable std::mutex m_mutex;
+};
+
+#endif // MIPMESSAGEARENA_H
+
@@ -32,6 +32,7 @@
 
 #include "mipconfig.h"
 #include "mipaudiomessage.h"
+#include "mipsharedbuffer.h"
 #include "miptime.h"
 #include <string.h>
 
@@ -85,35 +86,84 @@ public:
 	 *                      deleted when this message is destroyed or when the data is replaced.
 	 */
 	MIPRawFloatAudioMessage(int sampRate, int numChannels, int numFrames, float *pFrames, bool deleteFrames) : MIPAudioMessage(true, MIPRAWAUDIOMESSAGE_TYPE_FLOAT, sampRate, numChannels, numFrames)
-												{ m_pFrames = pFrames; m_deleteFrames = deleteFrames; }
-	~MIPRawFloatAudioMessage()								{ if (m_deleteFrames) delete [] m_pFrames; }
+												{ m_pFrames = pFrames; m_deleteFrames = deleteFrames; m_pBuffer = 0; }
+
+	/** Creates a MIPRawFloatAudioMessage instance which stores its data in a shared buffer.
+	 *  Creates a MIPRawFloatAudioMessage instance which stores its data in a shared buffer.
+	 *  Copies of this message will refer to the same buffer instead of copying the audio data.
+	 *  \param sampRate Sampling rate.
+	 *  \param numChannels Number of channels.
+	 *  \param numFrames Number of frames.
+	 *  \param pBuffer Buffer containing the audio data. The message takes over the caller's
+	 *                 reference to this buffer.
+	 */
+	MIPRawFloatAudioMessage(int sampRate, int numChannels, int numFrames, MIPSharedBuffer *pBuffer) : MIPAudioMessage(true, MIPRAWAUDIOMESSAGE_TYPE_FLOAT, sampRate, numChannels, numFrames)
+												{ m_pFrames = (float *)pBuffer->getData(); m_deleteFrames = false; m_pBuffer = pBuffer; }
+	~MIPRawFloatAudioMessage()								{ releaseData(); }
 
 	/** Returns the audio data. */
 	const float *getFrames() const								{ return m_pFrames; }
 
+	/** Returns the audio data so that it can be modified in place.
+	 *  Returns the audio data so that it can be modified in place. If the data is stored in
+	 *  a shared buffer which is also used by another message, a private copy is made first.
+	 */
+	float *getWritableFrames()
+	{
+		if (m_pBuffer && m_pBuffer->isShared())
+		{
+			MIPSharedBuffer *pNewBuffer = MIPSharedBuffer::createCopy(m_pFrames, getNumberOfFrames()*getNumberOfChannels()*sizeof(float));
+
+			m_pBuffer->release();
+			m_pBuffer = pNewBuffer;
+			m_pFrames = (float *)pNewBuffer->getData();
+		}
+		return m_pFrames;
+	}
+
+	/** Returns the shared buffer in which the data is stored, or NULL if no such buffer is used. */
+	MIPSharedBuffer *getSharedBuffer() const						{ return m_pBuffer; }
+
 	/** Stores audio data.
 	 *  Stores audio data.
 	 *  \param pFrames The audio data.
 	 *  \param deleteFrames Flag indicating if the data contained in \c pFrames should be
 	 *                      deleted when this message is destroyed or when the data is replaced.
 	 */
-	void setFrames(float *pFrames, bool deleteFrames)					{ if (m_deleteFrames) delete [] m_pFrames; m_pFrames = pFrames; m_deleteFrames = deleteFrames; }
+	void setFrames(float *pFrames, bool deleteFrames)					{ releaseData(); m_pFrames = pFrames; m_deleteFrames = deleteFrames; }
 
-	/** Create a copy of this message. */
+	/** Create a copy of this message.
+	 *  Create a copy of this message. If the data is stored in a shared buffer, the copy will
+	 *  refer to the same buffer. Otherwise, the data is copied into a new shared buffer, so
+	 *  that further copies of the copy are cheap.
+	 */
 	MIPMediaMessage *createCopy() const
 	{
-		size_t numSamples = getNumberOfFrames()*getNumberOfChannels();
-		float *pFrames = new float [numSamples];
+		MIPSharedBuffer *pBuffer = m_pBuffer;
+
+		if (pBuffer)
+			pBuffer->addReference();
+		else
+			pBuffer = MIPSharedBuffer::createCopy(m_pFrames, getNumberOfFrames()*getNumberOfChannels()*sizeof(float));
 
-		memcpy(pFrames, m_pFrames, numSamples*sizeof(float));
 		MIPMediaMessage *pMsg = new MIPRawFloatAudioMessage(getSamplingRate(), getNumberOfChannels(),
-		                                                    getNumberOfFrames(), pFrames, true);
+		                                                    getNumberOfFrames(), pBuffer);
 		pMsg->copyMediaInfoFrom(*this);
 		return pMsg;
 	}
 private:
+	void releaseData()
+	{
+		if (m_pBuffer)
+			m_pBuffer->release();
+		else if (m_deleteFrames)
+			delete [] m_pFrames;
+		m_pBuffer = 0;
+	}
+
 	float *m_pFrames;
 	bool m_deleteFrames;
+	MIPSharedBuffer *m_pBuffer;
 };
 
 /** Container for unsigned eight-bit raw audio data. */
@@ -182,12 +232,50 @@ public:
 	 */
 	MIPRaw16bitAudioMessage(int sampRate, int numChannels, int numFrames, bool isSigned, SampleEncoding sampleEncoding, 
                                 uint16_t *pFrames, bool deleteFrames) : MIPAudioMessage(true, calcSubtype(isSigned, sampleEncoding), sampRate, numChannels, numFrames)
-												{ m_pFrames = pFrames; m_deleteFrames = deleteFrames; m_isSigned = isSigned; m_sampleEncoding = sampleEncoding; }
-	~MIPRaw16bitAudioMessage()								{ if (m_deleteFrames) delete [] m_pFrames; }
+												{ m_pFrames = pFrames; m_deleteFrames = deleteFrames; m_pBuffer = 0; m_isSigned = isSigned; m_sampleEncoding = sampleEncoding; }
 
-	/** Returns the audio data. */
+	/** Creates a MIPRaw16bitAudioMessage instance which stores its data in a shared buffer.
+	 *  Creates a MIPRaw16bitAudioMessage instance which stores its data in a shared buffer.
+	 *  Copies of this message will refer to the same buffer instead of copying the audio data.
+	 *  \param sampRate Sampling rate.
+	 *  \param numChannels Number of channels.
+	 *  \param numFrames Number of frames.
+	 *  \param isSigned Flag indicating if the samples are stored as signed or unsigned data.
+	 *  \param sampleEncoding Indicates if the samples are encoded in little endian, big endian or native format.
+	 *  \param pBuffer Buffer containing the audio data. The message takes over the caller's
+	 *                 reference to this buffer.
+	 */
+	MIPRaw16bitAudioMessage(int sampRate, int numChannels, int numFrames, bool isSigned, SampleEncoding sampleEncoding, 
+                                MIPSharedBuffer *pBuffer) : MIPAudioMessage(true, calcSubtype(isSigned, sampleEncoding), sampRate, numChannels, numFrames)
+												{ m_pFrames = (uint16_t *)pBuffer->getData(); m_deleteFrames = false; m_pBuffer = pBuffer; m_isSigned = isSigned; m_sampleEncoding = sampleEncoding; }
+	~MIPRaw16bitAudioMessage()								{ releaseData(); }
+
+	/** Returns the audio data.
+	 *  Returns the audio data. If the data is stored in a shared buffer (see getSharedBuffer), it
+	 *  must not be modified through this pointer; use getWritableFrames instead.
+	 */
 	uint16_t *getFrames() const								{ return m_pFrames; }
 
+	/** Returns the audio data so that it can be modified in place.
+	 *  Returns the audio data so that it can be modified in place. If the data is stored in
+	 *  a shared buffer which is also used by another message, a private copy is made first.
+	 */
+	uint16_t *getWritableFrames()
+	{
+		if (m_pBuffer && m_pBuffer->isShared())
+		{
+			MIPSharedBuffer *pNewBuffer = MIPSharedBuffer::createCopy(m_pFrames, getNumberOfFrames()*getNumberOfChannels()*sizeof(uint16_t));
+
+			m_pBuffer->release();
+			m_pBuffer = pNewBuffer;
+			m_pFrames = (uint16_t *)pNewBuffer->getData();
+		}
+		return m_pFrames;
+	}
+
+	/** Returns the shared buffer in which the data is stored, or NULL if no such buffer is used. */
+	MIPSharedBuffer *getSharedBuffer() const						{ return m_pBuffer; }
+
 	/** Stores audio data.
 	 *  Stores audio data.
 	 *  \param isSigned Flag indicating if the samples are stored as signed or unsigned data.
@@ -197,7 +285,7 @@ public:
 	 *                      deleted when this message is destroyed or when the data is replaced.
 	 */
 	void setFrames(bool isSigned, SampleEncoding sampleEncoding, uint16_t *pFrames, bool deleteFrames)
-												{ if (m_deleteFrames) delete [] m_pFrames; m_pFrames = pFrames; m_deleteFrames = deleteFrames; setMessageSubtype(calcSubtype(isSigned, sampleEncoding)); m_sampleEncoding = sampleEncoding; m_isSigned = isSigned; }
+												{ releaseData(); m_pFrames = pFrames; m_deleteFrames = deleteFrames; setMessageSubtype(calcSubtype(isSigned, sampleEncoding)); m_sampleEncoding = sampleEncoding; m_isSigned = isSigned; }
 
 	/** Returns \c true if the stored data uses a signed encoding, \c false otherwise. */
 	bool isSigned() const									{ return m_isSigned; }
@@ -214,20 +302,37 @@ public:
 	/** Returns sample encoding. */
 	SampleEncoding getSampleEncoding() const						{ return m_sampleEncoding; } 
 
-	/** Create a copy of this message. */
+	/** Create a copy of this message.
+	 *  Create a copy of this message. If the data is stored in a shared buffer, the copy will
+	 *  refer to the same buffer. Otherwise, the data is copied into a new shared buffer, so
+	 *  that further copies of the copy are cheap.
+	 */
 	MIPMediaMessage *createCopy() const
 	{
-		size_t numSamples = getNumberOfFrames()*getNumberOfChannels();
-		uint16_t *pFrames = new uint16_t [numSamples];
+		MIPSharedBuffer *pBuffer = m_pBuffer;
+
+		if (pBuffer)
+			pBuffer->addReference();
+		else
+			pBuffer = MIPSharedBuffer::createCopy(m_pFrames, getNumberOfFrames()*getNumberOfChannels()*sizeof(uint16_t));
 
-		memcpy(pFrames, m_pFrames, numSamples*sizeof(uint16_t));
 		MIPMediaMessage *pMsg = new MIPRaw16bitAudioMessage(getSamplingRate(), getNumberOfChannels(),
 		                                                    getNumberOfFrames(), m_isSigned, 
-								    m_sampleEncoding, pFrames, true);
+								    m_sampleEncoding, pBuffer);
 		pMsg->copyMediaInfoFrom(*this);
 		return pMsg;
 	}
 private:
+	void releaseData()
+	{
+		if (m_pBuffer)
+			m_pBuffer->release();
+		else if (m_deleteFrames)
+			delete [] m_pFrames;
+		m_pBuffer = 0;
+	}
+
+
 	static inline uint32_t calcSubtype(bool isSigned, SampleEncoding sampleEncoding)
 	{
 		if (isSigned)
@@ -247,6 +352,7 @@ private:
 	
 	uint16_t *m_pFrames;
 	bool m_deleteFrames;
+	MIPSharedBuffer *m_pBuffer;
 	bool m_isSigned;
 	SampleEncoding m_sampleEncoding;
 };
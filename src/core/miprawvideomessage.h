@@ -32,6 +32,7 @@
 
 #include "mipconfig.h"
 #include "mipvideomessage.h"
+#include "mipsharedbuffer.h"
 #include "miptypes.h"
 #include "miptime.h"
 #include <string.h>
@@ -69,26 +70,65 @@ public:
 	 *                    deleted when this message is destroyed or when the data is replaced.
 	 */
 	MIPRawYUV420PVideoMessage(int width, int height, uint8_t *pData, bool deleteData) : MIPVideoMessage(true, MIPRAWVIDEOMESSAGE_TYPE_YUV420P, width, height)
-												{ m_pData = pData; m_deleteData = deleteData; }
-	~MIPRawYUV420PVideoMessage()								{ if (m_deleteData) delete [] m_pData; }
+												{ m_pData = pData; m_deleteData = deleteData; m_pBuffer = 0; }
+
+	/** Creates a raw video message with a YUV420P representation, stored in a shared buffer.
+	 *  Creates a raw video message with a YUV420P representation, stored in a shared buffer.
+	 *  Copies of this message will refer to the same buffer instead of copying the frame.
+	 *  \param width Width of the video frame.
+	 *  \param height Height of the video frame.
+	 *  \param pBuffer Buffer containing the data of the video frame. The message takes over
+	 *                 the caller's reference to this buffer.
+	 */
+	MIPRawYUV420PVideoMessage(int width, int height, MIPSharedBuffer *pBuffer) : MIPVideoMessage(true, MIPRAWVIDEOMESSAGE_TYPE_YUV420P, width, height)
+												{ m_pData = pBuffer->getData(); m_deleteData = false; m_pBuffer = pBuffer; }
+	~MIPRawYUV420PVideoMessage()								{ if (m_pBuffer) m_pBuffer->release(); else if (m_deleteData) delete [] m_pData; }
 
 	/** Returns the image data. */
 	const uint8_t *getImageData() const							{ return m_pData; }
 
-	/** Returns a copy of the message. */
+	/** Returns the image data so that it can be modified in place.
+	 *  Returns the image data so that it can be modified in place. If the data is stored in
+	 *  a shared buffer which is also used by another message, a private copy is made first.
+	 */
+	uint8_t *getWritableImageData()
+	{
+		if (m_pBuffer && m_pBuffer->isShared())
+		{
+			MIPSharedBuffer *pNewBuffer = MIPSharedBuffer::createCopy(m_pData, (getWidth()*getHeight()*3)/2);
+
+			m_pBuffer->release();
+			m_pBuffer = pNewBuffer;
+			m_pData = pNewBuffer->getData();
+		}
+		return m_pData;
+	}
+
+	/** Returns the shared buffer in which the data is stored, or NULL if no such buffer is used. */
+	MIPSharedBuffer *getSharedBuffer() const						{ return m_pBuffer; }
+
+	/** Returns a copy of the message.
+	 *  Returns a copy of the message. If the frame is stored in a shared buffer, the copy will
+	 *  refer to the same buffer. Otherwise, the frame is copied into a new shared buffer, so
+	 *  that further copies of the copy are cheap.
+	 */
 	MIPMediaMessage *createCopy() const
 	{
-		size_t dataSize = (getWidth()*getHeight()*3)/2;
-		uint8_t *pData = new uint8_t [dataSize];
+		MIPSharedBuffer *pBuffer = m_pBuffer;
 
-		memcpy(pData, m_pData, dataSize);
-		MIPMediaMessage *pMsg = new MIPRawYUV420PVideoMessage(getWidth(), getHeight(), pData, true);
+		if (pBuffer)
+			pBuffer->addReference();
+		else
+			pBuffer = MIPSharedBuffer::createCopy(m_pData, (getWidth()*getHeight()*3)/2);
+
+		MIPMediaMessage *pMsg = new MIPRawYUV420PVideoMessage(getWidth(), getHeight(), pBuffer);
 		pMsg->copyMediaInfoFrom(*this);
 		return pMsg;
 	}
 private:
 	bool m_deleteData;
 	uint8_t *m_pData;
+	MIPSharedBuffer *m_pBuffer;
 };
 
 /** Container for an YUYV encoded raw video frame. */
@@ -33,6 +33,7 @@
 #include "mipconfig.h"
 #include "mipmessage.h"
 #include "miptime.h"
+#include "mipsharedbuffer.h"
 #include <jrtplib3/rtpsession.h>
 #include <jrtplib3/rtppacket.h>
 #include <string.h>
@@ -66,7 +67,7 @@ public:
 	 */
 	MIPRTPSendMessage(uint8_t *pData, size_t dataLength, uint8_t payloadType, bool marker,
 	                  uint32_t tsInc, bool deleteData = true) : MIPMessage(MIPMESSAGE_TYPE_RTP, MIPRTPMESSAGE_TYPE_SEND)
-													{ m_pData = pData; m_dataLength = dataLength; m_payloadType = payloadType; m_marker = marker; m_tsInc = tsInc; m_deleteData = deleteData; }
+													{ m_pData = pData; m_dataLength = dataLength; m_payloadType = payloadType; m_marker = marker; m_tsInc = tsInc; m_deleteData = deleteData; m_comfortNoise = false; }
 	~MIPRTPSendMessage()										{ if (m_deleteData) delete [] m_pData; }
 
 	/** Returns the payload data. */
@@ -89,6 +90,12 @@ public:
 
 	/** Returns the sampling instant as set by the MIPRTPSendMessage::setSamplingInstant function. */
 	MIPTime getSamplingInstant() const								{ return m_samplingInstant; }
+
+	/** Marks the payload as comfort noise, so that MIPRTPComponent does not treat it as the start of a talk spurt. */
+	void setComfortNoise(bool f)									{ m_comfortNoise = f; }
+
+	/** Returns \c true if the payload was marked as comfort noise. */
+	bool isComfortNoise() const									{ return m_comfortNoise; }
 private:
 	uint8_t *m_pData;
 	size_t m_dataLength;
@@ -96,6 +103,7 @@ private:
 	bool m_marker;
 	uint32_t m_tsInc;
 	bool m_deleteData;
+	bool m_comfortNoise;
 	MIPTime m_samplingInstant;
 };
 
@@ -122,12 +130,35 @@ public:
 	 *               memory.
 	 */
 	MIPRTPReceiveMessage(jrtplib::RTPPacket *pPack, const uint8_t *pCName, size_t cnameLength, bool deletePacket = true, jrtplib::RTPSession *pSess = 0) : MIPMessage(MIPMESSAGE_TYPE_RTP, MIPRTPMESSAGE_TYPE_RECEIVE), m_jitter(0)
-													{ m_deletePacket = deletePacket; m_pPack = pPack; if (cnameLength > MIPRTPMESSAGE_MAXCNAMELENGTH) m_cnameLength = MIPRTPMESSAGE_MAXCNAMELENGTH; else m_cnameLength = cnameLength; if (cnameLength > 0) memcpy(m_cname,pCName,m_cnameLength); m_tsUnit = -1; m_tsUnitEstimate = -1; m_timingInfoSet = false; m_sourceID = 0; m_pSession = pSess; }
-	~MIPRTPReceiveMessage()										{ if (m_deletePacket) { if (m_pSession) m_pSession->DeletePacket(m_pPack); else delete m_pPack; } }
+													{ m_pPack = 0; m_deletePacket = false; m_pPayloadBuffer = 0; setPacket(pPack, pCName, cnameLength, deletePacket, pSess); }
+	~MIPRTPReceiveMessage()										{ releasePacket(); }
+
+	/** Stores another received RTP packet in this message, so that the message object can be reused.
+	 *  Stores another received RTP packet in this message, so that the message object can be 
+	 *  reused. The packet that was stored previously is released first, and the other information 
+	 *  (jitter, timestamp units, timing info and source ID) is reset. The parameters have the same 
+	 *  meaning as in the constructor.
+	 */
+	void setPacket(jrtplib::RTPPacket *pPack, const uint8_t *pCName, size_t cnameLength, bool deletePacket = true, jrtplib::RTPSession *pSess = 0)
+													{ releasePacket(); m_deletePacket = deletePacket; m_pPack = pPack; if (cnameLength > MIPRTPMESSAGE_MAXCNAMELENGTH) m_cnameLength = MIPRTPMESSAGE_MAXCNAMELENGTH; else m_cnameLength = cnameLength; if (cnameLength > 0) memcpy(m_cname,pCName,m_cnameLength); m_jitter = MIPTime(0); m_tsUnit = -1; m_tsUnitEstimate = -1; m_timingInfoSet = false; m_sourceID = 0; m_pSession = pSess; }
+
+	/** Releases the stored RTP packet, deallocating it if the message owns it and it is no longer used by a payload buffer. */
+	void releasePacket()										{ if (m_pPayloadBuffer) m_pPayloadBuffer->release(); m_pPayloadBuffer = 0; if (m_deletePacket && m_pPack) { if (m_pSession) m_pSession->DeletePacket(m_pPack); else delete m_pPack; } m_pPack = 0; m_deletePacket = false; }
 
 	/** Returns the received packet. */
 	const jrtplib::RTPPacket *getPacket() const							{ return m_pPack; }
 
+	/** Returns a shared buffer containing the payload of the RTP packet.
+	 *  Returns a shared buffer containing the payload of the RTP packet, which can be used to
+	 *  create media messages that don't need their own copy of the data. The caller receives
+	 *  a new reference to the buffer, which it must release when done. If the message owns the
+	 *  packet and the packet was not allocated by a jrtplib memory manager, the buffer refers
+	 *  directly to the packet's memory and the ownership of the packet is transferred to the
+	 *  buffer: the packet will only be deleted when this message and all users of the buffer 
+	 *  have released it. Otherwise, the payload is copied once into a pooled buffer.
+	 */
+	MIPSharedBuffer *getPayloadBuffer();
+
 	/** Returns a pointer to the CNAME data of the sender of this packet. */
 	const uint8_t *getCName() const									{ return m_cname; }
 
@@ -167,8 +198,11 @@ public:
 	/** Returns the source ID which should be used further on. */
 	uint64_t getSourceID() const									{ return m_sourceID; }
 private:
+	static void deletePacket(void *pPack)								{ delete (jrtplib::RTPPacket *)pPack; }
+
 	jrtplib::RTPPacket *m_pPack;
 	jrtplib::RTPSession *m_pSession;
+	MIPSharedBuffer *m_pPayloadBuffer;
 	uint8_t m_cname[MIPRTPMESSAGE_MAXCNAMELENGTH];
 	size_t m_cnameLength;
 	bool m_deletePacket;
@@ -180,5 +214,27 @@ private:
 	uint64_t m_sourceID;
 };
 
+inline MIPSharedBuffer *MIPRTPReceiveMessage::getPayloadBuffer()
+{
+	if (m_pPayloadBuffer == 0)
+	{
+		uint8_t *pPayload = m_pPack->GetPayloadData();
+		size_t payloadLength = m_pPack->GetPayloadLength();
+
+		// Without a memory manager, RTPSession::DeletePacket is the same as a plain delete,
+		// which can safely be done when the last reference to the buffer is released, even
+		// if the session no longer exists by then
+		if (m_deletePacket && (m_pSession == 0 || m_pSession->GetMemoryManager() == 0))
+		{
+			m_pPayloadBuffer = MIPSharedBuffer::createReference(pPayload, payloadLength, deletePacket, m_pPack);
+			m_deletePacket = false;
+		}
+		else
+			m_pPayloadBuffer = MIPSharedBuffer::createCopy(pPayload, payloadLength);
+	}
+	m_pPayloadBuffer->addReference();
+	return m_pPayloadBuffer;
+}
+
 #endif // MIPRTPMESSAGE_H
 
@@ -0,0 +1,181 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+#include "mipconfig.h"
+#include "mipsharedbuffer.h"
+#include <jthread/jmutex.h>
+#include <string.h>
+#include <vector>
+#include <cstdlib>
+#include <iostream>
+
+#include "mipdebug.h"
+
+#define MIPSHAREDBUFFER_MINSHIFT						8
+#define MIPSHAREDBUFFER_NUMCLASSES						16
+#define MIPSHAREDBUFFER_DEFAULTPOOLSIZE						64
+
+// Keeps unused buffers around, one free list per power of two between 256 bytes
+// and 8 MB. Larger buffers are simply allocated and deleted.
+class MIPSharedBufferPool
+{
+public:
+	MIPSharedBufferPool()
+	{
+		int status;
+
+		if ((status = m_mutex.Init()) < 0)
+		{
+			std::cerr << "Error: can't initialize shared buffer pool mutex (JMutex error code " << status << ")" << std::endl;
+			exit(-1);
+		}
+		m_maxPoolSize = MIPSHAREDBUFFER_DEFAULTPOOLSIZE;
+	}
+
+	MIPSharedBuffer *allocate(size_t size)
+	{
+		int sizeClass = getSizeClass(size);
+
+		if (sizeClass < 0)
+			return new MIPSharedBuffer(new uint8_t[size], size, -1);
+
+		MIPSharedBuffer *pBuffer = 0;
+
+		m_mutex.Lock();
+		std::vector<MIPSharedBuffer *> &freeList = m_freeLists[sizeClass];
+		if (!freeList.empty())
+		{
+			pBuffer = freeList.back();
+			freeList.pop_back();
+		}
+		m_mutex.Unlock();
+
+		if (pBuffer)
+		{
+			pBuffer->m_refCount = 1;
+			return pBuffer;
+		}
+		
+		size_t capacity = ((size_t)1) << (sizeClass + MIPSHAREDBUFFER_MINSHIFT);
+		return new MIPSharedBuffer(new uint8_t[capacity], capacity, sizeClass);
+	}
+
+	void recycle(MIPSharedBuffer *pBuffer)
+	{
+		if (pBuffer->m_sizeClass >= 0)
+		{
+			m_mutex.Lock();
+			std::vector<MIPSharedBuffer *> &freeList = m_freeLists[pBuffer->m_sizeClass];
+			if ((int)freeList.size() < m_maxPoolSize)
+			{
+				freeList.push_back(pBuffer);
+				pBuffer = 0;
+			}
+			m_mutex.Unlock();
+		}
+		delete pBuffer;
+	}
+
+	void setMaximumPoolSize(int num)
+	{
+		std::vector<MIPSharedBuffer *> superfluousBuffers;
+
+		m_mutex.Lock();
+		m_maxPoolSize = num;
+		for (int i = 0 ; i < MIPSHAREDBUFFER_NUMCLASSES ; i++)
+		{
+			while ((int)m_freeLists[i].size() > num)
+			{
+				superfluousBuffers.push_back(m_freeLists[i].back());
+				m_freeLists[i].pop_back();
+			}
+		}
+		m_mutex.Unlock();
+
+		for (size_t i = 0 ; i < superfluousBuffers.size() ; i++)
+			delete superfluousBuffers[i];
+	}
+private:
+	static int getSizeClass(size_t size)
+	{
+		int sizeClass = 0;
+		size_t capacity = ((size_t)1) << MIPSHAREDBUFFER_MINSHIFT;
+
+		while (capacity < size)
+		{
+			capacity <<= 1;
+			sizeClass++;
+			if (sizeClass >= MIPSHAREDBUFFER_NUMCLASSES)
+				return -1;
+		}
+		return sizeClass;
+	}
+
+	jthread::JMutex m_mutex;
+	std::vector<MIPSharedBuffer *> m_freeLists[MIPSHAREDBUFFER_NUMCLASSES];
+	int m_maxPoolSize;
+};
+
+// The pool is never destroyed, so buffers which are still in use when the
+// program exits can safely be released.
+static MIPSharedBufferPool &getPool()
+{
+	static MIPSharedBufferPool *pPool = new MIPSharedBufferPool();
+	return *pPool;
+}
+
+MIPSharedBuffer *MIPSharedBuffer::allocate(size_t size)
+{
+	return getPool().allocate(size);
+}
+
+MIPSharedBuffer *MIPSharedBuffer::createCopy(const void *pData, size_t size)
+{
+	MIPSharedBuffer *pBuffer = getPool().allocate(size);
+
+	memcpy(pBuffer->getData(), pData, size);
+	return pBuffer;
+}
+
+MIPSharedBuffer *MIPSharedBuffer::createReference(uint8_t *pData, size_t size, void (*pReleaseFunction)(void *), void *pReleaseParam)
+{
+	// A size class of -1 makes sure that the buffer is deleted instead of being recycled
+	MIPSharedBuffer *pBuffer = new MIPSharedBuffer(pData, size, -1);
+
+	pBuffer->m_pReleaseFunction = pReleaseFunction;
+	pBuffer->m_pReleaseParam = pReleaseParam;
+	return pBuffer;
+}
+
+void MIPSharedBuffer::setMaximumPoolSize(int num)
+{
+	getPool().setMaximumPoolSize(num);
+}
+
+void MIPSharedBuffer::release()
+{
+	if (m_refCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		getPool().recycle(this);
+}
+
@@ -0,0 +1,104 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+/**
+ * \file mipsharedbuffer.h
+ */
+
+#ifndef MIPSHAREDBUFFER_H
+
+#define MIPSHAREDBUFFER_H
+
+#include "mipconfig.h"
+#include "miptypes.h"
+#include <stddef.h>
+#include <atomic>
+
+/** A reference counted block of memory, obtained from a pool of buffers.
+ *  Media messages can store their data in such a buffer instead of in a block
+ *  of memory allocated with \c new. In that case, creating a copy of the message
+ *  only increases the reference count of the buffer instead of copying all the
+ *  data, which avoids a lot of copying in components like MIPMediaBuffer and
+ *  MIPVideoMixer. When the last reference is released, the memory is returned
+ *  to a pool and will be reused for a later buffer of a similar size.
+ *
+ *  Since the data can be shared between several messages, it must not be
+ *  modified unless the buffer is not shared. The media messages which support
+ *  these buffers provide a function to obtain writable data, which will first
+ *  make a private copy of the data if needed (copy-on-write).
+ */
+class EMIPLIB_IMPORTEXPORT MIPSharedBuffer
+{
+public:
+	/** Returns a buffer with room for at least \c size bytes and a reference count of one. */
+	static MIPSharedBuffer *allocate(size_t size);
+
+	/** Returns a new buffer containing a copy of the \c size bytes pointed to by \c pData. */
+	static MIPSharedBuffer *createCopy(const void *pData, size_t size);
+
+	/** Creates a buffer which refers to memory that is owned by someone else.
+	 *  Creates a buffer which refers to memory that is owned by someone else, for example the
+	 *  payload inside a received RTP packet. The buffer has a reference count of one and is not
+	 *  taken from the pool: when the last reference is released, \c pReleaseFunction is called 
+	 *  with \c pReleaseParam as its argument so that the owner can free the memory.
+	 *  \param pData The memory that the buffer should refer to.
+	 *  \param size The number of bytes in \c pData.
+	 *  \param pReleaseFunction Function which is called when the buffer is no longer used.
+	 *  \param pReleaseParam Argument for the release function.
+	 */
+	static MIPSharedBuffer *createReference(uint8_t *pData, size_t size, void (*pReleaseFunction)(void *), void *pReleaseParam);
+
+	/** Sets the maximum number of unused buffers kept for each buffer size (default is 64). */
+	static void setMaximumPoolSize(int num);
+
+	/** Increases the reference count of the buffer. */
+	void addReference()									{ m_refCount.fetch_add(1, std::memory_order_relaxed); }
+
+	/** Decreases the reference count, returning the buffer to the pool when it is no longer used. */
+	void release();
+
+	/** Returns \c true if the buffer is being used by more than one owner. */
+	bool isShared() const									{ return m_refCount.load(std::memory_order_acquire) > 1; }
+
+	/** Returns the data stored in the buffer. */
+	uint8_t *getData() const								{ return m_pData; }
+
+	/** Returns the number of bytes that can be stored in the buffer. */
+	size_t getCapacity() const								{ return m_capacity; }
+private:
+	MIPSharedBuffer(uint8_t *pData, size_t capacity, int sizeClass)				{ m_pData = pData; m_capacity = capacity; m_sizeClass = sizeClass; m_refCount = 1; m_pReleaseFunction = 0; m_pReleaseParam = 0; }
+	~MIPSharedBuffer()									{ if (m_pReleaseFunction) m_pReleaseFunction(m_pReleaseParam); else delete [] m_pData; }
+
+	uint8_t *m_pData;
+	size_t m_capacity;
+	int m_sizeClass;
+	void (*m_pReleaseFunction)(void *);
+	void *m_pReleaseParam;
+	std::atomic<int> m_refCount;
+
+	friend class MIPSharedBufferPool;
+};
+
+#endif // MIPSHAREDBUFFER_H
+
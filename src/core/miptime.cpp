@@ -27,6 +27,88 @@
 #include "mipcompat.h"
 #include <inttypes.h>
 #include <string>
+#if (defined(WIN32) || defined(_WIN32_WCE))
+	#include <windows.h>
+#else
+	#include <time.h>
+	#include <errno.h>
+#endif // WIN32 || _WIN32_WCE
+
+#if (defined(WIN32) || defined(_WIN32_WCE))
+static int64_t getPerformanceFrequency()
+{
+	LARGE_INTEGER frequency;
+
+	QueryPerformanceFrequency(&frequency);
+	return (int64_t)frequency.QuadPart;
+}
+#endif // WIN32 || _WIN32_WCE
+
+MIPTime MIPTime::getCurrentTime()
+{
+#if (defined(WIN32) || defined(_WIN32_WCE))
+	static const int64_t frequency = getPerformanceFrequency();
+	LARGE_INTEGER counter;
+
+	QueryPerformanceCounter(&counter);
+
+	int64_t ticks = (int64_t)counter.QuadPart;
+
+	return MIPTime::fromNanoSeconds((ticks/frequency)*1000000000 + ((ticks%frequency)*1000000000)/frequency);
+#elif defined(MIPCONFIG_HAVE_CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return MIPTime::fromNanoSeconds((int64_t)ts.tv_sec*1000000000 + (int64_t)ts.tv_nsec);
+#else
+	return getWallClockTime();
+#endif
+}
+
+MIPTime MIPTime::getWallClockTime()
+{
+	// we'll use the RTPTime for this
+	jrtplib::RTPTime tv = jrtplib::RTPTime::CurrentTime();
+	return MIPTime((int64_t)tv.GetSeconds(), (int64_t)tv.GetMicroSeconds());
+}
+
+void MIPTime::wait(const MIPTime &delay)
+{
+	if (delay.m_time < 0)
+		return;
+
+#ifdef MIPCONFIG_HAVE_CLOCK_NANOSLEEP
+	MIPTime deadline = getCurrentTime();
+
+	deadline += delay;
+	waitUntil(deadline);
+#else
+	jrtplib::RTPTime::Wait(jrtplib::RTPTime((double)delay.getValue()));
+#endif // MIPCONFIG_HAVE_CLOCK_NANOSLEEP
+}
+
+void MIPTime::waitUntil(const MIPTime &deadline)
+{
+#ifdef MIPCONFIG_HAVE_CLOCK_NANOSLEEP
+	if (deadline.m_time < 0)
+		return;
+
+	struct timespec ts;
+
+	ts.tv_sec = (time_t)(deadline.m_time/1000000000);
+	ts.tv_nsec = (long)(deadline.m_time%1000000000);
+
+	// An absolute deadline means that we can simply restart after an interruption
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, 0) == EINTR)
+		;
+#else
+	MIPTime delay = deadline;
+
+	delay -= getCurrentTime();
+	if (delay.m_time > 0)
+		jrtplib::RTPTime::Wait(jrtplib::RTPTime((double)delay.getValue()));
+#endif // MIPCONFIG_HAVE_CLOCK_NANOSLEEP
+}
 
 std::string MIPTime::getString() const
 {
@@ -40,31 +40,55 @@
 #include <jrtplib3/rtptimeutilities.h>
 
 /** This class is used for timing purposes.
- *  This class provides some time handling functions.
+ *  This class provides some time handling functions. Internally, a time value is
+ *  stored as a 64 bit integer number of nanoseconds, so that no precision is lost
+ *  when time values become large.
  */
 class EMIPLIB_IMPORTEXPORT MIPTime
 {
 public:
-	/** Returns a MIPTime object containing the current time. */
+	/** Returns a MIPTime object containing the current time.
+	 *  Returns a MIPTime object containing the current time. Where available, a 
+	 *  monotonic clock is used for this, which is not affected by adjustments of the
+	 *  system's wall clock time. This means that the value is only meaningful when
+	 *  compared to other values returned by this function. Use MIPTime::getWallClockTime
+	 *  if the actual time of day is needed.
+	 */
 	static MIPTime getCurrentTime();
 
+	/** Returns the current wall clock time, i.e. the time since the Unix epoch. */
+	static MIPTime getWallClockTime();
+
 	/** Pauses the current thread for the time contained in \c delay. */
 	static void wait(const MIPTime &delay);
+
+	/** Pauses the current thread until the time returned by MIPTime::getCurrentTime reaches \c deadline.
+	 *  Pauses the current thread until the time returned by MIPTime::getCurrentTime reaches \c deadline.
+	 *  When waiting repeatedly, using absolute deadlines avoids the accumulation of errors that
+	 *  occurs when the delays are calculated separately.
+	 */
+	static void waitUntil(const MIPTime &deadline);
+
+	/** Creates a time object containing the specified number of nanoseconds. */
+	static MIPTime fromNanoSeconds(int64_t nanoSeconds)				{ MIPTime t; t.m_time = nanoSeconds; return t; }
 	
-	/** Creates a time object containing the time corresponding to \c t. */
-	MIPTime(real_t t = 0.0)								{ m_time = t; }
+	/** Creates a time object containing the time corresponding to \c t seconds. */
+	MIPTime(real_t t = 0.0)								{ m_time = (int64_t)((t < 0)?(t*1000000000.0-0.5):(t*1000000000.0+0.5)); }
 
 	/** Creates a time object containing the time corresponding to the two parameters. */
-	MIPTime(int64_t seconds, int64_t microSeconds)					{ m_time = (((real_t)seconds)+(((real_t)microSeconds)/1000000.0)); }
+	MIPTime(int64_t seconds, int64_t microSeconds)					{ m_time = seconds*1000000000 + microSeconds*1000; }
 
 	/** Returns the number of seconds contained in the time object. */
-	int64_t getSeconds() const							{ return (int64_t)m_time; }
+	int64_t getSeconds() const							{ return m_time/1000000000; }
 
 	/** Returns the number of microseconds contained in the time object. */
 	int64_t getMicroSeconds() const;
 
+	/** Returns the time contained in this object as a number of nanoseconds. */
+	int64_t getNanoSeconds() const							{ return m_time; }
+
 	/** Returns a real value describing the time contained in this object. */
-	real_t getValue() const 							{ return m_time; }
+	real_t getValue() const 							{ return ((real_t)m_time)/1000000000.0; }
 
 	MIPTime &operator-=(const MIPTime &t);
 	MIPTime &operator+=(const MIPTime &t);
@@ -72,33 +96,20 @@ public:
 	bool operator>(const MIPTime &t) const;
 	bool operator<=(const MIPTime &t) const;
 	bool operator>=(const MIPTime &t) const;
+
 	std::string getString() const;
 private:
-	real_t m_time;
+	int64_t m_time;
 };
 
-inline MIPTime MIPTime::getCurrentTime()
-{
-	// we'll use the RTPTime for this
-	jrtplib::RTPTime tv = jrtplib::RTPTime::CurrentTime();
-	return MIPTime((int64_t)tv.GetSeconds(), (int64_t)tv.GetMicroSeconds());
-}
-
-inline void MIPTime::wait(const MIPTime &delay)
-{
-	if (delay.m_time < 0)
-		return;
-	jrtplib::RTPTime::Wait(jrtplib::RTPTime(delay.m_time));
-}
-
 inline int64_t MIPTime::getMicroSeconds() const
 {
-	real_t t = m_time;
+	int64_t t = m_time;
+
 	if (t < 0)
 		t = -t;
-	t -= (real_t)((int64_t)t);
-	t *= 1000000.0;
-	return (int64_t)t;
+
+	return (t%1000000000)/1000;
 }
 
 inline MIPTime &MIPTime::operator-=(const MIPTime &t)
@@ -75,6 +75,10 @@
 #include "mipopusencoder.h"
 #include "mipopenslesandroidinput.h"
 #include "mipopenslesandroidoutput.h"
+#include "mipvoiceactivitydetector.h"
+#include "miprtpcnencoder.h"
+#include "miprtpcndecoder.h"
+#include "mipcomfortnoisedecoder.h"
 #include <jrtplib3/rtpsession.h>
 #include <jrtplib3/rtpsessionparams.h>
 #include <jrtplib3/rtperrors.h>
@@ -95,6 +99,7 @@ using namespace jrtplib;
 #define MIPAUDIOSESSION_ERRSTR_NOGSM						"Can't use GSM codec since no GSM support was compiled in"
 #define MIPAUDIOSESSION_ERRSTR_NOOPUS						"Can't use Opus codec since no Opus support was compiled in"
 #define MIPAUDIOSESSION_ERRSTR_EQUALPAYLOADTYPES				"Incoming payload types for Speex and Opus must be different"
+#define MIPAUDIOSESSION_ERRSTR_CNPAYLOADTYPE					"The incoming payload type for comfort noise is already used by another codec"
 
 MIPAudioSession::MIPAudioSession()
 {
@@ -279,6 +284,41 @@ bool MIPAudioSession::init(const MIPAudioSessionParams *pParams, MIPRTPSynchroni
 
 #endif // MIPCONFIG_SUPPORT_OPENSLESANDROID
 
+	MIPVoiceActivityDetector *pVAD = 0;
+	MIPRTPCNEncoder *pRTPCNEnc = 0;
+	uint32_t audioMask = MIPMESSAGE_TYPE_ALL;
+
+	if (pParams2->getUseVoiceActivityDetection())
+	{
+		// The detector is placed before the splitter, so that it decides for a
+		// complete sampling interval, which is what MIPRTPComponent counts when
+		// increasing the timestamp for skipped intervals
+		pVAD = new MIPVoiceActivityDetector();
+		storeComponent(pVAD);
+
+		if (!pVAD->init())
+		{
+			setErrorString(pVAD->getErrorString());
+			deleteAll();
+			return false;
+		}
+		addLink(pActiveChain, &pPrevComponent, pVAD);
+
+		pRTPCNEnc = new MIPRTPCNEncoder();
+		storeComponent(pRTPCNEnc);
+
+		if (!pRTPCNEnc->init())
+		{
+			setErrorString(pRTPCNEnc->getErrorString());
+			deleteAll();
+			return false;
+		}
+		pRTPCNEnc->setPayloadType(pParams2->getComfortNoiseOutgoingPayloadType());
+		pActiveChain->addConnection(pVAD, pRTPCNEnc, false, MIPMESSAGE_TYPE_AUDIO_ENCODED, MIPENCODEDAUDIOMESSAGE_TYPE_CN);
+
+		audioMask = MIPMESSAGE_TYPE_AUDIO_RAW;
+	}
+
 	if (pParams2->getInputMultiplier() > 1)
 	{
 		MIPAudioSplitter *pSplitter = new MIPAudioSplitter();
@@ -290,7 +330,8 @@ bool MIPAudioSession::init(const MIPAudioSessionParams *pParams, MIPRTPSynchroni
 			deleteAll();
 			return false;
 		}
-		addLink(pActiveChain, &pPrevComponent, pSplitter);
+		addLink(pActiveChain, &pPrevComponent, pSplitter, false, audioMask);
+		audioMask = MIPMESSAGE_TYPE_ALL;
 	}
 
 	MIPSampleEncoder *pSampEnc = new MIPSampleEncoder();
@@ -314,7 +355,7 @@ bool MIPAudioSession::init(const MIPAudioSessionParams *pParams, MIPRTPSynchroni
 			return false;
 		}
 	}
-	addLink(pActiveChain, &pPrevComponent, pSampEnc);
+	addLink(pActiveChain, &pPrevComponent, pSampEnc, false, audioMask);
 	
 	switch (pParams2->getCompressionType())
 	{
@@ -577,7 +618,10 @@ bool MIPAudioSession::init(const MIPAudioSessionParams *pParams, MIPRTPSynchroni
 	m_pRTPComp = new MIPRTPComponent();
 	storeComponent(m_pRTPComp);
 	
-	if (!m_pRTPComp->init(m_pRTPSession))
+	// When silent intervals are skipped, the timestamp still needs to advance
+	uint32_t silentIncrement = (pVAD) ? (uint32_t)((double)sampRate*inputInterval.getValue() + 0.5) : 0;
+
+	if (!m_pRTPComp->init(m_pRTPSession, silentIncrement))
 	{
 		setErrorString(m_pRTPComp->getErrorString());
 		deleteAll();
@@ -585,6 +629,9 @@ bool MIPAudioSession::init(const MIPAudioSessionParams *pParams, MIPRTPSynchroni
 	}
 	addLink(pActiveChain, &pPrevComponent, m_pRTPComp);
 
+	if (pRTPCNEnc)
+		pActiveChain->addConnection(pRTPCNEnc, m_pRTPComp);
+
 	bool usingInterChainTiming = true;
 
 	if (pParams2->getDisableInterChainTimer())
@@ -607,6 +654,7 @@ bool MIPAudioSession::init(const MIPAudioSessionParams *pParams, MIPRTPSynchroni
 			storeComponent(pTimer);
 		
 			m_pOutputChain->setChainStart(pTimer);
+			m_pOutputChain->setScheduler(pParams2->getChainScheduler());
 		
 			pActiveChain = m_pOutputChain;
 			pPrevComponent = pTimer;
@@ -744,6 +792,32 @@ bool MIPAudioSession::init(const MIPAudioSessionParams *pParams, MIPRTPSynchroni
 		return false;
 	}
 
+	uint8_t cnPT = pParams2->getComfortNoiseIncomingPayloadType();
+
+	if (cnPT == 0 || cnPT == 3 || cnPT == 7 || cnPT == 8 || cnPT == 11
+#ifdef MIPCONFIG_SUPPORT_SPEEX
+	    || cnPT == pParams2->getSpeexIncomingPayloadType()
+#endif // MIPCONFIG_SUPPORT_SPEEX
+#ifdef MIPCONFIG_SUPPORT_OPUS
+	    || cnPT == pParams2->getOpusIncomingPayloadType()
+#endif // MIPCONFIG_SUPPORT_OPUS
+	   )
+	{
+		setErrorString(MIPAUDIOSESSION_ERRSTR_CNPAYLOADTYPE);
+		deleteAll();
+		return false;
+	}
+
+	MIPRTPCNDecoder *pRTPCNDec = new MIPRTPCNDecoder(sampRate);
+	storePacketDecoder(pRTPCNDec);
+
+	if (!pRTPDec->setPacketDecoder(cnPT, pRTPCNDec))
+	{
+		setErrorString(pRTPDec->getErrorString());
+		deleteAll();
+		return false;
+	}
+
 	MIPMediaBuffer *pMediaBuf = new MIPMediaBuffer();
 	storeComponent(pMediaBuf);
 	
@@ -857,6 +931,17 @@ bool MIPAudioSession::init(const MIPAudioSessionParams *pParams, MIPRTPSynchroni
 	pActiveChain->addConnection(pMediaBuf, pL16SampDec, false, MIPMESSAGE_TYPE_AUDIO_RAW, MIPRAWAUDIOMESSAGE_TYPE_S16BE);
 	pActiveChain->addConnection(pL16SampDec, pSampConv, false);
 
+	MIPComfortNoiseDecoder *pCNDec = new MIPComfortNoiseDecoder();
+	storeComponent(pCNDec);
+
+	if (!pCNDec->init())
+	{
+		setErrorString(pCNDec->getErrorString());
+		deleteAll();
+		return false;
+	}
+	pActiveChain->addConnection(pMediaBuf, pCNDec, false, MIPMESSAGE_TYPE_AUDIO_ENCODED, MIPENCODEDAUDIOMESSAGE_TYPE_CN);
+	pActiveChain->addConnection(pCNDec, pSampConv, false);
 
 	pPrevComponent = pSampConv;
 	
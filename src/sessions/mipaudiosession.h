@@ -115,8 +115,12 @@ public:
 #endif // _WIN32_WCE
 		m_compType = ULaw;
 		m_disableInterChainTimer = false;
+		m_pChainScheduler = 0;
 
 		m_opusBandwidth = 16000; // results in a few kilobytes per second (with RTP overhead)
+		m_useVAD = false;
+		m_cnIncomingPT = 13;
+		m_cnOutgoingPT = 13;
 	}
 	~MIPAudioSessionParams()							{ }
 	
@@ -165,6 +169,9 @@ public:
 	 */
 	bool getDisableInterChainTimer() const						{ return m_disableInterChainTimer; }
 
+	/** Returns the scheduler set by setChainScheduler (default: none). */
+	MIPChainScheduler *getChainScheduler() const					{ return m_pChainScheduler; }
+
 	/** Returns the codec bandwidth used if the Opus codec is selected (default is 16000 bits per second, 0 means that the codec default is used). */
 	int getOpusBandwidth() const							{ return m_opusBandwidth; }
 
@@ -174,6 +181,15 @@ public:
 	/** This payload type will be set on outgoing Opus packets. */
 	uint8_t getOpusOutgoingPayloadType() const					{ return m_opusOutgoingPT; }
 
+	/** Returns \c true if voice activity detection is used on the transmitted audio (default: \c false). */
+	bool getUseVoiceActivityDetection() const					{ return m_useVAD; }
+
+	/** Incoming packets with this payload type will be interpreted as comfort noise packets (default: 13). */
+	uint8_t getComfortNoiseIncomingPayloadType() const				{ return m_cnIncomingPT; }
+
+	/** This payload type will be set on outgoing comfort noise packets (default: 13). */
+	uint8_t getComfortNoiseOutgoingPayloadType() const				{ return m_cnOutgoingPT; }
+
 	/** Sets the ID of the input device (only used on Win32/WinCE). */
 	void setInputDevice(unsigned int ID)						{ m_inputDevID = ID; }
 	
@@ -223,6 +239,14 @@ public:
 	 */
 	void setDisableInterChainTimer(bool f)						{ m_disableInterChainTimer = f; }
 
+	/** Lets the output chain be run by a shared scheduler.
+	 *  When the output chain is controlled by a simple timing component (see
+	 *  setDisableInterChainTimer), it can be run by the MIPChainScheduler specified
+	 *  here instead of by its own thread. Chains which are driven by the sound card
+	 *  always keep their own thread. The scheduler must exist as long as the session does.
+	 */
+	void setChainScheduler(MIPChainScheduler *pScheduler)				{ m_pChainScheduler = pScheduler; }
+
 	/** This will interpret incoming packets with payload type \c pt as Opus packets. */
 	void setOpusIncomingPayloadType(uint8_t pt)					{ m_opusIncomingPT = pt; }
 	
@@ -231,6 +255,25 @@ public:
 
 	/** Specifies the bandwidth the Opus codec may use (between 6000 and 510000), specify 0 for the codec default. */
 	void setOpusBandwidth(int b)							{ m_opusBandwidth = b; }
+
+	/** Enables or disables voice activity detection.
+	 *  Enables or disables voice activity detection. When enabled, a MIPVoiceActivityDetector 
+	 *  is placed right after the input component: during silence no audio packets are sent,
+	 *  only occasional RFC 3389 comfort noise packets, and the first packet of each talk spurt 
+	 *  gets the RTP marker bit. Incoming comfort noise packets are always handled, regardless 
+	 *  of this setting.
+	 */
+	void setUseVoiceActivityDetection(bool f)					{ m_useVAD = f; }
+
+	/** This will interpret incoming packets with payload type \c pt as comfort noise packets.
+	 *  This will interpret incoming packets with payload type \c pt as comfort noise packets.
+	 *  The static payload type 13 implies a sampling rate of 8000 Hz, so for the codecs which
+	 *  use a different sampling rate, a dynamic payload type should be agreed upon.
+	 */
+	void setComfortNoiseIncomingPayloadType(uint8_t pt)				{ m_cnIncomingPT = pt; }
+
+	/** Sets the payload type for outgoing comfort noise packets (see also setComfortNoiseIncomingPayloadType). */
+	void setComfortNoiseOutgoingPayloadType(uint8_t pt)				{ m_cnOutgoingPT = pt; }
 private:
 	unsigned int m_inputDevID, m_outputDevID;
 	std::string m_inputDevName, m_outputDevName;
@@ -242,8 +285,11 @@ private:
 	CompressionType m_compType;
 	uint8_t m_speexOutgoingPT, m_speexIncomingPT;
 	bool m_disableInterChainTimer;
+	MIPChainScheduler *m_pChainScheduler;
 	int m_opusBandwidth;
 	uint8_t m_opusOutgoingPT, m_opusIncomingPT;
+	bool m_useVAD;
+	uint8_t m_cnOutgoingPT, m_cnIncomingPT;
 };
 
 /** Creates a VoIP session.
@@ -33,11 +33,15 @@
 #include "mipavcodecframeconverter.h"
 #include "mipavcodecencoder.h"
 #include "miprtph263encoder.h"
+#include "miprtph264encoder.h"
+#include "miprtpvp8encoder.h"
 #include "miprtpvideoencoder.h"
 #include "miprtpcomponent.h"
 #include "mipaveragetimer.h"
 #include "miprtpdecoder.h"
 #include "miprtph263decoder.h"
+#include "miprtph264decoder.h"
+#include "miprtpvp8decoder.h"
 #include "miprtpvideodecoder.h"
 #include "miprtpdummydecoder.h"
 #include "mipmediabuffer.h"
@@ -62,7 +66,7 @@ using namespace jrtplib;
 #define MIPVIDEOSESSION_ERRSTR_NOQTSUPPORT					"No Qt support available"
 #define MIPVIDEOSESSION_ERRSTR_NOSTORAGE					"The Qt component is being used instead of the storage component"
 #define MIPVIDEOSESSION_ERRSTR_NOOUTPUTCOMPONENT			"The Qt component is not being used"
-#define MIPVIDEOSESSION_ERRSTR_CONFLICTPAYLOADTYPEMAPPING	"The incoming payload types for H263 and internal video formats cannot be the same"
+#define MIPVIDEOSESSION_ERRSTR_CONFLICTPAYLOADTYPEMAPPING	"The incoming payload types for the H263, H264, VP8 and internal video formats must all be different"
 
 MIPVideoSession::MIPVideoSession()
 {
@@ -93,7 +97,20 @@ bool MIPVideoSession::init(const MIPVideoSessionParams *pParams, MIPRTPSynchroni
 	MIPVideoSessionParams::SessionType sessionType = pParams2->getSessionType();
 	real_t frameRate = pParams2->getFrameRate();
 
-	if (pParams2->getIncomingInternalPayloadType() == pParams2->getIncomingH263PayloadType())
+	uint8_t inPayloadTypes[4] = { pParams2->getIncomingH263PayloadType(), pParams2->getIncomingInternalPayloadType(),
+	                              pParams2->getIncomingH264PayloadType(), pParams2->getIncomingVP8PayloadType() };
+	bool payloadTypeConflict = false;
+
+	for (int i = 0 ; i < 4 ; i++)
+	{
+		for (int j = i+1 ; j < 4 ; j++)
+		{
+			if (inPayloadTypes[i] == inPayloadTypes[j])
+				payloadTypeConflict = true;
+		}
+	}
+
+	if (payloadTypeConflict)
 	{
 		setErrorString(MIPVIDEOSESSION_ERRSTR_CONFLICTPAYLOADTYPEMAPPING);
 		return false;
@@ -174,8 +191,15 @@ bool MIPVideoSession::init(const MIPVideoSessionParams *pParams, MIPRTPSynchroni
 			
 		if (pParams2->getEncodingType() != MIPVideoSessionParams::IntYUV420)
 		{
+			MIPAVCodecEncoder::CodecType codecType = MIPAVCodecEncoder::H263P;
+
+			if (pParams2->getEncodingType() == MIPVideoSessionParams::H264)
+				codecType = MIPAVCodecEncoder::H264;
+			else if (pParams2->getEncodingType() == MIPVideoSessionParams::VP8)
+				codecType = MIPAVCodecEncoder::VP8;
+
 			m_pAvcEnc = new MIPAVCodecEncoder();
-			if (!m_pAvcEnc->init(width, height, frameRate, bandwidth))
+			if (!m_pAvcEnc->init(width, height, frameRate, bandwidth, codecType))
 			{
 				setErrorString(m_pAvcEnc->getErrorString());
 				deleteAll();
@@ -196,6 +220,32 @@ bool MIPVideoSession::init(const MIPVideoSessionParams *pParams, MIPRTPSynchroni
 		
 			m_pRTPH263Enc->setPayloadType(pParams2->getOutgoingH263PayloadType());
 		}
+		else if (pParams2->getEncodingType() == MIPVideoSessionParams::H264)
+		{
+			m_pRTPH264Enc = new MIPRTPH264Encoder();
+
+			if (!m_pRTPH264Enc->init(frameRate, pParams2->getMaximumPayloadSize()))
+			{
+				setErrorString(m_pRTPH264Enc->getErrorString());
+				deleteAll();
+				return false;
+			}
+		
+			m_pRTPH264Enc->setPayloadType(pParams2->getOutgoingH264PayloadType());
+		}
+		else if (pParams2->getEncodingType() == MIPVideoSessionParams::VP8)
+		{
+			m_pRTPVP8Enc = new MIPRTPVP8Encoder();
+
+			if (!m_pRTPVP8Enc->init(frameRate, pParams2->getMaximumPayloadSize()))
+			{
+				setErrorString(m_pRTPVP8Enc->getErrorString());
+				deleteAll();
+				return false;
+			}
+		
+			m_pRTPVP8Enc->setPayloadType(pParams2->getOutgoingVP8PayloadType());
+		}
 		else
 		{
 			MIPRTPVideoEncoder::EncodingType encType;
@@ -279,6 +329,12 @@ bool MIPVideoSession::init(const MIPVideoSessionParams *pParams, MIPRTPSynchroni
 	m_pRTPH263Dec = new MIPRTPH263Decoder();
 	m_pRTPDec->setPacketDecoder(pParams2->getIncomingH263PayloadType(), m_pRTPH263Dec);
 
+	m_pRTPH264Dec = new MIPRTPH264Decoder();
+	m_pRTPDec->setPacketDecoder(pParams2->getIncomingH264PayloadType(), m_pRTPH264Dec);
+
+	m_pRTPVP8Dec = new MIPRTPVP8Decoder();
+	m_pRTPDec->setPacketDecoder(pParams2->getIncomingVP8PayloadType(), m_pRTPVP8Dec);
+
 	m_pRTPIntVideoDec = new MIPRTPVideoDecoder();
 	m_pRTPDec->setPacketDecoder(pParams2->getIncomingInternalPayloadType(), m_pRTPIntVideoDec);
 
@@ -356,6 +412,10 @@ bool MIPVideoSession::init(const MIPVideoSessionParams *pParams, MIPRTPSynchroni
 
 		if (pParams2->getEncodingType() == MIPVideoSessionParams::H263)
 			pRTPEnc = m_pRTPH263Enc;
+		else if (pParams2->getEncodingType() == MIPVideoSessionParams::H264)
+			pRTPEnc = m_pRTPH264Enc;
+		else if (pParams2->getEncodingType() == MIPVideoSessionParams::VP8)
+			pRTPEnc = m_pRTPVP8Enc;
 		else
 			pRTPEnc = m_pRTPIntVideoEnc;
 
@@ -401,7 +461,8 @@ bool MIPVideoSession::init(const MIPVideoSessionParams *pParams, MIPRTPSynchroni
 
 	m_pOutputChain->addConnection(m_pRTPComp, m_pRTPDec);
 	m_pOutputChain->addConnection(m_pRTPDec, m_pMediaBuf, true);
-	m_pOutputChain->addConnection(m_pMediaBuf, m_pAvcDec, true, MIPMESSAGE_TYPE_VIDEO_ENCODED, MIPENCODEDVIDEOMESSAGE_TYPE_H263P);
+	m_pOutputChain->addConnection(m_pMediaBuf, m_pAvcDec, true, MIPMESSAGE_TYPE_VIDEO_ENCODED, 
+	                              MIPENCODEDVIDEOMESSAGE_TYPE_H263P|MIPENCODEDVIDEOMESSAGE_TYPE_H264|MIPENCODEDVIDEOMESSAGE_TYPE_VP8);
 	m_pOutputChain->addConnection(m_pAvcDec, m_pMixer, true);
 	
 	m_pOutputChain->addConnection(m_pMediaBuf, m_pBufferAlias, false, 0, 0); // extra link to creat equal length branches
@@ -754,6 +815,8 @@ void MIPVideoSession::zeroAll()
 	m_pOutputFrameConverter = 0;
 	m_pAvcEnc = 0;
 	m_pRTPH263Enc = 0;
+	m_pRTPH264Enc = 0;
+	m_pRTPVP8Enc = 0;
 	m_pRTPIntVideoEnc = 0;
 	m_pRTPComp = 0;
 	m_pRTPSession = 0;
@@ -761,6 +824,8 @@ void MIPVideoSession::zeroAll()
 	m_pTimer2 = 0;
 	m_pRTPDec = 0;
 	m_pRTPH263Dec = 0;
+	m_pRTPH264Dec = 0;
+	m_pRTPVP8Dec = 0;
 	m_pRTPIntVideoDec = 0;
 	m_pRTPDummyDec = 0;
 	m_pMediaBuf = 0;
@@ -803,6 +868,10 @@ void MIPVideoSession::deleteAll()
 		delete m_pAvcEnc;
 	if (m_pRTPH263Enc)
 		delete m_pRTPH263Enc;
+	if (m_pRTPH264Enc)
+		delete m_pRTPH264Enc;
+	if (m_pRTPVP8Enc)
+		delete m_pRTPVP8Enc;
 	if (m_pRTPIntVideoEnc)
 		delete m_pRTPIntVideoEnc;
 	if (m_pRTPComp)
@@ -821,6 +890,10 @@ void MIPVideoSession::deleteAll()
 		delete m_pRTPDec;
 	if (m_pRTPH263Dec)
 		delete m_pRTPH263Dec;
+	if (m_pRTPH264Dec)
+		delete m_pRTPH264Dec;
+	if (m_pRTPVP8Dec)
+		delete m_pRTPVP8Dec;
 	if (m_pRTPIntVideoDec)
 		delete m_pRTPIntVideoDec;
 	if (m_pRTPDummyDec)
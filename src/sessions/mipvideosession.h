@@ -51,11 +51,15 @@ class MIPDirectShowCapture;
 class MIPV4L2Input;
 class MIPAVCodecEncoder;
 class MIPRTPH263Encoder;
+class MIPRTPH264Encoder;
+class MIPRTPVP8Encoder;
 class MIPRTPVideoEncoder;
 class MIPRTPComponent;
 class MIPAverageTimer;
 class MIPRTPDecoder;
 class MIPRTPH263Decoder;
+class MIPRTPH264Decoder;
+class MIPRTPVP8Decoder;
 class MIPRTPVideoDecoder;
 class MIPRTPDummyDecoder;
 class MIPMediaBuffer;
@@ -84,7 +88,9 @@ public:
 	{ 
 		H263, 		/**< H.263 compression is used, in an RTP format based on RFC 4629. */
 		IntH263, 	/**< H.263 compression is used, but stored in RTP packets using an internal format, not compatible with other software. */
-		IntYUV420 	/**< Raw YUV420P frames will be sent, using an internal format for storage into RTP packets. */
+		IntYUV420, 	/**< Raw YUV420P frames will be sent, using an internal format for storage into RTP packets. */
+		H264,		/**< H.264 compression is used, in an RTP format based on RFC 6184 (non-interleaved mode). */
+		VP8		/**< VP8 compression is used, in an RTP format based on RFC 7741. */
 	};
 
 	MIPVideoSessionParams()								
@@ -103,6 +109,10 @@ public:
 		m_inH263PayloadType = 34;
 		m_outIntPayloadType = 103;
 		m_inIntPayloadType = 103;
+		m_outH264PayloadType = 96;
+		m_inH264PayloadType = 96;
+		m_outVP8PayloadType = 97;
+		m_inVP8PayloadType = 97;
 		m_encType = H263;
 		m_waitForKeyframe = true;
 		m_maxPayloadSize = 64000;
@@ -161,6 +171,26 @@ public:
 	 */
 	uint8_t getOutgoingInternalPayloadType() const					{ return m_outIntPayloadType; }
 
+	/** Returns the payload type that should used to interpret incoming packets
+	 *  as H.264 encoded video (default: 96).
+	 */
+	uint8_t getIncomingH264PayloadType() const					{ return m_inH264PayloadType; }
+
+	/** Returns the payload type that will be set on outgoing RTP packets if they
+	 *  contain H.264 video (default: 96).
+	 */
+	uint8_t getOutgoingH264PayloadType() const					{ return m_outH264PayloadType; }
+
+	/** Returns the payload type that should used to interpret incoming packets
+	 *  as VP8 encoded video (default: 97).
+	 */
+	uint8_t getIncomingVP8PayloadType() const					{ return m_inVP8PayloadType; }
+
+	/** Returns the payload type that will be set on outgoing RTP packets if they
+	 *  contain VP8 video (default: 97).
+	 */
+	uint8_t getOutgoingVP8PayloadType() const					{ return m_outVP8PayloadType; }
+
 	/** Returns the encoding that outgoing video frames will have 
 	 *  (default: MIPVideoSessionParams::H263).
 	 */
@@ -228,6 +258,26 @@ public:
 	 */
 	void setOutgoingInternalPayloadType(uint8_t pt)					{ m_outIntPayloadType = pt; }
 
+	/** Sets the payload type that will be used to interpret RTP packets as
+	 *  H.264 encoded video.
+	 */
+	void setIncomingH264PayloadType(uint8_t pt)					{ m_inH264PayloadType = pt; }
+
+	/** Sets the payload type that will be used for outgoing messages when
+	 *  sending H.264 data.
+	 */
+	void setOutgoingH264PayloadType(uint8_t pt)					{ m_outH264PayloadType = pt; }
+
+	/** Sets the payload type that will be used to interpret RTP packets as
+	 *  VP8 encoded video.
+	 */
+	void setIncomingVP8PayloadType(uint8_t pt)					{ m_inVP8PayloadType = pt; }
+
+	/** Sets the payload type that will be used for outgoing messages when
+	 *  sending VP8 data.
+	 */
+	void setOutgoingVP8PayloadType(uint8_t pt)					{ m_outVP8PayloadType = pt; }
+
 	/** Sets the current encoding type. */
 	void setEncodingType(EncodingType t)						{ m_encType = t; }
 
@@ -254,6 +304,10 @@ private:
 	uint8_t m_outH263PayloadType;
 	uint8_t m_inIntPayloadType;
 	uint8_t m_outIntPayloadType;
+	uint8_t m_inH264PayloadType;
+	uint8_t m_outH264PayloadType;
+	uint8_t m_inVP8PayloadType;
+	uint8_t m_outVP8PayloadType;
 	EncodingType m_encType; 
 	bool m_waitForKeyframe;
 	int m_maxPayloadSize;
@@ -261,8 +315,10 @@ private:
 
 /** Creates a video over IP session.
  *  This wrapper class can be used to create a video over IP session. Transmitted data
- *  will be H.263+ encoded. Destinations are specified using subclasses of
- *  RTPAddress from the JRTPLIB library. Currently, only RTPIPv4Address
+ *  will be H.263+ encoded by default, but H.264 or VP8 can be selected using
+ *  MIPVideoSessionParams::setEncodingType. Incoming H.263+, H.264 and VP8 streams are
+ *  all decoded, based on their payload types. Destinations are specified using
+ *  subclasses of RTPAddress from the JRTPLIB library. Currently, only RTPIPv4Address
  *  instances can be specified.
  */
 class EMIPLIB_IMPORTEXPORT MIPVideoSession : public MIPErrorBase
@@ -418,6 +474,8 @@ private:
 	MIPAVCodecFrameConverter *m_pOutputFrameConverter;
 	MIPAVCodecEncoder *m_pAvcEnc;
 	MIPRTPH263Encoder *m_pRTPH263Enc;
+	MIPRTPH264Encoder *m_pRTPH264Enc;
+	MIPRTPVP8Encoder *m_pRTPVP8Enc;
 	MIPRTPVideoEncoder *m_pRTPIntVideoEnc;
 	MIPRTPComponent *m_pRTPComp;
 	
@@ -427,6 +485,8 @@ private:
 	MIPAverageTimer *m_pTimer2;
 	MIPRTPDecoder *m_pRTPDec;
 	MIPRTPH263Decoder *m_pRTPH263Dec;
+	MIPRTPH264Decoder *m_pRTPH264Dec;
+	MIPRTPVP8Decoder *m_pRTPVP8Dec;
 	MIPRTPVideoDecoder *m_pRTPIntVideoDec;
 	MIPRTPDummyDecoder *m_pRTPDummyDec;
 	MIPMediaBuffer *m_pMediaBuf;
@@ -0,0 +1,196 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+#include "mipconfig.h"
+#include "mipcomfortnoise.h"
+#include <math.h>
+#include <string.h>
+
+#include "mipdebug.h"
+
+// The level is stored as 0 to 127 -dBov, the reflection coefficients are quantized
+// linearly: k = (q - 127)/128
+
+#define MIPCOMFORTNOISE_MAXLEVEL						127
+#define MIPCOMFORTNOISE_MAXREFLECTION						0.995f
+
+MIPComfortNoise::MIPComfortNoise()
+{
+	m_gotParameters = false;
+	m_order = 0;
+	m_excitationGain = 0;
+	m_seed = 0x12345678;
+	memset(m_lpc, 0, sizeof(float)*MIPCOMFORTNOISE_MAXORDER);
+	memset(m_history, 0, sizeof(float)*MIPCOMFORTNOISE_MAXORDER);
+}
+
+MIPComfortNoise::~MIPComfortNoise()
+{
+}
+
+size_t MIPComfortNoise::createPayload(const float *pAutoCorrelation, int order, uint8_t *pPayload)
+{
+	if (order < 0)
+		order = 0;
+	if (order > MIPCOMFORTNOISE_MAXORDER)
+		order = MIPCOMFORTNOISE_MAXORDER;
+
+	double power = pAutoCorrelation[0];
+	int level = MIPCOMFORTNOISE_MAXLEVEL;
+
+	if (power > 0)
+	{
+		level = (int)(-10.0*log10(power) + 0.5);
+		if (level < 0)
+			level = 0;
+		else if (level > MIPCOMFORTNOISE_MAXLEVEL)
+			level = MIPCOMFORTNOISE_MAXLEVEL;
+	}
+	pPayload[0] = (uint8_t)level;
+
+	// Levinson-Durbin recursion, the reflection coefficients are stored
+	// directly. A small amount of white noise is added to the first
+	// autocorrelation value to keep the recursion well conditioned.
+
+	double lpc[MIPCOMFORTNOISE_MAXORDER+1];
+	double prevLPC[MIPCOMFORTNOISE_MAXORDER+1];
+	double err = power*1.0001;
+
+	lpc[0] = 1.0;
+	for (int i = 1 ; i <= order ; i++)
+	{
+		double k = 0;
+
+		if (err > 0)
+		{
+			double acc = pAutoCorrelation[i];
+
+			for (int j = 1 ; j < i ; j++)
+				acc += lpc[j]*(double)pAutoCorrelation[i-j];
+			k = -acc/err;
+			if (k > MIPCOMFORTNOISE_MAXREFLECTION)
+				k = MIPCOMFORTNOISE_MAXREFLECTION;
+			else if (k < -MIPCOMFORTNOISE_MAXREFLECTION)
+				k = -MIPCOMFORTNOISE_MAXREFLECTION;
+		}
+
+		for (int j = 1 ; j < i ; j++)
+			prevLPC[j] = lpc[j];
+		for (int j = 1 ; j < i ; j++)
+			lpc[j] = prevLPC[j] + k*prevLPC[i-j];
+		lpc[i] = k;
+		err *= (1.0 - k*k);
+
+		int q = (int)floor(k*128.0 + 127.5);
+
+		if (q < 0)
+			q = 0;
+		else if (q > 255)
+			q = 255;
+		pPayload[i] = (uint8_t)q;
+	}
+
+	return (size_t)(order + 1);
+}
+
+bool MIPComfortNoise::setParameters(const uint8_t *pPayload, size_t length)
+{
+	if (length < 1)
+		return false;
+
+	int order = (int)length - 1;
+
+	if (order > MIPCOMFORTNOISE_MAXORDER)
+		order = MIPCOMFORTNOISE_MAXORDER;
+
+	// Convert the reflection coefficients to the coefficients of the
+	// synthesis filter, keeping track of the prediction error, which
+	// is the power of the excitation for unit power output.
+
+	float prevLPC[MIPCOMFORTNOISE_MAXORDER];
+	double errFraction = 1.0;
+
+	for (int i = 0 ; i < order ; i++)
+	{
+		float k = ((float)pPayload[i+1] - 127.0f)/128.0f;
+
+		if (k > MIPCOMFORTNOISE_MAXREFLECTION)
+			k = MIPCOMFORTNOISE_MAXREFLECTION;
+		else if (k < -MIPCOMFORTNOISE_MAXREFLECTION)
+			k = -MIPCOMFORTNOISE_MAXREFLECTION;
+
+		for (int j = 0 ; j < i ; j++)
+			prevLPC[j] = m_lpc[j];
+		for (int j = 0 ; j < i ; j++)
+			m_lpc[j] = prevLPC[j] + k*prevLPC[i-1-j];
+		m_lpc[i] = k;
+		errFraction *= (1.0 - (double)k*(double)k);
+	}
+
+	for (int i = order ; i < m_order ; i++)
+		m_history[i] = 0;
+
+	int level = (int)(pPayload[0] & 0x7f);
+	double power = pow(10.0, -(double)level/10.0);
+
+	// The excitation is uniformly distributed between -1 and 1, which has
+	// a power of 1/3
+	m_excitationGain = (float)sqrt(3.0*power*errFraction);
+	m_order = order;
+	m_gotParameters = true;
+	return true;
+}
+
+void MIPComfortNoise::generate(float *pSamples, int numSamples)
+{
+	if (!m_gotParameters)
+	{
+		for (int i = 0 ; i < numSamples ; i++)
+			pSamples[i] = 0;
+		return;
+	}
+
+	for (int i = 0 ; i < numSamples ; i++)
+	{
+		m_seed = m_seed*1664525 + 1013904223;
+
+		float excitation = ((float)(m_seed >> 8)/(float)(1 << 23) - 1.0f)*m_excitationGain;
+		float value = excitation;
+
+		for (int j = 0 ; j < m_order ; j++)
+			value -= m_lpc[j]*m_history[j];
+
+		for (int j = m_order-1 ; j > 0 ; j--)
+			m_history[j] = m_history[j-1];
+		if (m_order > 0)
+			m_history[0] = value;
+
+		if (value > 1.0f)
+			value = 1.0f;
+		else if (value < -1.0f)
+			value = -1.0f;
+		pSamples[i] = value;
+	}
+}
+
@@ -0,0 +1,87 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+/**
+ * \file mipcomfortnoise.h
+ */
+
+#ifndef MIPCOMFORTNOISE_H
+
+#define MIPCOMFORTNOISE_H
+
+#include "mipconfig.h"
+#include "miptypes.h"
+#include <stddef.h>
+
+/** The maximum number of reflection coefficients used by MIPComfortNoise. */
+#define MIPCOMFORTNOISE_MAXORDER						10
+
+/** Describes and synthesizes background noise as described in RFC 3389.
+ *  An RFC 3389 comfort noise payload consists of the level of the background noise in
+ *  -dBov, followed by a number of quantized reflection coefficients which describe the 
+ *  spectral envelope of the noise. The static MIPComfortNoise::createPayload function creates
+ *  such a payload from the autocorrelation of the noise, an instance of the class can generate 
+ *  noise which matches a received payload. Samples are floating point values for which a full
+ *  scale signal has amplitude 1, and a level of 0 dBov corresponds to a full scale square wave.
+ */
+class EMIPLIB_IMPORTEXPORT MIPComfortNoise
+{
+public:
+	MIPComfortNoise();
+	~MIPComfortNoise();
+
+	/** Creates a comfort noise payload.
+	 *  Creates a comfort noise payload which describes noise with a specific autocorrelation.
+	 *  \param pAutoCorrelation The autocorrelation values for lags 0 up to \c order. The value for
+	 *                          lag 0 is the mean power of the noise.
+	 *  \param order The number of reflection coefficients to store, at most MIPCOMFORTNOISE_MAXORDER.
+	 *  \param pPayload Buffer which receives the payload, it must be able to hold \c order + 1 bytes.
+	 *  \return The length of the payload.
+	 */
+	static size_t createPayload(const float *pAutoCorrelation, int order, uint8_t *pPayload);
+
+	/** Sets the parameters of the noise that will be generated.
+	 *  Sets the parameters of the noise that will be generated from a received payload. 
+	 *  Reflection coefficients beyond MIPCOMFORTNOISE_MAXORDER are ignored. The state of the
+	 *  synthesis filter is kept, so that the noise continues smoothly.
+	 *  \return \c false if the payload is empty.
+	 */
+	bool setParameters(const uint8_t *pPayload, size_t length);
+
+	/** Generates \c numSamples samples of noise according to the last parameters that were set.
+	 *  Generates \c numSamples samples of noise according to the last parameters that were set.
+	 *  If no parameters were set yet, the buffer is filled with silence.
+	 */
+	void generate(float *pSamples, int numSamples);
+private:
+	bool m_gotParameters;
+	int m_order;
+	float m_lpc[MIPCOMFORTNOISE_MAXORDER];
+	float m_history[MIPCOMFORTNOISE_MAXORDER];
+	float m_excitationGain;
+	uint32_t m_seed;
+};
+
+#endif // MIPCOMFORTNOISE_H
+
@@ -0,0 +1,244 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+#include "mipconfig.h"
+#include "mipfft.h"
+#include <math.h>
+#include <string.h>
+
+#include "mipdebug.h"
+
+#define MIPFFT_ERRSTR_BADSIZE					"The size of the transform must be a power of two of at least four"
+
+#define MIPFFT_PI						3.14159265358979323846
+
+// The real transform of 'size' samples is calculated using a complex transform
+// of size/2 points: even samples are used as real parts, odd samples as 
+// imaginary parts and the two interleaved spectra are separated afterwards.
+
+MIPFFT::MIPFFT()
+{
+	m_size = 0;
+}
+
+MIPFFT::~MIPFFT()
+{
+}
+
+bool MIPFFT::init(int size)
+{
+	if (size < 4 || (size & (size-1)) != 0)
+	{
+		setErrorString(MIPFFT_ERRSTR_BADSIZE);
+		return false;
+	}
+
+	int halfSize = size/2;
+	int bits = 0;
+
+	while ((1 << bits) < halfSize)
+		bits++;
+
+	m_cosTable.resize(halfSize/2+1);
+	m_sinTable.resize(halfSize/2+1);
+	for (int i = 0 ; i < (int)m_cosTable.size() ; i++)
+	{
+		double angle = 2.0*MIPFFT_PI*(double)i/(double)halfSize;
+
+		m_cosTable[i] = (float)cos(angle);
+		m_sinTable[i] = (float)sin(angle);
+	}
+
+	m_realCos.resize(halfSize+1);
+	m_realSin.resize(halfSize+1);
+	for (int i = 0 ; i <= halfSize ; i++)
+	{
+		double angle = 2.0*MIPFFT_PI*(double)i/(double)size;
+
+		m_realCos[i] = (float)cos(angle);
+		m_realSin[i] = (float)sin(angle);
+	}
+
+	m_bitReverse.resize(halfSize);
+	for (int i = 0 ; i < halfSize ; i++)
+	{
+		int r = 0;
+
+		for (int b = 0 ; b < bits ; b++)
+		{
+			if (i & (1 << b))
+				r |= 1 << (bits-1-b);
+		}
+		m_bitReverse[i] = r;
+	}
+
+	m_work.resize(size);
+	m_size = size;
+	return true;
+}
+
+void MIPFFT::complexTransform(float *pData, bool inverse)
+{
+	int num = m_size/2;
+
+	for (int i = 0 ; i < num ; i++)
+	{
+		int j = m_bitReverse[i];
+
+		if (j > i)
+		{
+			float tmpRe = pData[2*i];
+			float tmpIm = pData[2*i+1];
+
+			pData[2*i] = pData[2*j];
+			pData[2*i+1] = pData[2*j+1];
+			pData[2*j] = tmpRe;
+			pData[2*j+1] = tmpIm;
+		}
+	}
+
+	float sign = (inverse)?1.0f:-1.0f;
+
+	for (int len = 2 ; len <= num ; len <<= 1)
+	{
+		int half = len/2;
+		int step = num/len;
+
+		for (int j = 0 ; j < half ; j++)
+		{
+			float wRe = m_cosTable[j*step];
+			float wIm = sign*m_sinTable[j*step];
+
+			for (int i = j ; i < num ; i += len)
+			{
+				float *pA = pData + 2*i;
+				float *pB = pData + 2*(i+half);
+				float tRe = pB[0]*wRe - pB[1]*wIm;
+				float tIm = pB[0]*wIm + pB[1]*wRe;
+
+				pB[0] = pA[0] - tRe;
+				pB[1] = pA[1] - tIm;
+				pA[0] += tRe;
+				pA[1] += tIm;
+			}
+		}
+	}
+}
+
+void MIPFFT::forward(const float *pInput, float *pSpectrum)
+{
+	int num = m_size/2;
+	float *pWork = &(m_work[0]);
+
+	memcpy(pWork, pInput, sizeof(float)*m_size);
+	complexTransform(pWork, false);
+
+	for (int k = 0 ; k <= num ; k++)
+	{
+		int k1 = (k == num)?0:k;
+		int k2 = (k == 0)?0:(num-k);
+		float zRe = pWork[2*k1];
+		float zIm = pWork[2*k1+1];
+		float zmRe = pWork[2*k2];
+		float zmIm = pWork[2*k2+1];
+
+		// spectrum of the even samples
+		float evenRe = 0.5f*(zRe + zmRe);
+		float evenIm = 0.5f*(zIm - zmIm);
+		// spectrum of the odd samples
+		float oddRe = 0.5f*(zIm + zmIm);
+		float oddIm = -0.5f*(zRe - zmRe);
+		float c = m_realCos[k];
+		float s = m_realSin[k];
+
+		pSpectrum[2*k] = evenRe + c*oddRe + s*oddIm;
+		pSpectrum[2*k+1] = evenIm + c*oddIm - s*oddRe;
+	}
+}
+
+void MIPFFT::inverse(const float *pSpectrum, float *pOutput)
+{
+	int num = m_size/2;
+	float *pWork = &(m_work[0]);
+
+	for (int k = 0 ; k < num ; k++)
+	{
+		float xRe = pSpectrum[2*k];
+		float xIm = pSpectrum[2*k+1];
+		float xmRe = pSpectrum[2*(num-k)];
+		float xmIm = pSpectrum[2*(num-k)+1];
+
+		float evenRe = 0.5f*(xRe + xmRe);
+		float evenIm = 0.5f*(xIm - xmIm);
+		float dRe = 0.5f*(xRe - xmRe);
+		float dIm = 0.5f*(xIm + xmIm);
+		float c = m_realCos[k];
+		float s = m_realSin[k];
+		float oddRe = dRe*c - dIm*s;
+		float oddIm = dRe*s + dIm*c;
+
+		pWork[2*k] = evenRe - oddIm;
+		pWork[2*k+1] = evenIm + oddRe;
+	}
+
+	complexTransform(pWork, true);
+
+	float scale = 1.0f/(float)num;
+
+	for (int i = 0 ; i < m_size ; i++)
+		pOutput[i] = pWork[i]*scale;
+}
+
+void MIPFFT::multiply(const float *pSpectrum1, const float *pSpectrum2, float *pDest) const
+{
+	int num = m_size/2+1;
+
+	for (int k = 0 ; k < num ; k++)
+	{
+		float aRe = pSpectrum1[2*k];
+		float aIm = pSpectrum1[2*k+1];
+		float bRe = pSpectrum2[2*k];
+		float bIm = pSpectrum2[2*k+1];
+
+		pDest[2*k] = aRe*bRe - aIm*bIm;
+		pDest[2*k+1] = aRe*bIm + aIm*bRe;
+	}
+}
+
+void MIPFFT::multiplyAdd(const float *pSpectrum1, const float *pSpectrum2, float *pDest) const
+{
+	int num = m_size/2+1;
+
+	for (int k = 0 ; k < num ; k++)
+	{
+		float aRe = pSpectrum1[2*k];
+		float aIm = pSpectrum1[2*k+1];
+		float bRe = pSpectrum2[2*k];
+		float bIm = pSpectrum2[2*k+1];
+
+		pDest[2*k] += aRe*bRe - aIm*bIm;
+		pDest[2*k+1] += aRe*bIm + aIm*bRe;
+	}
+}
+
@@ -0,0 +1,90 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+/**
+ * \file mipfft.h
+ */
+
+#ifndef MIPFFT_H
+
+#define MIPFFT_H
+
+#include "mipconfig.h"
+#include "miperrorbase.h"
+#include <vector>
+
+/** Fast Fourier transform of real valued data.
+ *  This class calculates the discrete Fourier transform of a block of real valued
+ *  samples, and its inverse. The size of the transform must be a power of two.
+ *  A spectrum is stored as \c size/2+1 complex values, each of which takes two 
+ *  consecutive floats (real part followed by imaginary part), so a buffer for
+ *  a spectrum must be able to hold \c size+2 floats.
+ */
+class EMIPLIB_IMPORTEXPORT MIPFFT : public MIPErrorBase
+{
+public:
+	MIPFFT();
+	~MIPFFT();
+
+	/** Prepares the tables for a transform of \c size samples, which must be a power of two of at least four. */
+	bool init(int size);
+
+	/** Returns the size of the transform. */
+	int getSize() const										{ return m_size; }
+
+	/** Calculates the spectrum of the \c size samples in \c pInput, storing the result in \c pSpectrum. */
+	void forward(const float *pInput, float *pSpectrum);
+
+	/** Calculates the \c size samples which correspond to the spectrum in \c pSpectrum.
+	 *  Calculates the \c size samples which correspond to the spectrum in \c pSpectrum,
+	 *  storing them in \c pOutput. The result is scaled so that a forward transform
+	 *  followed by an inverse one returns the original samples.
+	 */
+	void inverse(const float *pSpectrum, float *pOutput);
+
+	/** Multiplies the spectra \c pSpectrum1 and \c pSpectrum2 bin by bin, storing the result in \c pDest.
+	 *  Multiplies the spectra \c pSpectrum1 and \c pSpectrum2 bin by bin, storing the result in \c pDest,
+	 *  which may be the same as one of the inputs. In the time domain this corresponds to a circular
+	 *  convolution.
+	 */
+	void multiply(const float *pSpectrum1, const float *pSpectrum2, float *pDest) const;
+
+	/** Multiplies the spectra \c pSpectrum1 and \c pSpectrum2 bin by bin, adding the result to \c pDest.
+	 *  Multiplies the spectra \c pSpectrum1 and \c pSpectrum2 bin by bin, adding the result to \c pDest.
+	 *  This is useful to sum the contributions of several filter partitions before doing a single
+	 *  inverse transform.
+	 */
+	void multiplyAdd(const float *pSpectrum1, const float *pSpectrum2, float *pDest) const;
+private:
+	void complexTransform(float *pData, bool inverse);
+
+	int m_size;
+	std::vector<float> m_cosTable, m_sinTable;
+	std::vector<float> m_realCos, m_realSin;
+	std::vector<int> m_bitReverse;
+	std::vector<float> m_work;
+};
+
+#endif // MIPFFT_H
+
@@ -0,0 +1,290 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+#include "mipconfig.h"
+#include "mipg711.h"
+
+#include "mipdebug.h"
+
+#define MIPG711_ULAWCLIP						32635
+#define MIPG711_ULAWBIAS						132
+#define MIPG711_ALAWMAXMAGNITUDE					((1 << 15) - 1)
+
+static const uint8_t uLawExponentTable[256] = 
+{
+	0,0,1,1,2,2,2,2,3,3,3,3,3,3,3,3,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
+	5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,5,
+	6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
+	6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,6,
+	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
+	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
+	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,
+	7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7,7
+};
+
+const int16_t MIPG711::m_uLawDecompressionTable[256] = 
+{
+	-32124,-31100,-30076,-29052,-28028,-27004,-25980,-24956,
+	-23932,-22908,-21884,-20860,-19836,-18812,-17788,-16764,
+	-15996,-15484,-14972,-14460,-13948,-13436,-12924,-12412,
+	-11900,-11388,-10876,-10364,-9852,-9340,-8828,-8316,
+	-7932,-7676,-7420,-7164,-6908,-6652,-6396,-6140,
+	-5884,-5628,-5372,-5116,-4860,-4604,-4348,-4092,
+	-3900,-3772,-3644,-3516,-3388,-3260,-3132,-3004,
+	-2876,-2748,-2620,-2492,-2364,-2236,-2108,-1980,
+	-1884,-1820,-1756,-1692,-1628,-1564,-1500,-1436,
+	-1372,-1308,-1244,-1180,-1116,-1052,-988,-924,
+	-876,-844,-812,-780,-748,-716,-684,-652,
+	-620,-588,-556,-524,-492,-460,-428,-396,
+	-372,-356,-340,-324,-308,-292,-276,-260,
+	-244,-228,-212,-196,-180,-164,-148,-132,
+	-120,-112,-104,-96,-88,-80,-72,-64,
+	-56,-48,-40,-32,-24,-16,-8,0,
+	32124,31100,30076,29052,28028,27004,25980,24956,
+	23932,22908,21884,20860,19836,18812,17788,16764,
+	15996,15484,14972,14460,13948,13436,12924,12412,
+	11900,11388,10876,10364,9852,9340,8828,8316,
+	7932,7676,7420,7164,6908,6652,6396,6140,
+	5884,5628,5372,5116,4860,4604,4348,4092,
+	3900,3772,3644,3516,3388,3260,3132,3004,
+	2876,2748,2620,2492,2364,2236,2108,1980,
+	1884,1820,1756,1692,1628,1564,1500,1436,
+	1372,1308,1244,1180,1116,1052,988,924,
+	876,844,812,780,748,716,684,652,
+	620,588,556,524,492,460,428,396,
+	372,356,340,324,308,292,276,260,
+	244,228,212,196,180,164,148,132,
+	120,112,104,96,88,80,72,64,
+	56,48,40,32,24,16,8,0
+};
+
+const int16_t MIPG711::m_aLawDecompressionTable[256] = 
+{
+	-5504,-5248,-6016,-5760,-4480,-4224,-4992,-4736,
+	-7552,-7296,-8064,-7808,-6528,-6272,-7040,-6784,
+	-2752,-2624,-3008,-2880,-2240,-2112,-2496,-2368,
+	-3776,-3648,-4032,-3904,-3264,-3136,-3520,-3392,
+	-22016,-20992,-24064,-23040,-17920,-16896,-19968,-18944,
+	-30208,-29184,-32256,-31232,-26112,-25088,-28160,-27136,
+	-11008,-10496,-12032,-11520,-8960,-8448,-9984,-9472,
+	-15104,-14592,-16128,-15616,-13056,-12544,-14080,-13568,
+	-344,-328,-376,-360,-280,-264,-312,-296,
+	-472,-456,-504,-488,-408,-392,-440,-424,
+	-88,-72,-120,-104,-24,-8,-56,-40,
+	-216,-200,-248,-232,-152,-136,-184,-168,
+	-1376,-1312,-1504,-1440,-1120,-1056,-1248,-1184,
+	-1888,-1824,-2016,-1952,-1632,-1568,-1760,-1696,
+	-688,-656,-752,-720,-560,-528,-624,-592,
+	-944,-912,-1008,-976,-816,-784,-880,-848,
+	5504,5248,6016,5760,4480,4224,4992,4736,
+	7552,7296,8064,7808,6528,6272,7040,6784,
+	2752,2624,3008,2880,2240,2112,2496,2368,
+	3776,3648,4032,3904,3264,3136,3520,3392,
+	22016,20992,24064,23040,17920,16896,19968,18944,
+	30208,29184,32256,31232,26112,25088,28160,27136,
+	11008,10496,12032,11520,8960,8448,9984,9472,
+	15104,14592,16128,15616,13056,12544,14080,13568,
+	344,328,376,360,280,264,312,296,
+	472,456,504,488,408,392,440,424,
+	88,72,120,104,24,8,56,40,
+	216,200,248,232,152,136,184,168,
+	1376,1312,1504,1440,1120,1056,1248,1184,
+	1888,1824,2016,1952,1632,1568,1760,1696,
+	688,656,752,720,560,528,624,592,
+	944,912,1008,976,816,784,880,848
+};
+
+// The large encoding tables are indexed by the 16 bit sample value, reinterpreted
+// as an unsigned number. The transcoding tables follow from decoding a value and
+// encoding the result again. The tables are built once and never destroyed.
+class MIPG711Tables
+{
+public:
+	MIPG711Tables()
+	{
+		for (int i = 0 ; i < 65536 ; i++)
+		{
+			int16_t sample = (int16_t)(uint16_t)i;
+
+			m_uLawEncode[i] = MIPG711::encodeULawSample(sample);
+			m_aLawEncode[i] = MIPG711::encodeALawSample(sample);
+		}
+
+		for (int i = 0 ; i < 256 ; i++)
+		{
+			uint8_t value = (uint8_t)i;
+			int16_t sample;
+
+			MIPG711::decodeULaw(&value, &sample, 1);
+			m_uLawToALaw[i] = m_aLawEncode[(uint16_t)sample];
+			MIPG711::decodeALaw(&value, &sample, 1);
+			m_aLawToULaw[i] = m_uLawEncode[(uint16_t)sample];
+		}
+	}
+
+	uint8_t m_uLawEncode[65536];
+	uint8_t m_aLawEncode[65536];
+	uint8_t m_uLawToALaw[256];
+	uint8_t m_aLawToULaw[256];
+};
+
+static const MIPG711Tables &getTables()
+{
+	static const MIPG711Tables *pTables = new MIPG711Tables();
+	return *pTables;
+}
+
+uint8_t MIPG711::encodeULawSample(int16_t sample)
+{
+	int val = sample;
+	int mant, signval, mantpos, expon;
+	
+	if (val < 0)
+	{
+		signval = (1<<7);
+		if (val < -MIPG711_ULAWCLIP)
+			val = MIPG711_ULAWCLIP;
+		else
+			val = -val;
+	}
+	else
+	{
+		signval = 0;
+		if (val > MIPG711_ULAWCLIP)
+			val = MIPG711_ULAWCLIP;
+	}
+
+	val += MIPG711_ULAWBIAS;
+	expon = uLawExponentTable[val>>7];
+	mantpos = expon + 7 - 4;
+	mant = ((val >> mantpos) & 15);
+	return ~((uint8_t)(signval|(expon<<4)|mant));
+}
+
+uint8_t MIPG711::encodeALawSample(int16_t sample)
+{
+	int samp = sample;
+	int seg, seglimit, sign, mant;
+
+	sign = (samp >= 0);
+	if (!sign)
+		samp = -samp;
+
+	if (samp > MIPG711_ALAWMAXMAGNITUDE)
+		samp = MIPG711_ALAWMAXMAGNITUDE;
+
+	seglimit = 1 << 8;
+	seg = 0;
+
+	while (seglimit <= samp)
+	{
+		seglimit <<= 1;
+		seg++;
+	}
+
+	mant = (samp >> ((seg == 0) ? 4 : seg + 3)) & 0xF;
+	return (uint8_t)((sign << 7)|(seg << 4)|mant) ^ 0x55;
+}
+
+// The loops below only consist of table lookups; they are unrolled a bit so that 
+// several independent loads can be in flight at the same time
+
+void MIPG711::encodeULaw(const int16_t *pSrc, uint8_t *pDst, size_t num)
+{
+	const uint8_t *pTable = getTables().m_uLawEncode;
+	size_t i = 0;
+
+	for ( ; i + 4 <= num ; i += 4)
+	{
+		pDst[i] = pTable[(uint16_t)pSrc[i]];
+		pDst[i+1] = pTable[(uint16_t)pSrc[i+1]];
+		pDst[i+2] = pTable[(uint16_t)pSrc[i+2]];
+		pDst[i+3] = pTable[(uint16_t)pSrc[i+3]];
+	}
+	for ( ; i < num ; i++)
+		pDst[i] = pTable[(uint16_t)pSrc[i]];
+}
+
+void MIPG711::encodeALaw(const int16_t *pSrc, uint8_t *pDst, size_t num)
+{
+	const uint8_t *pTable = getTables().m_aLawEncode;
+	size_t i = 0;
+
+	for ( ; i + 4 <= num ; i += 4)
+	{
+		pDst[i] = pTable[(uint16_t)pSrc[i]];
+		pDst[i+1] = pTable[(uint16_t)pSrc[i+1]];
+		pDst[i+2] = pTable[(uint16_t)pSrc[i+2]];
+		pDst[i+3] = pTable[(uint16_t)pSrc[i+3]];
+	}
+	for ( ; i < num ; i++)
+		pDst[i] = pTable[(uint16_t)pSrc[i]];
+}
+
+void MIPG711::decodeULaw(const uint8_t *pSrc, int16_t *pDst, size_t num)
+{
+	size_t i = 0;
+
+	for ( ; i + 4 <= num ; i += 4)
+	{
+		pDst[i] = m_uLawDecompressionTable[pSrc[i]];
+		pDst[i+1] = m_uLawDecompressionTable[pSrc[i+1]];
+		pDst[i+2] = m_uLawDecompressionTable[pSrc[i+2]];
+		pDst[i+3] = m_uLawDecompressionTable[pSrc[i+3]];
+	}
+	for ( ; i < num ; i++)
+		pDst[i] = m_uLawDecompressionTable[pSrc[i]];
+}
+
+void MIPG711::decodeALaw(const uint8_t *pSrc, int16_t *pDst, size_t num)
+{
+	size_t i = 0;
+
+	for ( ; i + 4 <= num ; i += 4)
+	{
+		pDst[i] = m_aLawDecompressionTable[pSrc[i]];
+		pDst[i+1] = m_aLawDecompressionTable[pSrc[i+1]];
+		pDst[i+2] = m_aLawDecompressionTable[pSrc[i+2]];
+		pDst[i+3] = m_aLawDecompressionTable[pSrc[i+3]];
+	}
+	for ( ; i < num ; i++)
+		pDst[i] = m_aLawDecompressionTable[pSrc[i]];
+}
+
+void MIPG711::uLawToALaw(const uint8_t *pSrc, uint8_t *pDst, size_t num)
+{
+	const uint8_t *pTable = getTables().m_uLawToALaw;
+
+	for (size_t i = 0 ; i < num ; i++)
+		pDst[i] = pTable[pSrc[i]];
+}
+
+void MIPG711::aLawToULaw(const uint8_t *pSrc, uint8_t *pDst, size_t num)
+{
+	const uint8_t *pTable = getTables().m_aLawToULaw;
+
+	for (size_t i = 0 ; i < num ; i++)
+		pDst[i] = pTable[pSrc[i]];
+}
+
@@ -0,0 +1,78 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+/**
+ * \file mipg711.h
+ */
+
+#ifndef MIPG711_H
+
+#define MIPG711_H
+
+#include "mipconfig.h"
+#include "miptypes.h"
+#include <stddef.h>
+
+/** Block conversion routines for G.711 u-law and A-law audio.
+ *  This class contains the conversion routines which are used by the u-law and A-law 
+ *  encoders, decoders and by MIPG711Transcoder. Every function converts a whole block 
+ *  of samples using lookup tables only: encoding uses a table with an entry for each 
+ *  of the 65536 possible 16 bit sample values, decoding uses a 256 entry table, and
+ *  u-law samples can be converted to A-law and vice versa with a 256 entry table,
+ *  without an intermediate linear representation. The encoding tables are created 
+ *  the first time they are needed.
+ */
+class EMIPLIB_IMPORTEXPORT MIPG711
+{
+public:
+	/** Converts \c num signed 16 bit native endian samples from \c pSrc to u-law bytes in \c pDst. */
+	static void encodeULaw(const int16_t *pSrc, uint8_t *pDst, size_t num);
+
+	/** Converts \c num signed 16 bit native endian samples from \c pSrc to A-law bytes in \c pDst. */
+	static void encodeALaw(const int16_t *pSrc, uint8_t *pDst, size_t num);
+
+	/** Converts \c num u-law bytes from \c pSrc to signed 16 bit native endian samples in \c pDst. */
+	static void decodeULaw(const uint8_t *pSrc, int16_t *pDst, size_t num);
+
+	/** Converts \c num A-law bytes from \c pSrc to signed 16 bit native endian samples in \c pDst. */
+	static void decodeALaw(const uint8_t *pSrc, int16_t *pDst, size_t num);
+
+	/** Converts \c num u-law bytes from \c pSrc to A-law bytes in \c pDst (both may be the same). */
+	static void uLawToALaw(const uint8_t *pSrc, uint8_t *pDst, size_t num);
+
+	/** Converts \c num A-law bytes from \c pSrc to u-law bytes in \c pDst (both may be the same). */
+	static void aLawToULaw(const uint8_t *pSrc, uint8_t *pDst, size_t num);
+
+	/** Encodes a single sample as u-law, without using the lookup table. */
+	static uint8_t encodeULawSample(int16_t sample);
+
+	/** Encodes a single sample as A-law, without using the lookup table. */
+	static uint8_t encodeALawSample(int16_t sample);
+private:
+	static const int16_t m_uLawDecompressionTable[256];
+	static const int16_t m_aLawDecompressionTable[256];
+};
+
+#endif // MIPG711_H
+
@@ -0,0 +1,241 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+#include "mipconfig.h"
+#include "mippacketlossconcealer.h"
+#include <string.h>
+
+#include "mipdebug.h"
+
+#define MIPPACKETLOSSCONCEALER_ERRSTR_BADSAMPRATE		"Invalid sampling rate"
+#define MIPPACKETLOSSCONCEALER_ERRSTR_BADCHANNELS		"Invalid number of channels"
+
+MIPPacketLossConcealer::MIPPacketLossConcealer()
+{
+	m_init = false;
+	m_samplingRate = 0;
+	m_channels = 0;
+	m_minPitch = 0;
+	m_maxPitch = 0;
+	m_fadeStart = 0;
+	m_fadeEnd = 0;
+	m_overlap = 0;
+	m_historyFrames = 0;
+	reset();
+}
+
+MIPPacketLossConcealer::~MIPPacketLossConcealer()
+{
+}
+
+bool MIPPacketLossConcealer::init(int samplingRate, int channels)
+{
+	if (samplingRate < 1000)
+	{
+		setErrorString(MIPPACKETLOSSCONCEALER_ERRSTR_BADSAMPRATE);
+		return false;
+	}
+	if (channels < 1)
+	{
+		setErrorString(MIPPACKETLOSSCONCEALER_ERRSTR_BADCHANNELS);
+		return false;
+	}
+
+	// Pitch periods between 2.5 and 15 ms are considered; the correlation is
+	// calculated over the last 15 ms of audio
+
+	m_samplingRate = samplingRate;
+	m_channels = channels;
+	m_minPitch = samplingRate/400;
+	m_maxPitch = (samplingRate*15)/1000;
+	m_fadeStart = samplingRate/100;
+	m_fadeEnd = (samplingRate*6)/100;
+	m_overlap = samplingRate/250;
+	m_historyFrames = 2*m_maxPitch;
+	m_history.resize(m_historyFrames*m_channels);
+
+	reset();
+	m_init = true;
+	return true;
+}
+
+void MIPPacketLossConcealer::reset()
+{
+	m_numHistoryFrames = 0;
+	m_pitch = 0;
+	m_pitchPos = 0;
+	m_erasedFrames = 0;
+	m_concealing = false;
+}
+
+void MIPPacketLossConcealer::addFrames(int16_t *pFrames, int numFrames)
+{
+	if (!m_init || numFrames <= 0)
+		return;
+
+	if (m_concealing)
+	{
+		// Cross-fade from the synthesized signal to the received one
+
+		int overlap = (numFrames < m_overlap)?numFrames:m_overlap;
+
+		if (m_pitch > 0 && overlap > 0)
+		{
+			std::vector<int16_t> synth(overlap*m_channels);
+
+			synthesize(&(synth[0]), overlap, false);
+			for (int i = 0 ; i < overlap ; i++)
+			{
+				float w = (float)(i+1)/(float)(overlap+1);
+
+				for (int c = 0 ; c < m_channels ; c++)
+				{
+					int idx = i*m_channels+c;
+					float v = (1.0f-w)*(float)synth[idx] + w*(float)pFrames[idx];
+
+					pFrames[idx] = (int16_t)v;
+				}
+			}
+		}
+		m_concealing = false;
+		m_erasedFrames = 0;
+	}
+
+	// Append the frames to the history
+
+	if (numFrames >= m_historyFrames)
+	{
+		memcpy(&(m_history[0]), pFrames + (numFrames-m_historyFrames)*m_channels, m_historyFrames*m_channels*sizeof(int16_t));
+		m_numHistoryFrames = m_historyFrames;
+	}
+	else
+	{
+		int keep = m_historyFrames - numFrames;
+
+		memmove(&(m_history[0]), &(m_history[numFrames*m_channels]), keep*m_channels*sizeof(int16_t));
+		memcpy(&(m_history[keep*m_channels]), pFrames, numFrames*m_channels*sizeof(int16_t));
+		m_numHistoryFrames += numFrames;
+		if (m_numHistoryFrames > m_historyFrames)
+			m_numHistoryFrames = m_historyFrames;
+	}
+}
+
+bool MIPPacketLossConcealer::conceal(int16_t *pFrames, int numFrames)
+{
+	if (!m_init)
+		return false;
+	if (numFrames <= 0)
+		return true;
+
+	if (m_numHistoryFrames < m_historyFrames)
+	{
+		// Not enough history to work with
+		memset(pFrames, 0, numFrames*m_channels*sizeof(int16_t));
+		return true;
+	}
+
+	if (!m_concealing)
+	{
+		m_pitch = findPitchPeriod();
+		m_pitchPos = 0;
+		m_erasedFrames = 0;
+		m_concealing = true;
+	}
+
+	synthesize(pFrames, numFrames, true);
+	return true;
+}
+
+int MIPPacketLossConcealer::findPitchPeriod() const
+{
+	// Look for the lag with the highest normalized correlation between the end of
+	// the history and the audio one lag earlier
+
+	int window = m_maxPitch;
+	int end = m_historyFrames;
+	int bestPitch = m_maxPitch;
+	float bestScore = -1.0f;
+
+	for (int lag = m_minPitch ; lag <= m_maxPitch ; lag++)
+	{
+		float corr = 0, energy = 0;
+
+		for (int i = end - window ; i < end ; i++)
+		{
+			for (int c = 0 ; c < m_channels ; c++)
+			{
+				float x = (float)m_history[i*m_channels+c];
+				float y = (float)m_history[(i-lag)*m_channels+c];
+
+				corr += x*y;
+				energy += y*y;
+			}
+		}
+
+		if (energy > 0 && corr > 0)
+		{
+			float score = corr*corr/energy;
+
+			if (score > bestScore)
+			{
+				bestScore = score;
+				bestPitch = lag;
+			}
+		}
+	}
+	return bestPitch;
+}
+
+void MIPPacketLossConcealer::synthesize(int16_t *pFrames, int numFrames, bool advance)
+{
+	// Repeat the last pitch period, attenuating the signal after a while
+
+	int pos = m_pitchPos;
+	int erased = m_erasedFrames;
+	int start = m_historyFrames - m_pitch;
+
+	for (int i = 0 ; i < numFrames ; i++, erased++)
+	{
+		float gain = 1.0f;
+
+		if (erased >= m_fadeEnd)
+			gain = 0;
+		else if (erased > m_fadeStart)
+			gain = (float)(m_fadeEnd - erased)/(float)(m_fadeEnd - m_fadeStart);
+
+		for (int c = 0 ; c < m_channels ; c++)
+			pFrames[i*m_channels+c] = (int16_t)(gain*(float)m_history[(start+pos)*m_channels+c]);
+
+		pos++;
+		if (pos == m_pitch)
+			pos = 0;
+	}
+
+	if (advance)
+	{
+		m_pitchPos = pos;
+		m_erasedFrames = erased;
+	}
+}
+
@@ -0,0 +1,98 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+/**
+ * \file mippacketlossconcealer.h
+ */
+
+#ifndef MIPPACKETLOSSCONCEALER_H
+
+#define MIPPACKETLOSSCONCEALER_H
+
+#include "mipconfig.h"
+#include "miperrorbase.h"
+#include "miptypes.h"
+#include <vector>
+
+/** Hides short gaps in a stream of 16 bit audio.
+ *  This class hides short gaps in a stream of 16 bit audio by repeating the last
+ *  pitch period of the audio that was received before the gap, similar to the method
+ *  described in appendix I of ITU-T G.711. It is meant for codecs which have no
+ *  concealment of their own. After 10 ms, the synthesized signal is gradually 
+ *  attenuated until it is silent after 60 ms. When audio is received again, it is 
+ *  cross-faded with the synthesized signal to avoid a click.
+ */
+class EMIPLIB_IMPORTEXPORT MIPPacketLossConcealer : public MIPErrorBase
+{
+public:
+	MIPPacketLossConcealer();
+	~MIPPacketLossConcealer();
+
+	/** Initializes the concealer for audio with a specific sampling rate and number of channels. */
+	bool init(int samplingRate, int channels);
+
+	/** Clears the audio history. */
+	void reset();
+
+	/** Stores received audio in the history.
+	 *  This should be called for every block of audio that was received. If the
+	 *  previous block was synthesized, the start of this block will be modified to
+	 *  fade in smoothly.
+	 *  \param pFrames The interleaved audio frames.
+	 *  \param numFrames The number of frames.
+	 */
+	void addFrames(int16_t *pFrames, int numFrames);
+
+	/** Synthesizes audio to replace a lost block.
+	 *  Synthesizes audio to replace a lost block. If too little audio was received
+	 *  before the gap, the buffer is filled with silence. 
+	 *  \param pFrames Buffer which will receive the interleaved audio frames.
+	 *  \param numFrames The number of frames to synthesize.
+	 *  \return \c false if the concealer was not initialized, in which case the buffer is not touched.
+	 */
+	bool conceal(int16_t *pFrames, int numFrames);
+
+	/** Returns the sampling rate the concealer was initialized with. */
+	int getSamplingRate() const								{ return m_samplingRate; }
+
+	/** Returns the number of channels the concealer was initialized with. */
+	int getNumberOfChannels() const								{ return m_channels; }
+private:
+	int findPitchPeriod() const;
+	void synthesize(int16_t *pFrames, int numFrames, bool advance);
+
+	bool m_init;
+	int m_samplingRate;
+	int m_channels;
+	int m_minPitch, m_maxPitch;
+	int m_fadeStart, m_fadeEnd, m_overlap;
+	std::vector<int16_t> m_history;
+	int m_historyFrames, m_numHistoryFrames;
+	int m_pitch, m_pitchPos;
+	int m_erasedFrames;
+	bool m_concealing;
+};
+
+#endif // MIPPACKETLOSSCONCEALER_H
+
@@ -0,0 +1,208 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+#include "mipconfig.h"
+#include "mipringbuffer.h"
+#include <string.h>
+
+#include "mipdebug.h"
+
+#define MIPRINGBUFFER_ERRSTR_ALREADYINIT			"Already initialized"
+#define MIPRINGBUFFER_ERRSTR_NOTINIT				"Not initialized"
+#define MIPRINGBUFFER_ERRSTR_BADCAPACITY			"The capacity must be positive and at most 2^30 bytes"
+
+MIPRingBuffer::MIPRingBuffer() : m_writePos(0), m_readPos(0), m_clearPos(0), m_clearRequested(false), m_overruns(0), m_underruns(0)
+{
+	m_capacity = 0;
+	m_mask = 0;
+	m_init = false;
+}
+
+MIPRingBuffer::~MIPRingBuffer()
+{
+	destroy();
+}
+
+bool MIPRingBuffer::init(int capacity)
+{
+	if (m_init)
+	{
+		setErrorString(MIPRINGBUFFER_ERRSTR_ALREADYINIT);
+		return false;
+	}
+
+	if (capacity < 1 || capacity > (1<<30))
+	{
+		setErrorString(MIPRINGBUFFER_ERRSTR_BADCAPACITY);
+		return false;
+	}
+
+	size_t size = 1;
+
+	while (size < (size_t)capacity)
+		size <<= 1;
+
+	m_buffer.resize(size);
+	m_capacity = size;
+	m_mask = size-1;
+
+	m_writePos.store(0);
+	m_readPos.store(0);
+	m_clearPos.store(0);
+	m_clearRequested.store(false);
+	m_overruns.store(0);
+	m_underruns.store(0);
+
+	m_init = true;
+	return true;
+}
+
+bool MIPRingBuffer::destroy()
+{
+	if (!m_init)
+	{
+		setErrorString(MIPRINGBUFFER_ERRSTR_NOTINIT);
+		return false;
+	}
+
+	std::vector<uint8_t> empty;
+
+	m_buffer.swap(empty);
+	m_capacity = 0;
+	m_mask = 0;
+	m_init = false;
+	return true;
+}
+
+int MIPRingBuffer::getAmountBuffered() const
+{
+	size_t readPos = m_readPos.load(std::memory_order_acquire);
+	size_t writePos = m_writePos.load(std::memory_order_acquire);
+
+	return (int)(writePos - readPos);
+}
+
+int MIPRingBuffer::write(const void *pData, int amount)
+{
+	if (!m_init || amount <= 0)
+		return 0;
+
+	size_t writePos = m_writePos.load(std::memory_order_relaxed); // only we change this
+	size_t readPos = m_readPos.load(std::memory_order_acquire);
+	size_t space = m_capacity - (writePos - readPos);
+	size_t num = (size_t)amount;
+
+	if (num > space)
+	{
+		num = space;
+		m_overruns.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	size_t offset = writePos & m_mask;
+	size_t part1 = m_capacity - offset;
+	const uint8_t *pSrc = (const uint8_t *)pData;
+
+	if (part1 >= num)
+		memcpy(&(m_buffer[offset]), pSrc, num);
+	else
+	{
+		memcpy(&(m_buffer[offset]), pSrc, part1);
+		memcpy(&(m_buffer[0]), pSrc + part1, num - part1);
+	}
+
+	m_writePos.store(writePos + num, std::memory_order_release);
+	return (int)num;
+}
+
+int MIPRingBuffer::read(void *pData, int amount)
+{
+	if (!m_init || amount <= 0)
+		return 0;
+
+	handleClearRequest();
+
+	size_t readPos = m_readPos.load(std::memory_order_relaxed); // only we change this
+	size_t writePos = m_writePos.load(std::memory_order_acquire);
+	size_t available = writePos - readPos;
+	size_t num = (size_t)amount;
+
+	if (num > available)
+	{
+		num = available;
+		m_underruns.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	size_t offset = readPos & m_mask;
+	size_t part1 = m_capacity - offset;
+	uint8_t *pDst = (uint8_t *)pData;
+
+	if (part1 >= num)
+		memcpy(pDst, &(m_buffer[offset]), num);
+	else
+	{
+		memcpy(pDst, &(m_buffer[offset]), part1);
+		memcpy(pDst + part1, &(m_buffer[0]), num - part1);
+	}
+
+	m_readPos.store(readPos + num, std::memory_order_release);
+	return (int)num;
+}
+
+void MIPRingBuffer::clear()
+{
+	if (!m_init)
+		return;
+
+	m_clearRequested.store(false, std::memory_order_relaxed);
+	m_readPos.store(m_writePos.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+void MIPRingBuffer::requestClear()
+{
+	if (!m_init)
+		return;
+
+	m_clearPos.store(m_writePos.load(std::memory_order_relaxed), std::memory_order_relaxed);
+	m_clearRequested.store(true, std::memory_order_release);
+}
+
+void MIPRingBuffer::handleClearRequest()
+{
+	if (!m_clearRequested.load(std::memory_order_acquire))
+		return;
+
+	// If the producer requests another clear right now, we'll read the new
+	// position and handle both requests at once
+
+	m_clearRequested.store(false, std::memory_order_relaxed);
+
+	size_t clearPos = m_clearPos.load(std::memory_order_acquire);
+	size_t readPos = m_readPos.load(std::memory_order_relaxed);
+
+	size_t diff = clearPos - readPos;
+
+	if (diff > 0 && diff <= m_capacity) // otherwise we've already read past this position
+		m_readPos.store(clearPos, std::memory_order_release);
+}
+
@@ -0,0 +1,132 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+/**
+ * \file mipringbuffer.h
+ */
+
+#ifndef MIPRINGBUFFER_H
+
+#define MIPRINGBUFFER_H
+
+#include "mipconfig.h"
+#include "miperrorbase.h"
+#include "miptypes.h"
+#include <atomic>
+#include <vector>
+
+#define MIPRINGBUFFER_CACHELINESIZE					64
+
+/** A lock-free buffer to pass a stream of bytes from one thread to another.
+ *  This class is a fixed size ring buffer to which one thread (the producer) writes data
+ *  and from which one other thread (the consumer) reads it. No locks are used and no memory
+ *  is allocated after MIPRingBuffer::init, which makes it suitable to exchange audio with
+ *  a realtime callback: neither side can ever be blocked by the other one.
+ *
+ *  Only the producer may call MIPRingBuffer::write and MIPRingBuffer::requestClear, and only
+ *  the consumer may call MIPRingBuffer::read and MIPRingBuffer::clear. The other functions
+ *  can be called from both threads. Writes for which there is not enough room and reads for
+ *  which not enough data is available are counted as overruns and underruns respectively.
+ */
+class EMIPLIB_IMPORTEXPORT MIPRingBuffer : public MIPErrorBase
+{
+public:
+	MIPRingBuffer();
+	~MIPRingBuffer();
+
+	/** Allocates the buffer.
+	 *  Allocates the buffer.
+	 *  \param capacity The number of bytes the buffer should be able to hold. This
+	 *                  is rounded up to a power of two.
+	 */
+	bool init(int capacity);
+
+	/** Releases the buffer memory. Neither thread may be using the buffer. */
+	bool destroy();
+
+	/** Returns the number of bytes that fit in the buffer. */
+	int getCapacity() const								{ return (int)m_capacity; }
+
+	/** Returns the number of bytes that are currently stored in the buffer.
+	 *  Returns the number of bytes that are currently stored in the buffer. When called
+	 *  from a thread that neither produces nor consumes data, this is a snapshot that 
+	 *  may already be outdated.
+	 */
+	int getAmountBuffered() const;
+
+	/** Writes \c amount bytes from \c pData into the buffer (producer only).
+	 *  Writes \c amount bytes from \c pData into the buffer (producer only). If the 
+	 *  buffer does not have room for all of them, only the part that fits is written
+	 *  and an overrun is counted.
+	 *  \return The number of bytes that were actually written.
+	 */
+	int write(const void *pData, int amount);
+
+	/** Reads and removes \c amount bytes from the buffer, storing them in \c pData (consumer only).
+	 *  Reads and removes \c amount bytes from the buffer, storing them in \c pData (consumer only).
+	 *  If less data is available, all of it is read and an underrun is counted.
+	 *  \return The number of bytes that were actually read.
+	 */
+	int read(void *pData, int amount);
+
+	/** Discards all buffered data (consumer only). */
+	void clear();
+
+	/** Asks the consumer to discard the data that is buffered at this moment (producer only).
+	 *  Asks the consumer to discard the data that is buffered at this moment (producer only).
+	 *  This is done at the start of the next MIPRingBuffer::read call; data written after
+	 *  this request is kept.
+	 */
+	void requestClear();
+
+	/** Returns the number of writes that did not fit completely in the buffer. */
+	int64_t getNumberOfOverruns() const						{ return m_overruns.load(std::memory_order_relaxed); }
+
+	/** Returns the number of reads for which not enough data was available. */
+	int64_t getNumberOfUnderruns() const						{ return m_underruns.load(std::memory_order_relaxed); }
+private:
+	void handleClearRequest();
+
+	// Positions only increase; they're reduced to an offset in the buffer using m_mask.
+	// Each index gets its own cache line so that the producer and the consumer don't
+	// invalidate each other's cache on every access.
+
+	std::atomic<size_t> m_writePos;
+	uint8_t m_pad1[MIPRINGBUFFER_CACHELINESIZE];
+	std::atomic<size_t> m_readPos;
+	uint8_t m_pad2[MIPRINGBUFFER_CACHELINESIZE];
+	std::atomic<size_t> m_clearPos;
+	std::atomic<bool> m_clearRequested;
+	std::atomic<int64_t> m_overruns;
+	std::atomic<int64_t> m_underruns;
+	uint8_t m_pad3[MIPRINGBUFFER_CACHELINESIZE];
+
+	std::vector<uint8_t> m_buffer;
+	size_t m_capacity;
+	size_t m_mask;
+	bool m_init;
+};
+
+#endif // MIPRINGBUFFER_H
+
@@ -349,6 +349,13 @@ void MIPRTPPacketGrouper::checkCompletePacket(int index, std::vector<uint8_t *>
 
 	if (endIdx != -1)
 	{
+		// A part which is known to start the frame can still be preceded by parts
+		// with the same timestamp, e.g. H.264 parameter sets in a separate packet,
+		// so the search only stops at another frame or at a missing part
+
+		if (m_firstPartMarkers[index]) // this part itself is known to start the frame
+			startIdx = index;
+
 		done = false;
 		counter = 0;
 		idx = index;
@@ -383,10 +390,7 @@ void MIPRTPPacketGrouper::checkCompletePacket(int index, std::vector<uint8_t *>
 					else
 					{
 						if (m_firstPartMarkers[idx])
-						{
-							done = true;
 							startIdx = idx;
-						}
 					}
 				}
 			}
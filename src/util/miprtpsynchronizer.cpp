@@ -26,11 +26,27 @@
 #include "miprtpsynchronizer.h"
 #include <iostream>
 #include <cstdlib>
+#include <cmath>
 
 #include "mipdebug.h"
 
 #define MIPRTPSYNCHRONIZER_ERRSTR_IDNOTFOUND		"Specified ID was not found in the table"
 #define MIPRTPSYNCHRONIZER_ERRSTR_INVALIDCNAMELENGTH	"An invalid CNAME length was specified"
+#define MIPRTPSYNCHRONIZER_ERRSTR_NOOFFSET		"No synchronization offset has been calculated for this stream yet"
+
+#define MIPRTPSYNCHRONIZER_MAXSRMAPPINGS		32
+#define MIPRTPSYNCHRONIZER_MINSRMAPPINGS		3
+#define MIPRTPSYNCHRONIZER_MINFITSPAN			10.0
+#define MIPRTPSYNCHRONIZER_MAXSKEW			0.001
+#define MIPRTPSYNCHRONIZER_MAXSRRESIDUAL		0.050
+#define MIPRTPSYNCHRONIZER_JUMPTHRESHOLD		1.0
+
+static inline int32_t getTimestampDifference(uint32_t t1, uint32_t t2)
+{
+	if ((t1 - t2) < 0x80000000)
+		return (int32_t)(t1 - t2);
+	return -(int32_t)(t2 - t1);
+}
 
 MIPRTPSynchronizer::MIPRTPSynchronizer()
 {
@@ -42,6 +58,7 @@ MIPRTPSynchronizer::MIPRTPSynchronizer()
 		exit(-1);
 	}
 
+	m_nextStreamID = 0;
 	clear();
 }
 
@@ -75,7 +92,8 @@ void MIPRTPSynchronizer::clear()
 		delete (*it3).second;
 	m_streamIDTable.clear();
 
-	m_tolerance = MIPTime(0.100);
+	m_tolerance = MIPTime(0.020);
+	m_maxSlewRate = 0.01;
 }
 
 bool MIPRTPSynchronizer::registerStream(const uint8_t *pCName, size_t cnameLength, real_t timestampUnit, int64_t *streamID)
@@ -210,43 +228,219 @@ bool MIPRTPSynchronizer::setStreamInfo(int64_t streamID, MIPTime SRwallclock, ui
 	return true;
 }
 
-MIPTime MIPRTPSynchronizer::calculateSynchronizationOffset(int64_t streamID)
+bool MIPRTPSynchronizer::calculateSynchronizationOffset(int64_t streamID, MIPTime currentOffset, MIPTime *pTargetOffset)
 {
 	std::map<int64_t, StreamInfo *>::iterator it1 = m_streamIDTable.find(streamID);
 
 	if (it1 == m_streamIDTable.end())
-		return MIPTime(0);
+	{
+		setErrorString(MIPRTPSYNCHRONIZER_ERRSTR_IDNOTFOUND);
+		return false;
+	}
 
+	MIPTime curTime = MIPTime::getCurrentTime();
 	StreamInfo *pStreamInf = (*it1).second;
 	StreamGroup *pGroup = pStreamInf->getGroup();
 	bool recalc = false;
+
+	pStreamInf->setCurrentOffset(currentOffset, curTime);
 	
 	if (pGroup->didStreamsChange())		
 		recalc = true;
 	else
 	{
-		if ((MIPTime::getCurrentTime().getValue() - pGroup->getLastCalculationTime().getValue()) > 5.0) // only perform calculation each five seconds
+		if ((curTime.getValue() - pGroup->getLastCalculationTime().getValue()) > 5.0) // only perform calculation each five seconds
 			recalc = true;
 	}
 
-	if (!recalc)
+	if (recalc)
 	{
-//		std::cout << "Stream " << streamID << ": sync offset " << pStreamInf->getSynchronizationOffset().getString() << std::endl;
-		return pStreamInf->getSynchronizationOffset();
+		pGroup->setStreamsChanged(false);
+
+		// The other streams of the group may have moved towards their targets since they 
+		// last reported their offsets
+		pGroup->estimateCurrentOffsets(curTime, m_maxSlewRate);
+
+		MIPTime maxDiff = pGroup->calculateOffsets(); // this should take the old offsets into consideration!
+
+		if (maxDiff > m_tolerance) 
+		{
+			// values changes too much, the offsets will move towards the newly calculated ones
+			pGroup->acceptNewOffsets();
+		}
 	}
 
-	pGroup->setStreamsChanged(false);
+//	std::cout << "Stream " << streamID << ": target offset " << pStreamInf->getTargetOffset().getString() << std::endl;
+
+	if (!pStreamInf->hasTargetOffset())
+	{
+		setErrorString(MIPRTPSYNCHRONIZER_ERRSTR_NOOFFSET);
+		return false;
+	}
 
-	MIPTime maxDiff = pGroup->calculateOffsets(); // this should take the old offsets into consideration!
+	*pTargetOffset = pStreamInf->getTargetOffset();
+	return true;
+}
+
+bool MIPRTPSynchronizer::getClockSkew(int64_t streamID, real_t *pSkew)
+{
+	std::map<int64_t, StreamInfo *>::iterator it1 = m_streamIDTable.find(streamID);
 
-	if (maxDiff > m_tolerance) 
+	if (it1 == m_streamIDTable.end())
 	{
-		// values changes too much, accept newly calculated offsets
-		pGroup->acceptNewOffsets(); // this saves the new offsets as the old offsets
+		setErrorString(MIPRTPSYNCHRONIZER_ERRSTR_IDNOTFOUND);
+		return false;
 	}
 
-//	std::cout << "Stream " << streamID << ": sync offset " << pStreamInf->getSynchronizationOffset().getString() << std::endl;
-		
-	return pStreamInf->getSynchronizationOffset();
+	*pSkew = (*it1).second->getClockSkew();
+	return true;
 }
 
+void MIPRTPSynchronizer::StreamInfo::addSRMapping(MIPTime SRwallclock, uint32_t SRtimestamp)
+{
+	int64_t extendedTimestamp = 0;
+	real_t wallclock = 0;
+
+	if (!m_SRTimestamps.empty())
+	{
+		if (SRtimestamp == m_SRtimestamp && SRwallclock.getNanoSeconds() == m_SRwallclock.getNanoSeconds()) // same report as before
+			return;
+
+		MIPTime t = SRwallclock;
+		t -= m_baseWallclock;
+
+		extendedTimestamp = m_lastExtendedTimestamp + getTimestampDifference(SRtimestamp, m_SRtimestamp);
+		wallclock = t.getValue();
+
+		// If the new report doesn't fit the previous ones, the sender's clock was probably 
+		// adjusted or the stream was restarted; in that case, we start over
+
+		real_t predicted = 0;
+
+		if (m_fitValid)
+			predicted = m_meanWallclock + ((real_t)extendedTimestamp - m_meanTimestamp)/m_timestampRate;
+		else
+			predicted = m_SRWallclocks.back() + ((real_t)(extendedTimestamp - m_lastExtendedTimestamp))*m_tsUnit;
+
+		if (std::fabs(predicted - wallclock) > MIPRTPSYNCHRONIZER_MAXSRRESIDUAL || wallclock <= m_SRWallclocks.back())
+		{
+			m_SRWallclocks.clear();
+			m_SRTimestamps.clear();
+		}
+	}
+
+	if (m_SRTimestamps.empty())
+	{
+		m_baseWallclock = SRwallclock;
+		extendedTimestamp = 0;
+		wallclock = 0;
+	}
+
+	m_SRWallclocks.push_back(wallclock);
+	m_SRTimestamps.push_back((real_t)extendedTimestamp);
+	m_lastExtendedTimestamp = extendedTimestamp;
+
+	if (m_SRTimestamps.size() > MIPRTPSYNCHRONIZER_MAXSRMAPPINGS)
+	{
+		m_SRWallclocks.erase(m_SRWallclocks.begin());
+		m_SRTimestamps.erase(m_SRTimestamps.begin());
+	}
+
+	// Least squares fit of the timestamps as a function of the wallclock time
+
+	size_t num = m_SRTimestamps.size();
+
+	m_fitValid = false;
+	m_skew = 0;
+
+	if (num < MIPRTPSYNCHRONIZER_MINSRMAPPINGS || m_SRWallclocks.back() - m_SRWallclocks.front() < MIPRTPSYNCHRONIZER_MINFITSPAN)
+		return;
+
+	real_t meanWallclock = 0, meanTimestamp = 0;
+
+	for (size_t i = 0 ; i < num ; i++)
+	{
+		meanWallclock += m_SRWallclocks[i];
+		meanTimestamp += m_SRTimestamps[i];
+	}
+	meanWallclock /= (real_t)num;
+	meanTimestamp /= (real_t)num;
+
+	real_t sxx = 0, sxy = 0;
+
+	for (size_t i = 0 ; i < num ; i++)
+	{
+		real_t dx = m_SRWallclocks[i] - meanWallclock;
+		real_t dy = m_SRTimestamps[i] - meanTimestamp;
+
+		sxx += dx*dx;
+		sxy += dx*dy;
+	}
+
+	if (sxx <= 0)
+		return;
+
+	real_t rate = sxy/sxx;
+	real_t skew = rate*m_tsUnit - 1.0;
+
+	if (std::fabs(skew) > MIPRTPSYNCHRONIZER_MAXSKEW) // not plausible, use the nominal rate
+		return;
+
+	m_fitValid = true;
+	m_meanWallclock = meanWallclock;
+	m_meanTimestamp = meanTimestamp;
+	m_timestampRate = rate;
+	m_skew = skew;
+}
+
+MIPTime MIPRTPSynchronizer::StreamInfo::getWallclockTime(uint32_t timestamp) const
+{
+	int32_t tsDiff = getTimestampDifference(timestamp, m_SRtimestamp);
+
+	if (!m_fitValid)
+	{
+		MIPTime wallclock = m_SRwallclock;
+
+		wallclock += MIPTime(((real_t)tsDiff)*m_tsUnit);
+		return wallclock;
+	}
+
+	real_t extendedTimestamp = (real_t)(m_lastExtendedTimestamp + tsDiff);
+	MIPTime wallclock = m_baseWallclock;
+
+	wallclock += MIPTime(m_meanWallclock + (extendedTimestamp - m_meanTimestamp)/m_timestampRate);
+	return wallclock;
+}
+
+MIPTime MIPRTPSynchronizer::slewOffset(MIPTime offset, MIPTime targetOffset, real_t maxSlewRate, real_t elapsed)
+{
+	real_t d = targetOffset.getValue() - offset.getValue();
+
+	// Very large corrections are applied at once
+
+	if (maxSlewRate <= 0 || std::fabs(d) > MIPRTPSYNCHRONIZER_JUMPTHRESHOLD)
+		return targetOffset;
+
+	real_t maxStep = (elapsed > 0)?maxSlewRate*elapsed:0;
+
+	if (d > maxStep)
+		d = maxStep;
+	else if (d < -maxStep)
+		d = -maxStep;
+
+	offset += MIPTime(d);
+	return offset;
+}
+
+void MIPRTPSynchronizer::StreamInfo::estimateCurrentOffset(MIPTime curTime, real_t maxSlewRate)
+{
+	MIPTime elapsed = curTime;
+
+	elapsed -= m_lastSlewTime;
+	m_lastSlewTime = curTime;
+
+	if (!m_targetSet)
+		return;
+
+	m_syncOffset = MIPRTPSynchronizer::slewOffset(m_syncOffset, m_targetOffset, maxSlewRate, elapsed.getValue());
+}
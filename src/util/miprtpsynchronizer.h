@@ -36,6 +36,7 @@
 #include <jthread/jmutex.h>
 #include <list>
 #include <map>
+#include <vector>
 #include <string.h>
 
 //#include <iostream>
@@ -45,6 +46,14 @@
  *  you simply have to pass a MIPRTPSynchronizer instance as an argument to the MIPRTPDecoder::init
  *  function of a MIPRTPDecoder derived class. Based upon the RTCP CNAME information, streams
  *  will be grouped and synchronized.
+ *
+ *  For each stream, the relation between the RTP timestamps and the sender's wallclock time is
+ *  estimated by a linear regression over the mappings in the received sender reports. This
+ *  smooths out the jitter of individual reports and takes into account that the media clock of
+ *  the sender may run slightly faster or slower than its nominal rate, which would otherwise 
+ *  make the streams drift apart in long sessions. When the synchronization offsets need to 
+ *  change, they are adjusted gradually (see MIPRTPSynchronizer::setMaximumSlewRate) instead 
+ *  of in one jump.
  */
 class EMIPLIB_IMPORTEXPORT MIPRTPSynchronizer : public MIPErrorBase
 {
@@ -66,15 +75,49 @@ public:
 	void clear();
 	
 	/** Sets the maximum amount of de-synchronization which may exist between streams of the
-	 *  same source (default: 100 milliseconds).
+	 *  same source (default: 20 milliseconds).
 	 */
 	void setTolerance(MIPTime t)								{ m_tolerance = t; }
+
+	/** Sets the rate at which synchronization offsets are adjusted.
+	 *  Sets the rate at which synchronization offsets are adjusted, in seconds per second (default:
+	 *  0.01, so that an offset changes by at most ten milliseconds each second). Small corrections
+	 *  are then barely noticeable. The offset of a new stream, and a correction of more than a 
+	 *  second, are still applied at once. Specify zero to always apply the new offsets at once.
+	 */
+	void setMaximumSlewRate(real_t r)							{ m_maxSlewRate = (r > 0)?r:0; }
+
+	/** Returns the rate at which synchronization offsets are adjusted (see MIPRTPSynchronizer::setMaximumSlewRate). */
+	real_t getMaximumSlewRate() const							{ return m_maxSlewRate; }
+
+	/** Moves a synchronization offset towards its target.
+	 *  Moves the synchronization offset \c offset towards \c targetOffset, by at most
+	 *  \c maxSlewRate times \c elapsed seconds, and returns the result. The target is returned
+	 *  at once if \c maxSlewRate is zero, or if the offsets differ by more than a second. Since
+	 *  this function doesn't access any state, the lock doesn't need to be held.
+	 */
+	static MIPTime slewOffset(MIPTime offset, MIPTime targetOffset, real_t maxSlewRate, real_t elapsed);
+
+	/** Stores the estimated clock skew of a stream in \c pSkew.
+	 *  Stores the estimated clock skew of a stream in \c pSkew: this is the relative amount by
+	 *  which the RTP timestamps advance faster than the nominal timestamp rate, measured against
+	 *  the wallclock time of the sender. The value is zero until enough sender reports have been
+	 *  received to make an estimate.
+	 */
+	bool getClockSkew(int64_t streamID, real_t *pSkew);
 	
 	bool registerStream(const uint8_t *pCName, size_t cnameLength, real_t timestampUnit, int64_t *streamID);
 	bool unregisterStream(int64_t streamID);
 	bool setStreamInfo(int64_t streamID, MIPTime SRwallclock, uint32_t SRtimestamp, uint32_t curTimestamp,
 			   MIPTime outputStreamOffset, MIPTime totalComponentDelay);
-	MIPTime calculateSynchronizationOffset(int64_t streamID);
+
+	/** Calculates the synchronization offset a stream should move towards.
+	 *  Calculates the synchronization offset a stream should move towards and stores it in
+	 *  \c pTargetOffset. The caller adjusts the offset it actually applies gradually, using
+	 *  MIPRTPSynchronizer::slewOffset, and passes that offset as \c currentOffset. If no
+	 *  offset has been calculated for the stream yet, the function returns false.
+	 */
+	bool calculateSynchronizationOffset(int64_t streamID, MIPTime currentOffset, MIPTime *pTargetOffset);
 private:
 	class CNameInfo
 	{
@@ -104,13 +147,14 @@ private:
 	class StreamInfo
 	{
 	public:
-		StreamInfo(StreamGroup *pGroup, real_t tsUnit)					{ m_pGroup = pGroup; m_infoSet = false; m_tsUnit = tsUnit; }
+		StreamInfo(StreamGroup *pGroup, real_t tsUnit)					{ m_pGroup = pGroup; m_infoSet = false; m_tsUnit = tsUnit; m_targetSet = false; m_fitValid = false; m_skew = 0; }
 		~StreamInfo()									{ }
 		StreamGroup *getGroup()								{ return m_pGroup; }
 		bool isInfoSet() const								{ return m_infoSet; }
 		void setInfo(MIPTime SRwallclock, uint32_t SRtimestamp, uint32_t curTimestamp,
 			     MIPTime outputStreamOffset, MIPTime totalComponentDelay)		
 		{
+			addSRMapping(SRwallclock, SRtimestamp);
 			m_infoSet = true;
 			m_lastInfoUpdateTime = MIPTime::getCurrentTime();
 			m_SRwallclock = SRwallclock;
@@ -126,6 +170,7 @@ private:
 		MIPTime getOutputStreamOffset() const						{ return m_outputStreamOffset; }
 		MIPTime getTotalComponentDelay() const						{ return m_totalComponentDelay; }
 		real_t getTimestampUnit() const							{ return m_tsUnit; }
+		real_t getClockSkew() const							{ return m_skew; }
 
 		MIPTime getSynchronizationOffset() const					{ return m_syncOffset; }
 		
@@ -137,22 +182,10 @@ private:
 //			std::cout << std::endl;
 //			std::cout << "lastTimeDiff: " << lastTimeDiff.getString() << std::endl;
 
-			int32_t tsDiff;
-			
-			if ((m_lastTimestamp - m_SRtimestamp) < 0x80000000)
-				tsDiff = (int32_t)(m_lastTimestamp - m_SRtimestamp);
-			else
-				tsDiff = -(int32_t)(m_SRtimestamp - m_lastTimestamp);
-
-			MIPTime tsTimeDiff = MIPTime(((real_t)tsDiff)*m_tsUnit);
+			MIPTime wallclock = getWallclockTime(m_lastTimestamp);
 
-//			std::cout << "tsTimeDiff: " << tsTimeDiff.getString() << std::endl;
-
-			MIPTime wallclock = m_SRwallclock;
-
-//			std::cout << "m_SRwallclock: " << wallclock.getString() << std::endl;
+//			std::cout << "wallclock: " << wallclock.getString() << std::endl;
 			
-			wallclock += tsTimeDiff;
 			wallclock += lastTimeDiff;
 
 			// 'wallclock' would be our result if there would be no component delay, output stream delay etc
@@ -172,9 +205,20 @@ private:
 		}
 		MIPTime getRemoteWallclockTime() const						{ return m_remoteWallclockTime; }
 		void setOffsetAdjustment(MIPTime a)						{ m_adjustment = a; }
-		void acceptAdjustment()								{ m_syncOffset += m_adjustment; }
-		void adjustOffset(MIPTime t)							{ m_syncOffset -= t; }
+		MIPTime getAdjustedOffset() const						{ MIPTime t = m_syncOffset; t += m_adjustment; return t; }
+		void setTargetOffset(MIPTime t)							{ if (!m_targetSet) m_syncOffset = t; m_targetOffset = t; m_targetSet = true; }
+		bool hasTargetOffset() const							{ return m_targetSet; }
+		MIPTime getTargetOffset() const							{ return m_targetOffset; }
+
+		// The offset is applied by the decoder, which reports it when it resynchronizes. In
+		// between, it is estimated by slewing it towards the target in the same way; like
+		// the decoder, the first target is used at once.
+		void setCurrentOffset(MIPTime t, MIPTime curTime)				{ m_syncOffset = t; m_lastSlewTime = curTime; }
+		void estimateCurrentOffset(MIPTime curTime, real_t maxSlewRate);
 	private:
+		void addSRMapping(MIPTime SRwallclock, uint32_t SRtimestamp);
+		MIPTime getWallclockTime(uint32_t timestamp) const;
+
 		StreamGroup *m_pGroup;
 		bool m_infoSet;
 		MIPTime m_lastInfoUpdateTime;
@@ -187,6 +231,18 @@ private:
 		MIPTime m_syncOffset;
 		MIPTime m_adjustment;
 		MIPTime m_remoteWallclockTime;
+		MIPTime m_targetOffset;
+		MIPTime m_lastSlewTime;
+		bool m_targetSet;
+
+		// The sender report mappings, relative to the first one in the list
+		std::vector<real_t> m_SRWallclocks;
+		std::vector<real_t> m_SRTimestamps;
+		MIPTime m_baseWallclock;
+		int64_t m_lastExtendedTimestamp;
+		bool m_fitValid;
+		real_t m_meanWallclock, m_meanTimestamp, m_timestampRate;
+		real_t m_skew;
 	};
 
 	class StreamGroup
@@ -198,6 +254,13 @@ private:
 		void setStreamsChanged(bool f)							{ m_streamsChanged = f; }
 		bool didStreamsChange() const							{ return m_streamsChanged; }
 		MIPTime getLastCalculationTime() const						{ return m_lastCalcTime; }
+		void estimateCurrentOffsets(MIPTime curTime, real_t maxSlewRate)
+		{
+			std::list<StreamInfo *>::iterator it;
+
+			for (it = m_streams.begin() ; it != m_streams.end() ; it++)
+				(*it)->estimateCurrentOffset(curTime, maxSlewRate);
+		}
 		MIPTime calculateOffsets()
 		{
 			MIPTime referenceTime = MIPTime::getCurrentTime();
@@ -261,8 +324,7 @@ private:
 			{
 				if ((*it)->isInfoSet())
 				{
-					(*it)->acceptAdjustment();
-					MIPTime t2 = (*it)->getSynchronizationOffset();
+					MIPTime t2 = (*it)->getAdjustedOffset();
 					
 					if (!extSet)
 					{
@@ -277,10 +339,16 @@ private:
 				}
 			}
 
+			// The offsets themselves are only changed gradually, see MIPRTPSynchronizer::slewOffset
+
 			for (it = m_streams.begin() ; it != m_streams.end() ; it++)
 			{
 				if ((*it)->isInfoSet())
-					(*it)->adjustOffset(minOffset);
+				{
+					MIPTime t = (*it)->getAdjustedOffset();
+					t -= minOffset;
+					(*it)->setTargetOffset(t);
+				}
 			}
 		}
 	private:
@@ -293,6 +361,7 @@ private:
 	std::map<int64_t, StreamInfo *> m_streamIDTable;
 	
 	MIPTime m_tolerance;
+	real_t m_maxSlewRate;
 	int64_t m_nextStreamID;
 	jthread::JMutex m_mutex;
 };
@@ -0,0 +1,478 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+#include "mipconfig.h"
+#include "mipstreamresampler.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#include <xmmintrin.h>
+	#define MIPSTREAMRESAMPLER_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#include <arm_neon.h>
+	#define MIPSTREAMRESAMPLER_NEON
+#endif
+
+#include "mipdebug.h"
+
+#define MIPSTREAMRESAMPLER_ERRSTR_BADRATE			"Sampling rates must be positive"
+#define MIPSTREAMRESAMPLER_ERRSTR_BADCHANNELS			"Can't handle this channel conversion"
+
+#define MIPSTREAMRESAMPLER_MAXPHASES				256
+#define MIPSTREAMRESAMPLER_PI					3.14159265358979323846
+
+// Dot product of 'num' samples, 'num' must be a multiple of four
+static inline float dotProduct(const float *pSamples, const float *pCoeffs, int num)
+{
+#if defined(MIPSTREAMRESAMPLER_SSE)
+	__m128 sum0 = _mm_setzero_ps();
+	__m128 sum1 = _mm_setzero_ps();
+	int i = 0;
+
+	for ( ; i + 8 <= num ; i += 8)
+	{
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(pSamples + i), _mm_loadu_ps(pCoeffs + i)));
+		sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(pSamples + i + 4), _mm_loadu_ps(pCoeffs + i + 4)));
+	}
+	if (i < num)
+		sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(pSamples + i), _mm_loadu_ps(pCoeffs + i)));
+	sum0 = _mm_add_ps(sum0, sum1);
+
+	float parts[4];
+
+	_mm_storeu_ps(parts, sum0);
+	return (parts[0] + parts[1]) + (parts[2] + parts[3]);
+#elif defined(MIPSTREAMRESAMPLER_NEON)
+	float32x4_t sum = vdupq_n_f32(0);
+
+	for (int i = 0 ; i < num ; i += 4)
+		sum = vmlaq_f32(sum, vld1q_f32(pSamples + i), vld1q_f32(pCoeffs + i));
+
+	float32x2_t s = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+
+	return vget_lane_f32(vpadd_f32(s, s), 0);
+#else
+	float sum = 0;
+
+	for (int i = 0 ; i < num ; i++)
+		sum += pSamples[i]*pCoeffs[i];
+	return sum;
+#endif
+}
+
+// Zeroth order modified Bessel function of the first kind, used for the Kaiser window
+static double besselI0(double x)
+{
+	double sum = 1.0;
+	double term = 1.0;
+	double halfX = x/2.0;
+
+	for (int k = 1 ; k < 50 ; k++)
+	{
+		term *= (halfX/(double)k)*(halfX/(double)k);
+		sum += term;
+		if (term < sum*1e-12)
+			break;
+	}
+	return sum;
+}
+
+static int greatestCommonDivisor(int a, int b)
+{
+	while (b != 0)
+	{
+		int t = a % b;
+
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+MIPStreamResampler::MIPStreamResampler()
+{
+	m_init = false;
+	m_passThrough = false;
+	m_inRate = 1;
+	m_inChannels = 0;
+	m_numTaps = 0;
+}
+
+MIPStreamResampler::~MIPStreamResampler()
+{
+}
+
+bool MIPStreamResampler::init(int inRate, int inChannels, int outRate, int outChannels, Quality quality)
+{
+	if (inRate < 1 || outRate < 1)
+	{
+		setErrorString(MIPSTREAMRESAMPLER_ERRSTR_BADRATE);
+		return false;
+	}
+	if (inChannels < 1 || outChannels < 1 || (inChannels != outChannels && inChannels != 1 && outChannels != 1))
+	{
+		setErrorString(MIPSTREAMRESAMPLER_ERRSTR_BADCHANNELS);
+		return false;
+	}
+
+	m_inRate = inRate;
+	m_outRate = outRate;
+	m_inChannels = inChannels;
+	m_outChannels = outChannels;
+	
+	// If the number of channels is reduced, the input is first mixed to mono; if
+	// it's increased, mono audio is resampled and copied to all output channels
+	m_channels = (inChannels == outChannels)?inChannels:1;
+	m_tmpFrame.resize(m_channels);
+
+	int gcd = greatestCommonDivisor(inRate, outRate);
+
+	m_upFactor = outRate/gcd;
+	m_downFactor = inRate/gcd;
+	m_passThrough = (inRate == outRate);
+	
+	if (m_passThrough)
+	{
+		m_numTaps = 0;
+		m_numPhases = 0;
+		m_coefficients.clear();
+		m_history.clear();
+	}
+	else
+	{
+		buildFilter(quality);
+		m_history.resize(m_channels);
+	}
+
+	m_init = true;
+	reset();
+	return true;
+}
+
+void MIPStreamResampler::buildFilter(Quality quality)
+{
+	int zeroCrossings = 8;
+	double beta = 7.0;
+	double rolloff = 0.9;
+
+	if (quality == Fast)
+	{
+		zeroCrossings = 4;
+		beta = 5.0;
+		rolloff = 0.85;
+	}
+	else if (quality == Best)
+	{
+		zeroCrossings = 16;
+		beta = 9.0;
+		rolloff = 0.94;
+	}
+
+	// cutoff relative to the Nyquist frequency of the input; when downsampling it
+	// must be lowered to the Nyquist frequency of the output to avoid aliasing
+	double cutoff = rolloff;
+
+	if (m_outRate < m_inRate)
+		cutoff *= (double)m_outRate/(double)m_inRate;
+
+	int halfTaps = (int)ceil((double)zeroCrossings/cutoff);
+
+	m_numTaps = ((2*halfTaps + 3)/4)*4;
+	m_numPhases = (m_upFactor <= MIPSTREAMRESAMPLER_MAXPHASES)?m_upFactor:MIPSTREAMRESAMPLER_MAXPHASES;
+	m_coefficients.resize((m_numPhases+1)*m_numTaps);
+
+	double halfWidth = (double)(m_numTaps/2);
+	double windowScale = 1.0/besselI0(beta);
+	int center = m_numTaps/2-1;
+
+	// Row 'p' contains the filter for an output sample which lies a fraction
+	// p/m_numPhases of an input sample beyond the center tap. An extra row
+	// is stored to be able to interpolate between phases.
+
+	for (int p = 0 ; p <= m_numPhases ; p++)
+	{
+		double frac = (double)p/(double)m_numPhases;
+		float *pRow = &(m_coefficients[p*m_numTaps]);
+		double sum = 0;
+
+		for (int j = 0 ; j < m_numTaps ; j++)
+		{
+			double d = (double)(j - center) - frac;
+			double x = cutoff*d;
+			double sinc = (fabs(x) < 1e-9)?1.0:(sin(MIPSTREAMRESAMPLER_PI*x)/(MIPSTREAMRESAMPLER_PI*x));
+			double r = d/halfWidth;
+			double w = (fabs(r) >= 1.0)?0.0:(besselI0(beta*sqrt(1.0-r*r))*windowScale);
+			double h = cutoff*sinc*w;
+
+			pRow[j] = (float)h;
+			sum += h;
+		}
+
+		// unity gain at DC for every phase
+		for (int j = 0 ; j < m_numTaps ; j++)
+			pRow[j] = (float)((double)pRow[j]/sum);
+	}
+}
+
+void MIPStreamResampler::reset()
+{
+	if (!m_init || m_passThrough)
+		return;
+
+	// Start with a history of zeros which also covers the look-ahead of the
+	// filter, so that output can be produced for every input frame immediately
+
+	m_buffered = m_numTaps-1;
+	m_position = m_numTaps/2-1;
+	m_phase = 0;
+
+	for (int c = 0 ; c < m_channels ; c++)
+		m_history[c].assign(m_buffered, 0);
+}
+
+int MIPStreamResampler::getMaximumOutputFrames(int numInputFrames) const
+{
+	if (m_passThrough)
+		return numInputFrames;
+	return (int)((((int64_t)numInputFrames+1)*(int64_t)m_upFactor)/(int64_t)m_downFactor) + 2;
+}
+
+void MIPStreamResampler::appendInput(const float *pInput, int numInputFrames)
+{
+	for (int c = 0 ; c < m_channels ; c++)
+	{
+		if ((int)m_history[c].size() < m_buffered + numInputFrames)
+			m_history[c].resize(m_buffered + numInputFrames);
+	}
+
+	if (m_channels == m_inChannels)
+	{
+		for (int c = 0 ; c < m_channels ; c++)
+		{
+			float *pDst = &(m_history[c][m_buffered]);
+			const float *pSrc = pInput + c;
+
+			for (int i = 0 ; i < numInputFrames ; i++, pSrc += m_inChannels)
+				pDst[i] = *pSrc;
+		}
+	}
+	else // mix down to mono
+	{
+		float *pDst = &(m_history[0][m_buffered]);
+		const float *pSrc = pInput;
+		float scale = 1.0f/(float)m_inChannels;
+
+		for (int i = 0 ; i < numInputFrames ; i++)
+		{
+			float sum = 0;
+
+			for (int c = 0 ; c < m_inChannels ; c++, pSrc++)
+				sum += *pSrc;
+			pDst[i] = sum*scale;
+		}
+	}
+	m_buffered += numInputFrames;
+}
+
+void MIPStreamResampler::appendInput(const int16_t *pInput, int numInputFrames)
+{
+	for (int c = 0 ; c < m_channels ; c++)
+	{
+		if ((int)m_history[c].size() < m_buffered + numInputFrames)
+			m_history[c].resize(m_buffered + numInputFrames);
+	}
+
+	if (m_channels == m_inChannels)
+	{
+		for (int c = 0 ; c < m_channels ; c++)
+		{
+			float *pDst = &(m_history[c][m_buffered]);
+			const int16_t *pSrc = pInput + c;
+
+			for (int i = 0 ; i < numInputFrames ; i++, pSrc += m_inChannels)
+				pDst[i] = (float)(*pSrc);
+		}
+	}
+	else // mix down to mono
+	{
+		float *pDst = &(m_history[0][m_buffered]);
+		const int16_t *pSrc = pInput;
+		float scale = 1.0f/(float)m_inChannels;
+
+		for (int i = 0 ; i < numInputFrames ; i++)
+		{
+			float sum = 0;
+
+			for (int c = 0 ; c < m_inChannels ; c++, pSrc++)
+				sum += (float)(*pSrc);
+			pDst[i] = sum*scale;
+		}
+	}
+	m_buffered += numInputFrames;
+}
+
+int MIPStreamResampler::process(float *pOutput, int16_t *pOutputInt)
+{
+	int halfTaps = m_numTaps/2;
+	int numFrames = 0;
+	float *pValues = &(m_tmpFrame[0]);
+
+	while (m_position + halfTaps < m_buffered)
+	{
+		int start = m_position - (halfTaps-1);
+
+		if (m_numPhases == m_upFactor)
+		{
+			const float *pRow = &(m_coefficients[m_phase*m_numTaps]);
+
+			for (int c = 0 ; c < m_channels ; c++)
+				pValues[c] = dotProduct(&(m_history[c][start]), pRow, m_numTaps);
+		}
+		else // interpolate between the two nearest phases
+		{
+			int64_t scaledPhase = (int64_t)m_phase*(int64_t)m_numPhases;
+			int row = (int)(scaledPhase/m_upFactor);
+			float frac = (float)(scaledPhase - (int64_t)row*(int64_t)m_upFactor)/(float)m_upFactor;
+			const float *pRow1 = &(m_coefficients[row*m_numTaps]);
+			const float *pRow2 = pRow1 + m_numTaps;
+
+			for (int c = 0 ; c < m_channels ; c++)
+			{
+				const float *pSamples = &(m_history[c][start]);
+				float v1 = dotProduct(pSamples, pRow1, m_numTaps);
+				float v2 = dotProduct(pSamples, pRow2, m_numTaps);
+
+				pValues[c] = v1 + frac*(v2 - v1);
+			}
+		}
+
+		for (int c = 0 ; c < m_outChannels ; c++)
+		{
+			float v = pValues[(m_channels == 1)?0:c];
+
+			if (pOutput)
+				*pOutput++ = v;
+			else
+			{
+				v = (v < 0)?(v - 0.5f):(v + 0.5f);
+				if (v > 32767.0f)
+					v = 32767.0f;
+				else if (v < -32768.0f)
+					v = -32768.0f;
+				*pOutputInt++ = (int16_t)v;
+			}
+		}
+		numFrames++;
+
+		m_phase += m_downFactor;
+		m_position += m_phase/m_upFactor;
+		m_phase %= m_upFactor;
+	}
+
+	// Drop the samples which are no longer needed
+	
+	int drop = m_position - (halfTaps-1);
+
+	if (drop > 0)
+	{
+		for (int c = 0 ; c < m_channels ; c++)
+		{
+			if (m_buffered > drop)
+				memmove(&(m_history[c][0]), &(m_history[c][drop]), sizeof(float)*(m_buffered - drop));
+		}
+		m_buffered -= drop;
+		m_position -= drop;
+	}
+	return numFrames;
+}
+
+int MIPStreamResampler::resample(const float *pInput, int numInputFrames, float *pOutput)
+{
+	if (!m_init || numInputFrames < 1)
+		return 0;
+
+	if (m_passThrough)
+	{
+		if (m_inChannels == m_outChannels)
+			memcpy(pOutput, pInput, sizeof(float)*numInputFrames*m_inChannels);
+		else if (m_inChannels == 1)
+		{
+			for (int i = 0 ; i < numInputFrames ; i++)
+				for (int c = 0 ; c < m_outChannels ; c++)
+					*pOutput++ = pInput[i];
+		}
+		else
+		{
+			float scale = 1.0f/(float)m_inChannels;
+
+			for (int i = 0 ; i < numInputFrames ; i++)
+			{
+				float sum = 0;
+
+				for (int c = 0 ; c < m_inChannels ; c++)
+					sum += *pInput++;
+				pOutput[i] = sum*scale;
+			}
+		}
+		return numInputFrames;
+	}
+
+	appendInput(pInput, numInputFrames);
+	return process(pOutput, 0);
+}
+
+int MIPStreamResampler::resample(const int16_t *pInput, int numInputFrames, int16_t *pOutput)
+{
+	if (!m_init || numInputFrames < 1)
+		return 0;
+
+	if (m_passThrough)
+	{
+		if (m_inChannels == m_outChannels)
+			memcpy(pOutput, pInput, sizeof(int16_t)*numInputFrames*m_inChannels);
+		else if (m_inChannels == 1)
+		{
+			for (int i = 0 ; i < numInputFrames ; i++)
+				for (int c = 0 ; c < m_outChannels ; c++)
+					*pOutput++ = pInput[i];
+		}
+		else
+		{
+			for (int i = 0 ; i < numInputFrames ; i++)
+			{
+				int32_t sum = 0;
+
+				for (int c = 0 ; c < m_inChannels ; c++)
+					sum += (int32_t)(*pInput++);
+				pOutput[i] = (int16_t)(sum/m_inChannels);
+			}
+		}
+		return numInputFrames;
+	}
+
+	appendInput(pInput, numInputFrames);
+	return process(0, pOutput);
+}
+
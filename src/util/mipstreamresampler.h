@@ -0,0 +1,127 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+/**
+ * \file mipstreamresampler.h
+ */
+
+#ifndef MIPSTREAMRESAMPLER_H
+
+#define MIPSTREAMRESAMPLER_H
+
+#include "mipconfig.h"
+#include "miperrorbase.h"
+#include "miptime.h"
+#include "miptypes.h"
+#include <vector>
+
+/** Streaming sampling rate and channel converter.
+ *  This class converts a continuous stream of audio from one sampling rate to
+ *  another, using a Kaiser windowed sinc filter which is stored as a polyphase
+ *  table. The filter history is kept between calls, so consecutive blocks of
+ *  the same stream can be converted without discontinuities at their edges.
+ *  
+ *  Besides the sampling rate, the number of channels can be converted as well:
+ *  mono audio can be converted to several channels and vice versa.
+ *
+ *  The output is delayed by half the filter length (see MIPStreamResampler::getDelay),
+ *  which makes sure that each block of input results in the number of output
+ *  frames that corresponds to its duration.
+ */
+class EMIPLIB_IMPORTEXPORT MIPStreamResampler : public MIPErrorBase
+{
+public:
+	/** Quality settings, determining the length of the interpolation filter. */
+	enum Quality 
+	{ 
+		/** Short filter with a wide transition band, cheapest to compute. */
+		Fast, 
+		/** A good compromise between quality and speed. */
+		Medium, 
+		/** Long filter with a steep transition band and high stopband attenuation. */
+		Best 
+	};
+
+	MIPStreamResampler();
+	~MIPStreamResampler();
+
+	/** Initializes the resampler.
+	 *  Initializes the resampler.
+	 *  \param inRate Sampling rate of the input audio.
+	 *  \param inChannels Number of channels in the input audio.
+	 *  \param outRate Sampling rate of the output audio.
+	 *  \param outChannels Number of channels in the output audio. If this differs
+	 *                     from \c inChannels, one of both must be 1.
+	 *  \param quality Quality setting for the interpolation filter.
+	 */
+	bool init(int inRate, int inChannels, int outRate, int outChannels, Quality quality = Medium);
+
+	/** Clears the stored filter history, as if the resampler was just initialized. */
+	void reset();
+
+	/** Returns the input sampling rate. */
+	int getInputSamplingRate() const								{ return m_inRate; }
+
+	/** Returns the number of input channels. */
+	int getNumberOfInputChannels() const								{ return m_inChannels; }
+
+	/** Returns the delay introduced by the resampler. */
+	MIPTime getDelay() const									{ return MIPTime((real_t)(m_numTaps/2)/(real_t)m_inRate); }
+
+	/** Returns the maximum number of output frames that \c numInputFrames input frames can produce. */
+	int getMaximumOutputFrames(int numInputFrames) const;
+
+	/** Converts \c numInputFrames interleaved frames from \c pInput.
+	 *  Converts \c numInputFrames interleaved frames from \c pInput and stores the
+	 *  result in \c pOutput, which must be able to hold the amount of frames returned
+	 *  by MIPStreamResampler::getMaximumOutputFrames. Returns the number of frames
+	 *  which were actually stored.
+	 */
+	int resample(const float *pInput, int numInputFrames, float *pOutput);
+
+	/** Converts \c numInputFrames frames of native endian signed 16 bit samples.
+	 *  Converts \c numInputFrames frames of native endian signed 16 bit samples, similar 
+	 *  to the floating point version. Output samples are clipped to the 16 bit range.
+	 */
+	int resample(const int16_t *pInput, int numInputFrames, int16_t *pOutput);
+private:
+	void buildFilter(Quality quality);
+	void appendInput(const float *pInput, int numInputFrames);
+	void appendInput(const int16_t *pInput, int numInputFrames);
+	int process(float *pOutput, int16_t *pOutputInt);
+	
+	bool m_init;
+	bool m_passThrough;
+	int m_inRate, m_outRate;
+	int m_inChannels, m_outChannels, m_channels;
+	int m_upFactor, m_downFactor;
+	int m_numTaps, m_numPhases;
+	std::vector<float> m_coefficients;
+	std::vector<std::vector<float> > m_history;
+	std::vector<float> m_tmpFrame;
+	int m_buffered, m_position, m_phase;
+};
+
+#endif // MIPSTREAMRESAMPLER_H
+
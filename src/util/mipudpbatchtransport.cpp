@@ -0,0 +1,472 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+#ifndef _GNU_SOURCE
+	#define _GNU_SOURCE // needed for recvmmsg and sendmmsg
+#endif // _GNU_SOURCE
+
+#include "mipconfig.h"
+
+#if !(defined(WIN32) || defined(_WIN32_WCE))
+
+#include "mipudpbatchtransport.h"
+#include <jrtplib3/rtpipv4address.h>
+#include <jthread/jmutexautolock.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <ifaddrs.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <iostream>
+#include <cstdlib>
+
+#include "mipdebug.h"
+
+using namespace jrtplib;
+using namespace jthread;
+
+#define MIPUDPBATCHTRANSPORT_ERRSTR_ALREADYINIT			"Already initialized"
+#define MIPUDPBATCHTRANSPORT_ERRSTR_NOTINIT			"Not initialized"
+#define MIPUDPBATCHTRANSPORT_ERRSTR_PORTBASENOTEVEN		"The port base must be an even number"
+#define MIPUDPBATCHTRANSPORT_ERRSTR_BADBATCHSIZE		"The batch size must be at least one"
+#define MIPUDPBATCHTRANSPORT_ERRSTR_BADMAXPACKETSIZE		"The maximum packet size is too small"
+#define MIPUDPBATCHTRANSPORT_ERRSTR_CANTCREATESOCKET		"Unable to create socket: "
+#define MIPUDPBATCHTRANSPORT_ERRSTR_CANTBINDSOCKET		"Unable to bind socket: "
+#define MIPUDPBATCHTRANSPORT_ERRSTR_CANTRECEIVE			"Error receiving packets: "
+#define MIPUDPBATCHTRANSPORT_ERRSTR_DESTINATIONEXISTS		"The specified destination is already in the list"
+#define MIPUDPBATCHTRANSPORT_ERRSTR_DESTINATIONNOTFOUND		"The specified destination was not found"
+
+#define MIPUDPBATCHTRANSPORT_MINPACKETSIZE			12 // size of an RTP header
+
+// The storage for the system calls is allocated once in MIPUDPBatchTransport::init. Each
+// receive slot holds one byte more than the maximum packet size, so that larger packets
+// can be detected even without the MSG_TRUNC flag.
+
+class MIPUDPBatchTransport::BatchData
+{
+public:
+	BatchData(int batchSize, int maxPacketSize) : m_recvBuffer((size_t)batchSize*(size_t)(maxPacketSize+1)),
+	                                              m_recvAddresses(batchSize), m_recvIOVecs(batchSize),
+	                                              m_sendAddresses(batchSize)
+#ifdef MIPCONFIG_HAVE_RECVMMSG
+	                                            , m_recvHeaders(batchSize), m_sendHeaders(batchSize)
+#endif // MIPCONFIG_HAVE_RECVMMSG
+	{
+		memset(&m_recvAddresses[0], 0, sizeof(struct sockaddr_in)*batchSize);
+		memset(&m_sendAddresses[0], 0, sizeof(struct sockaddr_in)*batchSize);
+		memset(&m_sendIOVec, 0, sizeof(struct iovec));
+
+		for (int i = 0 ; i < batchSize ; i++)
+		{
+			m_recvIOVecs[i].iov_base = &m_recvBuffer[(size_t)i*(size_t)(maxPacketSize+1)];
+			m_recvIOVecs[i].iov_len = maxPacketSize+1;
+		}
+#ifdef MIPCONFIG_HAVE_RECVMMSG
+		memset(&m_recvHeaders[0], 0, sizeof(struct mmsghdr)*batchSize);
+		memset(&m_sendHeaders[0], 0, sizeof(struct mmsghdr)*batchSize);
+
+		for (int i = 0 ; i < batchSize ; i++)
+		{
+			m_recvHeaders[i].msg_hdr.msg_name = &m_recvAddresses[i];
+			m_recvHeaders[i].msg_hdr.msg_iov = &m_recvIOVecs[i];
+			m_recvHeaders[i].msg_hdr.msg_iovlen = 1;
+
+			m_sendHeaders[i].msg_hdr.msg_name = &m_sendAddresses[i];
+			m_sendHeaders[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+			m_sendHeaders[i].msg_hdr.msg_iov = &m_sendIOVec;
+			m_sendHeaders[i].msg_hdr.msg_iovlen = 1;
+		}
+#endif // MIPCONFIG_HAVE_RECVMMSG
+	}
+
+	std::vector<uint8_t> m_recvBuffer;
+	std::vector<struct sockaddr_in> m_recvAddresses;
+	std::vector<struct iovec> m_recvIOVecs;
+	std::vector<struct sockaddr_in> m_sendAddresses;
+	struct iovec m_sendIOVec;
+#ifdef MIPCONFIG_HAVE_RECVMMSG
+	std::vector<struct mmsghdr> m_recvHeaders;
+	std::vector<struct mmsghdr> m_sendHeaders;
+#endif // MIPCONFIG_HAVE_RECVMMSG
+};
+
+MIPUDPBatchTransport::MIPUDPBatchTransport()
+{
+	int status;
+	
+	if ((status = m_sendMutex.Init()) < 0)
+	{
+		std::cerr << "Error: can't initialize batch transport mutex (JMutex error code " << status << ")" << std::endl;
+		exit(-1);
+	}
+
+	m_rtpSock = -1;
+	m_rtcpSock = -1;
+	m_portBase = 0;
+	m_bindIP = 0;
+	m_batchSize = 0;
+	m_maxPacketSize = 0;
+	m_pInjecter = 0;
+	m_pBatchData = 0;
+	m_init = false;
+}
+
+MIPUDPBatchTransport::~MIPUDPBatchTransport()
+{
+	destroy();
+}
+
+bool MIPUDPBatchTransport::init(uint16_t portBase, uint32_t bindIP, int batchSize, int maxPacketSize)
+{
+	if (m_init)
+	{
+		setErrorString(MIPUDPBATCHTRANSPORT_ERRSTR_ALREADYINIT);
+		return false;
+	}
+
+	if (portBase%2 != 0)
+	{
+		setErrorString(MIPUDPBATCHTRANSPORT_ERRSTR_PORTBASENOTEVEN);
+		return false;
+	}
+
+	if (batchSize < 1)
+	{
+		setErrorString(MIPUDPBATCHTRANSPORT_ERRSTR_BADBATCHSIZE);
+		return false;
+	}
+
+	if (maxPacketSize < MIPUDPBATCHTRANSPORT_MINPACKETSIZE)
+	{
+		setErrorString(MIPUDPBATCHTRANSPORT_ERRSTR_BADMAXPACKETSIZE);
+		return false;
+	}
+
+	if (!openSocket(bindIP, portBase, &m_rtpSock))
+		return false;
+
+	if (!openSocket(bindIP, portBase+1, &m_rtcpSock))
+	{
+		closeSockets();
+		return false;
+	}
+
+	m_portBase = portBase;
+	m_bindIP = bindIP;
+	m_batchSize = batchSize;
+	m_maxPacketSize = maxPacketSize;
+	m_pBatchData = new BatchData(batchSize, maxPacketSize);
+	findLocalIPs();
+	
+	m_init = true;
+	return true;
+}
+
+bool MIPUDPBatchTransport::destroy()
+{
+	if (!m_init)
+	{
+		setErrorString(MIPUDPBATCHTRANSPORT_ERRSTR_NOTINIT);
+		return false;
+	}
+
+	closeSockets();
+	delete m_pBatchData;
+	m_pBatchData = 0;
+	m_pInjecter = 0;
+	m_localIPs.clear();
+	clearDestinations();
+	m_init = false;
+	return true;
+}
+
+bool MIPUDPBatchTransport::addDestination(uint32_t ip, uint16_t portBase)
+{
+	JMutexAutoLock autoLock(m_sendMutex);
+
+	for (size_t i = 0 ; i < m_destinations.size() ; i++)
+	{
+		if (m_destinations[i].first == ip && m_destinations[i].second == portBase)
+		{
+			setErrorString(MIPUDPBATCHTRANSPORT_ERRSTR_DESTINATIONEXISTS);
+			return false;
+		}
+	}
+	m_destinations.push_back(std::pair<uint32_t, uint16_t>(ip, portBase));
+	return true;
+}
+
+bool MIPUDPBatchTransport::deleteDestination(uint32_t ip, uint16_t portBase)
+{
+	JMutexAutoLock autoLock(m_sendMutex);
+
+	for (size_t i = 0 ; i < m_destinations.size() ; i++)
+	{
+		if (m_destinations[i].first == ip && m_destinations[i].second == portBase)
+		{
+			m_destinations.erase(m_destinations.begin() + i);
+			return true;
+		}
+	}
+	setErrorString(MIPUDPBATCHTRANSPORT_ERRSTR_DESTINATIONNOTFOUND);
+	return false;
+}
+
+void MIPUDPBatchTransport::clearDestinations()
+{
+	JMutexAutoLock autoLock(m_sendMutex);
+
+	m_destinations.clear();
+}
+
+int MIPUDPBatchTransport::receivePackets()
+{
+	if (!m_init)
+	{
+		setErrorString(MIPUDPBATCHTRANSPORT_ERRSTR_NOTINIT);
+		return -1;
+	}
+
+	int numRTP = drainSocket(m_rtpSock, true);
+	if (numRTP < 0)
+		return -1;
+
+	int numRTCP = drainSocket(m_rtcpSock, false);
+	if (numRTCP < 0)
+		return -1;
+
+	return numRTP + numRTCP;
+}
+
+bool MIPUDPBatchTransport::SendRTP(const void *data, size_t len)
+{
+	if (!m_init)
+		return false;
+	return sendToDestinations(m_rtpSock, data, len, true);
+}
+
+bool MIPUDPBatchTransport::SendRTCP(const void *data, size_t len)
+{
+	if (!m_init)
+		return false;
+	return sendToDestinations(m_rtcpSock, data, len, false);
+}
+
+bool MIPUDPBatchTransport::ComesFromThisSender(const RTPAddress *a)
+{
+	if (!m_init || a == 0 || a->GetAddressType() != RTPAddress::IPv4Address)
+		return false;
+
+	const RTPIPv4Address *pAddr = (const RTPIPv4Address *)a;
+
+	if (!(pAddr->GetPort() == m_portBase || pAddr->GetPort() == m_portBase+1))
+		return false;
+
+	for (size_t i = 0 ; i < m_localIPs.size() ; i++)
+	{
+		if (m_localIPs[i] == pAddr->GetIP())
+			return true;
+	}
+	return false;
+}
+
+bool MIPUDPBatchTransport::openSocket(uint32_t ip, uint16_t port, int *pSock)
+{
+	int sock = socket(AF_INET, SOCK_DGRAM, 0);
+
+	if (sock < 0)
+	{
+		setErrorString(std::string(MIPUDPBATCHTRANSPORT_ERRSTR_CANTCREATESOCKET) + strerror(errno));
+		return false;
+	}
+
+	struct sockaddr_in addr;
+
+	memset(&addr, 0, sizeof(struct sockaddr_in));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	addr.sin_addr.s_addr = htonl(ip);
+
+	if (bind(sock, (struct sockaddr *)&addr, sizeof(struct sockaddr_in)) != 0)
+	{
+		setErrorString(std::string(MIPUDPBATCHTRANSPORT_ERRSTR_CANTBINDSOCKET) + strerror(errno));
+		close(sock);
+		return false;
+	}
+
+	*pSock = sock;
+	return true;
+}
+
+void MIPUDPBatchTransport::closeSockets()
+{
+	if (m_rtpSock >= 0)
+		close(m_rtpSock);
+	if (m_rtcpSock >= 0)
+		close(m_rtcpSock);
+	m_rtpSock = -1;
+	m_rtcpSock = -1;
+}
+
+void MIPUDPBatchTransport::findLocalIPs()
+{
+	m_localIPs.clear();
+	m_localIPs.push_back(0x7F000001); // 127.0.0.1
+
+	if (m_bindIP != 0)
+	{
+		m_localIPs.push_back(m_bindIP);
+		return;
+	}
+
+	struct ifaddrs *pAddrs = 0;
+
+	if (getifaddrs(&pAddrs) != 0)
+		return;
+
+	for (struct ifaddrs *pCur = pAddrs ; pCur != 0 ; pCur = pCur->ifa_next)
+	{
+		if (pCur->ifa_addr != 0 && pCur->ifa_addr->sa_family == AF_INET)
+			m_localIPs.push_back(ntohl(((struct sockaddr_in *)pCur->ifa_addr)->sin_addr.s_addr));
+	}
+	freeifaddrs(pAddrs);
+}
+
+int MIPUDPBatchTransport::drainSocket(int sock, bool rtp)
+{
+	BatchData &d = *m_pBatchData;
+	int total = 0;
+	bool done = false;
+
+	while (!done)
+	{
+		int num;
+
+#ifdef MIPCONFIG_HAVE_RECVMMSG
+		for (int i = 0 ; i < m_batchSize ; i++)
+		{
+			d.m_recvHeaders[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+			d.m_recvHeaders[i].msg_hdr.msg_flags = 0;
+		}
+
+		num = recvmmsg(sock, &d.m_recvHeaders[0], m_batchSize, MSG_DONTWAIT, 0);
+#else
+		socklen_t addrLen = sizeof(struct sockaddr_in);
+		ssize_t len = recvfrom(sock, d.m_recvIOVecs[0].iov_base, d.m_recvIOVecs[0].iov_len, MSG_DONTWAIT,
+		                       (struct sockaddr *)&d.m_recvAddresses[0], &addrLen);
+		num = (len < 0)?-1:1;
+#endif // MIPCONFIG_HAVE_RECVMMSG
+
+		if (num < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+
+			setErrorString(std::string(MIPUDPBATCHTRANSPORT_ERRSTR_CANTRECEIVE) + strerror(errno));
+			return -1;
+		}
+
+		for (int i = 0 ; i < num ; i++)
+		{
+#ifdef MIPCONFIG_HAVE_RECVMMSG
+			size_t packetLength = d.m_recvHeaders[i].msg_len;
+#else
+			size_t packetLength = (size_t)len;
+#endif // MIPCONFIG_HAVE_RECVMMSG
+
+			if (packetLength > (size_t)m_maxPacketSize || m_pInjecter == 0)
+				continue;
+
+			const struct sockaddr_in &srcAddr = d.m_recvAddresses[i];
+			RTPIPv4Address addr(ntohl(srcAddr.sin_addr.s_addr), ntohs(srcAddr.sin_port));
+
+			if (rtp)
+				m_pInjecter->InjectRTP(d.m_recvIOVecs[i].iov_base, packetLength, addr);
+			else
+				m_pInjecter->InjectRTCP(d.m_recvIOVecs[i].iov_base, packetLength, addr);
+		}
+		total += num;
+
+#ifdef MIPCONFIG_HAVE_RECVMMSG
+		// A batch that isn't full means the socket has been drained
+		if (num < m_batchSize)
+			done = true;
+#endif // MIPCONFIG_HAVE_RECVMMSG
+	}
+	return total;
+}
+
+bool MIPUDPBatchTransport::sendToDestinations(int sock, const void *pData, size_t len, bool rtp)
+{
+	JMutexAutoLock autoLock(m_sendMutex);
+	BatchData &d = *m_pBatchData;
+	size_t numDest = m_destinations.size();
+	size_t pos = 0;
+
+	// As with the UDP transmitters in JRTPLIB, an error for a specific destination
+	// is ignored, it shouldn't prevent the packet from being sent to the others.
+
+	d.m_sendIOVec.iov_base = (void *)pData;
+	d.m_sendIOVec.iov_len = len;
+
+	while (pos < numDest)
+	{
+		size_t num = numDest - pos;
+
+		if (num > (size_t)m_batchSize)
+			num = (size_t)m_batchSize;
+
+		for (size_t i = 0 ; i < num ; i++)
+		{
+			struct sockaddr_in &addr = d.m_sendAddresses[i];
+
+			addr.sin_family = AF_INET;
+			addr.sin_addr.s_addr = htonl(m_destinations[pos+i].first);
+			addr.sin_port = htons(rtp?m_destinations[pos+i].second:(m_destinations[pos+i].second+1));
+		}
+
+#ifdef MIPCONFIG_HAVE_RECVMMSG
+		int sent = sendmmsg(sock, &d.m_sendHeaders[0], num, 0);
+
+		if (sent < 0 && errno == EINTR)
+			continue;
+		if (sent <= 0) // the first message could not be sent, skip it
+			sent = 1;
+		pos += (size_t)sent;
+#else
+		for (size_t i = 0 ; i < num ; i++)
+			sendto(sock, pData, len, 0, (struct sockaddr *)&d.m_sendAddresses[i], sizeof(struct sockaddr_in));
+		pos += num;
+#endif // MIPCONFIG_HAVE_RECVMMSG
+	}
+	return true;
+}
+
+#endif // !(WIN32 || _WIN32_WCE)
+
@@ -0,0 +1,147 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+/**
+ * \file mipudpbatchtransport.h
+ */
+
+#ifndef MIPUDPBATCHTRANSPORT_H
+
+#define MIPUDPBATCHTRANSPORT_H
+
+#include "mipconfig.h"
+
+#if !(defined(WIN32) || defined(_WIN32_WCE))
+
+#include "miperrorbase.h"
+#include "miptypes.h"
+#include <jrtplib3/rtpexternaltransmitter.h>
+#include <jthread/jmutex.h>
+#include <vector>
+
+#define MIPUDPBATCHTRANSPORT_DEFAULTBATCHSIZE				32
+#define MIPUDPBATCHTRANSPORT_DEFAULTMAXPACKETSIZE			2048
+
+/** An IPv4 UDP transport for an RTPSession which sends and receives packets in batches.
+ *  This class opens an RTP and an RTCP socket and can be used as the sender of a \c JRTPLIB 
+ *  session that was created with the \c RTPTransmitter::ExternalProto transmission protocol.
+ *  Instead of using one system call per packet, incoming packets are read in batches using 
+ *  \c recvmmsg and an outgoing packet is sent to all destinations with a single \c sendmmsg
+ *  call (on systems where these calls are not available, a loop of \c recvfrom and \c sendto
+ *  calls is used). This considerably reduces the overhead when a lot of streams are handled.
+ *
+ *  The session can be set up as follows:
+ *  \code
+ *  MIPUDPBatchTransport transport;
+ *  transport.init(portBase);
+ *  RTPExternalTransmissionParams transParams(&transport, 28); // IP + UDP header size
+ *  session.Create(sessParams, &transParams, RTPTransmitter::ExternalProto);
+ *  RTPExternalTransmissionInfo *pInfo = (RTPExternalTransmissionInfo *)session.GetTransmissionInfo();
+ *  transport.setPacketInjecter(pInfo->GetPacketInjector());
+ *  session.DeleteTransmissionInfo(pInfo);
+ *  \endcode
+ *  Destinations must be added to this object instead of to the session. Incoming packets
+ *  are only read when MIPUDPBatchTransport::receivePackets is called; when the transport is
+ *  passed to MIPRTPComponent::setUDPBatchTransport, the RTP component does this at the start
+ *  of each iteration of its chain.
+ */
+class EMIPLIB_IMPORTEXPORT MIPUDPBatchTransport : public jrtplib::RTPExternalSender, public MIPErrorBase
+{
+public:
+	MIPUDPBatchTransport();
+	~MIPUDPBatchTransport();
+
+	/** Opens the sockets.
+	 *  Opens the sockets.
+	 *  \param portBase The RTP socket is bound to this port, the RTCP socket to the next one.
+	 *                  Must be an even number.
+	 *  \param bindIP The IP address (in host byte order) to bind the sockets to; by default
+	 *                all interfaces are used.
+	 *  \param batchSize The maximum number of packets that are read or sent in one system call.
+	 *  \param maxPacketSize Incoming packets that are larger than this are discarded.
+	 */
+	bool init(uint16_t portBase, uint32_t bindIP = 0, int batchSize = MIPUDPBATCHTRANSPORT_DEFAULTBATCHSIZE,
+	          int maxPacketSize = MIPUDPBATCHTRANSPORT_DEFAULTMAXPACKETSIZE);
+
+	/** Closes the sockets; the session which uses this transport must already be destroyed. */
+	bool destroy();
+
+	/** Sets the object through which received packets are passed to the RTPSession. */
+	void setPacketInjecter(jrtplib::RTPExternalPacketInjecter *pInjecter)			{ m_pInjecter = pInjecter; }
+
+	/** Adds a destination to which the RTP and RTCP packets should be sent.
+	 *  Adds a destination to which the RTP and RTCP packets should be sent.
+	 *  \param ip The IP address of the destination, in host byte order.
+	 *  \param portBase RTP packets are sent to this port, RTCP packets to the next one.
+	 */
+	bool addDestination(uint32_t ip, uint16_t portBase);
+
+	/** Removes a destination that was added using MIPUDPBatchTransport::addDestination. */
+	bool deleteDestination(uint32_t ip, uint16_t portBase);
+
+	/** Removes all destinations. */
+	void clearDestinations();
+
+	/** Reads all packets that are waiting on the sockets and passes them to the RTPSession.
+	 *  Reads all packets that are waiting on the sockets and passes them to the RTPSession,
+	 *  without blocking. 
+	 *  \return The number of packets that were received, or -1 on error.
+	 */
+	int receivePackets();
+
+	/** Returns the socket descriptor of the RTP socket, e.g. to wait for incoming data. */
+	int getRTPSocket() const								{ return m_rtpSock; }
+
+	/** Returns the socket descriptor of the RTCP socket. */
+	int getRTCPSocket() const								{ return m_rtcpSock; }
+
+	bool SendRTP(const void *data, size_t len);
+	bool SendRTCP(const void *data, size_t len);
+	bool ComesFromThisSender(const jrtplib::RTPAddress *a);
+private:
+	class BatchData;
+
+	bool openSocket(uint32_t ip, uint16_t port, int *pSock);
+	void closeSockets();
+	void findLocalIPs();
+	int drainSocket(int sock, bool rtp);
+	bool sendToDestinations(int sock, const void *pData, size_t len, bool rtp);
+
+	int m_rtpSock, m_rtcpSock;
+	uint16_t m_portBase;
+	uint32_t m_bindIP;
+	int m_batchSize;
+	int m_maxPacketSize;
+	jrtplib::RTPExternalPacketInjecter *m_pInjecter;
+	BatchData *m_pBatchData;
+	std::vector<uint32_t> m_localIPs;
+	std::vector<std::pair<uint32_t, uint16_t> > m_destinations;
+	jthread::JMutex m_sendMutex;
+	bool m_init;
+};
+
+#endif // !(WIN32 || _WIN32_WCE)
+
+#endif // MIPUDPBATCHTRANSPORT_H
+
@@ -24,6 +24,28 @@
 
 #include "mipconfig.h"
 #include "mipwavreader.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <string.h>
+#include <mutex>
+#include <unordered_map>
+#if !(defined(WIN32) || defined(_WIN32_WCE))
+	#include <sys/mman.h>
+	#include <unistd.h>
+	#include <thread>
+	#include <condition_variable>
+	#include <deque>
+	#define MIPWAVREADER_MMAP
+#endif // !(WIN32 || _WIN32_WCE)
+#ifndef MIPCONFIG_BIGENDIAN
+	#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		#include <emmintrin.h>
+		#define MIPWAVREADER_SSE2
+	#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+		#include <arm_neon.h>
+		#define MIPWAVREADER_NEON
+	#endif
+#endif // !MIPCONFIG_BIGENDIAN
 
 #include "mipdebug.h"
 
@@ -37,6 +59,7 @@
 #define MIPWAVREADER_ERRSTR_CANTREADWAVEID			"Can't read WAVE ID"
 #define MIPWAVREADER_ERRSTR_RIFFCHUNKSIZETOOSMALL		"RIFF chunk size too small"
 #define MIPWAVREADER_ERRSTR_NOFORMATCHUNKFOUND			"No format chunk found"
+#define MIPWAVREADER_ERRSTR_NODATACHUNKFOUND			"No data chunk found"
 #define MIPWAVREADER_ERRSTR_CANTREADCHUNKID			"Can't read chunk ID"
 #define MIPWAVREADER_ERRSTR_CANTREADCHUNKSIZE			"Can't read chunk size"
 #define MIPWAVREADER_ERRSTR_CANTREADFORMATDATA			"Can't read format data"
@@ -50,10 +73,284 @@
 #define MIPWAVREADER_ERRSTR_UNEXPECTEDEOF			"Couldn't read as much data as expected"
 
 #define MIPWAVREADER_FRAMEBUFSIZE				4096
+#define MIPWAVREADER_PREFETCHCHUNK				(256*1024)
+#define MIPWAVREADER_PREFETCHAHEAD				(2*1024*1024)
+#define MIPWAVREADER_MAXPREFETCHREQUESTS			256
+
+// Holds the sample data of a file which is either mapped into memory or
+// was loaded into the cache. The data can be shared by several readers.
+class MIPWAVReaderData
+{
+public:
+	MIPWAVReaderData(uint8_t *pSamples, size_t length)
+	{
+		m_pSamples = pSamples;
+		m_length = length;
+		m_pMapping = 0;
+		m_mappingLength = 0;
+	}
+
+#ifdef MIPWAVREADER_MMAP
+	MIPWAVReaderData(void *pMapping, size_t mappingLength, size_t dataOffset, size_t length)
+	{
+		m_pMapping = pMapping;
+		m_mappingLength = mappingLength;
+		m_pSamples = ((uint8_t *)pMapping) + dataOffset;
+		m_length = length;
+
+		madvise(m_pMapping, m_mappingLength, MADV_SEQUENTIAL);
+	}
+#endif // MIPWAVREADER_MMAP
+
+	~MIPWAVReaderData()
+	{
+#ifdef MIPWAVREADER_MMAP
+		if (m_pMapping)
+		{
+			munmap(m_pMapping, m_mappingLength);
+			return;
+		}
+#endif // MIPWAVREADER_MMAP
+		delete [] m_pSamples;
+	}
+
+	const uint8_t *getSamples() const							{ return m_pSamples; }
+	size_t getLength() const								{ return m_length; }
+
+	// Makes sure that the specified part of a mapped file is resident, by touching
+	// each of its pages
+	void prefetch(size_t offset, size_t length) const
+	{
+#ifdef MIPWAVREADER_MMAP
+		if (m_pMapping == 0 || offset >= m_length)
+			return;
+		if (length > m_length - offset)
+			length = m_length - offset;
+
+		size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+		size_t start = (size_t)(m_pSamples - (const uint8_t *)m_pMapping) + offset;
+		size_t end = start + length;
+		const volatile uint8_t *pMapping = (const volatile uint8_t *)m_pMapping;
+		uint8_t sum = 0;
+
+		start -= start % pageSize;
+		madvise((uint8_t *)m_pMapping + start, end - start, MADV_WILLNEED);
+		for (size_t pos = start ; pos < end ; pos += pageSize)
+			sum += pMapping[pos];
+		(void)sum;
+#endif // MIPWAVREADER_MMAP
+	}
+private:
+	uint8_t *m_pSamples;
+	size_t m_length;
+	void *m_pMapping;
+	size_t m_mappingLength;
+};
+
+#ifdef MIPWAVREADER_MMAP
+
+// Pages in parts of mapped files on a background thread, so that the thread which
+// reads the frames doesn't block on disk access. A single thread is shared by all
+// readers.
+class MIPWAVPrefetcher
+{
+public:
+	static MIPWAVPrefetcher &instance()
+	{
+		static MIPWAVPrefetcher prefetcher;
+		return prefetcher;
+	}
+
+	void request(const std::shared_ptr<MIPWAVReaderData> &data, size_t offset, size_t length)
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+
+		// Prefetching is only a hint, so a request can be dropped if we can't keep up
+		if (m_requests.size() >= MIPWAVREADER_MAXPREFETCHREQUESTS)
+			return;
+
+		m_requests.push_back(Request(data, offset, length));
+		m_condition.notify_one();
+	}
+private:
+	class Request
+	{
+	public:
+		Request(const std::shared_ptr<MIPWAVReaderData> &data, size_t offset, size_t length) : m_data(data), m_offset(offset), m_length(length) { }
+
+		std::shared_ptr<MIPWAVReaderData> m_data;
+		size_t m_offset;
+		size_t m_length;
+	};
+
+	MIPWAVPrefetcher() : m_stop(false)
+	{
+		m_thread = std::thread(&MIPWAVPrefetcher::run, this);
+	}
+
+	~MIPWAVPrefetcher()
+	{
+		{
+			std::lock_guard<std::mutex> guard(m_mutex);
+			m_stop = true;
+		}
+		m_condition.notify_one();
+		m_thread.join();
+	}
+
+	void run()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		while (true)
+		{
+			m_condition.wait(lock, [this] { return m_stop || !m_requests.empty(); });
+			if (m_stop)
+				return;
+
+			Request r = m_requests.front();
+			m_requests.pop_front();
+
+			lock.unlock();
+			r.m_data->prefetch(r.m_offset, r.m_length);
+			r.m_data.reset(); // may unmap the file, don't do this while holding the lock
+			lock.lock();
+		}
+	}
+
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	std::deque<Request> m_requests;
+	bool m_stop;
+	std::thread m_thread;
+};
+
+#endif // MIPWAVREADER_MMAP
+
+// An entry in the process wide cache, which also stores the format of the file
+// so that it doesn't need to be parsed again
+class MIPWAVCacheEntry
+{
+public:
+	std::shared_ptr<MIPWAVReaderData> m_data;
+	int m_samplingRate;
+	int m_channels;
+	int m_bytesPerSample;
+	int64_t m_totalFrames;
+	int64_t m_fileSize;
+	time_t m_modTime;
+};
+
+static std::mutex &getCacheMutex()
+{
+	static std::mutex cacheMutex;
+	return cacheMutex;
+}
+
+static std::unordered_map<std::string, MIPWAVCacheEntry> &getCache()
+{
+	static std::unordered_map<std::string, MIPWAVCacheEntry> cache;
+	return cache;
+}
+
+// Converts 'num' little endian samples to floating point values
+static inline void convertToFloat(float *pDst, const uint8_t *pSrc, size_t num, int bytesPerSample, float scale, uint32_t negStartVal)
+{
+	size_t i = 0;
+
+	if (bytesPerSample == 1)
+	{
+		for ( ; i < num ; i++)
+			pDst[i] = ((float)(pSrc[i])-128.0f)*scale;
+	}
+	else if (bytesPerSample == 2)
+	{
+#if defined(MIPWAVREADER_SSE2)
+		__m128 s = _mm_set1_ps(scale);
+
+		for ( ; i + 8 <= num ; i += 8)
+		{
+			__m128i x = _mm_loadu_si128((const __m128i *)(pSrc + i*2));
+			// sign extend by placing each sample in the upper half and shifting back
+			__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+			__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+
+			_mm_storeu_ps(pDst + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), s));
+			_mm_storeu_ps(pDst + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), s));
+		}
+#elif defined(MIPWAVREADER_NEON)
+		float32x4_t s = vdupq_n_f32(scale);
+
+		for ( ; i + 8 <= num ; i += 8)
+		{
+			int16x8_t x = vreinterpretq_s16_u8(vld1q_u8(pSrc + i*2));
+
+			vst1q_f32(pDst + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), s));
+			vst1q_f32(pDst + i + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), s));
+		}
+#endif
+		for ( ; i < num ; i++)
+		{
+			uint16_t x = (uint16_t)pSrc[i*2] | (((uint16_t)pSrc[i*2+1]) << 8);
+
+			pDst[i] = ((float)(*((int16_t *)(&x))))*scale;
+		}
+	}
+	else
+	{
+		for ( ; i < num ; i++, pSrc += bytesPerSample)
+		{
+			uint32_t x = 0;
+
+			if ((pSrc[bytesPerSample - 1] & 0x80) == 0x80)
+				x = negStartVal;
+
+			int shiftNum = 0;
+			for (int k = 0 ; k < bytesPerSample ; k++, shiftNum += 8)
+				x |= ((uint32_t)(pSrc[k])) << shiftNum;
+
+			int32_t y = *((int32_t *)(&x));
+
+			pDst[i] = ((float)y)*scale;
+		}
+	}
+}
+
+// Converts 'num' little endian samples to 16 bit native samples
+static inline void convertToInt16(int16_t *pDst, const uint8_t *pSrc, size_t num, int bytesPerSample)
+{
+	if (bytesPerSample == 1)
+	{
+		for (size_t i = 0 ; i < num ; i++)
+			pDst[i] = (int16_t)((((int)pSrc[i])-128)*256);
+		return;
+	}
+
+#ifndef MIPCONFIG_BIGENDIAN
+	if (bytesPerSample == 2)
+	{
+		memcpy(pDst, pSrc, num*sizeof(int16_t));
+		return;
+	}
+#endif // !MIPCONFIG_BIGENDIAN
+
+	// For 24 and 32 bit samples, the two most significant bytes are used
+	pSrc += bytesPerSample - 2;
+	for (size_t i = 0 ; i < num ; i++, pSrc += bytesPerSample)
+	{
+		uint16_t x = (uint16_t)pSrc[0] | (((uint16_t)pSrc[1]) << 8);
+
+		pDst[i] = *((int16_t *)(&x));
+	}
+}
 
 MIPWAVReader::MIPWAVReader()
 {
+	m_isOpen = false;
 	m_file = 0;
+	m_pFrameBuffer = 0;
+	m_prefetch = false;
+	m_prefetchPos = 0;
 }
 
 MIPWAVReader::~MIPWAVReader()
@@ -61,16 +358,46 @@ MIPWAVReader::~MIPWAVReader()
 	close();
 }
 
-bool MIPWAVReader::open(const std::string &fileName)
+bool MIPWAVReader::open(const std::string &fileName, bool useCache)
 {
-	if (m_file != 0)
+	if (m_isOpen)
 	{
 		setErrorString(MIPWAVREADER_ERRSTR_ALREADYOPEN);
 		return false;
 	}
 
+	struct stat fileInfo;
+
+	if (useCache)
+	{
+		if (stat(fileName.c_str(), &fileInfo) != 0)
+			useCache = false; // let the code below report the error
+		else
+		{
+			std::lock_guard<std::mutex> guard(getCacheMutex());
+			auto it = getCache().find(fileName);
+
+			if (it != getCache().end() && it->second.m_fileSize == (int64_t)fileInfo.st_size && it->second.m_modTime == fileInfo.st_mtime)
+			{
+				const MIPWAVCacheEntry &entry = it->second;
+
+				m_samplingRate = entry.m_samplingRate;
+				m_channels = entry.m_channels;
+				m_totalFrames = entry.m_totalFrames;
+				m_framesLeft = m_totalFrames;
+				m_dataStartPos = 0;
+				setSampleFormat(entry.m_bytesPerSample);
+				m_pData = entry.m_data;
+				m_prefetch = false;
+				m_isOpen = true;
+				return true;
+			}
+		}
+	}
+
 	FILE *f;
 
+
 #if (defined(WIN32) && (!defined(_WIN32_WCE))) && (defined(_MSC_VER) && _MSC_VER >= 1400)
 	if (fopen_s(&f, fileName.c_str(), "rb") != 0)
 #else
@@ -217,7 +544,6 @@ bool MIPWAVReader::open(const std::string &fileName)
 			}
 
 			m_bytesPerSample = bitsPerSample/8;
-			m_scale = (float)(2.0/((float)(((uint64_t)1) << bitsPerSample)));
 
 			if (fseek(f,(long)(chunkSize-16),SEEK_CUR) == -1)
 			{
@@ -265,7 +591,23 @@ bool MIPWAVReader::open(const std::string &fileName)
 		setErrorString(MIPWAVREADER_ERRSTR_NOFORMATCHUNKFOUND);
 		return false;
 	}
-	
+
+	if (dataChunkSize < 0)
+	{
+		fclose(f);
+		setErrorString(MIPWAVREADER_ERRSTR_NODATACHUNKFOUND);
+		return false;
+	}
+
+	if (fseek(f, 0, SEEK_END) == -1)
+	{
+		fclose(f);
+		setErrorString(MIPWAVREADER_ERRSTR_CANTSEEK);
+		return false;
+	}
+
+	int64_t fileSize = (int64_t)ftell(f);
+
 	if (fseek(f,m_dataStartPos,SEEK_SET) == -1)
 	{
 		fclose(f);
@@ -273,7 +615,7 @@ bool MIPWAVReader::open(const std::string &fileName)
 		return false;
 	}
 
-	m_frameSize = m_bytesPerSample*m_channels;
+	setSampleFormat(m_bytesPerSample);
 
 	if ((dataChunkSize % m_frameSize) != 0)
 	{
@@ -282,10 +624,86 @@ bool MIPWAVReader::open(const std::string &fileName)
 		return false;
 	}
 
+	// Only use the frames which are actually present in a truncated file
+	if (m_dataStartPos + dataChunkSize > fileSize)
+		dataChunkSize = fileSize - m_dataStartPos;
+
 	m_totalFrames = dataChunkSize / m_frameSize;
 	m_framesLeft = m_totalFrames;
+	m_prefetch = false;
+	m_prefetchPos = 0;
+
+	size_t dataLength = (size_t)(m_totalFrames * m_frameSize);
+
+	if (useCache)
+	{
+		uint8_t *pSamples = new uint8_t[dataLength + 1];
+
+		if (fread(pSamples, 1, dataLength, f) != dataLength)
+		{
+			delete [] pSamples;
+			fclose(f);
+			setErrorString(MIPWAVREADER_ERRSTR_UNEXPECTEDEOF);
+			return false;
+		}
+		fclose(f);
+
+		MIPWAVCacheEntry entry;
+
+		entry.m_data = std::make_shared<MIPWAVReaderData>(pSamples, dataLength);
+		entry.m_samplingRate = m_samplingRate;
+		entry.m_channels = m_channels;
+		entry.m_bytesPerSample = m_bytesPerSample;
+		entry.m_totalFrames = m_totalFrames;
+		entry.m_fileSize = (int64_t)fileInfo.st_size;
+		entry.m_modTime = fileInfo.st_mtime;
+
+		m_pData = entry.m_data;
+
+		std::lock_guard<std::mutex> guard(getCacheMutex());
+
+		getCache()[fileName] = entry;
+		m_isOpen = true;
+		return true;
+	}
+
+#ifdef MIPWAVREADER_MMAP
+	void *pMapping = mmap(0, (size_t)fileSize, PROT_READ, MAP_SHARED, fileno(f), 0);
+
+	if (pMapping != MAP_FAILED)
+	{
+		fclose(f);
+
+		m_pData = std::make_shared<MIPWAVReaderData>(pMapping, (size_t)fileSize, (size_t)m_dataStartPos, dataLength);
+
+		// Small files are paged in right away, for larger ones the background
+		// thread stays ahead of the read position
+		if (dataLength <= MIPWAVREADER_PREFETCHAHEAD)
+			m_pData->prefetch(0, dataLength);
+		else
+		{
+			m_prefetch = true;
+			prefetch(0);
+		}
+
+		m_isOpen = true;
+		return true;
+	}
+#endif // MIPWAVREADER_MMAP
+
+	// Fall back to reading the file in blocks
 	m_pFrameBuffer = new uint8_t [m_frameSize*MIPWAVREADER_FRAMEBUFSIZE];
-	
+	m_file = f;
+	m_isOpen = true;
+	return true;
+}
+
+void MIPWAVReader::setSampleFormat(int bytesPerSample)
+{
+	m_bytesPerSample = bytesPerSample;
+	m_frameSize = m_bytesPerSample*m_channels;
+	m_scale = (float)(2.0/((float)(((uint64_t)1) << (bytesPerSample*8))));
+
 	if (m_bytesPerSample == 4)
 		m_negStartVal = 0x00000000;
 	else if (m_bytesPerSample == 3)
@@ -294,28 +712,80 @@ bool MIPWAVReader::open(const std::string &fileName)
 		m_negStartVal = 0xffff0000;
 	else
 		m_negStartVal = 0xffffff00;
-
-	m_file = f;
-	return true;
 }
 
 bool MIPWAVReader::close()
 {
-	if (m_file == 0)
+	if (!m_isOpen)
 	{
 		setErrorString(MIPWAVREADER_ERRSTR_NOTOPENED);
 		return false;
 	}
 
-	delete [] m_pFrameBuffer;
-	fclose(m_file);
-	m_file = 0;
+	if (m_file)
+	{
+		delete [] m_pFrameBuffer;
+		fclose(m_file);
+		m_pFrameBuffer = 0;
+		m_file = 0;
+	}
+	m_pData.reset();
+	m_isOpen = false;
 	return true;
 }
 
+void MIPWAVReader::flushCache()
+{
+	std::lock_guard<std::mutex> guard(getCacheMutex());
+	auto &cache = getCache();
+	auto it = cache.begin();
+
+	while (it != cache.end())
+	{
+		if (it->second.m_data.use_count() == 1) // only referenced by the cache itself
+			it = cache.erase(it);
+		else
+			++it;
+	}
+}
+
+const uint8_t *MIPWAVReader::getFrames(int &num)
+{
+	if (m_pData.get() != 0)
+	{
+		size_t pos = (size_t)(m_totalFrames - m_framesLeft)*(size_t)m_frameSize;
+
+		if (m_prefetch)
+			prefetch(pos + (size_t)num*(size_t)m_frameSize);
+
+		return m_pData->getSamples() + pos;
+	}
+
+	if (num > MIPWAVREADER_FRAMEBUFSIZE)
+		num = MIPWAVREADER_FRAMEBUFSIZE;
+
+	if ((int)fread(m_pFrameBuffer, m_frameSize, num, m_file) != num)
+		return 0;
+
+	return m_pFrameBuffer;
+}
+
+void MIPWAVReader::prefetch(size_t readPos)
+{
+#ifdef MIPWAVREADER_MMAP
+	size_t length = m_pData->getLength();
+
+	while (m_prefetchPos < length && m_prefetchPos < readPos + MIPWAVREADER_PREFETCHAHEAD)
+	{
+		MIPWAVPrefetcher::instance().request(m_pData, m_prefetchPos, MIPWAVREADER_PREFETCHCHUNK);
+		m_prefetchPos += MIPWAVREADER_PREFETCHCHUNK;
+	}
+#endif // MIPWAVREADER_MMAP
+}
+
 bool MIPWAVReader::readFrames(float *buffer, int numFrames, int *numFramesRead)
 {
-	if (m_file == 0)
+	if (!m_isOpen)
 	{
 		setErrorString(MIPWAVREADER_ERRSTR_NOTOPENED);
 		return false;
@@ -327,64 +797,31 @@ bool MIPWAVReader::readFrames(float *buffer, int numFrames, int *numFramesRead)
 	if (framesToRead > m_framesLeft)
 		framesToRead = m_framesLeft;
 	
-	int floatBufPos = 0;
-	
 	while (framesToRead > 0)
 	{
 		int num = (int)framesToRead;
-		
-		if (num > MIPWAVREADER_FRAMEBUFSIZE)
-			num = MIPWAVREADER_FRAMEBUFSIZE;
+		const uint8_t *pFrames = getFrames(num);
 
-		if ((int)fread(m_pFrameBuffer, m_frameSize, num, m_file) != num)
+		if (pFrames == 0)
 		{
 			setErrorString(MIPWAVREADER_ERRSTR_UNEXPECTEDEOF);
 			return false;
 		}
 
-		int byteBufPos = 0;
-		
-		for (int i = 0 ; i < num ; i++)
-		{
-			for (int j = 0 ; j < m_channels ; j++)
-			{
-				if (m_bytesPerSample == 1)
-				{
-					buffer[floatBufPos] = ((float)(m_pFrameBuffer[byteBufPos])-128.0f)*m_scale;
-					byteBufPos++;
-				}
-				else
-				{
-					uint32_t x = 0;
-					
-					if ((m_pFrameBuffer[byteBufPos + m_bytesPerSample - 1] & 0x80) == 0x80)
-						x = m_negStartVal;
-	
-						int shiftNum = 0;
-					for (int k = 0 ; k < m_bytesPerSample ; k++, shiftNum += 8, byteBufPos++)
-						x |= ((uint32_t)(m_pFrameBuffer[byteBufPos])) << shiftNum;
-
-					int32_t y = *((int32_t *)(&x));
+		convertToFloat(buffer + framesRead*m_channels, pFrames, (size_t)num*(size_t)m_channels, m_bytesPerSample, m_scale, m_negStartVal);
 
-					buffer[floatBufPos] = ((float)y)*m_scale;
-				}		
-				floatBufPos++;
-			}
-		}
-		
 		framesToRead -= num;
 		framesRead += num;
+		m_framesLeft -= num;
 	}
 
 	*numFramesRead = (int)framesRead;
-	m_framesLeft -= framesRead;
-	
 	return true;
 }
 
 bool MIPWAVReader::readFrames(int16_t *buffer, int numFrames, int *numFramesRead)
 {
-	if (m_file == 0)
+	if (!m_isOpen)
 	{
 		setErrorString(MIPWAVREADER_ERRSTR_NOTOPENED);
 		return false;
@@ -396,81 +833,46 @@ bool MIPWAVReader::readFrames(int16_t *buffer, int numFrames, int *numFramesRead
 	if (framesToRead > m_framesLeft)
 		framesToRead = m_framesLeft;
 	
-	int intBufPos = 0;
-	
 	while (framesToRead > 0)
 	{
 		int num = (int)framesToRead;
-		
-		if (num > MIPWAVREADER_FRAMEBUFSIZE)
-			num = MIPWAVREADER_FRAMEBUFSIZE;
+		const uint8_t *pFrames = getFrames(num);
 
-		if ((int)fread(m_pFrameBuffer, m_frameSize, num, m_file) != num)
+		if (pFrames == 0)
 		{
 			setErrorString(MIPWAVREADER_ERRSTR_UNEXPECTEDEOF);
 			return false;
 		}
 
-		int byteBufPos = 0;
-		
-		for (int i = 0 ; i < num ; i++)
-		{
-			for (int j = 0 ; j < m_channels ; j++)
-			{
-				if (m_bytesPerSample == 1)
-				{
-					buffer[intBufPos] = (((int16_t)(m_pFrameBuffer[byteBufPos])-128)<<8);
-					byteBufPos++;
-				}
-				else
-				{		
-					uint32_t x = 0;
-
-					if ((m_pFrameBuffer[byteBufPos + m_bytesPerSample - 1] & 0x80) == 0x80)
-						x = m_negStartVal;
-		
-					int shiftNum = 0;
-					for (int k = 0 ; k < m_bytesPerSample ; k++, shiftNum += 8, byteBufPos++)
-						x |= ((uint32_t)(m_pFrameBuffer[byteBufPos])) << shiftNum;
-
-					int32_t y = *((int32_t *)(&x));
-
-					if (m_bytesPerSample == 2)
-						buffer[intBufPos] = (int16_t)y;
-					else if (m_bytesPerSample == 3)
-						buffer[intBufPos] = (int16_t)(y >> 8);
-					else
-						buffer[intBufPos] = (int16_t)(y >> 16);
-				}	
-				intBufPos++;
-			}
-		}
-		
+		convertToInt16(buffer + framesRead*m_channels, pFrames, (size_t)num*(size_t)m_channels, m_bytesPerSample);
+
 		framesToRead -= num;
 		framesRead += num;
+		m_framesLeft -= num;
 	}
 
 	*numFramesRead = (int)framesRead;
-	m_framesLeft -= framesRead;
-	
 	return true;
 }
 
 bool MIPWAVReader::rewind()
 {
-	if (m_file == 0)
+	if (!m_isOpen)
 	{
 		setErrorString(MIPWAVREADER_ERRSTR_NOTOPENED);
 		return false;
 	}
 
-	if (fseek(m_file,m_dataStartPos,SEEK_SET) == -1)
+	if (m_file != 0 && fseek(m_file,m_dataStartPos,SEEK_SET) == -1)
 	{
 		setErrorString(MIPWAVREADER_ERRSTR_CANTSEEK);
 		return false;
 	}
 
 	m_framesLeft = m_totalFrames;
+	m_prefetchPos = 0;
+	if (m_prefetch)
+		prefetch(0);
 	return true;
 }
 
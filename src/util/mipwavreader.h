@@ -34,16 +34,33 @@
 #include "miperrorbase.h"
 #include "miptypes.h"
 #include <stdio.h>
-
-/** This is a simple WAV file reader. */
+#include <string>
+#include <memory>
+
+class MIPWAVReaderData;
+
+/** This is a simple WAV file reader.
+ *  This is a simple WAV file reader. Where the platform supports it, the file is mapped
+ *  into memory and the samples are converted straight from the mapping, so no intermediate
+ *  copy is needed. For large files, a background thread pages in the data ahead of the
+ *  read position, to avoid that a slow disk stalls the thread which reads the frames.
+ *  Files which are played by many readers at once, like prompts, can be kept in a
+ *  process wide cache.
+ */
 class EMIPLIB_IMPORTEXPORT MIPWAVReader : public MIPErrorBase
 {
 public:
 	MIPWAVReader();
 	~MIPWAVReader();
 
-	/** Opens the WAV file specified in \c fileName. */
-	bool open(const std::string &fileName);
+	/** Opens the WAV file specified in \c fileName.
+	 *  Opens the WAV file specified in \c fileName.
+	 *  \param fileName The name of the WAV file.
+	 *  \param useCache If \c true, the sample data is loaded into a process wide cache which
+	 *                  is shared by all readers that open the same file with this flag set.
+	 *                  The file is only read again when its size or modification time changes.
+	 */
+	bool open(const std::string &fileName, bool useCache = false);
 
 	/** Returns the sampling rate. */
 	int getSamplingRate() const									{ return m_samplingRate; }
@@ -75,8 +92,19 @@ public:
 
 	/** Closes the file. */
 	bool close();
+
+	/** Removes the cached files which are no longer used by any reader. */
+	static void flushCache();
 private:
+	void setSampleFormat(int bytesPerSample);
+	const uint8_t *getFrames(int &num);
+	void prefetch(size_t readPos);
+
+	bool m_isOpen;
 	FILE *m_file;
+	std::shared_ptr<MIPWAVReaderData> m_pData;
+	bool m_prefetch;
+	size_t m_prefetchPos;
 	int m_samplingRate;
 	int m_channels;
 	int m_frameSize;
@@ -0,0 +1,198 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+#include "mipconfig.h"
+#include "mipyuv420scaler.h"
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define MIPYUV420SCALER_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#include <arm_neon.h>
+	#define MIPYUV420SCALER_NEON
+#endif
+
+#include "mipdebug.h"
+
+MIPYUV420Scaler::MIPYUV420Scaler()
+{
+}
+
+MIPYUV420Scaler::~MIPYUV420Scaler()
+{
+}
+
+void MIPYUV420Scaler::scale(const uint8_t *pSrc, int srcWidth, int srcHeight, uint8_t *pDst, int dstWidth, int dstHeight, 
+                            int x, int y, int width, int height)
+{
+	const uint8_t *pSrcU = pSrc + srcWidth*srcHeight;
+	const uint8_t *pSrcV = pSrcU + (srcWidth/2)*(srcHeight/2);
+	uint8_t *pDstU = pDst + dstWidth*dstHeight;
+	uint8_t *pDstV = pDstU + (dstWidth/2)*(dstHeight/2);
+
+	m_lumaScaler.scale(pSrc, srcWidth, srcHeight, pDst + y*dstWidth + x, dstWidth, width, height);
+	m_chromaScaler.scale(pSrcU, srcWidth/2, srcHeight/2, pDstU + (y/2)*(dstWidth/2) + x/2, dstWidth/2, width/2, height/2);
+	m_chromaScaler.scale(pSrcV, srcWidth/2, srcHeight/2, pDstV + (y/2)*(dstWidth/2) + x/2, dstWidth/2, width/2, height/2);
+}
+
+void MIPYUV420Scaler::fill(uint8_t *pDst, int dstWidth, int dstHeight, int x, int y, int width, int height, 
+                           uint8_t Y, uint8_t U, uint8_t V)
+{
+	uint8_t *pDstU = pDst + dstWidth*dstHeight;
+	uint8_t *pDstV = pDstU + (dstWidth/2)*(dstHeight/2);
+
+	for (int j = 0 ; j < height ; j++)
+		memset(pDst + (y+j)*dstWidth + x, Y, width);
+	
+	for (int j = 0 ; j < height/2 ; j++)
+	{
+		memset(pDstU + (y/2+j)*(dstWidth/2) + x/2, U, width/2);
+		memset(pDstV + (y/2+j)*(dstWidth/2) + x/2, V, width/2);
+	}
+}
+
+void MIPYUV420Scaler::PlaneScaler::scale(const uint8_t *pSrc, int srcWidth, int srcHeight, uint8_t *pDst, int dstStride, int width, int height)
+{
+	if (srcWidth <= 0 || srcHeight <= 0 || width <= 0 || height <= 0)
+		return;
+
+	if (srcWidth == width && srcHeight == height)
+	{
+		for (int j = 0 ; j < height ; j++)
+			memcpy(pDst + j*dstStride, pSrc + j*srcWidth, width);
+		return;
+	}
+
+	if (srcWidth != m_srcWidth || width != m_width)
+	{
+		calculateTable(srcWidth, width, m_xOffsets, m_xFractions);
+		m_srcWidth = srcWidth;
+		m_width = width;
+		m_row.resize(srcWidth);
+	}
+
+	if (srcHeight != m_srcHeight || height != m_height)
+	{
+		calculateTable(srcHeight, height, m_yOffsets, m_yFractions);
+		m_srcHeight = srcHeight;
+		m_height = height;
+	}
+
+	// First the two source rows are interpolated into a temporary row, which
+	// is then interpolated horizontally into the destination
+
+	uint8_t *pRow = &(m_row[0]);
+
+	for (int j = 0 ; j < height ; j++)
+	{
+		const uint8_t *pSrcRow = pSrc + m_yOffsets[j]*srcWidth;
+		int fy = m_yFractions[j];
+		uint8_t *pDstRow = pDst + j*dstStride;
+
+		if (fy != 0)
+		{
+			interpolateRows(pSrcRow, pSrcRow + srcWidth, fy, pRow, srcWidth);
+			pSrcRow = pRow;
+		}
+
+		for (int i = 0 ; i < width ; i++)
+		{
+			int x0 = m_xOffsets[i];
+			int fx = m_xFractions[i];
+
+			if (fx == 0)
+				pDstRow[i] = pSrcRow[x0];
+			else
+				pDstRow[i] = (uint8_t)((((int)pSrcRow[x0])*(256-fx) + ((int)pSrcRow[x0+1])*fx + 128) >> 8);
+		}
+	}
+}
+
+// Calculates for each destination position the source position to its left 
+// or top, and the weight (out of 256) of the next source value. The pixel
+// centers of source and destination are aligned.
+void MIPYUV420Scaler::PlaneScaler::calculateTable(int srcSize, int size, std::vector<int> &offsets, std::vector<int> &fractions)
+{
+	offsets.resize(size);
+	fractions.resize(size);
+
+	for (int i = 0 ; i < size ; i++)
+	{
+		int64_t pos = ((int64_t)(2*i+1)*srcSize - size)*256/(2*size);
+
+		if (pos < 0)
+			pos = 0;
+
+		int offset = (int)(pos >> 8);
+		int fraction = (int)(pos & 255);
+
+		if (offset >= srcSize - 1)
+		{
+			offset = srcSize - 1;
+			fraction = 0;
+		}
+
+		offsets[i] = offset;
+		fractions[i] = fraction;
+	}
+}
+
+void MIPYUV420Scaler::PlaneScaler::interpolateRows(const uint8_t *pRow0, const uint8_t *pRow1, int fraction, uint8_t *pDst, int num)
+{
+	int i = 0;
+
+#if defined(MIPYUV420SCALER_SSE2)
+	__m128i zero = _mm_setzero_si128();
+	__m128i w0 = _mm_set1_epi16((short)(256-fraction));
+	__m128i w1 = _mm_set1_epi16((short)fraction);
+	__m128i round = _mm_set1_epi16(128);
+
+	for ( ; i + 16 <= num ; i += 16)
+	{
+		__m128i a = _mm_loadu_si128((const __m128i *)(pRow0 + i));
+		__m128i b = _mm_loadu_si128((const __m128i *)(pRow1 + i));
+		__m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), w0), _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), w1));
+		__m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), w0), _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), w1));
+
+		lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 8);
+		hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 8);
+		_mm_storeu_si128((__m128i *)(pDst + i), _mm_packus_epi16(lo, hi));
+	}
+#elif defined(MIPYUV420SCALER_NEON)
+	uint8x8_t w0 = vdup_n_u8((uint8_t)(256-fraction));
+	uint8x8_t w1 = vdup_n_u8((uint8_t)fraction);
+
+	for ( ; i + 8 <= num ; i += 8)
+	{
+		uint16x8_t sum = vmull_u8(vld1_u8(pRow0 + i), w0);
+
+		sum = vmlal_u8(sum, vld1_u8(pRow1 + i), w1);
+		vst1_u8(pDst + i, vrshrn_n_u16(sum, 8));
+	}
+#endif 
+	for ( ; i < num ; i++)
+		pDst[i] = (uint8_t)((((int)pRow0[i])*(256-fraction) + ((int)pRow1[i])*fraction + 128) >> 8);
+}
+
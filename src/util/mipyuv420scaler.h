@@ -0,0 +1,93 @@
+/*
+    
+  This file is a part of EMIPLIB, the EDM Media over IP Library.
+  
+  Copyright (C) 2006-2016  Hasselt University - Expertise Centre for
+                      Digital Media (EDM) (http://www.edm.uhasselt.be)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  
+  USA
+
+*/
+
+/**
+ * \file mipyuv420scaler.h
+ */
+
+#ifndef MIPYUV420SCALER_H
+
+#define MIPYUV420SCALER_H
+
+#include "mipconfig.h"
+#include "miptypes.h"
+#include <vector>
+
+/** Scales YUV420P images into a rectangle of a larger YUV420P image.
+ *  This class scales YUV420P images using bilinear interpolation and writes the result
+ *  into a rectangle of another YUV420P image, which makes it suitable to compose several
+ *  video streams into one picture. The interpolation tables are kept between calls, so
+ *  that repeatedly scaling images of the same size into the same rectangle does not need
+ *  to recalculate them. If the image already has the size of the rectangle, its planes are
+ *  simply copied. The vertical interpolation uses SSE2 or NEON instructions when available.
+ *
+ *  All coordinates and sizes must be even, since the chrominance planes have half the 
+ *  resolution of the luminance plane.
+ */
+class EMIPLIB_IMPORTEXPORT MIPYUV420Scaler
+{
+public:
+	MIPYUV420Scaler();
+	~MIPYUV420Scaler();
+
+	/** Scales a YUV420P image into a rectangle of another YUV420P image.
+	 *  Scales a YUV420P image into a rectangle of another YUV420P image.
+	 *  \param pSrc The source image.
+	 *  \param srcWidth The width of the source image.
+	 *  \param srcHeight The height of the source image.
+	 *  \param pDst The destination image.
+	 *  \param dstWidth The width of the destination image.
+	 *  \param dstHeight The height of the destination image.
+	 *  \param x The horizontal position of the rectangle in the destination image.
+	 *  \param y The vertical position of the rectangle in the destination image.
+	 *  \param width The width of the rectangle.
+	 *  \param height The height of the rectangle.
+	 */
+	void scale(const uint8_t *pSrc, int srcWidth, int srcHeight, uint8_t *pDst, int dstWidth, int dstHeight, 
+	           int x, int y, int width, int height);
+
+	/** Fills a rectangle of a YUV420P image with one color. */
+	static void fill(uint8_t *pDst, int dstWidth, int dstHeight, int x, int y, int width, int height, 
+	                 uint8_t Y, uint8_t U, uint8_t V);
+private:
+	class PlaneScaler
+	{
+	public:
+		PlaneScaler()									{ m_srcWidth = -1; m_srcHeight = -1; m_width = -1; m_height = -1; }
+		void scale(const uint8_t *pSrc, int srcWidth, int srcHeight, uint8_t *pDst, int dstStride, int width, int height);
+	private:
+		static void calculateTable(int srcSize, int size, std::vector<int> &offsets, std::vector<int> &fractions);
+		static void interpolateRows(const uint8_t *pRow0, const uint8_t *pRow1, int fraction, uint8_t *pDst, int num);
+
+		int m_srcWidth, m_srcHeight, m_width, m_height;
+		std::vector<int> m_xOffsets, m_xFractions;
+		std::vector<int> m_yOffsets, m_yFractions;
+		std::vector<uint8_t> m_row;
+	};
+
+	PlaneScaler m_lumaScaler, m_chromaScaler;
+};
+
+#endif // MIPYUV420SCALER_H
+